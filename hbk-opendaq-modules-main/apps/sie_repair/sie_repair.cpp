@@ -0,0 +1,93 @@
+#include <chrono>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <advanced_recorder_module/sie/repair.h>
+
+static void usage(const char *program)
+{
+    std::cerr
+        << "Usage: " << program << " [--check] [--threads N] FILE..." << std::endl
+        << std::endl
+        << "Repairs SIE files whose recording was interrupted: truncates each file after its" << std::endl
+        << "last valid block and appends an index of the blocks not yet indexed." << std::endl
+        << std::endl
+        << "  --check      Only report the state of each file; do not modify it." << std::endl
+        << "  --threads N  Verify checksums with N threads (default: one per CPU)." << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+    bool checkOnly = false;
+    unsigned threads = 0;
+    std::vector<std::string> filenames;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+
+        if (arg == "--check")
+            checkOnly = true;
+
+        else if (arg == "--threads" && i + 1 < argc)
+            threads = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+
+        else if (arg == "--help" || arg == "-h" || (!arg.empty() && arg[0] == '-'))
+        {
+            usage(argv[0]);
+            return arg == "--help" || arg == "-h" ? 0 : 2;
+        }
+
+        else
+            filenames.push_back(arg);
+    }
+
+    if (filenames.empty())
+    {
+        usage(argv[0]);
+        return 2;
+    }
+
+    int result = 0;
+
+    for (const auto& filename : filenames)
+    {
+        try
+        {
+            auto started = std::chrono::steady_clock::now();
+            auto report = checkOnly
+                ? hbk::sie::check(filename, threads)
+                : hbk::sie::repair(filename, threads);
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - started;
+
+            std::cout << filename << ": " << report.blocks << " valid blocks, "
+                << report.valid_size << " of " << report.file_size << " bytes";
+
+            if (report.intact())
+                std::cout << ", intact";
+            else if (report.repaired)
+                std::cout << ", truncated " << report.file_size - report.valid_size
+                    << " bytes and indexed " << report.unindexed_blocks << " blocks";
+            else
+            {
+                std::cout << ", needs repair (" << report.file_size - report.valid_size
+                    << " invalid bytes, " << report.unindexed_blocks << " unindexed blocks"
+                    << (report.finished ? "" : ", no index directory") << ")";
+                result = 1;
+            }
+
+            std::cout << " in " << elapsed.count() << " s" << std::endl;
+        }
+
+        catch (const std::exception& ex)
+        {
+            std::cerr << filename << ": " << ex.what() << std::endl;
+            result = 1;
+        }
+    }
+
+    return result;
+}
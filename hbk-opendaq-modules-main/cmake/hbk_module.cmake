@@ -92,4 +92,36 @@ function(hbk_module)
 
     endif()
 
+    if(HBK_OPENDAQ_ENABLE_BENCHMARKS AND EXISTS "${CMAKE_CURRENT_SOURCE_DIR}/bench")
+
+        file(GLOB_RECURSE sources bench/*.cpp)
+
+        add_executable(bench_${MODULE_NAME} ${sources})
+
+        set_target_properties(bench_${MODULE_NAME} PROPERTIES
+            CXX_STANDARD                17
+            CXX_STANDARD_REQUIRED       ON
+            CXX_EXTENSIONS              ON
+            RUNTIME_OUTPUT_DIRECTORY    "${CMAKE_BINARY_DIR}/bin"
+        )
+
+        target_link_libraries(bench_${MODULE_NAME}
+            PRIVATE
+                daq::${MODULE_NAME}
+                benchmark::benchmark_main
+        )
+
+        # Runs the benchmarks and saves the results as JSON, so they can be compared between
+        # builds (e.g. with Google Benchmark's tools/compare.py).
+        add_custom_target(run_bench_${MODULE_NAME}
+            COMMAND             bench_${MODULE_NAME}
+                                --benchmark_out=${CMAKE_BINARY_DIR}/bench_${MODULE_NAME}.json
+                                --benchmark_out_format=json
+            DEPENDS             bench_${MODULE_NAME}
+            WORKING_DIRECTORY   "${CMAKE_BINARY_DIR}"
+            USES_TERMINAL
+        )
+
+    endif()
+
 endfunction()
@@ -0,0 +1,24 @@
+find_package(benchmark QUIET GLOBAL)
+
+if(benchmark_FOUND)
+
+    message(STATUS "Found Google Benchmark ${benchmark_VERSION} at ${benchmark_CONFIG}")
+
+else()
+
+    message(STATUS "Fetching Google Benchmark...")
+
+    set(BENCHMARK_ENABLE_TESTING        OFF CACHE BOOL "" FORCE)
+    set(BENCHMARK_ENABLE_GTEST_TESTS    OFF CACHE BOOL "" FORCE)
+    set(BENCHMARK_ENABLE_INSTALL        OFF CACHE BOOL "" FORCE)
+
+    FetchContent_Declare(benchmark
+        GIT_REPOSITORY  https://github.com/google/benchmark.git
+        GIT_TAG         v1.8.3
+        OVERRIDE_FIND_PACKAGE
+        EXCLUDE_FROM_ALL
+    )
+
+    FetchContent_MakeAvailable(benchmark)
+
+endif()
@@ -0,0 +1,99 @@
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include <advanced_recorder_module/sie/delta_codec.h>
+#include <advanced_recorder_module/sie/xor_codec.h>
+
+using namespace hbk::sie;
+
+/**
+ * Generates ADC counts: a slow sine wave with a few counts of noise.
+ */
+template <typename T>
+static std::vector<T> adcCounts(std::size_t count)
+{
+    std::mt19937 rng(12345);
+    std::vector<T> values(count);
+    for (std::size_t i = 0; i < count; ++i)
+        values[i] = static_cast<T>(1000 * std::sin(i * 1e-3) + static_cast<int>(rng() % 16));
+    return values;
+}
+
+/**
+ * Generates a slowly-varying measurement, such as a temperature, quantized by an ADC.
+ */
+template <typename T>
+static std::vector<T> slowlyVarying(std::size_t count)
+{
+    std::vector<T> values(count);
+    for (std::size_t i = 0; i < count; ++i)
+        values[i] = static_cast<T>(std::round((21.5 + 0.05 * std::sin(i * 1e-5)) * 65536) / 65536);
+    return values;
+}
+
+template <typename T>
+static void BM_DeltaEncode(benchmark::State& state)
+{
+    auto values = adcCounts<T>(state.range(0));
+    std::vector<std::uint8_t> encoded(delta_encode_bound<T>(values.size()));
+
+    for (auto _ : state)
+        benchmark::DoNotOptimize(delta_encode<T>(values.data(), values.size(), encoded.data()));
+
+    state.SetBytesProcessed(state.iterations() * values.size() * sizeof(T));
+}
+
+template <typename T>
+static void BM_DeltaDecode(benchmark::State& state)
+{
+    auto values = adcCounts<T>(state.range(0));
+    std::vector<std::uint8_t> encoded(delta_encode_bound<T>(values.size()));
+    encoded.resize(delta_encode<T>(values.data(), values.size(), encoded.data()));
+
+    for (auto _ : state)
+        benchmark::DoNotOptimize(delta_decode<T>(encoded.data(), encoded.size(), values.size(), values.data()));
+
+    state.SetBytesProcessed(state.iterations() * values.size() * sizeof(T));
+    state.counters["ratio"] = static_cast<double>(values.size() * sizeof(T)) / encoded.size();
+}
+
+template <typename T>
+static void BM_XorEncode(benchmark::State& state)
+{
+    auto values = slowlyVarying<T>(state.range(0));
+    std::vector<std::uint8_t> encoded(xor_encode_bound<T>(values.size()));
+
+    for (auto _ : state)
+        benchmark::DoNotOptimize(xor_encode<T>(values.data(), values.size(), encoded.data()));
+
+    state.SetBytesProcessed(state.iterations() * values.size() * sizeof(T));
+}
+
+template <typename T>
+static void BM_XorDecode(benchmark::State& state)
+{
+    auto values = slowlyVarying<T>(state.range(0));
+    std::vector<std::uint8_t> encoded(xor_encode_bound<T>(values.size()));
+    encoded.resize(xor_encode<T>(values.data(), values.size(), encoded.data()));
+
+    for (auto _ : state)
+        benchmark::DoNotOptimize(xor_decode<T>(encoded.data(), encoded.size(), values.size(), values.data()));
+
+    state.SetBytesProcessed(state.iterations() * values.size() * sizeof(T));
+    state.counters["ratio"] = static_cast<double>(values.size() * sizeof(T)) / encoded.size();
+}
+
+BENCHMARK(BM_DeltaEncode<std::int16_t>)->Arg(65536);
+BENCHMARK(BM_DeltaEncode<std::int32_t>)->Arg(65536);
+BENCHMARK(BM_DeltaDecode<std::int16_t>)->Arg(65536);
+BENCHMARK(BM_DeltaDecode<std::int32_t>)->Arg(65536);
+BENCHMARK(BM_DeltaDecode<std::int64_t>)->Arg(65536);
+BENCHMARK(BM_XorEncode<float>)->Arg(65536);
+BENCHMARK(BM_XorEncode<double>)->Arg(65536);
+BENCHMARK(BM_XorDecode<float>)->Arg(65536);
+BENCHMARK(BM_XorDecode<double>)->Arg(65536);
@@ -0,0 +1,72 @@
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <boost/crc.hpp>
+
+#include <advanced_recorder_module/sie/crc32.h>
+
+using namespace hbk::sie;
+
+static std::vector<std::uint8_t> randomBytes(std::size_t size)
+{
+    std::mt19937 rng(12345);
+    std::vector<std::uint8_t> bytes(size);
+    for (auto& byte : bytes)
+        byte = static_cast<std::uint8_t>(rng());
+    return bytes;
+}
+
+static void BM_Crc32Boost(benchmark::State& state)
+{
+    auto bytes = randomBytes(state.range(0));
+
+    for (auto _ : state)
+    {
+        boost::crc_32_type crc;
+        crc.process_bytes(bytes.data(), bytes.size());
+        benchmark::DoNotOptimize(crc());
+    }
+
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+
+static void BM_Crc32(benchmark::State& state)
+{
+    auto bytes = randomBytes(state.range(0));
+
+    for (auto _ : state)
+    {
+        crc32 crc;
+        crc.process_bytes(bytes.data(), bytes.size());
+        benchmark::DoNotOptimize(crc());
+    }
+
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+
+template <detail::crc32::update_function Update>
+static void BM_Crc32Implementation(benchmark::State& state)
+{
+    auto bytes = randomBytes(state.range(0));
+
+    for (auto _ : state)
+        benchmark::DoNotOptimize(Update(0xFFFFFFFFu, bytes.data(), bytes.size()));
+
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+
+BENCHMARK(BM_Crc32Boost)->RangeMultiplier(8)->Range(64, 1 << 20);
+BENCHMARK(BM_Crc32)->RangeMultiplier(8)->Range(64, 1 << 20);
+BENCHMARK_TEMPLATE(BM_Crc32Implementation, &detail::crc32::update_slice_by_16)
+    ->RangeMultiplier(8)->Range(64, 1 << 20);
+#ifdef HBK_SIE_CRC32_X86
+BENCHMARK_TEMPLATE(BM_Crc32Implementation, &detail::crc32::update_pclmul)
+    ->RangeMultiplier(8)->Range(64, 1 << 20);
+#endif
+#ifdef HBK_SIE_CRC32_ARM
+BENCHMARK_TEMPLATE(BM_Crc32Implementation, &detail::crc32::update_armv8)
+    ->RangeMultiplier(8)->Range(64, 1 << 20);
+#endif
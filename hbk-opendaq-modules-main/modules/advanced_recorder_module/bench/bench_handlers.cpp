@@ -0,0 +1,103 @@
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include <opendaq/opendaq.h>
+
+#include <advanced_recorder_module/block_pool.h>
+#include <advanced_recorder_module/handlers/scalar_linear_signal_handler.h>
+#include <advanced_recorder_module/recorder_settings.h>
+#include <advanced_recorder_module/sie/block_writer.h>
+#include <advanced_recorder_module/sie/indexed_writer.h>
+#include <advanced_recorder_module/sie/vector_io_file.h>
+#include <advanced_recorder_module/sie/writer.h>
+
+using namespace daq;
+using namespace daq::modules::advanced_recorder_module;
+
+#ifdef _WIN32
+static constexpr const char *NULL_DEVICE = "NUL";
+#else
+static constexpr const char *NULL_DEVICE = "/dev/null";
+#endif
+
+/**
+ * The number of distinct packets cycled through. Their domain offsets are contiguous, so the
+ * handler only sees a discontinuity when the cycle wraps around.
+ */
+static constexpr std::size_t PACKET_COUNT = 256;
+
+/**
+ * Drives a ScalarLinearSignalHandler, writing to the null device, with synthetic float64 packets.
+ * The arguments are the number of samples per packet and RecorderSettings::blockSize.
+ */
+static void BM_ScalarLinearHandler(benchmark::State& state)
+{
+    auto samplesPerPacket = static_cast<std::size_t>(state.range(0));
+
+    RecorderSettings settings;
+    settings.blockSize = static_cast<std::size_t>(state.range(1));
+    if (settings.blockSize)
+        settings.pool = std::make_shared<BlockPool>(settings.blockSize);
+
+    auto context = NullContext();
+    auto signal = Signal(context, nullptr, "bench");
+
+    auto domainDescriptor = DataDescriptorBuilder()
+        .setSampleType(SampleType::Int64)
+        .setUnit(Unit("s", -1, "seconds", "time"))
+        .setTickResolution(Ratio(1, 1000000))
+        .setRule(LinearDataRule(10, 0))
+        .setOrigin("1970-01-01T00:00:00Z")
+        .build();
+
+    auto valueDescriptor = DataDescriptorBuilder()
+        .setSampleType(SampleType::Float64)
+        .setRule(ExplicitDataRule())
+        .setUnit(Unit("V"))
+        .setName("bench")
+        .build();
+
+    std::vector<DataPacketPtr> packets;
+    for (std::size_t i = 0; i < PACKET_COUNT; ++i)
+    {
+        auto domainPacket = DataPacket(
+            domainDescriptor,
+            samplesPerPacket,
+            static_cast<Int>(i * samplesPerPacket * 10));
+
+        auto packet = DataPacketWithDomain(domainPacket, valueDescriptor, samplesPerPacket);
+        auto values = static_cast<double *>(packet.getRawData());
+        for (std::size_t j = 0; j < samplesPerPacket; ++j)
+            values[j] = static_cast<double>(j);
+
+        packets.push_back(packet);
+    }
+
+    hbk::sie::writer writer(
+        hbk::sie::indexed_writer(
+            hbk::sie::block_writer(
+                hbk::sie::vector_io_file(NULL_DEVICE, hbk::sie::io_backend::posix))));
+
+    ScalarLinearSignalHandler handler(writer, 0, settings, signal, valueDescriptor, domainDescriptor);
+
+    std::size_t i = 0;
+    for (auto _ : state)
+    {
+        handler.onDataPacketReceived(packets[i]);
+        if (++i == PACKET_COUNT)
+            i = 0;
+    }
+
+    handler.flush();
+
+    state.SetBytesProcessed(state.iterations() * samplesPerPacket * sizeof(double));
+    state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(BM_ScalarLinearHandler)
+    ->ArgNames({ "samples", "block_size" })
+    ->ArgsProduct({ { 1, 16, 256, 4096 }, { 0, 4096, 65536 } });
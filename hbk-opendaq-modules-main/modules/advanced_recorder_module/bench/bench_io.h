@@ -0,0 +1,112 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <vector>
+
+/**
+ * A VectorIoFile which discards everything written to it, so that benchmarks measure only the
+ * cost of the layers above the file.
+ */
+class NullVectorIoFile
+{
+    public:
+
+        template <typename ... Args>
+        void write(Args&&... args) noexcept
+        {
+            append(args...);
+        }
+
+        void flush() noexcept
+        {
+        }
+
+        std::uint64_t size() const noexcept
+        {
+            return written;
+        }
+
+    private:
+
+        void append() noexcept
+        {
+        }
+
+        template <typename ... Args>
+        void append(const void *, std::size_t size, Args... args) noexcept
+        {
+            written += size;
+            append(args...);
+        }
+
+        std::uint64_t written = 0;
+};
+
+/**
+ * A VectorIoFile which copies everything written to it into a fixed-size memory buffer, wrapping
+ * around at the end. This includes the cost of touching the data once, as a real file backend
+ * would, without any system calls.
+ */
+class MemoryVectorIoFile
+{
+    public:
+
+        explicit MemoryVectorIoFile(std::size_t capacity = 64 << 20)
+            : buffer(capacity)
+        {
+        }
+
+        template <typename ... Args>
+        void write(Args&&... args) noexcept
+        {
+            append(args...);
+        }
+
+        void flush() noexcept
+        {
+        }
+
+    private:
+
+        void append() noexcept
+        {
+        }
+
+        template <typename ... Args>
+        void append(const void *data, std::size_t size, Args... args) noexcept
+        {
+            auto bytes = static_cast<const std::uint8_t *>(data);
+
+            while (size)
+            {
+                if (position == buffer.size())
+                    position = 0;
+
+                std::size_t n = std::min(size, buffer.size() - position);
+                std::memcpy(buffer.data() + position, bytes, n);
+                position += n;
+                bytes += n;
+                size -= n;
+            }
+
+            append(args...);
+        }
+
+        std::vector<std::uint8_t> buffer;
+        std::size_t position = 0;
+};
+
+/**
+ * Generates reproducible pseudo-random bytes for use as benchmark payloads.
+ */
+inline std::vector<std::uint8_t> randomPayload(std::size_t size)
+{
+    std::mt19937 rng(12345);
+    std::vector<std::uint8_t> bytes(size);
+    for (auto& byte : bytes)
+        byte = static_cast<std::uint8_t>(rng());
+    return bytes;
+}
@@ -0,0 +1,111 @@
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <tuple>
+#include <utility>
+
+#include <benchmark/benchmark.h>
+
+#include <advanced_recorder_module/sie/basic_block_writer.h>
+#include <advanced_recorder_module/sie/basic_indexed_writer.h>
+#include <advanced_recorder_module/sie/basic_writer.h>
+
+#include "bench_io.h"
+
+using namespace hbk::sie;
+
+static constexpr std::uint32_t GROUP = 3;
+
+/**
+ * Writes a block whose payload is split into sizeof...(I) equally-sized segments.
+ */
+template <typename Writer, std::size_t ... I>
+static void writeSegments(
+    Writer& writer,
+    const std::uint8_t *data,
+    std::size_t segmentSize,
+    std::index_sequence<I...>)
+{
+    std::apply(
+        [&](auto... args) { writer.write_block(GROUP, args...); },
+        std::tuple_cat(std::make_tuple(
+            static_cast<const void *>(data + I * segmentSize),
+            segmentSize)...));
+}
+
+template <typename Writer, std::size_t Segments>
+static void runWriteBlock(benchmark::State& state, Writer& writer)
+{
+    auto size = static_cast<std::size_t>(state.range(0));
+    auto payload = randomPayload(size);
+    std::size_t segmentSize = size / Segments;
+
+    for (auto _ : state)
+        writeSegments(writer, payload.data(), segmentSize, std::make_index_sequence<Segments>());
+
+    state.SetBytesProcessed(state.iterations() * segmentSize * Segments);
+    state.SetItemsProcessed(state.iterations());
+    state.counters["segments"] = Segments;
+}
+
+template <typename VectorIoFile, std::size_t Segments>
+static void BM_BlockWriter(benchmark::State& state)
+{
+    basic_block_writer<VectorIoFile> writer { VectorIoFile() };
+    runWriteBlock<decltype(writer), Segments>(state, writer);
+}
+
+template <std::size_t Segments>
+static void BM_IndexedWriter(benchmark::State& state)
+{
+    basic_indexed_writer<basic_block_writer<NullVectorIoFile>> writer {
+        basic_block_writer<NullVectorIoFile>(NullVectorIoFile()) };
+    runWriteBlock<decltype(writer), Segments>(state, writer);
+}
+
+static void BM_IndexedWriterTimed(benchmark::State& state)
+{
+    basic_indexed_writer<basic_block_writer<NullVectorIoFile>> writer {
+        basic_block_writer<NullVectorIoFile>(NullVectorIoFile()) };
+
+    auto size = static_cast<std::size_t>(state.range(0));
+    auto payload = randomPayload(size);
+    std::int64_t tick = 0;
+
+    for (auto _ : state)
+    {
+        writer.write_timed_block(GROUP, tick, tick + 99, payload.data(), payload.size());
+        tick += 100;
+    }
+
+    state.SetBytesProcessed(state.iterations() * size);
+    state.SetItemsProcessed(state.iterations());
+}
+
+static void BM_WriterMetadata(benchmark::State& state)
+{
+    basic_writer<basic_indexed_writer<basic_block_writer<NullVectorIoFile>>> writer {
+        basic_indexed_writer<basic_block_writer<NullVectorIoFile>>(
+            basic_block_writer<NullVectorIoFile>(NullVectorIoFile())) };
+
+    std::string xml(static_cast<std::size_t>(state.range(0)), 'x');
+
+    for (auto _ : state)
+        writer.write_metadata(xml);
+
+    state.SetBytesProcessed(state.iterations() * xml.size());
+    state.SetItemsProcessed(state.iterations());
+}
+
+#define PAYLOAD_SIZES RangeMultiplier(4)->Range(64, 1 << 20)
+
+BENCHMARK_TEMPLATE(BM_BlockWriter, NullVectorIoFile, 1)->PAYLOAD_SIZES;
+BENCHMARK_TEMPLATE(BM_BlockWriter, NullVectorIoFile, 2)->PAYLOAD_SIZES;
+BENCHMARK_TEMPLATE(BM_BlockWriter, NullVectorIoFile, 8)->PAYLOAD_SIZES;
+BENCHMARK_TEMPLATE(BM_BlockWriter, MemoryVectorIoFile, 1)->PAYLOAD_SIZES;
+BENCHMARK_TEMPLATE(BM_BlockWriter, MemoryVectorIoFile, 2)->PAYLOAD_SIZES;
+BENCHMARK_TEMPLATE(BM_BlockWriter, MemoryVectorIoFile, 8)->PAYLOAD_SIZES;
+BENCHMARK_TEMPLATE(BM_IndexedWriter, 1)->PAYLOAD_SIZES;
+BENCHMARK_TEMPLATE(BM_IndexedWriter, 2)->PAYLOAD_SIZES;
+BENCHMARK(BM_IndexedWriterTimed)->PAYLOAD_SIZES;
+BENCHMARK(BM_WriterMetadata)->RangeMultiplier(8)->Range(256, 1 << 18);
@@ -0,0 +1,76 @@
+#include <cstddef>
+#include <string>
+
+#include <benchmark/benchmark.h>
+
+#include <advanced_recorder_module/sie/xml.h>
+
+using namespace hbk::sie;
+
+/**
+ * Builds the metadata for one channel, as written by ScalarLinearSignalHandler.
+ */
+static xml::element makeChannel(unsigned id)
+{
+    auto dim0 = dimension(0)
+        .add_child(transform(1e-6, 0))
+        .add_child(data(id, 0))
+        .add_child(units("s"));
+
+    auto dim1 = dimension(1)
+        .add_child(data(id, 1))
+        .add_child(units("V"))
+        .add_child(tag("FS_Min", "-10.000000"))
+        .add_child(tag("FS_Max", "10.000000"));
+
+    return channel(id, id + 3, "Channel " + std::to_string(id))
+        .add_child(tag("core:uuid", "00000000-0000-0000-0000-000000000000"))
+        .add_child(tag("data_type", "sequential_float64"))
+        .add_child(tag("somat:data_format", "float"))
+        .add_child(tag("core:description", "A <benchmark> & \"test\" channel"))
+        .add_child(tag("somat:input_channel", "/device/IO/AI/Ch" + std::to_string(id) + "/Sig"))
+        .add_child(tag("core:sample_rate", "1000.000000"))
+        .add_child(tag("somat:data_bits", "64"))
+        .add_child(tag("core:schema", "somat:sequential"))
+        .add_child(std::move(dim0))
+        .add_child(std::move(dim1));
+}
+
+static xml::element makeTest(unsigned channels)
+{
+    auto element = test(0);
+    for (unsigned i = 0; i < channels; ++i)
+        element.add_child(makeChannel(i));
+    return element;
+}
+
+static void BM_XmlBuild(benchmark::State& state)
+{
+    auto channels = static_cast<unsigned>(state.range(0));
+
+    for (auto _ : state)
+        benchmark::DoNotOptimize(makeTest(channels));
+
+    state.SetItemsProcessed(state.iterations() * channels);
+}
+
+static void BM_XmlSerialize(benchmark::State& state)
+{
+    auto channels = static_cast<unsigned>(state.range(0));
+    auto element = makeTest(channels);
+    std::string xml;
+    std::size_t bytes = 0;
+
+    for (auto _ : state)
+    {
+        xml.clear();
+        element.serialize(xml, 1);
+        bytes += xml.size();
+    }
+
+    state.SetBytesProcessed(bytes);
+    state.SetItemsProcessed(state.iterations() * channels);
+}
+
+BENCHMARK(BM_XmlBuild)->RangeMultiplier(8)->Range(1, 512);
+BENCHMARK(BM_XmlSerialize)->RangeMultiplier(8)->Range(1, 512);
@@ -1,14 +1,26 @@
 #pragma once
 
+#include <atomic>
+#include <cstddef>
+#include <functional>
 #include <map>
 #include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 #include <opendaq/function_block_impl.h>
 #include <opendaq/opendaq.h>
 
 #include <advanced_recorder_module/advanced_recorder_signal.h>
+#include <advanced_recorder_module/commit_thread.h>
 #include <advanced_recorder_module/common.h>
-#include <advanced_recorder_module/sie/writer.h>
+#include <advanced_recorder_module/recorder_settings.h>
+#include <advanced_recorder_module/segment.h>
+#include <advanced_recorder_module/statistics.h>
+#include <advanced_recorder_module/trigger.h>
+#include <advanced_recorder_module/writer_thread.h>
 
 BEGIN_NAMESPACE_ADVANCED_RECORDER_MODULE
 
@@ -17,14 +29,25 @@ BEGIN_NAMESPACE_ADVANCED_RECORDER_MODULE
  *     SIE file.
  *
  * A single SIE file is created for each recorded signal. The path and filename of this file is
- * specified by the `Filename` property. Signals can be dynamically connected and disconnected.
+ * specified by the `Filename` property. Long recordings can be split into several files
+ * (segments) by size, duration or wall-clock boundary; see the `Segment*` properties. Signals can
+ * be dynamically connected and disconnected.
  * Initially, the function block has a single input port named "Value1"; additional input ports
  * "Value2" etc. are created so that at least one unconnected input port is always available.
  * Signals can be connected or disconnected while the recording is active. Doing so does not
  * disturb ongoing recording of other signals.
  *
  * Packet handlers which write to the filesystem are invoked in a background thread to avoid
- * blocking the acquisition thread.
+ * blocking the acquisition thread. The acquisition thread only appends packet references to a
+ * bounded queue (see WriterThread), whose current depth and high-water mark are exposed as
+ * read-only properties. Further read-only properties report the write throughput and latency,
+ * updated once per second, so that a recorder which is falling behind can be spotted early.
+ *
+ * In triggered mode (see the `TriggerMode` property), starting the recording only arms the
+ * recorder: the most recent data of every signal is kept in memory, and is written to the file,
+ * together with the data that follows, only when a trigger fires. A trigger fires when the
+ * values of the input port selected by `TriggerInput` cross `TriggerLevel`, or when the
+ * `Trigger` function is called.
  */
 class AdvancedRecorderImpl final : public FunctionBlockImpl<IFunctionBlock, IRecorder>
 {
@@ -58,6 +81,337 @@ class AdvancedRecorderImpl final : public FunctionBlockImpl<IFunctionBlock, IRec
              * working directory of the process, but this behavior is not guaranteed.
              */
             static constexpr const char *FILENAME = "Filename";
+
+            /*!
+             * @brief If true, stopping the recording keeps the SIE file open, and each subsequent
+             *     start records a new test (`<test>` element) into the same file, so that stopping
+             *     and starting takes microseconds instead of closing and reopening the file. The
+             *     first recording is test 0 and each restart increments the test id; decoders
+             *     are shared between tests. The file is closed when the filename is changed,
+             *     when this property is set to false while the recording is stopped, or when
+             *     the function block is deactivated. Settings which are documented to take
+             *     effect when the recording is next started take effect when the next file is
+             *     opened instead.
+             */
+            static constexpr const char *APPEND_TESTS = "AppendTests";
+
+            /*!
+             * @brief The maximum number of packets which may be waiting to be written to the SIE
+             *     file; a batch handed over by the scheduler (see PacketNotification) counts as
+             *     one. If the queue is full, acquisition threads wait until the background
+             *     thread has made room. Changes take effect when the recording is next started.
+             */
+            static constexpr const char *QUEUE_CAPACITY = "QueueCapacity";
+
+            /*!
+             * @brief Selects the file output implementation: "Automatic" (the default, which
+             *     currently means POSIX), "POSIX", "io_uring" or "Memory-mapped". io_uring
+             *     batches many block writes into a single system call and keeps several writes
+             *     in flight. Memory-mapped output preallocates the file in large extents and
+             *     copies blocks directly into a mapping of it, avoiding per-block system calls
+             *     and file fragmentation. If the selected implementation is not available on the
+             *     running system, POSIX I/O is used instead and a message is logged. Changes take
+             *     effect when the recording is next started.
+             */
+            static constexpr const char *IO_BACKEND = "IoBackend";
+
+            /*!
+             * @brief The number of blocks listed in each index block of the SIE file, and of
+             *     index blocks listed in each index directory. Smaller values lose fewer blocks
+             *     from the index if the recording is interrupted; larger values write fewer
+             *     index blocks. Changes take effect when the recording is next started.
+             */
+            static constexpr const char *INDEX_INTERVAL = "IndexInterval";
+
+            /*!
+             * @brief The target payload size, in bytes, of the SIE data blocks. Consecutive
+             *     packets of a signal are merged into one block until this size is reached,
+             *     which reduces per-block overhead (header, footer, checksum and index entry).
+             *     Zero writes each packet as its own block. Changes take effect when the
+             *     recording is next started.
+             */
+            static constexpr const char *BLOCK_SIZE = "BlockSize";
+
+            /*!
+             * @brief The maximum time, in milliseconds, for which merged packets may be held
+             *     before they are written even if the block is not full. Changes take effect
+             *     when the recording is next started.
+             */
+            static constexpr const char *MAX_BLOCK_LATENCY = "MaxBlockLatency";
+
+            /*!
+             * @brief The size, in bytes, at which the recording is continued in a new file. Zero
+             *     (the default) disables this limit. Changes take effect when the recording is
+             *     next started.
+             */
+            static constexpr const char *SEGMENT_MAX_SIZE = "SegmentMaxSize";
+
+            /*!
+             * @brief The time, in seconds, after which the recording is continued in a new file.
+             *     Zero (the default) disables this limit. Changes take effect when the recording
+             *     is next started.
+             */
+            static constexpr const char *SEGMENT_MAX_DURATION = "SegmentMaxDuration";
+
+            /*!
+             * @brief If nonzero, the recording is continued in a new file whenever the UTC
+             *     wall-clock time crosses a multiple of this interval, in seconds; for example,
+             *     3600 starts a new file at the top of every hour. Zero (the default) disables
+             *     this rule. Changes take effect when the recording is next started.
+             */
+            static constexpr const char *SEGMENT_BOUNDARY = "SegmentBoundary";
+
+            /*!
+             * @brief The template used to generate filenames when the recording is split into
+             *     several files, e.g. "{base}_{seq:04}.sie". See formatSegmentFilename() for the
+             *     supported placeholders. If no segment limit is set, the `Filename` property is
+             *     used as-is. Changes take effect when the recording is next started.
+             */
+            static constexpr const char *SEGMENT_FILENAME = "SegmentFilename";
+
+            /*!
+             * @brief Selects whether data is recorded continuously ("Continuous", the default)
+             *     or only around trigger events ("Triggered"). Changes take effect when the
+             *     recording is next started.
+             */
+            static constexpr const char *TRIGGER_MODE = "TriggerMode";
+
+            /*!
+             * @brief In triggered mode, the time, in milliseconds, before a trigger event from
+             *     which data is recorded. This much data of every signal is kept in memory while
+             *     waiting for a trigger. The time is measured in the signals' domain (their
+             *     domain ticks scaled by the tick resolution), which the signals are assumed to
+             *     share; for signals whose domain time is not known, it is measured when the
+             *     packets are processed. Changes take effect when the recording is next started.
+             */
+            static constexpr const char *PRE_TRIGGER_TIME = "PreTriggerTime";
+
+            /*!
+             * @brief In triggered mode, the time, in milliseconds, after the most recent trigger
+             *     event until which data is recorded. Like PreTriggerTime, it is measured in
+             *     domain time where known, so packets which are processed late are still
+             *     recorded if their samples fall inside the window. Changes take effect when the
+             *     recording is next started.
+             */
+            static constexpr const char *POST_TRIGGER_TIME = "PostTriggerTime";
+
+            /*!
+             * @brief In triggered mode, the number of the input port (1 for "Value1", etc.)
+             *     whose values fire a trigger when they cross `TriggerLevel`. Zero (the default)
+             *     disables the level trigger, so triggers only fire when the `Trigger` function
+             *     is called. Changes take effect when the recording is next started.
+             */
+            static constexpr const char *TRIGGER_INPUT = "TriggerInput";
+
+            /*!
+             * @brief The level which the trigger input must cross to fire a trigger. Changes
+             *     take effect when the recording is next started.
+             */
+            static constexpr const char *TRIGGER_LEVEL = "TriggerLevel";
+
+            /*!
+             * @brief The direction in which the trigger input must cross `TriggerLevel`:
+             *     "Rising" (the default), "Falling" or "Either". Changes take effect when the
+             *     recording is next started.
+             */
+            static constexpr const char *TRIGGER_SLOPE = "TriggerSlope";
+
+            /*!
+             * @brief A procedure which fires a trigger when called. This has no effect unless
+             *     the recording is started in triggered mode.
+             */
+            static constexpr const char *TRIGGER = "Trigger";
+
+            /*!
+             * @brief Selects when recorded data is synced to the storage device, so that it
+             *     survives a crash or loss of power: "None" (the default) leaves this to the
+             *     operating system, "Periodic" syncs according to `SyncInterval` and `SyncSize`,
+             *     and "Group commit" syncs continuously, one sync covering everything written
+             *     while the previous one ran. Syncing happens in a background thread and never
+             *     delays recording. Changes take effect when the recording is next started.
+             */
+            static constexpr const char *DURABILITY_MODE = "DurabilityMode";
+
+            /*!
+             * @brief In periodic durability mode, the time, in milliseconds, after which
+             *     recorded data is synced. Zero disables this rule. Changes take effect when the
+             *     recording is next started.
+             */
+            static constexpr const char *SYNC_INTERVAL = "SyncInterval";
+
+            /*!
+             * @brief In periodic durability mode, the number of bytes written after which
+             *     recorded data is synced. Zero (the default) disables this rule. Changes take
+             *     effect when the recording is next started.
+             */
+            static constexpr const char *SYNC_SIZE = "SyncSize";
+
+            /*!
+             * @brief The maximum amount of memory, in bytes, which the recording may hold: the
+             *     sample data of packets waiting to be written, the buffers in which signal
+             *     handlers merge packets into blocks (at most half of the budget), and in
+             *     triggered mode the packets held for the pre-trigger interval (the oldest are
+             *     discarded beyond three quarters of the budget). Zero (the default) sets no
+             *     limit. Changes take effect when the recording is next started.
+             */
+            static constexpr const char *MEMORY_BUDGET = "MemoryBudget";
+
+            /*!
+             * @brief Selects what happens to a new packet when the queue is full or the memory
+             *     budget is exhausted: "Block" (the default) holds up the acquisition thread until
+             *     there is room, "Drop newest" discards the new packet, and "Drop oldest" discards
+             *     the oldest waiting packets. Discarded packets are counted in `DroppedPackets`.
+             *     Changes take effect when the recording is next started.
+             */
+            static constexpr const char *BACKPRESSURE = "Backpressure";
+
+            /*!
+             * @brief If true, the buffers in which signal handlers merge packets are allocated
+             *     from huge pages where the operating system supports it. Changes take effect
+             *     when the recording is next started.
+             */
+            static constexpr const char *HUGE_PAGES = "HugePages";
+
+            /*!
+             * @brief If true, sample values are compressed losslessly where the signal handler
+             *     supports it (currently scalar signals with a linear-rule domain): XOR compression
+             *     for floating-point values, delta compression for integers. Compressed channels
+             *     are marked with the `hbk:encoding` tag. Changes take effect when the recording
+             *     is next started.
+             */
+            static constexpr const char *COMPRESS = "Compress";
+
+            /*!
+             * @brief The number of worker threads which compress blocks and compute their
+             *     checksums, if `Compress` is enabled. The writer thread writes the compressed
+             *     blocks in their original order. Zero (the default) compresses blocks on the
+             *     writer thread instead. Changes take effect when the recording is next started.
+             */
+            static constexpr const char *COMPRESSION_THREADS = "CompressionThreads";
+
+            /*!
+             * @brief The maximum number of blocks per file which may be waiting for, or
+             *     undergoing, compression by the worker threads at a time. When this is reached,
+             *     the writer thread waits for the oldest block. Changes take effect when the
+             *     recording is next started.
+             */
+            static constexpr const char *COMPRESSION_IN_FLIGHT = "CompressionInFlight";
+
+            /*!
+             * @brief Selects how the recorder is notified of new packets: "Same thread" (the
+             *     default) hands packets to the writer thread on the device thread which sent
+             *     them, one input port at a time; "Scheduler" defers this to the openDAQ
+             *     scheduler, which drains the queued packets of all input ports in one pass and
+             *     hands each port's packets to the writer thread as one batch, so device threads
+             *     do no recorder work at all. Changes take effect immediately.
+             */
+            static constexpr const char *PACKET_NOTIFICATION = "PacketNotification";
+
+            /*!
+             * @brief (Read-only) The number of packets currently waiting to be written, counting
+             *     each batch handed over by the scheduler as one.
+             */
+            static constexpr const char *QUEUE_DEPTH = "QueueDepth";
+
+            /*!
+             * @brief (Read-only) The largest number of packets which have been waiting to be
+             *     written at any one time since the recording was started.
+             */
+            static constexpr const char *QUEUE_HIGH_WATER_MARK = "QueueHighWaterMark";
+
+            /*!
+             * @brief (Read-only) The number of bytes written to SIE files since the recording
+             *     was started.
+             */
+            static constexpr const char *BYTES_WRITTEN = "BytesWritten";
+
+            /*!
+             * @brief (Read-only) The rate, in bytes per second, at which data is currently being
+             *     written to SIE files.
+             */
+            static constexpr const char *WRITE_RATE = "WriteRate";
+
+            /*!
+             * @brief (Read-only) The number of SIE blocks written since the recording was
+             *     started.
+             */
+            static constexpr const char *BLOCKS_WRITTEN = "BlocksWritten";
+
+            /*!
+             * @brief (Read-only) The rate, in blocks per second, at which SIE blocks are
+             *     currently being written.
+             */
+            static constexpr const char *BLOCK_RATE = "BlockRate";
+
+            /*!
+             * @brief (Read-only) The number of index blocks written since the recording was
+             *     started.
+             */
+            static constexpr const char *INDEX_FLUSHES = "IndexFlushes";
+
+            /*!
+             * @brief (Read-only) The number of packets which were discarded without being
+             *     recorded since the recording was started.
+             */
+            static constexpr const char *DROPPED_PACKETS = "DroppedPackets";
+
+            /*!
+             * @brief (Read-only) The number of bytes currently charged to `MemoryBudget`.
+             */
+            static constexpr const char *MEMORY_USED = "MemoryUsed";
+
+            /*!
+             * @brief (Read-only) The median time, in microseconds, taken by the background
+             *     thread to record a packet during the last second.
+             */
+            static constexpr const char *WRITE_LATENCY_P50 = "WriteLatencyP50";
+
+            /*!
+             * @brief (Read-only) The 99th percentile of the time, in microseconds, taken by the
+             *     background thread to record a packet during the last second.
+             */
+            static constexpr const char *WRITE_LATENCY_P99 = "WriteLatencyP99";
+
+            /*!
+             * @brief (Read-only) The longest time, in microseconds, taken by the background
+             *     thread to record a packet since the recording was started.
+             */
+            static constexpr const char *WRITE_LATENCY_MAX = "WriteLatencyMax";
+
+            /*!
+             * @brief (Read-only) The number of bytes, counted as for `BytesWritten`, known to
+             *     have been synced to the storage device.
+             */
+            static constexpr const char *BYTES_COMMITTED = "BytesCommitted";
+
+            /*!
+             * @brief (Read-only) The number of syncs completed since the recording was started.
+             */
+            static constexpr const char *COMMITS = "Commits";
+
+            /*!
+             * @brief (Read-only) The median time, in microseconds, from requesting a sync until
+             *     the data was durable, during the last second.
+             */
+            static constexpr const char *COMMIT_LATENCY_P50 = "CommitLatencyP50";
+
+            /*!
+             * @brief (Read-only) The 99th percentile of the time, in microseconds, from
+             *     requesting a sync until the data was durable, during the last second.
+             */
+            static constexpr const char *COMMIT_LATENCY_P99 = "CommitLatencyP99";
+
+            /*!
+             * @brief (Read-only) The longest time, in microseconds, from requesting a sync until
+             *     the data was durable, since the recording was started.
+             */
+            static constexpr const char *COMMIT_LATENCY_MAX = "CommitLatencyMax";
+
+            /*!
+             * @brief (Read-only) A dictionary of the number of packets processed for each
+             *     signal, by global ID, since the recording was started.
+             */
+            static constexpr const char *PACKET_COUNTS = "PacketCounts";
         };
 
         /*!
@@ -133,17 +487,109 @@ class AdvancedRecorderImpl final : public FunctionBlockImpl<IFunctionBlock, IRec
     private:
 
         void addProperties();
+        void addStatisticProperty(
+            const PropertyPtr& property,
+            std::function<BaseObjectPtr(const RecorderStatistics&)> get);
         void addInputPort();
+        void readSettings(std::shared_ptr<MemoryBudget> budget);
+        RotationPolicy readRotationPolicy();
+        TriggerSettings readTriggerSettings();
+        DurabilityPolicy readDurabilityPolicy();
+        BackpressureSettings readBackpressureSettings();
         void reconfigure();
+        void closeFile();
 
         bool recordingActive = false;
 
-        std::shared_ptr<hbk::sie::writer> writer;
+        RecorderSettings settings;
 
-        std::shared_ptr<AdvancedRecorderSignal> findSignal(IInputPort *port);
+        /*!
+         * @brief The background thread which writes packets to the SIE file. This pointer is
+         *     read by statistics properties from arbitrary threads, so it must only be read and
+         *     written with std::atomic_load() and std::atomic_store(). Acquisition threads use
+         *     the copy in the published snapshot instead.
+         */
+        std::shared_ptr<WriterThread> writerThread;
 
+        /*!
+         * @brief The filename the writer thread was opened with, used to decide whether a
+         *     stopped recording can append a new test to the open file.
+         */
+        std::string openFilename;
+
+        /*!
+         * @brief The id of the <test> element which is, or will next be, recorded into the open
+         *     SIE file.
+         */
+        unsigned testId = 0;
+
+        /*!
+         * @brief The AdvancedRecorderSignal objects of the connected input ports. Only accessed
+         *     with the configuration lock held; acquisition threads use the published snapshot.
+         */
         std::map<IInputPort *, std::shared_ptr<AdvancedRecorderSignal>> signals;
 
+        /*!
+         * @brief An immutable copy of what the packet path needs: the writer thread, and the
+         *     connection and AdvancedRecorderSignal (if recorded) of each connected input port.
+         *     It is replaced as a whole (see publishSnapshot()) whenever any of these change, so
+         *     acquisition threads need only a single atomic load of a plain pointer per
+         *     notification and never take a lock (see SnapshotReader).
+         */
+        struct Snapshot
+        {
+            struct Source
+            {
+                ConnectionPtr connection;
+                std::shared_ptr<AdvancedRecorderSignal> signal;
+            };
+
+            std::shared_ptr<WriterThread> writerThread;
+            std::unordered_map<IInputPort *, Source> sources;
+
+            /*!
+             * @brief True if notifications arrive on scheduler threads, in which case each one
+             *     drains every connection (see Props::PACKET_NOTIFICATION).
+             */
+            bool drainAll = false;
+        };
+
+        /*!
+         * @brief The current snapshot. Acquisition threads only read it through a
+         *     SnapshotReader.
+         */
+        std::atomic<const Snapshot*> snapshot = nullptr;
+
+        /*!
+         * @brief Owns the current snapshot and every snapshot it replaced. An acquisition thread
+         *     may still be reading a replaced snapshot, so they are only freed when the recording
+         *     is closed (see reclaimSnapshots()). Only accessed with the configuration lock held.
+         */
+        std::vector<std::unique_ptr<const Snapshot>> snapshots;
+
+        /*!
+         * @brief The number of acquisition threads currently reading a snapshot.
+         */
+        std::atomic<std::size_t> snapshotReaders = 0;
+
+        class SnapshotReader;
+
+        /*!
+         * @brief Serializes draining in scheduler mode, so that packets of one connection are
+         *     never queued out of order by two scheduler threads. A notification which finds
+         *     another thread draining only sets drainPending, and that thread drains again.
+         */
+        std::mutex drainMutex;
+        std::atomic<bool> drainPending = false;
+
+        void drain(const Snapshot& current, const Snapshot::Source& source);
+        void drainAll();
+        void updateNotificationMethod();
+        PacketReadyNotification readNotificationMethod();
+
+        void publishSnapshot();
+        void reclaimSnapshots();
+
         unsigned portCount = 0;
 };
 
@@ -1,37 +1,141 @@
 #pragma once
 
+#include <chrono>
+#include <cstddef>
+#include <deque>
 #include <memory>
+#include <optional>
+#include <string>
+#include <utility>
 
 #include <coretypes/filesystem.h>
 #include <opendaq/opendaq.h>
 
+#include <advanced_recorder_module/block_pool.h>
 #include <advanced_recorder_module/common.h>
+#include <advanced_recorder_module/recorder_settings.h>
 #include <advanced_recorder_module/signal_handler.h>
 #include <advanced_recorder_module/sie/writer.h>
+#include <advanced_recorder_module/trigger.h>
 
 BEGIN_NAMESPACE_ADVANCED_RECORDER_MODULE
 
 /*!
  * Records a single openDAQ signal in an SIE file. Objects are constructed with a reference to the
- * openDAQ signal object, and a reference to the SIE writer object used to write data blocks to
- * the file. Then the caller calls onPacketReceived() (ideally from a worker thread) to
- * synchronously record packet data.
+ * openDAQ signal object. The writer thread then attaches the SIE writer object used to write data
+ * blocks to the file (see setWriter()) and calls onPacketReceived() to synchronously record
+ * packet data.
+ *
+ * When a recording is split into several files, the writer thread moves the signal to the next
+ * file with switchWriter(). The signal handler for the next file can be created ahead of time,
+ * from a background thread, with createHandler().
+ *
+ * In triggered mode, the writer thread passes packets to hold() rather than onPacketReceived()
+ * while no trigger window is open. The signal then keeps references to the packets received in
+ * the pre-trigger interval, and records them when the writer thread calls release(). The held
+ * packets stay charged to the memory budget until they are recorded or discarded.
  */
 class AdvancedRecorderSignal
 {
     public:
 
+        /*!
+         * @brief The descriptors for which a signal handler was created.
+         */
+        struct Descriptors
+        {
+            DataDescriptorPtr value;
+            DataDescriptorPtr domain;
+        };
+
+        /*!
+         * @brief The fraction of the memory budget's limit which the total charged may reach
+         *     through held packets. Beyond it, the oldest held packets are discarded, so that
+         *     the rest of the budget always remains for the packets waiting to be processed.
+         */
+        static constexpr double HISTORY_SHARE = 0.75;
+
         /*!
          * Creates a signal write handler for the specified signal.
          *
          * @param signal The openDAQ signal object to be recorded.
-         * @param writer A reference to the SIE writer object to write to.
          * @param testId The id of the <test> element in the SIE file.
+         * @param settings The recorder configuration passed to the signal handlers.
          */
         AdvancedRecorderSignal(
             const SignalPtr& signal,
+            unsigned testId,
+            const RecorderSettings& settings);
+
+        /*!
+         * @brief Releases the memory charged for the packets in the pre-trigger history.
+         */
+        ~AdvancedRecorderSignal();
+
+        AdvancedRecorderSignal(const AdvancedRecorderSignal&) = delete;
+        AdvancedRecorderSignal& operator=(const AdvancedRecorderSignal&) = delete;
+
+        /*!
+         * @brief Gets the global ID of the recorded openDAQ signal.
+         * @return The global ID, as captured when this object was constructed.
+         */
+        const std::string& getGlobalId() const noexcept;
+
+        /*!
+         * @brief Gets the SIE writer object this signal writes to.
+         * @return The writer, or nullptr if none has been attached yet.
+         */
+        const std::shared_ptr<hbk::sie::writer>& getWriter() const noexcept;
+
+        /*!
+         * @brief Attaches the SIE writer object to write to. Any data the current signal handler
+         *     has accumulated is written to the previous writer first, and a new signal handler is
+         *     created when the next packet is received.
+         *
+         * @param writer The SIE writer object to write to.
+         *
+         * @throws std::system_error Data could not be written to SIE file due to an I/O error.
+         */
+        void setWriter(std::shared_ptr<hbk::sie::writer> writer);
+
+        /*!
+         * @brief Attaches a new SIE writer object, together with a signal handler that was
+         *     prepared for it by createHandler(). Any data the current signal handler has
+         *     accumulated is written to the previous writer first.
+         *
+         * @param writer The SIE writer object to write to.
+         * @param handler The signal handler created for @p writer, or nullptr.
+         * @param descriptors The descriptors for which @p handler was created. If these differ
+         *     from the descriptors of the next packet, a new handler is created as usual.
+         *
+         * @throws std::system_error Data could not be written to SIE file due to an I/O error.
+         */
+        void switchWriter(
             std::shared_ptr<hbk::sie::writer> writer,
-            unsigned testId);
+            std::unique_ptr<SignalHandler> handler,
+            const Descriptors& descriptors);
+
+        /*!
+         * @brief Gets the descriptors of the most recently received data packet. This must only
+         *     be called from the thread which calls onPacketReceived().
+         * @return The descriptors. The members are not assigned if no data packet has been
+         *     received yet.
+         */
+        Descriptors getDescriptors() const;
+
+        /*!
+         * @brief Creates a signal handler suitable for the specified descriptors, which writes
+         *     its channel metadata (and later, its data) to the specified writer. This function
+         *     does not modify this object, so it may be called from any thread.
+         *
+         * @param writer The SIE writer object the handler will write to.
+         * @param descriptors The value and domain descriptors of the signal.
+         * @return The handler, or nullptr if no handler supports the descriptors or the handler
+         *     could not be created.
+         */
+        std::unique_ptr<SignalHandler> createHandler(
+            hbk::sie::writer& writer,
+            const Descriptors& descriptors) const;
 
         /*!
          * @brief Records the values in a packet to the SIE file.
@@ -42,6 +146,77 @@ class AdvancedRecorderSignal
          */
         void onPacketReceived(const PacketPtr& packet);
 
+        /*!
+         * @brief Makes this signal a trigger source: detectTrigger() then reports when the
+         *     signal's values cross the level of @p detector. This must be called before the
+         *     signal is passed to the writer thread.
+         *
+         * @param detector The level detector to apply to the signal's data packets.
+         */
+        void setLevelTrigger(const LevelDetector& detector);
+
+        /*!
+         * @brief Checks whether a packet fires this signal's level trigger, if any.
+         *
+         * @param packet The packet received.
+         * @return True if the signal is a trigger source and the packet crosses the trigger
+         *     level. Packets with non-scalar or non-numeric values never fire a trigger.
+         */
+        bool detectTrigger(const PacketPtr& packet);
+
+        /*!
+         * @brief Keeps a reference to a packet in the pre-trigger history rather than recording
+         *     it. Packets more than @p preTrigger older than this one are discarded from the
+         *     history, as are the oldest packets while the budget is charged beyond
+         *     HISTORY_SHARE. Ages are measured in domain time where both packets have one (see
+         *     getPacketDomainTime()), and otherwise by the time the packets were processed.
+         *
+         * @param packet The packet received.
+         * @param charge The number of bytes charged to @p budget for the packet. The history
+         *     takes over the charge, and releases it when the packet is recorded or discarded.
+         * @param budget The budget the packet is charged to. It must be the same for every call.
+         * @param now The current time.
+         * @param domainTime The domain time of the packet, if known.
+         * @param preTrigger How long packets are kept in the history.
+         */
+        void hold(
+            const PacketPtr& packet,
+            std::size_t charge,
+            const std::shared_ptr<MemoryBudget>& budget,
+            std::chrono::steady_clock::time_point now,
+            std::optional<DomainTime> domainTime,
+            std::chrono::milliseconds preTrigger);
+
+        /*!
+         * @brief Discards the oldest packets in the pre-trigger history while the memory budget
+         *     is charged beyond HISTORY_SHARE.
+         */
+        void trimHistory() noexcept;
+
+        /*!
+         * @brief Records the packets in the pre-trigger history, oldest first, and clears it.
+         *
+         * @throws std::system_error Data could not be written to SIE file due to an I/O error.
+         */
+        void release();
+
+        /*!
+         * @brief Writes any data the signal handler has accumulated but not yet written.
+         *
+         * @throws std::system_error Data could not be written to SIE file due to an I/O error.
+         */
+        void flush();
+
+        /*!
+         * @brief Gives the signal handler an opportunity to write accumulated data which has
+         *     become too old. This is called periodically by the writer thread.
+         *
+         * @param now The current time.
+         *
+         * @throws std::system_error Data could not be written to SIE file due to an I/O error.
+         */
+        void onTick(std::chrono::steady_clock::time_point now);
+
     private:
 
         /*!
@@ -56,19 +231,45 @@ class AdvancedRecorderSignal
         void onDataPacketReceived(const DataPacketPtr packet);
 
         SignalPtr signal;
+        std::string globalId;
 
         /**
          * A reference to the SIE writer object to write to.
          */
         std::shared_ptr<hbk::sie::writer> writer;
 
-        unsigned group = 2;
         unsigned testId;
+        RecorderSettings settings;
 
         DataDescriptorPtr lastValueDescriptor;
         DataDescriptorPtr lastDomainDescriptor;
 
         std::unique_ptr<SignalHandler> handler;
+
+        std::optional<LevelDetector> levelDetector;
+
+        /*!
+         * @brief A packet held while waiting for a trigger.
+         */
+        struct HeldPacket
+        {
+            std::chrono::steady_clock::time_point received;
+            std::optional<DomainTime> domainTime;
+            PacketPtr packet;
+            std::size_t charge;
+        };
+
+        /*!
+         * @brief Discards the oldest packet in the pre-trigger history and releases its charge.
+         */
+        void discardOldest() noexcept;
+
+        std::deque<HeldPacket> history;
+
+        /*!
+         * @brief The budget which the packets in the history are charged to.
+         */
+        std::shared_ptr<MemoryBudget> historyBudget;
 };
 
 END_NAMESPACE_ADVANCED_RECORDER_MODULE
@@ -0,0 +1,549 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#if defined (__unix__) || (defined (__APPLE__) && defined (__MACH__))
+#define ADVANCED_RECORDER_HAVE_MMAP 1
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include <advanced_recorder_module/bounded_queue.h>
+#include <advanced_recorder_module/common.h>
+
+BEGIN_NAMESPACE_ADVANCED_RECORDER_MODULE
+
+/*!
+ * @brief Accounts for the memory held by the recorder against a global limit.
+ *
+ * Every component which holds on to memory on behalf of the recording (the writer thread's
+ * queue of packets and the block buffers of the signal handlers) charges the budget before
+ * doing so and releases the charge afterwards, so the total stays below the limit no matter how
+ * many signals are recorded. This class is thread-safe. Charging and releasing are lock-free;
+ * only threads waiting in charge() for memory to be released, and the releases which wake them,
+ * take a lock.
+ */
+class MemoryBudget
+{
+    public:
+
+        /*!
+         * @brief Creates a budget.
+         * @param limit The maximum number of bytes which may be charged at once, or zero for no
+         *     limit.
+         */
+        explicit MemoryBudget(std::size_t limit = 0) noexcept
+            : limit_(limit)
+        {
+        }
+
+        MemoryBudget(const MemoryBudget&) = delete;
+        MemoryBudget& operator=(const MemoryBudget&) = delete;
+
+        /*!
+         * @brief Charges memory to the budget, if the total stays within the limit.
+         * @param bytes The number of bytes to charge.
+         * @param share The fraction of the limit which the total may reach; 1 allows the
+         *     entire limit to be used.
+         * @return True if the memory was charged; false if this would exceed the limit, in
+         *     which case nothing is charged.
+         */
+        bool tryCharge(std::size_t bytes, double share = 1) noexcept
+        {
+            if (!limit_)
+            {
+                used_.fetch_add(bytes, std::memory_order_relaxed);
+                return true;
+            }
+
+            auto ceiling = static_cast<std::size_t>(static_cast<double>(limit_) * share);
+            std::size_t used = used_.load(std::memory_order_relaxed);
+
+            do
+            {
+                if (bytes > ceiling || used > ceiling - bytes)
+                    return false;
+            }
+            while (!used_.compare_exchange_weak(used, used + bytes, std::memory_order_relaxed));
+
+            return true;
+        }
+
+        /*!
+         * @brief Charges memory to the budget, waiting for other threads to release memory
+         *     while the total would exceed the limit.
+         * @param bytes The number of bytes to charge. If it exceeds the limit, this waits until
+         *     cancelled.
+         * @param cancelled A function, checked before each wait, which returns true to give up.
+         *     Whoever makes it return true must call wakeAll() afterwards.
+         * @return True if the memory was charged; false if the wait was cancelled, in which
+         *     case nothing is charged.
+         */
+        template <typename Cancelled>
+        bool charge(std::size_t bytes, Cancelled&& cancelled)
+        {
+            for (;;)
+            {
+                // Read before trying, so that a release in between is not missed.
+                std::uint64_t seen = releases.load();
+                if (tryCharge(bytes))
+                    return true;
+                if (cancelled())
+                    return false;
+
+                std::unique_lock<std::mutex> lock(mutex);
+                waiters.fetch_add(1);
+                cv.wait(lock, [&] { return releases.load() != seen; });
+                waiters.fetch_sub(1);
+            }
+        }
+
+        /*!
+         * @brief Releases memory previously charged with tryCharge() or charge(), and wakes the
+         *     threads waiting in charge().
+         * @param bytes The number of bytes to release.
+         */
+        void release(std::size_t bytes) noexcept
+        {
+            used_.fetch_sub(bytes, std::memory_order_relaxed);
+            wakeAll();
+        }
+
+        /*!
+         * @brief Wakes the threads waiting in charge(), so that they try again and check whether
+         *     they have been cancelled.
+         */
+        void wakeAll() noexcept
+        {
+            // Pairs with charge(): either we see the waiter, or it sees the new release count.
+            releases.fetch_add(1);
+            if (waiters.load() > 0)
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                cv.notify_all();
+            }
+        }
+
+        /*!
+         * @brief Gets the number of bytes currently charged.
+         * @return The approximate number of bytes currently charged.
+         */
+        std::size_t used() const noexcept
+        {
+            return used_.load(std::memory_order_relaxed);
+        }
+
+        /*!
+         * @brief Gets the limit of the budget.
+         * @return The maximum number of bytes which may be charged at once, or zero for no
+         *     limit.
+         */
+        std::size_t limit() const noexcept
+        {
+            return limit_;
+        }
+
+    private:
+
+        const std::size_t limit_;
+        std::atomic<std::size_t> used_ = 0;
+
+        std::atomic<std::uint64_t> releases = 0;
+        std::atomic<unsigned> waiters = 0;
+        std::mutex mutex;
+        std::condition_variable cv;
+};
+
+/*!
+ * @brief A pool of fixed-size, aligned memory blocks in which signal handlers accumulate
+ *     samples before writing them as SIE blocks.
+ *
+ * Blocks are carved from large slabs (arenas) allocated directly from the operating system,
+ * optionally using huge pages, and are never returned to it until the pool is destroyed.
+ * Released blocks go onto a lock-free free list (see BoundedQueue), so once the pool has grown
+ * to the recording's working set, acquiring and releasing a block neither allocates memory nor
+ * takes a lock. Each block starts on a cache line boundary; blocks of at least a page are also
+ * page-aligned, which suits file backends that write them with direct or asynchronous I/O.
+ *
+ * Slabs are charged to a MemoryBudget when they are allocated, and the pool never takes more
+ * than half of the budget's limit, leaving the rest for queued packets. When the pool cannot
+ * grow any further, tryAcquire() fails; the caller is expected to fall back to a path which
+ * needs no buffer (e.g. writing a packet as its own block).
+ *
+ * This class is thread-safe. It must outlive every Block acquired from it.
+ */
+class BlockPool
+{
+    public:
+
+        /*!
+         * @brief The default maximum number of blocks in a pool.
+         */
+        static constexpr std::size_t DEFAULT_MAX_BLOCKS = 65536;
+
+        /*!
+         * @brief The fraction of the memory budget which the pool may use.
+         */
+        static constexpr double BUDGET_SHARE = 0.5;
+
+        /*!
+         * @brief An owning reference to a block acquired from a BlockPool. The block is
+         *     returned to the pool when this object is destroyed or reset. A default-constructed
+         *     Block references no memory.
+         */
+        class Block
+        {
+            public:
+
+                Block() noexcept = default;
+
+                Block(Block&& rhs) noexcept
+                    : pool(std::exchange(rhs.pool, nullptr))
+                    , data_(std::exchange(rhs.data_, nullptr))
+                    , size_(std::exchange(rhs.size_, 0))
+                {
+                }
+
+                Block& operator=(Block&& rhs) noexcept
+                {
+                    if (this != &rhs)
+                    {
+                        reset();
+                        pool = std::exchange(rhs.pool, nullptr);
+                        data_ = std::exchange(rhs.data_, nullptr);
+                        size_ = std::exchange(rhs.size_, 0);
+                    }
+
+                    return *this;
+                }
+
+                ~Block()
+                {
+                    reset();
+                }
+
+                /*!
+                 * @brief Returns the block to its pool. Afterwards, this object references no
+                 *     memory.
+                 */
+                void reset() noexcept
+                {
+                    if (pool)
+                        pool->release(data_);
+
+                    pool = nullptr;
+                    data_ = nullptr;
+                    size_ = 0;
+                }
+
+                /*!
+                 * @brief Appends bytes to the contents of the block. The caller must ensure
+                 *     they fit (see capacity()).
+                 * @param data A pointer to the bytes to append.
+                 * @param size The number of bytes to append.
+                 */
+                void append(const void *data, std::size_t size) noexcept
+                {
+                    std::memcpy(data_ + size_, data, size);
+                    size_ += size;
+                }
+
+                /*!
+                 * @brief Discards the contents of the block, without returning it to the pool.
+                 */
+                void clear() noexcept
+                {
+                    size_ = 0;
+                }
+
+                const std::uint8_t *data() const noexcept
+                {
+                    return data_;
+                }
+
+                /*!
+                 * @brief Gets the number of bytes appended to the block.
+                 */
+                std::size_t size() const noexcept
+                {
+                    return size_;
+                }
+
+                bool empty() const noexcept
+                {
+                    return size_ == 0;
+                }
+
+                /*!
+                 * @brief Gets the number of bytes the block can hold.
+                 * @return The pool's block size, or zero if this object references no block.
+                 */
+                std::size_t capacity() const noexcept
+                {
+                    return pool ? pool->blockSize() : 0;
+                }
+
+                explicit operator bool() const noexcept
+                {
+                    return data_ != nullptr;
+                }
+
+            private:
+
+                friend class BlockPool;
+
+                Block(BlockPool *pool, std::uint8_t *data) noexcept
+                    : pool(pool)
+                    , data_(data)
+                {
+                }
+
+                BlockPool *pool = nullptr;
+                std::uint8_t *data_ = nullptr;
+                std::size_t size_ = 0;
+        };
+
+        /*!
+         * @brief Creates an empty pool. No memory is allocated until a block is first acquired.
+         * @param blockSize The size of each block, in bytes. It must be non-zero.
+         * @param budget The budget which the pool's slabs are charged to. If null, the pool is
+         *     only limited by @p maxBlocks.
+         * @param hugePages If true, slabs are allocated from huge pages where the operating
+         *     system supports it, falling back to regular pages otherwise.
+         * @param maxBlocks The maximum number of blocks the pool may contain.
+         * @throws std::invalid_argument @p blockSize or @p maxBlocks is zero.
+         */
+        explicit BlockPool(
+                std::size_t blockSize,
+                std::shared_ptr<MemoryBudget> budget = nullptr,
+                bool hugePages = false,
+                std::size_t maxBlocks = DEFAULT_MAX_BLOCKS)
+            : blockSize_(blockSize)
+            , stride(strideOf(blockSize))
+            , slabSize(slabSizeOf(stride, hugePages))
+            , hugePages(hugePages)
+            , maxBlocks(maxBlocks)
+            , budget(std::move(budget))
+            , freeList(maxBlocks)
+        {
+            if (!blockSize)
+                throw std::invalid_argument("block size must be non-zero");
+        }
+
+        BlockPool(const BlockPool&) = delete;
+        BlockPool& operator=(const BlockPool&) = delete;
+
+        /*!
+         * @brief Returns the pool's memory to the operating system and releases its charge
+         *     to the budget.
+         */
+        ~BlockPool()
+        {
+            for (const auto& slab : slabs)
+            {
+                freeSlab(slab.first, slab.second);
+                if (budget)
+                    budget->release(slab.second);
+            }
+        }
+
+        /*!
+         * @brief Acquires a free block, growing the pool if needed.
+         * @return The block; or a Block which references no memory if every block is in use
+         *     and the pool has reached its maximum size or its share of the memory budget.
+         */
+        Block tryAcquire()
+        {
+            std::uint8_t *data;
+            if (!freeList.tryPop(data) && !grow(data))
+                return Block();
+
+            inUse_.fetch_add(1, std::memory_order_relaxed);
+            return Block(this, data);
+        }
+
+        /*!
+         * @brief Gets the size of each block.
+         * @return The size of each block, in bytes.
+         */
+        std::size_t blockSize() const noexcept
+        {
+            return blockSize_;
+        }
+
+        /*!
+         * @brief Gets the number of blocks currently acquired.
+         * @return The approximate number of blocks currently acquired.
+         */
+        std::size_t inUse() const noexcept
+        {
+            return inUse_.load(std::memory_order_relaxed);
+        }
+
+        /*!
+         * @brief Gets the amount of memory the pool has allocated from the operating system.
+         * @return The approximate total size of the pool's slabs, in bytes.
+         */
+        std::size_t allocated() const noexcept
+        {
+            return allocated_.load(std::memory_order_relaxed);
+        }
+
+    private:
+
+        static constexpr std::size_t CACHE_LINE = 64;
+        static constexpr std::size_t HUGE_PAGE = 2 * 1024 * 1024;
+
+        static std::size_t pageSize() noexcept
+        {
+#ifdef ADVANCED_RECORDER_HAVE_MMAP
+            return static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+#else
+            return 4096;
+#endif
+        }
+
+        static std::size_t roundUp(std::size_t n, std::size_t multiple) noexcept
+        {
+            return (n + multiple - 1) / multiple * multiple;
+        }
+
+        static std::size_t strideOf(std::size_t blockSize) noexcept
+        {
+            std::size_t page = pageSize();
+            return roundUp(std::max<std::size_t>(blockSize, 1), blockSize >= page ? page : CACHE_LINE);
+        }
+
+        static std::size_t slabSizeOf(std::size_t stride, bool hugePages) noexcept
+        {
+            // Large slabs amortize the system calls and keep the page tables small, while small
+            // pools do not waste much memory.
+            return roundUp(std::max(stride, HUGE_PAGE), hugePages ? HUGE_PAGE : pageSize());
+        }
+
+        bool grow(std::uint8_t *& data)
+        {
+            std::lock_guard<std::mutex> lock(growMutex);
+
+            // Another thread may have grown the pool while we were waiting.
+            if (freeList.tryPop(data))
+                return true;
+
+            if (carved == carvedEnd)
+            {
+                std::size_t blocks = slabSize / stride;
+                if (blockCount >= maxBlocks)
+                    return false;
+
+                std::size_t size = slabSize;
+                if (blocks > maxBlocks - blockCount)
+                {
+                    blocks = maxBlocks - blockCount;
+                    size = roundUp(blocks * stride, hugePages ? HUGE_PAGE : pageSize());
+                }
+
+                if (budget && !budget->tryCharge(size, BUDGET_SHARE))
+                    return false;
+
+                auto slab = allocateSlab(size);
+                if (!slab)
+                {
+                    if (budget)
+                        budget->release(size);
+                    return false;
+                }
+
+                slabs.emplace_back(slab, size);
+                allocated_.fetch_add(size, std::memory_order_relaxed);
+                blockCount += blocks;
+                carved = slab;
+                carvedEnd = slab + blocks * stride;
+            }
+
+            data = carved;
+            carved += stride;
+            return true;
+        }
+
+        std::uint8_t *allocateSlab(std::size_t size) noexcept
+        {
+#ifdef ADVANCED_RECORDER_HAVE_MMAP
+            void *slab = MAP_FAILED;
+
+#ifdef MAP_HUGETLB
+            if (hugePages)
+                slab = ::mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+#endif
+
+            if (slab == MAP_FAILED)
+            {
+                slab = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+                if (slab == MAP_FAILED)
+                    return nullptr;
+
+#ifdef MADV_HUGEPAGE
+                // Without reserved huge pages, transparent huge pages are the next best thing.
+                if (hugePages)
+                    ::madvise(slab, size, MADV_HUGEPAGE);
+#endif
+            }
+
+            return static_cast<std::uint8_t *>(slab);
+#else
+            return static_cast<std::uint8_t *>(::operator new(size, std::align_val_t(HUGE_PAGE), std::nothrow));
+#endif
+        }
+
+        static void freeSlab(std::uint8_t *slab, std::size_t size) noexcept
+        {
+#ifdef ADVANCED_RECORDER_HAVE_MMAP
+            ::munmap(slab, size);
+#else
+            ::operator delete(slab, std::align_val_t(HUGE_PAGE));
+#endif
+        }
+
+        void release(std::uint8_t *data) noexcept
+        {
+            // The free list can hold every block the pool will ever contain, so this never fails.
+            freeList.tryPush(data);
+            inUse_.fetch_sub(1, std::memory_order_relaxed);
+        }
+
+        const std::size_t blockSize_;
+        const std::size_t stride;
+        const std::size_t slabSize;
+        const bool hugePages;
+        const std::size_t maxBlocks;
+        std::shared_ptr<MemoryBudget> budget;
+
+        BoundedQueue<std::uint8_t *> freeList;
+
+        /*!
+         * @brief The slabs and the unused remainder of the newest one, protected by growMutex.
+         *     The mutex is only taken when the free list is empty, i.e. while the pool grows.
+         */
+        std::mutex growMutex;
+        std::vector<std::pair<std::uint8_t *, std::size_t>> slabs;
+        std::size_t blockCount = 0;
+        std::uint8_t *carved = nullptr;
+        std::uint8_t *carvedEnd = nullptr;
+
+        std::atomic<std::size_t> inUse_ = 0;
+        std::atomic<std::size_t> allocated_ = 0;
+};
+
+END_NAMESPACE_ADVANCED_RECORDER_MODULE
@@ -0,0 +1,168 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <utility>
+
+#include <advanced_recorder_module/common.h>
+
+BEGIN_NAMESPACE_ADVANCED_RECORDER_MODULE
+
+/*!
+ * @brief A bounded, lock-free, multiple-producer multiple-consumer queue.
+ *
+ * The queue is a ring of cells, each of which carries a sequence number that tells producers and
+ * consumers whether the cell is currently free or occupied (see Dmitry Vyukov's bounded MPMC
+ * queue). Neither tryPush() nor tryPop() ever blocks or allocates memory, so the queue can be
+ * used on acquisition threads without risking priority inversion.
+ *
+ * @tparam T The type of the queued elements. It must be default-constructible and
+ *     nothrow-move-assignable.
+ */
+template <typename T>
+class BoundedQueue
+{
+    public:
+
+        /*!
+         * @brief Creates an empty queue.
+         * @param capacity The maximum number of elements the queue can hold. This value is
+         *     rounded up to the next power of two.
+         * @throws std::invalid_argument @p capacity is zero.
+         */
+        explicit BoundedQueue(std::size_t capacity)
+            : mask(roundUpToPowerOfTwo(capacity) - 1)
+            , cells(std::make_unique<Cell[]>(mask + 1))
+        {
+            for (std::size_t i = 0; i <= mask; ++i)
+                cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+
+        BoundedQueue(const BoundedQueue&) = delete;
+        BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+        /*!
+         * @brief Attempts to append an element to the tail of the queue.
+         * @param value The element to append. It is moved-from only if the call succeeds.
+         * @return True if the element was appended; false if the queue is full.
+         */
+        bool tryPush(T& value) noexcept
+        {
+            Cell *cell;
+            std::size_t pos = tail.load(std::memory_order_relaxed);
+
+            for (;;)
+            {
+                cell = &cells[pos & mask];
+                std::size_t seq = cell->sequence.load(std::memory_order_acquire);
+                auto diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos);
+
+                if (diff == 0)
+                {
+                    if (tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                        break;
+                }
+
+                else if (diff < 0)
+                    return false;
+
+                else
+                    pos = tail.load(std::memory_order_relaxed);
+            }
+
+            cell->value = std::move(value);
+            cell->sequence.store(pos + 1, std::memory_order_release);
+            return true;
+        }
+
+        /*!
+         * @brief Attempts to remove an element from the head of the queue.
+         * @param value A reference to an object which receives the removed element.
+         * @return True if an element was removed; false if the queue is empty.
+         */
+        bool tryPop(T& value) noexcept
+        {
+            Cell *cell;
+            std::size_t pos = head.load(std::memory_order_relaxed);
+
+            for (;;)
+            {
+                cell = &cells[pos & mask];
+                std::size_t seq = cell->sequence.load(std::memory_order_acquire);
+                auto diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos + 1);
+
+                if (diff == 0)
+                {
+                    if (head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                        break;
+                }
+
+                else if (diff < 0)
+                    return false;
+
+                else
+                    pos = head.load(std::memory_order_relaxed);
+            }
+
+            value = std::move(cell->value);
+            cell->value = T();
+            cell->sequence.store(pos + mask + 1, std::memory_order_release);
+            return true;
+        }
+
+        /*!
+         * @brief Gets the approximate number of elements in the queue. The value may be stale
+         *     by the time the caller inspects it if other threads are concurrently using the
+         *     queue.
+         * @return The approximate number of queued elements.
+         */
+        std::size_t size() const noexcept
+        {
+            std::size_t h = head.load(std::memory_order_relaxed);
+            std::size_t t = tail.load(std::memory_order_relaxed);
+            return t > h ? t - h : 0;
+        }
+
+        /*!
+         * @brief Gets the maximum number of elements the queue can hold.
+         * @return The capacity of the queue.
+         */
+        std::size_t capacity() const noexcept
+        {
+            return mask + 1;
+        }
+
+    private:
+
+        static std::size_t roundUpToPowerOfTwo(std::size_t n)
+        {
+            if (n == 0)
+                throw std::invalid_argument("queue capacity must be non-zero");
+
+            std::size_t result = 1;
+            while (result < n)
+                result <<= 1;
+            return result;
+        }
+
+        struct Cell
+        {
+            std::atomic<std::size_t> sequence;
+            T value;
+        };
+
+        // Keep the producer and consumer indices on separate cache lines so that the
+        // acquisition threads and the writer thread do not invalidate each other's caches.
+        static constexpr std::size_t CACHE_LINE = 64;
+
+        const std::size_t mask;
+        std::unique_ptr<Cell[]> cells;
+
+        alignas(CACHE_LINE) std::atomic<std::size_t> tail = 0;
+        alignas(CACHE_LINE) std::atomic<std::size_t> head = 0;
+};
+
+END_NAMESPACE_ADVANCED_RECORDER_MODULE
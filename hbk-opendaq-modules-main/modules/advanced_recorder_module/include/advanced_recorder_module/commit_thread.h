@@ -0,0 +1,168 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <advanced_recorder_module/common.h>
+#include <advanced_recorder_module/sie/sync_handle.h>
+#include <advanced_recorder_module/statistics.h>
+
+BEGIN_NAMESPACE_ADVANCED_RECORDER_MODULE
+
+/*!
+ * @brief Specifies when recorded data is made durable, i.e. flushed from the operating system's
+ *     cache to the storage device, so that it survives a crash or loss of power.
+ */
+enum class DurabilityMode
+{
+    /*!
+     * @brief Data is never explicitly synced; the operating system writes it back eventually.
+     */
+    None,
+
+    /*!
+     * @brief Data is synced whenever a time interval has elapsed or an amount of data has been
+     *     written since the previous sync.
+     */
+    Periodic,
+
+    /*!
+     * @brief Data is synced continuously: as soon as one sync completes, another covering
+     *     everything written in the meantime is started.
+     */
+    GroupCommit,
+};
+
+/*!
+ * @brief Specifies how recorded data is made durable. The values are captured from the
+ *     AdvancedRecorderImpl properties when the recording is started.
+ */
+struct DurabilityPolicy
+{
+    DurabilityMode mode = DurabilityMode::None;
+
+    /*!
+     * @brief In periodic mode, the time after which data is synced. Zero disables this rule.
+     */
+    std::chrono::milliseconds interval { 1000 };
+
+    /*!
+     * @brief In periodic mode, the number of bytes written after which data is synced. Zero
+     *     disables this rule.
+     */
+    std::uint64_t bytes = 0;
+};
+
+/*!
+ * @brief Performance counters of a CommitThread.
+ */
+struct CommitStatistics
+{
+    /*!
+     * @brief The number of completed commits. Each commit syncs every file with pending data.
+     */
+    std::uint64_t commits = 0;
+
+    /*!
+     * @brief The recording position (see CommitThread::request()) up to which all data is known
+     *     to be durable.
+     */
+    std::uint64_t bytesCommitted = 0;
+
+    /*!
+     * @brief The median time from a commit request until the data was durable, over the
+     *     measurement interval.
+     */
+    std::chrono::nanoseconds latencyP50 { 0 };
+
+    /*!
+     * @brief The 99th percentile of the commit latency, over the measurement interval.
+     */
+    std::chrono::nanoseconds latencyP99 { 0 };
+
+    /*!
+     * @brief The longest commit latency since the thread was started.
+     */
+    std::chrono::nanoseconds latencyMax { 0 };
+};
+
+/*!
+ * @brief Makes recorded data durable in a dedicated background thread, so that neither the
+ *     acquisition threads nor the WriterThread wait for the storage device.
+ *
+ * The WriterThread calls request() with a handle obtained from the current segment's writer
+ * (see hbk::sie::basic_writer::prepare_sync()). Requests which arrive while a commit is running
+ * are coalesced: the next commit syncs each file with pending requests once, covering all data
+ * written to it before the most recent request, and is then accounted to the oldest request. The
+ * commit latency reported is therefore a bound on how long written data remains at risk.
+ */
+class CommitThread
+{
+    public:
+
+        /*!
+         * @brief Starts the background thread.
+         */
+        CommitThread();
+
+        CommitThread(const CommitThread&) = delete;
+        CommitThread& operator=(const CommitThread&) = delete;
+
+        /*!
+         * @brief Completes any pending commit and stops the background thread.
+         */
+        ~CommitThread();
+
+        /*!
+         * @brief Completes any pending commit and stops the background thread. Requests made
+         *     after this call are ignored, but the statistics remain available.
+         */
+        void stop();
+
+        /*!
+         * @brief Asks the background thread to make the data covered by @p handle durable.
+         * @param handle A handle which syncs the file, obtained after the data was written.
+         * @param position The total number of bytes recorded, in all files, when the handle was
+         *     obtained. This is reported in CommitStatistics::bytesCommitted once the commit
+         *     completes.
+         */
+        void request(hbk::sie::sync_handle handle, std::uint64_t position);
+
+        /*!
+         * @brief Determines whether a commit has been requested which has not been started yet.
+         * @return True if a request is waiting for the running commit to complete.
+         */
+        bool pending() const;
+
+        /*!
+         * @brief Gets the performance counters, and starts a new measurement interval for the
+         *     latency percentiles.
+         * @return A copy of the counters.
+         */
+        CommitStatistics collectStatistics();
+
+    private:
+
+        void run();
+
+        std::vector<hbk::sie::sync_handle> handles;
+        std::uint64_t requestedPosition = 0;
+        std::chrono::steady_clock::time_point firstRequested;
+        bool stopRequested = false;
+
+        std::uint64_t commits = 0;
+        std::uint64_t committedPosition = 0;
+        LatencyHistogram latency;
+        std::chrono::nanoseconds latencyMax { 0 };
+
+        mutable std::mutex mutex;
+        std::condition_variable cv;
+
+        std::thread thread;
+};
+
+END_NAMESPACE_ADVANCED_RECORDER_MODULE
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+
+#include <opendaq/opendaq.h>
+
+#include <advanced_recorder_module/common.h>
+#include <advanced_recorder_module/signal_handler.h>
+#include <advanced_recorder_module/sie/writer.h>
+
+BEGIN_NAMESPACE_ADVANCED_RECORDER_MODULE
+
+/*!
+ * @brief Records signals with a linear-rule domain whose samples are vectors or matrices, such
+ *     as spectra and order tracks, i.e. whose value has one or two linear-rule dimensions. Each
+ *     SIE block corresponds to one packet and consists of the 64-bit domain offset of the first
+ *     sample followed by the raw packet data, which is written straight from packet memory. The
+ *     domain ticks of the first and last sample of each block are recorded in the SIE time index.
+ *
+ * The SIE decoder emits one SIE sample per element, whose dimensions are the domain value, the
+ * index along each openDAQ dimension, and the element value. The channel metadata maps each
+ * index to the dimension's own values with a linear transform, and labels it with the
+ * dimension's name and unit.
+ */
+class MultiDimensionalSignalHandler : public SignalHandler
+{
+    public:
+
+        static bool supports(
+            const SignalPtr& signal,
+            const DataDescriptorPtr& valueDescriptor,
+            const DataDescriptorPtr& domainDescriptor);
+
+        MultiDimensionalSignalHandler(
+            hbk::sie::writer& writer,
+            unsigned testId,
+            const SignalPtr& signal,
+            const DataDescriptorPtr& valueDescriptor,
+            const DataDescriptorPtr& domainDescriptor);
+
+        void onDataPacketReceived(const DataPacketPtr& packet) override;
+
+    private:
+
+        hbk::sie::writer& writer;
+        std::uint32_t group;
+
+        std::int64_t start;
+        std::int64_t delta;
+};
+
+END_NAMESPACE_ADVANCED_RECORDER_MODULE
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <opendaq/opendaq.h>
+
+#include <advanced_recorder_module/common.h>
+#include <advanced_recorder_module/signal_handler.h>
+#include <advanced_recorder_module/sie/writer.h>
+
+BEGIN_NAMESPACE_ADVANCED_RECORDER_MODULE
+
+/*!
+ * @brief Records scalar signals with an explicit 64-bit integer domain, such as event-driven
+ *     signals. Each SIE block corresponds to one packet and consists of the 32-bit sample count,
+ *     followed by the domain values of all samples, followed by the raw sample values. Both
+ *     columns are written straight from packet memory. The domain ticks of the first and last
+ *     sample of each block are recorded in the SIE time index.
+ */
+class ScalarExplicitSignalHandler : public SignalHandler
+{
+    public:
+
+        static bool supports(
+            const SignalPtr& signal,
+            const DataDescriptorPtr& valueDescriptor,
+            const DataDescriptorPtr& domainDescriptor);
+
+        ScalarExplicitSignalHandler(
+            hbk::sie::writer& writer,
+            unsigned testId,
+            const SignalPtr& signal,
+            const DataDescriptorPtr& valueDescriptor,
+            const DataDescriptorPtr& domainDescriptor);
+
+        void onDataPacketReceived(const DataPacketPtr& packet) override;
+
+    private:
+
+        hbk::sie::writer& writer;
+        std::uint32_t group;
+        std::size_t valueBytes;
+};
+
+END_NAMESPACE_ADVANCED_RECORDER_MODULE
@@ -1,15 +1,41 @@
 #pragma once
 
+#include <chrono>
+#include <cstddef>
 #include <cstdint>
+#include <memory>
 
 #include <opendaq/opendaq.h>
 
+#include <advanced_recorder_module/block_pool.h>
 #include <advanced_recorder_module/common.h>
+#include <advanced_recorder_module/recorder_settings.h>
 #include <advanced_recorder_module/signal_handler.h>
+#include <advanced_recorder_module/sie/buffer_handle.h>
 #include <advanced_recorder_module/sie/writer.h>
 
 BEGIN_NAMESPACE_ADVANCED_RECORDER_MODULE
 
+/*!
+ * @brief Records scalar signals with a linear-rule domain. Each SIE block consists of the 64-bit
+ *     domain offset of the first sample followed by the raw sample values. The domain ticks of
+ *     the first and last sample of each block are recorded in the SIE time index.
+ *
+ * To avoid writing one small block per packet, consecutive packets whose domain offsets are
+ * contiguous are accumulated in a buffer and written as a single block once the buffer reaches
+ * RecorderSettings::blockSize bytes, once it has been held for RecorderSettings::maxBlockLatency,
+ * or as soon as a discontinuity in the domain is detected. The buffer is taken from
+ * RecorderSettings::pool when the first packet is accumulated and returned when it is written;
+ * if the pool is exhausted, packets are written as their own blocks until a buffer is available.
+ *
+ * If RecorderSettings::compress is set, the values are compressed: the domain offset is followed
+ * by the 32-bit sample count and the output of hbk::sie::xor_encode() for float32 and float64
+ * values, or of hbk::sie::delta_encode() for integer values, and the decoder reads the values
+ * with the corresponding extension element (hbk::sie::READ_XOR_ELEMENT or READ_DELTA_ELEMENT).
+ * Compressed blocks are submitted with hbk::sie::writer::submit_timed_block(), so that they are
+ * compressed on the writer's worker threads if it has a block pipeline; the merge buffer or the
+ * packet is handed over with the block.
+ */
 class ScalarLinearSignalHandler : public SignalHandler
 {
     public:
@@ -22,16 +48,41 @@ class ScalarLinearSignalHandler : public SignalHandler
         ScalarLinearSignalHandler(
             hbk::sie::writer& writer,
             unsigned testId,
+            const RecorderSettings& settings,
             const SignalPtr& signal,
             const DataDescriptorPtr& valueDescriptor,
             const DataDescriptorPtr& domainDescriptor);
 
         void onDataPacketReceived(const DataPacketPtr& packet) override;
+        void flush() override;
+        void onTick(std::chrono::steady_clock::time_point now) override;
 
     private:
 
+        void writePacket(const DataPacketPtr& packet, std::int64_t domainValue);
+        void writeCompressed(
+            std::int64_t domainValue,
+            hbk::sie::buffer_handle owner,
+            const void *data,
+            std::size_t size);
+
         hbk::sie::writer& writer;
         std::uint32_t group;
+
+        std::size_t blockSize;
+        std::chrono::milliseconds maxBlockLatency;
+        std::int64_t start;
+        std::int64_t delta;
+
+        std::shared_ptr<BlockPool> pool;
+        BlockPool::Block buffer;
+        std::int64_t bufferOffset = 0;
+        std::int64_t nextOffset = 0;
+        std::chrono::steady_clock::time_point bufferStarted;
+
+        SampleType sampleType;
+        std::size_t sampleSize;
+        bool compress;
 };
 
 END_NAMESPACE_ADVANCED_RECORDER_MODULE
@@ -1,10 +1,13 @@
 #include <cstdint>
+#include <optional>
+#include <string>
 #include <utility>
 
 #include <opendaq/opendaq.h>
 
 #include <advanced_recorder_module/common.h>
 #include <advanced_recorder_module/sie/xml.h>
+#include <advanced_recorder_module/trigger.h>
 
 
 BEGIN_NAMESPACE_ADVANCED_RECORDER_MODULE
@@ -38,6 +41,60 @@ getLinearRuleStartDelta(const DataDescriptorPtr& descriptor)
         params.getOrDefault("delta", 1));
 }
 
+/*!
+ * @brief Gets the domain time of the first sample of a data packet. This is only known for
+ *     linear-rule domains with an offset and explicit signed or unsigned 64-bit integer domains;
+ *     for other packets, nothing is returned.
+ */
+inline std::optional<DomainTime>
+getPacketDomainTime(const DataPacketPtr& packet)
+{
+    auto domainPacket = packet.getDomainPacket();
+    if (!domainPacket.assigned())
+        return std::nullopt;
+
+    auto descriptor = domainPacket.getDataDescriptor();
+    auto rule = descriptor.getRule();
+    if (!rule.assigned())
+        return std::nullopt;
+
+    double tick;
+    if (rule.getType() == DataRuleType::Linear)
+    {
+        auto offset = domainPacket.getOffset();
+        auto params = rule.getParameters();
+        if (!offset.assigned() || !params.assigned())
+            return std::nullopt;
+
+        std::int64_t start = params.getOrDefault("start", 0);
+        tick = static_cast<double>(static_cast<std::int64_t>(offset) + start);
+    }
+
+    else if (rule.getType() == DataRuleType::Explicit
+        && descriptor.getSampleType() == SampleType::Int64
+        && domainPacket.getRawDataSize() >= sizeof(std::int64_t))
+    {
+        tick = static_cast<double>(*static_cast<const std::int64_t *>(domainPacket.getRawData()));
+    }
+
+    else if (rule.getType() == DataRuleType::Explicit
+        && descriptor.getSampleType() == SampleType::UInt64
+        && domainPacket.getRawDataSize() >= sizeof(std::uint64_t))
+    {
+        tick = static_cast<double>(*static_cast<const std::uint64_t *>(domainPacket.getRawData()));
+    }
+
+    else
+        return std::nullopt;
+
+    double resolution = 1;
+    if (auto tickResolution = descriptor.getTickResolution(); tickResolution.assigned())
+        resolution = static_cast<double>(tickResolution.getNumerator())
+            / static_cast<double>(tickResolution.getDenominator());
+
+    return DomainTime(tick * resolution);
+}
+
 inline std::pair<const char *, unsigned>
 sampleTypeToSieReadType(const DataDescriptorPtr& descriptor)
 {
@@ -60,4 +117,70 @@ sampleTypeToSieReadType(const DataDescriptorPtr& descriptor)
     }
 }
 
+inline const char *
+openDaqSampleTypeToSieDataType(SampleType type)
+{
+    switch (type)
+    {
+        case SampleType::Float32: return "sequential_float32";
+        case SampleType::Float64: return "sequential_float64";
+        case SampleType::UInt8: return "sequential_uint8";
+        case SampleType::Int8: return "sequential_int8";
+        case SampleType::UInt16: return "sequential_uint16";
+        case SampleType::Int16: return "sequential_int16";
+        case SampleType::UInt32: return "sequential_uint32";
+        case SampleType::Int32: return "sequential_int32";
+        case SampleType::UInt64: return "sequential_uint64";
+        case SampleType::Int64: return "sequential_int64";
+
+        default:
+            throw InvalidParameterException(
+                "Unsupported openDAQ sample type " + std::to_string(static_cast<int>(type)));
+    }
+}
+
+inline const char *
+openDaqSampleTypeToSieDataFormat(SampleType type)
+{
+    switch (type)
+    {
+        case SampleType::Float32: return "float";
+        case SampleType::Float64: return "float";
+        case SampleType::UInt8: return "uint";
+        case SampleType::UInt16: return "uint";
+        case SampleType::UInt32: return "uint";
+        case SampleType::UInt64: return "uint";
+        case SampleType::Int8: return "int";
+        case SampleType::Int16: return "int";
+        case SampleType::Int32: return "int";
+        case SampleType::Int64: return "int";
+
+        default:
+            throw InvalidParameterException(
+                "Unsupported openDAQ sample type " + std::to_string(static_cast<int>(type)));
+    }
+}
+
+inline unsigned
+openDaqSampleTypeToSieBits(SampleType type)
+{
+    switch (type)
+    {
+        case SampleType::Float32: return 32;
+        case SampleType::Float64: return 64;
+        case SampleType::UInt8: return 8;
+        case SampleType::Int8: return 8;
+        case SampleType::UInt16: return 16;
+        case SampleType::Int16: return 16;
+        case SampleType::UInt32: return 32;
+        case SampleType::Int32: return 32;
+        case SampleType::UInt64: return 64;
+        case SampleType::Int64: return 64;
+
+        default:
+            throw InvalidParameterException(
+                "Unsupported openDAQ sample type " + std::to_string(static_cast<int>(type)));
+    }
+}
+
 END_NAMESPACE_ADVANCED_RECORDER_MODULE
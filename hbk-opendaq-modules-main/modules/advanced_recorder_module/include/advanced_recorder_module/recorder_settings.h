@@ -0,0 +1,47 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <memory>
+
+#include <advanced_recorder_module/block_pool.h>
+#include <advanced_recorder_module/common.h>
+
+BEGIN_NAMESPACE_ADVANCED_RECORDER_MODULE
+
+/*!
+ * @brief Contains the recorder configuration which is passed down to the signal handlers. The
+ *     values are captured from the AdvancedRecorderImpl properties when the recording is started.
+ */
+struct RecorderSettings
+{
+    /*!
+     * @brief The payload size, in bytes, at which a signal handler writes its accumulated
+     *     samples as an SIE block. Consecutive packets are merged into one block until this size
+     *     is reached. Zero disables merging, so each packet is written as its own block.
+     */
+    std::size_t blockSize = 65536;
+
+    /*!
+     * @brief The maximum time for which a signal handler may hold accumulated samples before
+     *     writing them, even if blockSize has not been reached.
+     */
+    std::chrono::milliseconds maxBlockLatency { 500 };
+
+    /*!
+     * @brief The pool of blockSize-byte buffers in which signal handlers accumulate samples. A
+     *     handler holds a buffer only while it has accumulated samples. If null, or if the pool
+     *     is exhausted, each packet is written as its own block.
+     */
+    std::shared_ptr<BlockPool> pool;
+
+    /*!
+     * @brief If true, signal handlers compress sample values losslessly where they support it:
+     *     the values of linear-domain scalar signals are XOR-compressed if they are float32 or
+     *     float64 (see hbk::sie::xor_encode()) and delta-compressed if they are integers (see
+     *     hbk::sie::delta_encode()). Other signals are recorded uncompressed.
+     */
+    bool compress = false;
+};
+
+END_NAMESPACE_ADVANCED_RECORDER_MODULE
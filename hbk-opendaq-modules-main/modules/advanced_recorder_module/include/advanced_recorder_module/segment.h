@@ -0,0 +1,136 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <string>
+
+#include <advanced_recorder_module/common.h>
+#include <advanced_recorder_module/sie/writer.h>
+
+BEGIN_NAMESPACE_ADVANCED_RECORDER_MODULE
+
+/*!
+ * @brief Specifies when a recording is split into a new file (segment). A limit of zero disables
+ *     the corresponding rule; if all limits are zero, the recording is written to a single file.
+ */
+struct RotationPolicy
+{
+    /*!
+     * @brief The size, in bytes, at which a segment is closed and the next one started.
+     */
+    std::uint64_t maxBytes = 0;
+
+    /*!
+     * @brief The time after which a segment is closed and the next one started.
+     */
+    std::chrono::seconds maxDuration { 0 };
+
+    /*!
+     * @brief If nonzero, a new segment is started whenever the wall-clock time (UTC) crosses a
+     *     multiple of this interval, e.g. at the top of every hour for an interval of 3600 s.
+     */
+    std::chrono::seconds boundary { 0 };
+
+    /*!
+     * @brief Determines whether any rotation rule is enabled.
+     * @return True if the recording should be split into segments.
+     */
+    bool enabled() const noexcept
+    {
+        return maxBytes || maxDuration.count() || boundary.count();
+    }
+};
+
+/*!
+ * @brief An open, initialized SIE file: the preamble and any channel metadata known when it was
+ *     created have been written, and it is ready to receive data blocks.
+ */
+struct Segment
+{
+    /*!
+     * @brief The path and filename of the file.
+     */
+    std::string filename;
+
+    /*!
+     * @brief The writer for the file. The file is closed when the last reference is released.
+     */
+    std::shared_ptr<hbk::sie::writer> writer;
+};
+
+/*!
+ * @brief A function which creates and initializes the segment with the specified sequence number.
+ *     It may be called from a background thread, so it must not access the function block.
+ */
+typedef std::function<Segment(unsigned sequence)> SegmentFactory;
+
+/*!
+ * @brief Generates the filename of a segment from a template.
+ *
+ * The following placeholders are replaced:
+ *
+ * - `{base}`: @p filename without its extension, e.g. `/data/run` for `/data/run.sie`.
+ * - `{ext}`: the extension of @p filename, including the dot, e.g. `.sie`.
+ * - `{seq}`: the sequence number of the segment, starting from 0.
+ * - `{seq:N}`: the sequence number, zero-padded to N digits.
+ *
+ * Any other text, including unrecognized placeholders, is copied unchanged.
+ *
+ * @param pattern The template, e.g. `{base}_{seq:04}.sie`.
+ * @param filename The configured filename of the recording.
+ * @param sequence The sequence number of the segment.
+ * @return The filename of the segment.
+ */
+inline std::string formatSegmentFilename(
+    const std::string& pattern,
+    const std::string& filename,
+    unsigned sequence)
+{
+    std::filesystem::path path(filename);
+    std::string ext = path.extension().string();
+    std::string base = path.replace_extension().string();
+
+    std::string result;
+    std::size_t pos = 0;
+
+    while (pos < pattern.size())
+    {
+        auto open = pattern.find('{', pos);
+        auto close = open == std::string::npos ? std::string::npos : pattern.find('}', open);
+        if (close == std::string::npos)
+        {
+            result.append(pattern, pos, std::string::npos);
+            break;
+        }
+
+        result.append(pattern, pos, open - pos);
+
+        std::string name = pattern.substr(open + 1, close - open - 1);
+        if (name == "base")
+            result += base;
+        else if (name == "ext")
+            result += ext;
+        else if (name == "seq")
+            result += std::to_string(sequence);
+        else if (name.rfind("seq:", 0) == 0)
+        {
+            std::string digits = std::to_string(sequence);
+            std::size_t width = std::strtoul(name.c_str() + 4, nullptr, 10);
+            if (digits.size() < width)
+                result.append(width - digits.size(), '0');
+            result += digits;
+        }
+        else
+            result.append(pattern, open, close - open + 1);
+
+        pos = close + 1;
+    }
+
+    return result;
+}
+
+END_NAMESPACE_ADVANCED_RECORDER_MODULE
@@ -3,11 +3,14 @@
 #include <cstddef>
 #include <cstdint>
 #include <filesystem>
+#include <memory>
+#include <utility>
 
 #include <boost/endian/conversion.hpp>
-#include <boost/crc.hpp>
-
+#include <advanced_recorder_module/sie/buffer_handle.h>
+#include <advanced_recorder_module/sie/crc32.h>
 #include <advanced_recorder_module/sie/format.h>
+#include <advanced_recorder_module/sie/sync_handle.h>
 
 namespace hbk::sie
 {
@@ -19,13 +22,21 @@ namespace hbk::sie
      *
      * This class provides the write_block() function, which supports vectored (scatter/gather)
      * writes by accepting one or more pairs of arguments describing the payload data segments.
+     * The write_block_retained() variant additionally takes a buffer_handle which keeps the
+     * payload alive until it has been written, so that asynchronous file implementations need
+     * not copy it.
      *
      * This class is implemented using template-based dependency injection. This pattern allows
      * for better reuse and unit-testing.
      *
      * @tparam VectorIoFile A type which implements vectored (scatter/gather) file output. This
      *     type must be noexcept-moveable and must provide a write() function which accepts one or
-     *     more pairs of data/size arguments describing the data segments to write.
+     *     more pairs of data/size arguments describing the data segments to write, and a flush()
+     *     function which submits any buffered writes to the operating system. To use
+     *     write_block_retained(), it must also provide a write_retained() function which takes a
+     *     buffer_handle followed by the data/size pairs, and releases the handle once the data
+     *     segments are no longer needed. To use prepare_sync() or sync(), it must provide the
+     *     functions of the same names, which make the data written so far durable.
      */
     template <typename VectorIoFile>
     class basic_block_writer
@@ -70,6 +81,145 @@ namespace hbk::sie
                 block_header header;
                 block_footer footer;
 
+                std::size_t block_size = seal(header, footer, group, args...);
+
+                file.write(
+                    &header, sizeof(header),
+                    args...,
+                    &footer, sizeof(footer));
+
+                return block_size;
+            }
+
+            /**
+             * Writes a block to the SIE file without requiring the payload data to remain valid
+             * only until the call returns. Instead, @p owner is kept until the underlying file
+             * has finished with the data, and then released. Depending on the VectorIoFile
+             * implementation, this may happen before the call returns or some time later (for
+             * example when an asynchronous write completes), possibly from a later call to
+             * write_block(), write_block_retained() or flush(), or from the destructor.
+             *
+             * @param group The group ID of the block.
+             * @param owner A handle which keeps the memory described by @p args valid.
+             * @param args One or more pairs of arguments describing the payload data, as for
+             *     write_block(). The data must not be modified until @p owner is released.
+             *
+             * @return The number of bytes written, including the block header and footer.
+             *
+             * @throws ... This function propagates any exception thrown by
+             *     VectorIoFile::write_retained().
+             */
+            template <typename ... Args>
+            std::size_t write_block_retained(
+                std::uint32_t group,
+                buffer_handle owner,
+                Args&&... args)
+            {
+                // The header and footer must outlive the write, too, so they are kept together
+                // with the caller's handle.
+                auto block = std::make_shared<retained_block>();
+                block->payload = std::move(owner);
+
+                auto& header = block->header;
+                auto& footer = block->footer;
+                std::size_t block_size = seal(header, footer, group, args...);
+
+                file.write_retained(
+                    std::move(block),
+                    &header, sizeof(header),
+                    args...,
+                    &footer, sizeof(footer));
+
+                return block_size;
+            }
+
+            /**
+             * Writes a block which has already been sealed, i.e. whose header, payload and
+             * footer, including the checksum, are in place (see seal_block()), as-is. @p owner
+             * is kept until the underlying file has finished with the data, as for
+             * write_block_retained().
+             *
+             * @param owner A handle which keeps the memory pointed to by @p data valid.
+             * @param data The complete block.
+             * @param size The size of the block, including the header and footer.
+             *
+             * @return @p size.
+             *
+             * @throws ... This function propagates any exception thrown by
+             *     VectorIoFile::write_retained().
+             */
+            std::size_t write_sealed_block_retained(
+                buffer_handle owner,
+                const void *data,
+                std::size_t size)
+            {
+                file.write_retained(std::move(owner), data, size);
+                return size;
+            }
+
+            /**
+             * Submits any writes buffered by the underlying file to the operating system.
+             *
+             * @throws ... This function propagates any exception thrown by VectorIoFile::flush().
+             */
+            void flush()
+            {
+                file.flush();
+            }
+
+            /**
+             * Prepares to make the blocks written so far durable, so that they survive a crash of
+             * the operating system or a loss of power. Any writes buffered or in flight in the
+             * underlying file are completed first.
+             *
+             * @return A handle whose sync() function, which may be called from any thread, makes
+             *     the blocks written before this call durable.
+             *
+             * @throws ... This function propagates any exception thrown by
+             *     VectorIoFile::prepare_sync().
+             */
+            sync_handle prepare_sync()
+            {
+                return file.prepare_sync();
+            }
+
+            /**
+             * Makes the blocks written so far durable. This blocks until the storage device has
+             * acknowledged the data; see prepare_sync() for a way to do this on another thread.
+             *
+             * @throws ... This function propagates any exception thrown by VectorIoFile::sync().
+             */
+            void sync()
+            {
+                file.sync();
+            }
+
+        private:
+
+            /**
+             * The header and footer of a block written by write_block_retained(), together with
+             * the handle keeping its payload alive.
+             */
+            struct retained_block
+            {
+                block_header header;
+                block_footer footer;
+                buffer_handle payload;
+            };
+
+            /**
+             * Fills in the header and footer of a block, including the checksum of the header
+             * and payload.
+             *
+             * @return The size of the block, including the header and footer.
+             */
+            template <typename ... Args>
+            static std::size_t seal(
+                block_header& header,
+                block_footer& footer,
+                std::uint32_t group,
+                Args... args)
+            {
                 std::size_t payload_size = get_payload_size(args...);
 
                 header.size = boost::endian::native_to_big<std::uint32_t>(
@@ -77,40 +227,33 @@ namespace hbk::sie
                 header.group = boost::endian::native_to_big<std::uint32_t>(group);
                 header.sync = boost::endian::native_to_big<std::uint32_t>(SYNC_WORD);
 
-                boost::crc_32_type crc;
+                crc32 crc;
                 crc.process_bytes(&header, sizeof(header));
                 do_payload_crc(crc, args...);
 
                 footer.checksum = boost::endian::native_to_big<std::uint32_t>(crc());
                 footer.size = header.size;
 
-                file.write(
-                    &header, sizeof(header),
-                    args...,
-                    &footer, sizeof(footer));
-
                 return sizeof(header) + payload_size + sizeof(footer);
             }
 
-        private:
-
             static std::size_t get_payload_size()
             {
                 return 0;
             }
 
             template <typename ... Args>
-            static std::size_t get_payload_size(const void *data, std::size_t size, Args... args)
+            static std::size_t get_payload_size(const void *, std::size_t size, Args... args)
             {
                 return size + get_payload_size(args...);
             }
 
-            static void do_payload_crc(boost::crc_32_type& crc)
+            static void do_payload_crc(crc32&)
             {
             }
 
             template <typename ... Args>
-            static void do_payload_crc(boost::crc_32_type& crc,
+            static void do_payload_crc(crc32& crc,
                 const void *data, std::size_t size, Args... args)
             {
                 crc.process_bytes(data, size);
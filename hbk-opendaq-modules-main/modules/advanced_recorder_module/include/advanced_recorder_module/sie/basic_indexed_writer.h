@@ -1,11 +1,16 @@
 #pragma once
 
+#include <algorithm>
+#include <cstddef>
 #include <cstdint>
 #include <exception>
+#include <optional>
 #include <utility>
 #include <vector>
 
+#include <advanced_recorder_module/sie/buffer_handle.h>
 #include <advanced_recorder_module/sie/format.h>
+#include <advanced_recorder_module/sie/sync_handle.h>
 
 namespace hbk::sie
 {
@@ -15,30 +20,68 @@ namespace hbk::sie
      * periodically emits index blocks containing the group number and offset of each
      * previously-written block.
      *
-     * This class wraps the write_block() function of the underlying block layer. It also adds a
-     * flush_index() function which can be called to explicitly generate an index block. Index
-     * blocks are also periodically emitted automatically.
+     * Data blocks written with write_timed_block() are additionally recorded, together with the
+     * domain ticks of their first and last samples, in time index blocks (see
+     * groups::TIME_INDEX). A time index block, if there is anything to record, is emitted just
+     * before each index block, and is itself listed in that index block. This allows readers to
+     * locate the data covering a time window without decoding any data blocks.
+     *
+     * The index blocks are themselves indexed by index directories, which are also group 1
+     * blocks, but list other group 1 blocks instead of data blocks. A directory is emitted after
+     * every index_every() index blocks and when the file is finished. Each one lists the index
+     * blocks written since the previous directory, and the previous directory itself, so every
+     * index block can be reached from any later directory while visiting only one in
+     * index_every() index blocks along the way. A finished file ends with a fixed-size trailer: a
+     * directory with a single entry pointing at the last directory. Standard SIE readers see
+     * directories as ordinary index blocks, whose entries correctly describe other blocks.
+     *
+     * This class wraps the write_block() and write_block_retained() functions of the underlying
+     * block layer. It also adds a flush_index() function which can be called to explicitly
+     * generate an index block, and a finish() function which writes the closing index blocks.
+     * Index blocks are also periodically emitted automatically.
      *
      * This class is implemented using template-based dependency injection. This pattern allows
      * for better reuse and unit-testing.
      *
      * @tparam BlockWriter A type which implements the block layer of SIE file writing. This type
-     *     must be noexcept-moveable and must provide a write_block() function.
+     *     must be noexcept-moveable and must provide write_block() and flush() functions,
+     *     write_block_retained() if the retained variants of the write functions are used, and
+     *     write_sealed_block_retained() if write_sealed_block() is used.
      */
     template <typename BlockWriter>
     class basic_indexed_writer
     {
         public:
 
+            /**
+             * The default number of blocks listed in each index block, and of index blocks listed
+             * in each index directory.
+             */
+            static constexpr std::size_t DEFAULT_INDEX_EVERY = 100;
+
+            /**
+             * The size of the trailer block written by finish(), which is always the last block
+             * of a finished file and points at the last index directory.
+             */
+            static constexpr std::size_t TRAILER_SIZE =
+                sizeof(block_header) + sizeof(index_entry) + sizeof(block_footer);
+
             /**
              * Creates a new indexed writer.
              *
              * @param writer A @p BlockWriter object which is moved-into the constructed object.
              *     After the call, @p writer is in an invalid state and its members should not be
              *     accessed.
+             * @param index_every The number of blocks after which an index block is emitted, and
+             *     of index blocks after which an index directory is emitted. Smaller values let
+             *     readers recover more of an interrupted recording from its index, at the cost of
+             *     more and smaller index blocks. Values less than 2 are treated as 2.
              */
-            basic_indexed_writer(BlockWriter&& writer) noexcept
+            basic_indexed_writer(
+                    BlockWriter&& writer,
+                    std::size_t index_every = DEFAULT_INDEX_EVERY) noexcept
                 : writer(std::move(writer))
+                , every(std::max<std::size_t>(index_every, 2))
             {
             }
 
@@ -59,14 +102,108 @@ namespace hbk::sie
                 std::uint32_t group,
                 Args&&... args)
             {
-                if (group != groups::INDEX)
-                    index.emplace_back(
-                        boost::endian::native_to_big<std::uint64_t>(offset),
-                        boost::endian::native_to_big<std::uint32_t>(group));
+                append_block(group, args...);
 
-                offset += writer.write_block(group, args...);
+                if (index.size() >= every)
+                    flush_index();
+            }
+
+            /**
+             * Writes a data block, like write_block(), and records it in the time index.
+             *
+             * @param group The group ID of the block.
+             * @param first The domain tick of the first sample in the block.
+             * @param last The domain tick of the last sample in the block.
+             * @param args One or more pairs of arguments describing the payload data, as for
+             *     write_block().
+             *
+             * @throws ... This function propagates any exception thrown by
+             *     BlockWriter::write_block().
+             */
+            template <typename ... Args>
+            void write_timed_block(
+                std::uint32_t group,
+                std::int64_t first,
+                std::int64_t last,
+                Args&&... args)
+            {
+                record_time(group, first, last);
+                write_block(group, args...);
+            }
+
+            /**
+             * @copydoc basic_block_writer::write_block_retained()
+             *
+             * This call may also autonomously emit an index block, as for write_block().
+             */
+            template <typename ... Args>
+            void write_block_retained(
+                std::uint32_t group,
+                buffer_handle owner,
+                Args&&... args)
+            {
+                record(group);
+                offset += writer.write_block_retained(group, std::move(owner), args...);
+                ++blocks;
+
+                if (index.size() >= every)
+                    flush_index();
+            }
+
+            /**
+             * Writes a data block, like write_block_retained(), and records it in the time index.
+             *
+             * @param group The group ID of the block.
+             * @param first The domain tick of the first sample in the block.
+             * @param last The domain tick of the last sample in the block.
+             * @param owner A handle which keeps the memory described by @p args valid.
+             * @param args One or more pairs of arguments describing the payload data, as for
+             *     write_block_retained().
+             *
+             * @throws ... This function propagates any exception thrown by
+             *     BlockWriter::write_block_retained().
+             */
+            template <typename ... Args>
+            void write_timed_block_retained(
+                std::uint32_t group,
+                std::int64_t first,
+                std::int64_t last,
+                buffer_handle owner,
+                Args&&... args)
+            {
+                record_time(group, first, last);
+                write_block_retained(group, std::move(owner), args...);
+            }
+
+            /**
+             * Writes a data block which has already been sealed, such as one produced by a
+             * block_pipeline, and records it in the index and the time index, like
+             * write_timed_block_retained().
+             *
+             * @param group The group ID of the block, which must match its header.
+             * @param first The domain tick of the first sample in the block.
+             * @param last The domain tick of the last sample in the block.
+             * @param owner A handle which keeps the memory pointed to by @p data valid.
+             * @param data The complete block.
+             * @param size The size of the block, including the header and footer.
+             *
+             * @throws ... This function propagates any exception thrown by
+             *     BlockWriter::write_sealed_block_retained().
+             */
+            void write_sealed_block(
+                std::uint32_t group,
+                std::int64_t first,
+                std::int64_t last,
+                buffer_handle owner,
+                const void *data,
+                std::size_t size)
+            {
+                record_time(group, first, last);
+                record(group);
+                offset += writer.write_sealed_block_retained(std::move(owner), data, size);
+                ++blocks;
 
-                if (index.size() >= INDEX_EVERY)
+                if (index.size() >= every)
                     flush_index();
             }
 
@@ -83,23 +220,138 @@ namespace hbk::sie
                 if (index.empty())
                     return;
 
-                offset += writer.write_block(
-                    groups::INDEX,
-                    index.data(),
-                    index.size() * sizeof(index_entry));
+                if (!time_index.empty())
+                {
+                    append_block(
+                        groups::TIME_INDEX,
+                        time_index.data(),
+                        time_index.size() * sizeof(time_index_entry));
+
+                    time_index.clear();
+                }
+
+                directory.emplace_back(
+                    boost::endian::native_to_big<std::uint64_t>(offset),
+                    boost::endian::native_to_big<std::uint32_t>(groups::INDEX));
+
+                append_index_block(index);
+                ++index_flushes;
+
+                if (directory.size() >= every)
+                    flush_directory();
+            }
+
+            /**
+             * Emits the closing index block, if any not-yet-indexed blocks have been written,
+             * followed by a final index directory and the trailer, which let readers locate all
+             * index blocks quickly. This is called automatically when the writer is destroyed,
+             * but may be called explicitly first, e.g. to make the complete file durable with
+             * sync() before closing it. No blocks may be written after this call; further calls
+             * have no effect.
+             *
+             * @throws ... This function propagates any exception thrown by
+             *     BlockWriter::write_block().
+             */
+            void finish()
+            {
+                if (finished)
+                    return;
+
+                flush_index();
+                flush_directory();
+
+                if (last_directory)
+                {
+                    std::vector<index_entry> trailer;
+                    trailer.emplace_back(
+                        boost::endian::native_to_big<std::uint64_t>(*last_directory),
+                        boost::endian::native_to_big<std::uint32_t>(groups::INDEX));
+                    append_index_block(trailer);
+                }
+
+                finished = true;
+            }
 
-                index.clear();
+            /**
+             * Gets the number of blocks listed in each index block, and of index blocks listed in
+             * each index directory.
+             *
+             * @return The value passed to the constructor, or 2 if it was less than that.
+             */
+            std::size_t index_every() const noexcept
+            {
+                return every;
+            }
+
+            /**
+             * Gets the number of bytes written to the file so far, including all block headers,
+             * footers and index blocks.
+             *
+             * @return The current size of the file.
+             */
+            std::uint64_t size() const noexcept
+            {
+                return offset;
+            }
+
+            /**
+             * Gets the number of blocks written to the file so far, including index blocks.
+             *
+             * @return The number of blocks written.
+             */
+            std::uint64_t block_count() const noexcept
+            {
+                return blocks;
+            }
+
+            /**
+             * Gets the number of index blocks written to the file so far, whether emitted
+             * autonomously or by flush_index().
+             *
+             * @return The number of index blocks written.
+             */
+            std::uint64_t index_flush_count() const noexcept
+            {
+                return index_flushes;
+            }
+
+            /**
+             * @copydoc basic_block_writer::flush()
+             */
+            void flush()
+            {
+                writer.flush();
+            }
+
+            /**
+             * @copydoc basic_block_writer::prepare_sync()
+             *
+             * Blocks which have not been indexed yet are durable, too, but readers only find
+             * them by scanning; call flush_index() first if the index must be durable as well,
+             * or finish() if the file is about to be closed.
+             */
+            sync_handle prepare_sync()
+            {
+                return writer.prepare_sync();
+            }
+
+            /**
+             * @copydoc basic_block_writer::sync()
+             */
+            void sync()
+            {
+                writer.sync();
             }
 
             /**
-             * Emits a closing index block, if any not-yet-indexed blocks have been written. If an
-             * I/O error occurrs, it is silently ignored.
+             * Calls finish(), if it has not been called yet. If an I/O error occurrs, it is
+             * silently ignored.
              */
             ~basic_indexed_writer() noexcept
             {
                 try
                 {
-                    flush_index();
+                    finish();
                 }
 
                 catch (const std::exception&)
@@ -110,15 +362,92 @@ namespace hbk::sie
         private:
 
             /**
-             * An index block is automatically emitted after this number of non-index blocks have
-             * been written via write_block(). Index blocks can also be explicitly emitted by
-             * calling flush_index().
+             * Writes a block and records it in the index, without emitting an index block.
              */
-            static constexpr std::size_t INDEX_EVERY = 100;
+            template <typename ... Args>
+            void append_block(
+                std::uint32_t group,
+                Args&&... args)
+            {
+                record(group);
+                offset += writer.write_block(group, args...);
+                ++blocks;
+            }
+
+            /**
+             * Emits an index directory listing the previous directory and the index blocks
+             * written since, if there are any.
+             */
+            void flush_directory()
+            {
+                if (directory.empty())
+                    return;
+
+                if (last_directory)
+                    directory.emplace(
+                        directory.begin(),
+                        boost::endian::native_to_big<std::uint64_t>(*last_directory),
+                        boost::endian::native_to_big<std::uint32_t>(groups::INDEX));
+
+                last_directory = offset;
+                append_index_block(directory);
+            }
+
+            /**
+             * Writes a group 1 block containing @p entries, which is not itself recorded in the
+             * index, and clears @p entries.
+             */
+            void append_index_block(std::vector<index_entry>& entries)
+            {
+                offset += writer.write_block(
+                    groups::INDEX,
+                    entries.data(),
+                    entries.size() * sizeof(index_entry));
+
+                ++blocks;
+                entries.clear();
+            }
+
+            /**
+             * Records the block about to be written at the current offset in the index.
+             */
+            void record(std::uint32_t group)
+            {
+                if (group != groups::INDEX)
+                    index.emplace_back(
+                        boost::endian::native_to_big<std::uint64_t>(offset),
+                        boost::endian::native_to_big<std::uint32_t>(group));
+            }
+
+            /**
+             * Records the data block about to be written at the current offset in the time
+             * index.
+             */
+            void record_time(std::uint32_t group, std::int64_t first, std::int64_t last)
+            {
+                time_index.emplace_back(
+                    boost::endian::native_to_big<std::uint64_t>(offset),
+                    boost::endian::native_to_big<std::uint32_t>(group),
+                    boost::endian::native_to_big<std::int64_t>(first),
+                    boost::endian::native_to_big<std::int64_t>(last));
+            }
 
             BlockWriter writer;
 
+            /**
+             * An index block is automatically emitted after this number of non-index blocks have
+             * been written via write_block(), and an index directory after this number of index
+             * blocks. Index blocks can also be explicitly emitted by calling flush_index().
+             */
+            std::size_t every;
+
             std::vector<index_entry> index;
+            std::vector<time_index_entry> time_index;
+            std::vector<index_entry> directory;
+            std::optional<std::uint64_t> last_directory;
+            bool finished = false;
             std::uint64_t offset = 0;
+            std::uint64_t blocks = 0;
+            std::uint64_t index_flushes = 0;
     };
 }
@@ -1,11 +1,21 @@
 #pragma once
 
 #include <atomic>
+#include <cstddef>
 #include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <unordered_map>
 #include <utility>
+#include <vector>
 
+#include <advanced_recorder_module/sie/block_pipeline.h>
+#include <advanced_recorder_module/sie/buffer_handle.h>
 #include <advanced_recorder_module/sie/format.h>
+#include <advanced_recorder_module/sie/sync_handle.h>
 
 namespace hbk::sie
 {
@@ -17,11 +27,18 @@ namespace hbk::sie
      * this purpose. It also adds the write_metadata() function for writing XML strings to the
      * special metadata group (group 0).
      *
+     * Data blocks whose payload is expensive to produce, such as compressed sample values, can be
+     * submitted with submit_timed_block(). If start_pipeline() has been called, they are encoded
+     * and checksummed by the worker threads of a block_pipeline and written in submission order
+     * by later calls on the writing thread; otherwise they are encoded and written immediately.
+     *
      * This class is implemented using template-based dependency injection. This pattern allows
      * for better reuse and unit-testing.
      *
      * @tparam Writer A type which implements the block or block indexing layer of SIE file
-     *     writing. This type must be noexcept-moveable and must provide a write_block() function.
+     *     writing. This type must be noexcept-moveable and must provide write_block() and flush()
+     *     functions. To use start_pipeline(), it must also provide write_sealed_block(); the
+     *     code which calls it is only instantiated by start_pipeline().
      */
     template <typename Writer>
     class basic_writer
@@ -40,6 +57,22 @@ namespace hbk::sie
             {
             }
 
+            /**
+             * Writes the blocks still pending in the pipeline, if one has been started. If an
+             * error occurs, it is silently ignored.
+             */
+            ~basic_writer() noexcept
+            {
+                try
+                {
+                    drain();
+                }
+
+                catch (const std::exception&)
+                {
+                }
+            }
+
             /**
              * Allocate and returns a unique channel identifier.
              *
@@ -60,6 +93,31 @@ namespace hbk::sie
                 return next_decoder_id++;
             }
 
+            /**
+             * Gets the identifier of the decoder with the specified definition, allocating a new
+             * one if no such decoder has been used in this SIE file yet. Channels whose data is
+             * laid out identically, including the channels of successive tests recording the
+             * same signals, can thereby share one decoder.
+             *
+             * This function is thread-safe.
+             *
+             * @param definition A string which uniquely describes the decoder, such as its XML
+             *     serialized with a placeholder identifier.
+             *
+             * @return The decoder identifier, and true if it was newly allocated, in which case
+             *     the caller must write the decoder's XML with write_metadata().
+             */
+            std::pair<unsigned, bool> intern_decoder(const std::string& definition)
+            {
+                std::lock_guard<std::mutex> lock(decoders_mutex);
+
+                auto [it, created] = decoders.try_emplace(definition, 0);
+                if (created)
+                    it->second = allocate_decoder();
+
+                return { it->second, created };
+            }
+
             /**
              * Allocate and returns a unique group number.
              *
@@ -107,13 +165,228 @@ namespace hbk::sie
                 writer.write_block(group, args...);
             }
 
+            /**
+             * @copydoc basic_indexed_writer::write_timed_block()
+             */
+            template <typename ... Args>
+            void write_timed_block(
+                std::uint32_t group,
+                std::int64_t first,
+                std::int64_t last,
+                Args&&... args)
+            {
+                writer.write_timed_block(group, first, last, args...);
+            }
+
+            /**
+             * @copydoc basic_block_writer::write_block_retained()
+             */
+            template <typename ... Args>
+            void write_block_retained(
+                std::uint32_t group,
+                buffer_handle owner,
+                Args&&... args)
+            {
+                writer.write_block_retained(group, std::move(owner), args...);
+            }
+
+            /**
+             * @copydoc basic_indexed_writer::write_timed_block_retained()
+             */
+            template <typename ... Args>
+            void write_timed_block_retained(
+                std::uint32_t group,
+                std::int64_t first,
+                std::int64_t last,
+                buffer_handle owner,
+                Args&&... args)
+            {
+                writer.write_timed_block_retained(group, first, last, std::move(owner), args...);
+            }
+
+            /**
+             * Starts a pipeline which encodes and checksums the blocks passed to
+             * submit_timed_block() on worker threads. This must be called before any block is
+             * submitted.
+             *
+             * @param threads The number of worker threads. Zero selects one per hardware thread.
+             * @param max_in_flight The maximum number of submitted blocks which may be pending at
+             *     a time; submit_timed_block() waits while this many are.
+             */
+            void start_pipeline(
+                unsigned threads,
+                std::size_t max_in_flight = block_pipeline::DEFAULT_MAX_IN_FLIGHT)
+            {
+                // Only this function refers to Writer::write_sealed_block(), so writers which
+                // do not provide it can be used as long as no pipeline is started.
+                emit = [this](sealed_block block)
+                {
+                    auto data = block.data->data();
+                    auto size = block.data->size();
+                    writer.write_sealed_block(block.group, block.first, block.last,
+                        std::move(block.data), data, size);
+                };
+
+                pipeline = std::make_unique<block_pipeline>(threads, max_in_flight);
+            }
+
+            /**
+             * Writes a data block whose payload is produced by @p encode, and records it in the
+             * time index, like write_timed_block(). If a pipeline has been started, the payload
+             * is encoded and checksummed on a worker thread, and the block is written by this or
+             * a later call to submit_timed_block(), flush(), finish() or the destructor, in the
+             * order in which blocks were submitted. Blocks written by the other write functions
+             * may overtake pending submitted blocks, so all blocks of a group should be written
+             * the same way. Otherwise, the block is encoded and written before the call returns.
+             *
+             * @param group The group ID of the block.
+             * @param first The domain tick of the first sample in the block.
+             * @param last The domain tick of the last sample in the block.
+             * @param encode The function which appends the payload to the vector it is passed.
+             *
+             * @throws ... This function propagates any exception thrown by @p encode (or by the
+             *     encoder of an earlier block) or by Writer::write_timed_block() or
+             *     Writer::write_sealed_block().
+             */
+            void submit_timed_block(
+                std::uint32_t group,
+                std::int64_t first,
+                std::int64_t last,
+                block_encoder encode)
+            {
+                if (pipeline)
+                {
+                    pipeline->submit(group, first, last, std::move(encode), emit);
+                    return;
+                }
+
+                // The encoding buffer is kept between blocks to avoid reallocating it.
+                scratch.resize(sizeof(block_header));
+                encode(scratch);
+
+                writer.write_timed_block(group, first, last,
+                    scratch.data() + sizeof(block_header),
+                    scratch.size() - sizeof(block_header));
+            }
+
+            /**
+             * Waits for all blocks pending in the pipeline, if one has been started, and writes
+             * them.
+             *
+             * @throws ... This function propagates any exception thrown by an encoder or by
+             *     Writer::write_sealed_block().
+             */
+            void drain()
+            {
+                if (pipeline)
+                    pipeline->drain(emit);
+            }
+
+            /**
+             * @copydoc basic_indexed_writer::flush_index()
+             */
+            void flush_index()
+            {
+                writer.flush_index();
+            }
+
+            /**
+             * @copydoc basic_indexed_writer::finish()
+             *
+             * Blocks pending in the pipeline are written first.
+             */
+            void finish()
+            {
+                drain();
+                writer.finish();
+            }
+
+            /**
+             * @copydoc basic_indexed_writer::size()
+             *
+             * Blocks pending in the pipeline are not included.
+             */
+            std::uint64_t size() const noexcept
+            {
+                return writer.size();
+            }
+
+            /**
+             * @copydoc basic_indexed_writer::block_count()
+             */
+            std::uint64_t block_count() const noexcept
+            {
+                return writer.block_count();
+            }
+
+            /**
+             * @copydoc basic_indexed_writer::index_flush_count()
+             */
+            std::uint64_t index_flush_count() const noexcept
+            {
+                return writer.index_flush_count();
+            }
+
+            /**
+             * @copydoc basic_indexed_writer::index_every()
+             */
+            std::size_t index_every() const noexcept
+            {
+                return writer.index_every();
+            }
+
+            /**
+             * @copydoc basic_block_writer::flush()
+             *
+             * Blocks which the pipeline has completed in order are written first, without
+             * waiting for the others.
+             */
+            void flush()
+            {
+                if (pipeline)
+                    pipeline->poll(emit);
+
+                writer.flush();
+            }
+
+            /**
+             * @copydoc basic_indexed_writer::prepare_sync()
+             *
+             * Blocks pending in the pipeline are not included; call drain() first if they must
+             * be.
+             */
+            sync_handle prepare_sync()
+            {
+                return writer.prepare_sync();
+            }
+
+            /**
+             * @copydoc basic_block_writer::sync()
+             */
+            void sync()
+            {
+                writer.sync();
+            }
+
         private:
 
             std::atomic<unsigned> next_channel_id = 0;
-            std::atomic<unsigned> next_decoder_id = 2;
-            std::atomic<std::uint32_t> next_group = 2;
+            std::atomic<unsigned> next_decoder_id = 3;
+            std::atomic<std::uint32_t> next_group = 3;
             std::atomic<unsigned> next_test_id = 2;
 
+            std::mutex decoders_mutex;
+            std::unordered_map<std::string, unsigned> decoders;
+
             Writer writer;
+
+            std::vector<std::uint8_t> scratch;
+
+            /**
+             * The function with which the pipeline hands back sealed blocks, set together with
+             * the pipeline by start_pipeline().
+             */
+            std::function<void(sealed_block)> emit;
+            std::unique_ptr<block_pipeline> pipeline;
     };
 }
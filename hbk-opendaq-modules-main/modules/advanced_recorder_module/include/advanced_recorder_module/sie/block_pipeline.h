@@ -0,0 +1,345 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <boost/endian/conversion.hpp>
+
+#include <advanced_recorder_module/sie/crc32.h>
+#include <advanced_recorder_module/sie/format.h>
+
+namespace hbk::sie
+{
+    /**
+     * A function which encodes the payload of a data block, for example by compressing sample
+     * values, and appends it to the vector it is passed. The vector initially holds room for the
+     * block header, which the function must leave untouched. It is called on a worker thread of
+     * a block_pipeline, so anything it captures must be safe to use from there; it is destroyed
+     * on the same thread once it has returned.
+     */
+    typedef std::function<void(std::vector<std::uint8_t>& block)> block_encoder;
+
+    /**
+     * A complete data block produced by a block_pipeline: header, payload and footer, with the
+     * checksum filled in, ready to be written to the file as-is.
+     */
+    struct sealed_block
+    {
+        std::uint32_t group;    /**< The group ID of the block. */
+        std::int64_t first;     /**< The domain tick of the first sample in the block. */
+        std::int64_t last;      /**< The domain tick of the last sample in the block. */
+        std::shared_ptr<const std::vector<std::uint8_t>> data;  /**< The block itself. */
+    };
+
+    /**
+     * Fills in the header and footer of a block whose payload has been appended to room left for
+     * the header, as by a block_encoder, including the checksum of the header and payload.
+     *
+     * @param block The block. On return, it additionally contains the footer.
+     * @param group The group ID of the block.
+     */
+    inline void seal_block(std::vector<std::uint8_t>& block, std::uint32_t group)
+    {
+        block_header header;
+        block_footer footer;
+
+        header.size = boost::endian::native_to_big<std::uint32_t>(
+            static_cast<std::uint32_t>(block.size() + sizeof(footer)));
+        header.group = boost::endian::native_to_big<std::uint32_t>(group);
+        header.sync = boost::endian::native_to_big<std::uint32_t>(SYNC_WORD);
+        std::memcpy(block.data(), &header, sizeof(header));
+
+        crc32 crc;
+        crc.process_bytes(block.data(), block.size());
+
+        footer.checksum = boost::endian::native_to_big<std::uint32_t>(crc());
+        footer.size = header.size;
+
+        auto bytes = reinterpret_cast<const std::uint8_t *>(&footer);
+        block.insert(block.end(), bytes, bytes + sizeof(footer));
+    }
+
+    /**
+     * Encodes data blocks and computes their checksums on a pool of worker threads, and hands
+     * the sealed blocks back in the order in which they were submitted. This takes the CPU-bound
+     * part of writing compressed blocks off the thread which writes the file, while the offsets
+     * and index entries, which depend on the order of the blocks, are still maintained by that
+     * thread alone.
+     *
+     * Each submitted job occupies a slot in a reorder buffer until its block has been handed
+     * back. Workers take jobs in submission order, but may finish them in any order; completed
+     * blocks are only handed back once all earlier ones have been, by calling the emit function
+     * passed to submit(), poll() or drain() on the calling thread. At most max_in_flight() jobs
+     * are held at a time; submit() waits, handing back blocks as they complete, while the buffer
+     * is full. This bounds both the memory held by pending jobs and how far the file lags behind.
+     *
+     * An exception thrown by an encoder is rethrown, in submission order, by the call which
+     * would have handed back its block.
+     *
+     * The functions of this class must all be called from the same thread, or otherwise
+     * serialized, like the functions of the writer whose blocks it produces.
+     */
+    class block_pipeline
+    {
+        public:
+
+            /**
+             * The default maximum number of jobs held at a time.
+             */
+            static constexpr std::size_t DEFAULT_MAX_IN_FLIGHT = 64;
+
+            /**
+             * Creates a pipeline and starts its worker threads.
+             *
+             * @param threads The number of worker threads. Zero selects one per hardware thread.
+             * @param max_in_flight The maximum number of jobs held at a time. Values less than
+             *     1 are treated as 1.
+             */
+            explicit block_pipeline(
+                    unsigned threads,
+                    std::size_t max_in_flight = DEFAULT_MAX_IN_FLIGHT)
+                : limit(std::max<std::size_t>(max_in_flight, 1))
+            {
+                if (threads == 0)
+                    threads = std::max(1u, std::thread::hardware_concurrency());
+
+                for (unsigned i = 0; i < threads; ++i)
+                    workers.emplace_back([this] { work(); });
+            }
+
+            block_pipeline(const block_pipeline&) = delete;
+            block_pipeline& operator=(const block_pipeline&) = delete;
+
+            /**
+             * Stops the worker threads. Jobs which have not been handed back are discarded; call
+             * drain() first to write them.
+             */
+            ~block_pipeline() noexcept
+            {
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    stopping = true;
+                }
+
+                work_cv.notify_all();
+                for (auto& worker : workers)
+                    worker.join();
+            }
+
+            /**
+             * Submits a data block to be encoded and sealed by a worker thread. If the reorder
+             * buffer is full, this first waits for the oldest job to complete. Any blocks which
+             * have completed in order are handed back before the call returns.
+             *
+             * @param group The group ID of the block.
+             * @param first The domain tick of the first sample in the block.
+             * @param last The domain tick of the last sample in the block.
+             * @param encode The function which encodes the payload.
+             * @param emit A function taking a sealed_block, which is called on this thread for
+             *     each block handed back.
+             *
+             * @throws ... This function propagates any exception thrown by an encoder or by
+             *     @p emit.
+             */
+            template <typename Emit>
+            void submit(
+                std::uint32_t group,
+                std::int64_t first,
+                std::int64_t last,
+                block_encoder encode,
+                Emit&& emit)
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+
+                while (jobs.size() >= limit)
+                    emit_front(lock, emit);
+
+                jobs.push_back({ group, first, last, std::move(encode), nullptr, nullptr, false });
+                lock.unlock();
+                work_cv.notify_one();
+
+                poll(emit);
+            }
+
+            /**
+             * Hands back the blocks which have completed in order, without waiting.
+             *
+             * @param emit A function taking a sealed_block, as for submit().
+             *
+             * @throws ... This function propagates any exception thrown by an encoder or by
+             *     @p emit.
+             */
+            template <typename Emit>
+            void poll(Emit&& emit)
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+
+                while (!jobs.empty() && jobs.front().done)
+                    emit_front(lock, emit);
+            }
+
+            /**
+             * Waits for all submitted jobs to complete and hands back their blocks.
+             *
+             * @param emit A function taking a sealed_block, as for submit().
+             *
+             * @throws ... This function propagates any exception thrown by an encoder or by
+             *     @p emit. The jobs after the failed one remain pending.
+             */
+            template <typename Emit>
+            void drain(Emit&& emit)
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+
+                while (!jobs.empty())
+                    emit_front(lock, emit);
+            }
+
+            /**
+             * Gets the number of worker threads.
+             *
+             * @return The number of worker threads.
+             */
+            std::size_t thread_count() const noexcept
+            {
+                return workers.size();
+            }
+
+            /**
+             * Gets the maximum number of jobs held at a time.
+             *
+             * @return The value passed to the constructor, or 1 if it was less than that.
+             */
+            std::size_t max_in_flight() const noexcept
+            {
+                return limit;
+            }
+
+            /**
+             * Gets the number of jobs submitted but not yet handed back.
+             *
+             * @return The number of jobs in the reorder buffer.
+             */
+            std::size_t in_flight() const
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                return jobs.size();
+            }
+
+        private:
+
+            /**
+             * A submitted block, occupying a slot of the reorder buffer until it is handed back.
+             */
+            struct job
+            {
+                std::uint32_t group;
+                std::int64_t first;
+                std::int64_t last;
+                block_encoder encode;
+                std::shared_ptr<std::vector<std::uint8_t>> block;
+                std::exception_ptr error;
+                bool done = false;
+            };
+
+            /**
+             * The body of each worker thread: takes the oldest job not yet taken, encodes and
+             * seals its block outside the lock, and marks it done.
+             */
+            void work()
+            {
+                for (;;)
+                {
+                    job *current;
+
+                    {
+                        std::unique_lock<std::mutex> lock(mutex);
+                        work_cv.wait(lock, [&] { return next < jobs.size() || stopping; });
+                        if (stopping)
+                            return;
+                        current = &jobs[next++];
+                    }
+
+                    // Jobs are only removed once done, so the reference remains valid.
+                    auto block = std::make_shared<std::vector<std::uint8_t>>(sizeof(block_header));
+                    std::exception_ptr error;
+
+                    try
+                    {
+                        current->encode(*block);
+                        seal_block(*block, current->group);
+                    }
+
+                    catch (...)
+                    {
+                        error = std::current_exception();
+                    }
+
+                    // Release whatever the encoder captured, such as the sample buffer, now.
+                    current->encode = nullptr;
+
+                    {
+                        std::lock_guard<std::mutex> lock(mutex);
+                        current->block = std::move(block);
+                        current->error = error;
+                        current->done = true;
+                    }
+
+                    done_cv.notify_one();
+                }
+            }
+
+            /**
+             * Waits for the oldest job to complete, removes it from the reorder buffer, and hands
+             * back its block with the lock released, so that workers are not held up meanwhile.
+             */
+            template <typename Emit>
+            void emit_front(std::unique_lock<std::mutex>& lock, Emit& emit)
+            {
+                done_cv.wait(lock, [&] { return jobs.front().done; });
+
+                auto& front = jobs.front();
+                sealed_block block { front.group, front.first, front.last, std::move(front.block) };
+                auto error = std::move(front.error);
+
+                // The oldest job has necessarily been taken by a worker.
+                jobs.pop_front();
+                --next;
+
+                lock.unlock();
+
+                if (error)
+                    std::rethrow_exception(error);
+
+                emit(std::move(block));
+                lock.lock();
+            }
+
+            std::size_t limit;
+
+            mutable std::mutex mutex;
+            std::condition_variable work_cv;
+            std::condition_variable done_cv;
+
+            /**
+             * The reorder buffer, in submission order. The first @c next jobs have been taken by
+             * workers; the rest are waiting to be.
+             */
+            std::deque<job> jobs;
+            std::size_t next = 0;
+            bool stopping = false;
+
+            std::vector<std::thread> workers;
+    };
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+namespace hbk::sie
+{
+    /**
+     * A reference-counted handle to the owner of memory passed to a retained write (see
+     * basic_block_writer::write_block_retained()). The writer keeps the handle, and therefore
+     * the memory, alive until the data has been written to the file, and then releases it. The
+     * owner is destroyed when the last handle to it is released, which may be on whichever
+     * thread performs the write.
+     */
+    typedef std::shared_ptr<const void> buffer_handle;
+
+    /**
+     * Creates a buffer handle which owns a copy of (or, for rvalues, takes over) an object, such
+     * as a reference-counted smart pointer to a buffer. Only a single memory allocation is made.
+     *
+     * @param owner The object to own.
+     *
+     * @return A handle which destroys the owned object when the last copy of it is released.
+     */
+    template <typename T>
+    buffer_handle make_buffer_handle(T&& owner)
+    {
+        return std::make_shared<std::decay_t<T>>(std::forward<T>(owner));
+    }
+}
@@ -0,0 +1,359 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <boost/endian/conversion.hpp>
+
+#if defined (__x86_64__) || defined (__i386__) || defined (_M_X64) || defined (_M_IX86)
+#define HBK_SIE_CRC32_X86 1
+#include <immintrin.h>
+#if defined (_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+#if defined (__aarch64__) && (defined (__linux__) || defined (__APPLE__) || defined (__ARM_FEATURE_CRC32))
+#define HBK_SIE_CRC32_ARM 1
+#include <arm_acle.h>
+#if defined (__linux__)
+#include <asm/hwcap.h>
+#include <sys/auxv.h>
+#endif
+#endif
+
+#if defined (__clang__) || defined (__GNUC__)
+#define HBK_SIE_CRC32_TARGET(features) __attribute__((target(features)))
+#else
+#define HBK_SIE_CRC32_TARGET(features)
+#endif
+
+namespace hbk::sie
+{
+    namespace detail::crc32
+    {
+        /**
+         * The reflected CRC-32 polynomial (IEEE 802.3), as used by the SIE block checksum.
+         */
+        static constexpr std::uint32_t POLYNOMIAL = 0xEDB88320u;
+
+        /**
+         * Lookup tables for the slice-by-16 algorithm. Table 0 is the classic bytewise table;
+         * table k advances the CRC of a byte by k further zero bytes.
+         */
+        typedef std::array<std::array<std::uint32_t, 256>, 16> tables_type;
+
+        constexpr tables_type make_tables()
+        {
+            tables_type tables {};
+
+            for (std::uint32_t i = 0; i < 256; ++i)
+            {
+                std::uint32_t crc = i;
+                for (int bit = 0; bit < 8; ++bit)
+                    crc = (crc >> 1) ^ ((crc & 1) ? POLYNOMIAL : 0);
+                tables[0][i] = crc;
+            }
+
+            for (std::size_t k = 1; k < 16; ++k)
+                for (std::size_t i = 0; i < 256; ++i)
+                    tables[k][i] = (tables[k - 1][i] >> 8) ^ tables[0][tables[k - 1][i] & 0xFF];
+
+            return tables;
+        }
+
+        inline constexpr tables_type tables = make_tables();
+
+        inline std::uint32_t load_le32(const std::uint8_t *p) noexcept
+        {
+            std::uint32_t value;
+            std::memcpy(&value, p, sizeof(value));
+            return boost::endian::little_to_native(value);
+        }
+
+        /**
+         * Updates a CRC register (i.e., the non-inverted intermediate state) one byte at a time.
+         */
+        inline std::uint32_t update_bytewise(std::uint32_t crc, const std::uint8_t *p, std::size_t size) noexcept
+        {
+            while (size--)
+                crc = (crc >> 8) ^ tables[0][(crc ^ *p++) & 0xFF];
+            return crc;
+        }
+
+        /**
+         * Updates a CRC register using the portable slice-by-16 algorithm, which processes 16
+         * bytes per iteration with 16 independent table lookups.
+         */
+        inline std::uint32_t update_slice_by_16(std::uint32_t crc, const std::uint8_t *p, std::size_t size) noexcept
+        {
+            while (size >= 16)
+            {
+                std::uint32_t one = load_le32(p) ^ crc;
+                std::uint32_t two = load_le32(p + 4);
+                std::uint32_t three = load_le32(p + 8);
+                std::uint32_t four = load_le32(p + 12);
+
+                crc = tables[0][(four >> 24) & 0xFF]
+                    ^ tables[1][(four >> 16) & 0xFF]
+                    ^ tables[2][(four >> 8) & 0xFF]
+                    ^ tables[3][four & 0xFF]
+                    ^ tables[4][(three >> 24) & 0xFF]
+                    ^ tables[5][(three >> 16) & 0xFF]
+                    ^ tables[6][(three >> 8) & 0xFF]
+                    ^ tables[7][three & 0xFF]
+                    ^ tables[8][(two >> 24) & 0xFF]
+                    ^ tables[9][(two >> 16) & 0xFF]
+                    ^ tables[10][(two >> 8) & 0xFF]
+                    ^ tables[11][two & 0xFF]
+                    ^ tables[12][(one >> 24) & 0xFF]
+                    ^ tables[13][(one >> 16) & 0xFF]
+                    ^ tables[14][(one >> 8) & 0xFF]
+                    ^ tables[15][one & 0xFF];
+
+                p += 16;
+                size -= 16;
+            }
+
+            return update_bytewise(crc, p, size);
+        }
+
+#ifdef HBK_SIE_CRC32_X86
+        /**
+         * Updates a CRC register using carry-less multiplication (PCLMULQDQ) to fold four 128-bit
+         * lanes in parallel, followed by a Barrett reduction. This is the method described in
+         * Intel's "Fast CRC Computation for Generic Polynomials Using PCLMULQDQ Instruction",
+         * with the folding constants for the reflected IEEE polynomial. Tails shorter than 16
+         * bytes, and buffers too short to fold, are handled by slice-by-16.
+         */
+        HBK_SIE_CRC32_TARGET("sse4.1,pclmul")
+        inline std::uint32_t update_pclmul(std::uint32_t crc, const std::uint8_t *p, std::size_t size) noexcept
+        {
+            if (size < 64)
+                return update_slice_by_16(crc, p, size);
+
+            alignas(16) static const std::uint64_t k1k2[] = { 0x0154442BD4, 0x01C6E41596 };
+            alignas(16) static const std::uint64_t k3k4[] = { 0x01751997D0, 0x00CCAA009E };
+            alignas(16) static const std::uint64_t k5k0[] = { 0x0163CD6124, 0x0000000000 };
+            alignas(16) static const std::uint64_t poly[] = { 0x01DB710641, 0x01F7011641 };
+
+            __m128i x0, x1, x2, x3, x4, x5, x6, x7, x8, y5, y6, y7, y8;
+
+            x1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 0x00));
+            x2 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 0x10));
+            x3 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 0x20));
+            x4 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 0x30));
+
+            x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128(static_cast<int>(crc)));
+            x0 = _mm_load_si128(reinterpret_cast<const __m128i *>(k1k2));
+
+            p += 64;
+            size -= 64;
+
+            // Fold 64 bytes at a time.
+            while (size >= 64)
+            {
+                x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+                x6 = _mm_clmulepi64_si128(x2, x0, 0x00);
+                x7 = _mm_clmulepi64_si128(x3, x0, 0x00);
+                x8 = _mm_clmulepi64_si128(x4, x0, 0x00);
+
+                x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+                x2 = _mm_clmulepi64_si128(x2, x0, 0x11);
+                x3 = _mm_clmulepi64_si128(x3, x0, 0x11);
+                x4 = _mm_clmulepi64_si128(x4, x0, 0x11);
+
+                y5 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 0x00));
+                y6 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 0x10));
+                y7 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 0x20));
+                y8 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 0x30));
+
+                x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), y5);
+                x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), y6);
+                x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), y7);
+                x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), y8);
+
+                p += 64;
+                size -= 64;
+            }
+
+            // Fold the four lanes into one.
+            x0 = _mm_load_si128(reinterpret_cast<const __m128i *>(k3k4));
+
+            x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+            x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+            x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+
+            x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+            x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+            x1 = _mm_xor_si128(_mm_xor_si128(x1, x3), x5);
+
+            x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+            x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+            x1 = _mm_xor_si128(_mm_xor_si128(x1, x4), x5);
+
+            // Fold 16 bytes at a time.
+            while (size >= 16)
+            {
+                x2 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+
+                x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+                x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+                x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+
+                p += 16;
+                size -= 16;
+            }
+
+            // Fold 128 bits to 64 bits.
+            x2 = _mm_clmulepi64_si128(x1, x0, 0x10);
+            x3 = _mm_setr_epi32(~0, 0, ~0, 0);
+            x1 = _mm_srli_si128(x1, 8);
+            x1 = _mm_xor_si128(x1, x2);
+
+            x0 = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(k5k0));
+
+            x2 = _mm_srli_si128(x1, 4);
+            x1 = _mm_and_si128(x1, x3);
+            x1 = _mm_clmulepi64_si128(x1, x0, 0x00);
+            x1 = _mm_xor_si128(x1, x2);
+
+            // Barrett-reduce to 32 bits.
+            x0 = _mm_load_si128(reinterpret_cast<const __m128i *>(poly));
+
+            x2 = _mm_and_si128(x1, x3);
+            x2 = _mm_clmulepi64_si128(x2, x0, 0x10);
+            x2 = _mm_and_si128(x2, x3);
+            x2 = _mm_clmulepi64_si128(x2, x0, 0x00);
+            x1 = _mm_xor_si128(x1, x2);
+
+            crc = static_cast<std::uint32_t>(_mm_extract_epi32(x1, 1));
+
+            return update_slice_by_16(crc, p, size);
+        }
+
+        inline bool cpu_has_pclmul() noexcept
+        {
+#if defined (_MSC_VER)
+            int regs[4];
+            __cpuid(regs, 1);
+            return (regs[2] & (1 << 1)) && (regs[2] & (1 << 19));
+#else
+            unsigned eax, ebx, ecx, edx;
+            if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+                return false;
+            return (ecx & bit_PCLMUL) && (ecx & bit_SSE4_1);
+#endif
+        }
+#endif
+
+#ifdef HBK_SIE_CRC32_ARM
+        /**
+         * Updates a CRC register using the ARMv8 CRC32 instructions, eight bytes at a time.
+         */
+#if defined (__clang__)
+        HBK_SIE_CRC32_TARGET("crc")
+#else
+        HBK_SIE_CRC32_TARGET("+crc")
+#endif
+        inline std::uint32_t update_armv8(std::uint32_t crc, const std::uint8_t *p, std::size_t size) noexcept
+        {
+            while (size >= 8)
+            {
+                std::uint64_t value;
+                std::memcpy(&value, p, sizeof(value));
+                crc = __crc32d(crc, boost::endian::little_to_native(value));
+                p += 8;
+                size -= 8;
+            }
+
+            while (size--)
+                crc = __crc32b(crc, *p++);
+
+            return crc;
+        }
+
+        inline bool cpu_has_armv8_crc() noexcept
+        {
+#if defined (__ARM_FEATURE_CRC32) || defined (__APPLE__)
+            return true;
+#else
+            return (::getauxval(AT_HWCAP) & HWCAP_CRC32) != 0;
+#endif
+        }
+#endif
+
+        typedef std::uint32_t (*update_function)(std::uint32_t, const std::uint8_t *, std::size_t);
+
+        /**
+         * Returns the fastest CRC update function supported by the running CPU.
+         */
+        inline update_function select_update() noexcept
+        {
+#ifdef HBK_SIE_CRC32_X86
+            if (cpu_has_pclmul())
+                return &update_pclmul;
+#endif
+#ifdef HBK_SIE_CRC32_ARM
+            if (cpu_has_armv8_crc())
+                return &update_armv8;
+#endif
+            return &update_slice_by_16;
+        }
+
+        /**
+         * The CRC update function, chosen once at program startup by CPU feature detection.
+         */
+        inline const update_function update = select_update();
+    }
+
+    /**
+     * Computes the CRC-32 checksum used by the SIE block layer (the IEEE 802.3 polynomial,
+     * reflected, with an initial value and final XOR of 0xFFFFFFFF). The result is bit-identical
+     * to boost::crc_32_type, and this class provides the same process_bytes() and operator()()
+     * interface, but uses hardware acceleration where available: PCLMULQDQ folding on x86,
+     * the CRC32 instructions on ARMv8, or a portable slice-by-16 implementation otherwise. The
+     * implementation is chosen once at startup by CPU feature detection.
+     */
+    class crc32
+    {
+        public:
+
+            /**
+             * Adds the specified bytes to the checksum.
+             *
+             * @param data A pointer to the data to add.
+             * @param size The number of bytes pointed to by @p data.
+             */
+            void process_bytes(const void *data, std::size_t size) noexcept
+            {
+                reg = detail::crc32::update(reg, static_cast<const std::uint8_t *>(data), size);
+            }
+
+            /**
+             * Gets the checksum of all bytes added so far.
+             *
+             * @return The CRC-32 checksum.
+             */
+            std::uint32_t checksum() const noexcept
+            {
+                return reg ^ 0xFFFFFFFFu;
+            }
+
+            /**
+             * @copydoc checksum()
+             */
+            std::uint32_t operator()() const noexcept
+            {
+                return checksum();
+            }
+
+        private:
+
+            std::uint32_t reg = 0xFFFFFFFFu;
+    };
+}
@@ -0,0 +1,401 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#include <boost/endian/conversion.hpp>
+
+#include <advanced_recorder_module/sie/format.h>
+
+#if defined (__x86_64__) || defined (__i386__) || defined (_M_X64) || defined (_M_IX86)
+#define HBK_SIE_DELTA_X86 1
+#include <immintrin.h>
+#if defined (_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+#if defined (__clang__) || defined (__GNUC__)
+#define HBK_SIE_DELTA_TARGET(features) __attribute__((target(features)))
+#else
+#define HBK_SIE_DELTA_TARGET(features)
+#endif
+
+namespace hbk::sie
+{
+    /**
+     * The value of the channel tag ENCODING_TAG identifying channels whose sample values are
+     * delta-compressed (see delta_encode()).
+     */
+    static constexpr const char *DELTA_ENCODING = "delta";
+
+    /**
+     * The name of the decoder element which reads the next value of a delta-compressed stream.
+     * This is an extension of the SIE decoder schema; it is used in place of a read element
+     * inside a loop, has the same var, type and bits attributes, and reads the values in the
+     * order in which delta_encode() encoded them, starting at the element's first execution.
+     */
+    static constexpr const char *READ_DELTA_ELEMENT = "hbk:read_delta";
+
+    namespace detail::delta_codec
+    {
+        /**
+         * The number of values in a frame. Each frame is packed with its own bit width.
+         */
+        static constexpr std::size_t FRAME_SIZE = 256;
+
+        /**
+         * The number of bytes in a packed frame per bit of width: FRAME_SIZE values of one bit.
+         */
+        static constexpr std::size_t FRAME_BYTES_PER_BIT = FRAME_SIZE / 8;
+
+        /**
+         * The word type in which values of type @p T are packed and unpacked.
+         */
+        template <typename T>
+        using word_type = std::conditional_t<sizeof(T) == 8, std::uint64_t, std::uint32_t>;
+
+        template <typename W>
+        inline W load_word(const std::uint8_t *words, std::size_t index) noexcept
+        {
+            W value;
+            std::memcpy(&value, words + index * sizeof(W), sizeof(value));
+            return boost::endian::little_to_native(value);
+        }
+
+        template <typename W>
+        inline void store_word(std::uint8_t *words, std::size_t index, W value) noexcept
+        {
+            value = boost::endian::native_to_little(value);
+            std::memcpy(words + index * sizeof(W), &value, sizeof(value));
+        }
+
+        /**
+         * Packs the low @p bits bits of each of FRAME_SIZE words. The frame is divided into
+         * 256-bit rows of 32 / sizeof(W) lanes: value i belongs to lane i % lanes, and each lane
+         * is a little-endian bit stream whose consecutive words are a row apart. All lanes of a
+         * row thus hold consecutive values at the same bit offset, so one SIMD register can
+         * unpack them together (this is the layout of Lemire and Boytsov's SIMD-BP128).
+         *
+         * @param values The values to pack. Bits above the low @p bits bits must be zero.
+         * @param bits The bit width, from 1 to the width of @p W.
+         * @param out Receives FRAME_BYTES_PER_BIT * @p bits bytes.
+         */
+        template <typename W>
+        inline void pack(const W *values, unsigned bits, std::uint8_t *out) noexcept
+        {
+            constexpr unsigned width = 8 * sizeof(W);
+            constexpr unsigned lanes = 32 / sizeof(W);
+
+            W words[FRAME_SIZE] = { };
+
+            for (unsigned row = 0; row < FRAME_SIZE / lanes; ++row)
+            {
+                unsigned position = row * bits;
+                unsigned word = position / width;
+                unsigned shift = position % width;
+                const W *value = values + row * lanes;
+
+                for (unsigned lane = 0; lane < lanes; ++lane)
+                    words[word * lanes + lane] |= value[lane] << shift;
+
+                if (shift + bits > width)
+                    for (unsigned lane = 0; lane < lanes; ++lane)
+                        words[(word + 1) * lanes + lane] |= value[lane] >> (width - shift);
+            }
+
+            for (unsigned i = 0; i < lanes * bits; ++i)
+                store_word(out, i, words[i]);
+        }
+
+        /**
+         * Unpacks a frame packed by pack(), undoes the zigzag encoding, and accumulates the
+         * deltas, one value at a time.
+         *
+         * @param in The packed frame.
+         * @param bits The bit width, from 1 to the width of @p W.
+         * @param previous The value preceding the frame.
+         * @param out Receives the FRAME_SIZE values.
+         */
+        template <typename W>
+        inline void unpack_scalar(const std::uint8_t *in, unsigned bits, W previous, W *out) noexcept
+        {
+            constexpr unsigned width = 8 * sizeof(W);
+            constexpr unsigned lanes = 32 / sizeof(W);
+
+            const W mask = bits == width ? ~W(0) : (W(1) << bits) - 1;
+
+            for (unsigned row = 0; row < FRAME_SIZE / lanes; ++row)
+            {
+                unsigned position = row * bits;
+                unsigned word = position / width;
+                unsigned shift = position % width;
+
+                for (unsigned lane = 0; lane < lanes; ++lane)
+                {
+                    W value = load_word<W>(in, word * lanes + lane) >> shift;
+                    if (shift + bits > width)
+                        value |= load_word<W>(in, (word + 1) * lanes + lane) << (width - shift);
+                    value &= mask;
+
+                    previous += (value >> 1) ^ (W(0) - (value & 1));
+                    out[row * lanes + lane] = previous;
+                }
+            }
+        }
+
+#ifdef HBK_SIE_DELTA_X86
+        /**
+         * Does the same as unpack_scalar() for 32-bit words using AVX2, eight values at a time:
+         * each row is shifted and masked into place, zigzag-decoded, and accumulated with an
+         * in-register prefix sum.
+         */
+        HBK_SIE_DELTA_TARGET("avx2")
+        inline void unpack_avx2(const std::uint8_t *in, unsigned bits, std::uint32_t previous, std::uint32_t *out) noexcept
+        {
+            const __m256i mask = _mm256_set1_epi32(bits == 32 ? -1 : static_cast<int>((1u << bits) - 1));
+            const __m256i one = _mm256_set1_epi32(1);
+            const __m256i zero = _mm256_setzero_si256();
+            const __m256i broadcast3 = _mm256_set1_epi32(3);
+            const __m256i broadcast7 = _mm256_set1_epi32(7);
+
+            auto rows = reinterpret_cast<const __m256i *>(in);
+            __m256i carry = _mm256_set1_epi32(static_cast<int>(previous));
+
+            for (unsigned i = 0; i < 32; ++i)
+            {
+                unsigned position = i * bits;
+                unsigned word = position / 32;
+                unsigned shift = position % 32;
+
+                __m256i value = _mm256_srl_epi32(
+                    _mm256_loadu_si256(rows + word),
+                    _mm_cvtsi32_si128(static_cast<int>(shift)));
+                if (shift + bits > 32)
+                    value = _mm256_or_si256(value, _mm256_sll_epi32(
+                        _mm256_loadu_si256(rows + word + 1),
+                        _mm_cvtsi32_si128(static_cast<int>(32 - shift))));
+                value = _mm256_and_si256(value, mask);
+
+                value = _mm256_xor_si256(
+                    _mm256_srli_epi32(value, 1),
+                    _mm256_sub_epi32(zero, _mm256_and_si256(value, one)));
+
+                // Prefix sum within each 128-bit half, then carry the low half into the high one.
+                value = _mm256_add_epi32(value, _mm256_slli_si256(value, 4));
+                value = _mm256_add_epi32(value, _mm256_slli_si256(value, 8));
+                value = _mm256_add_epi32(value,
+                    _mm256_blend_epi32(zero, _mm256_permutevar8x32_epi32(value, broadcast3), 0xF0));
+
+                value = _mm256_add_epi32(value, carry);
+                carry = _mm256_permutevar8x32_epi32(value, broadcast7);
+
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + 8 * i), value);
+            }
+        }
+
+        inline bool cpu_has_avx2() noexcept
+        {
+#if defined (_MSC_VER) && !defined (__clang__)
+            int regs[4];
+            __cpuid(regs, 0);
+            if (regs[0] < 7)
+                return false;
+
+            // AVX2 also requires the operating system to save the YMM registers.
+            __cpuid(regs, 1);
+            if (!(regs[2] & (1 << 27)) || !(regs[2] & (1 << 28)) || (_xgetbv(0) & 6) != 6)
+                return false;
+
+            __cpuidex(regs, 7, 0);
+            return (regs[1] & (1 << 5)) != 0;
+#else
+            return __builtin_cpu_supports("avx2");
+#endif
+        }
+#endif
+
+        typedef void (*unpack32_function)(const std::uint8_t *, unsigned, std::uint32_t, std::uint32_t *);
+
+        /**
+         * Returns the fastest unpack function for 32-bit words supported by the running CPU.
+         */
+        inline unpack32_function select_unpack32() noexcept
+        {
+#ifdef HBK_SIE_DELTA_X86
+            if (cpu_has_avx2())
+                return &unpack_avx2;
+#endif
+            return &unpack_scalar<std::uint32_t>;
+        }
+
+        /**
+         * The unpack function for 32-bit words, chosen once at program startup by CPU feature
+         * detection.
+         */
+        inline const unpack32_function unpack32 = select_unpack32();
+    }
+
+    /**
+     * Returns the maximum number of bytes which delta_encode() writes for @p count values of the
+     * integer type @p T.
+     */
+    template <typename T>
+    constexpr std::size_t delta_encode_bound(std::size_t count) noexcept
+    {
+        std::size_t frames = (count + detail::delta_codec::FRAME_SIZE - 1) / detail::delta_codec::FRAME_SIZE;
+        return sizeof(T) + frames * (1 + detail::delta_codec::FRAME_BYTES_PER_BIT * 8 * sizeof(T));
+    }
+
+    /**
+     * Compresses a sequence of integer values losslessly. Each value is replaced by its
+     * difference from its predecessor, in the wrapping arithmetic of @p T, and the differences
+     * are zigzag-encoded so that small negative differences become small unsigned numbers. The
+     * results are bit-packed in frames of 256 values, each with the smallest bit width that
+     * holds all of its values, so slowly-changing signals such as ADC counts take a few bits per
+     * value, and a frame of repeated values takes none.
+     *
+     * The output consists of the first value, as a little-endian @p T, followed by one frame per
+     * 256 values (the last frame is padded with zero differences). Each frame consists of its bit
+     * width as one byte, followed by 32 bytes per bit of width, laid out as described in
+     * detail::delta_codec::pack(). Values of up to 32 bits are packed in 32-bit words, 64-bit
+     * values in 64-bit words.
+     *
+     * @param values The values to compress. No alignment is required.
+     * @param count The number of values.
+     * @param out Receives the compressed data. It must have room for delta_encode_bound<T>(count)
+     *     bytes.
+     *
+     * @return The number of bytes written to @p out.
+     */
+    template <typename T>
+    std::size_t delta_encode(const void *values, std::size_t count, std::uint8_t *out) noexcept
+    {
+        static_assert(std::is_integral_v<T>, "T must be an integer type");
+
+        using value_type = std::make_unsigned_t<T>;
+        using word_type = detail::delta_codec::word_type<T>;
+        constexpr unsigned width = 8 * sizeof(T);
+        constexpr std::size_t FRAME_SIZE = detail::delta_codec::FRAME_SIZE;
+
+        if (count == 0)
+            return 0;
+
+        auto bytes = static_cast<const std::uint8_t *>(values);
+        auto zigzag = [](value_type delta)
+        {
+            return static_cast<word_type>(static_cast<value_type>(
+                static_cast<value_type>(delta << 1) ^ static_cast<value_type>(value_type(0) - (delta >> (width - 1)))));
+        };
+
+        value_type first;
+        std::memcpy(&first, bytes, sizeof(first));
+        first = boost::endian::native_to_little(first);
+        std::memcpy(out, &first, sizeof(first));
+        auto p = out + sizeof(first);
+
+        word_type zigzags[FRAME_SIZE];
+
+        for (std::size_t i = 0; i < count; i += FRAME_SIZE)
+        {
+            std::size_t n = std::min(FRAME_SIZE, count - i);
+
+            // The differences are taken from an aligned copy of the frame, preceded by the value
+            // before it, which lets the compiler vectorize them. The first value has no
+            // predecessor; it is stored in full, so its difference is zero.
+            value_type current[FRAME_SIZE + 1];
+            std::memcpy(current, bytes + (i ? i - 1 : 0) * sizeof(T), sizeof(T));
+            std::memcpy(current + 1, bytes + i * sizeof(T), n * sizeof(T));
+
+            for (std::size_t j = 0; j < n; ++j)
+                zigzags[j] = zigzag(static_cast<value_type>(current[j + 1] - current[j]));
+            std::fill(zigzags + n, zigzags + FRAME_SIZE, word_type(0));
+
+            word_type any = 0;
+            for (std::size_t j = 0; j < n; ++j)
+                any |= zigzags[j];
+
+            unsigned bits = 0;
+            while (bits < width && (any >> bits))
+                ++bits;
+
+            *p++ = static_cast<std::uint8_t>(bits);
+            if (bits)
+                detail::delta_codec::pack(zigzags, bits, p);
+            p += detail::delta_codec::FRAME_BYTES_PER_BIT * bits;
+        }
+
+        return static_cast<std::size_t>(p - out);
+    }
+
+    /**
+     * Decompresses values compressed by delta_encode(). Values of up to 32 bits are unpacked
+     * with AVX2 where the CPU supports it.
+     *
+     * @param data The compressed data.
+     * @param size The size of the compressed data, in bytes.
+     * @param count The number of values to decompress.
+     * @param values Receives the values. It must have room for @p count values of type @p T. No
+     *     alignment is required.
+     *
+     * @return False if the compressed data is truncated or malformed. The contents of
+     *     @p values are then unspecified.
+     */
+    template <typename T>
+    bool delta_decode(const std::uint8_t *data, std::size_t size, std::size_t count, void *values) noexcept
+    {
+        static_assert(std::is_integral_v<T>, "T must be an integer type");
+
+        using value_type = std::make_unsigned_t<T>;
+        using word_type = detail::delta_codec::word_type<T>;
+        constexpr std::size_t FRAME_SIZE = detail::delta_codec::FRAME_SIZE;
+
+        if (count == 0)
+            return true;
+        if (size < sizeof(T))
+            return false;
+
+        value_type first;
+        std::memcpy(&first, data, sizeof(first));
+        auto previous = static_cast<word_type>(boost::endian::little_to_native(first));
+
+        auto p = data + sizeof(first);
+        auto end = data + size;
+        auto out = static_cast<std::uint8_t *>(values);
+
+        word_type decoded[FRAME_SIZE];
+
+        for (std::size_t i = 0; i < count; i += FRAME_SIZE)
+        {
+            if (p == end)
+                return false;
+
+            unsigned bits = *p++;
+            std::size_t frameBytes = detail::delta_codec::FRAME_BYTES_PER_BIT * bits;
+            if (bits > 8 * sizeof(T) || static_cast<std::size_t>(end - p) < frameBytes)
+                return false;
+
+            if (bits == 0)
+                std::fill(decoded, decoded + FRAME_SIZE, previous);
+            else if constexpr (sizeof(word_type) == sizeof(std::uint32_t))
+                detail::delta_codec::unpack32(p, bits, previous, decoded);
+            else
+                detail::delta_codec::unpack_scalar<word_type>(p, bits, previous, decoded);
+
+            p += frameBytes;
+            previous = decoded[FRAME_SIZE - 1];
+
+            // Narrowing into an aligned buffer first lets the compiler vectorize it.
+            value_type narrowed[FRAME_SIZE];
+            for (std::size_t j = 0; j < FRAME_SIZE; ++j)
+                narrowed[j] = static_cast<value_type>(decoded[j]);
+
+            std::memcpy(out + i * sizeof(T), narrowed, std::min(FRAME_SIZE, count - i) * sizeof(T));
+        }
+
+        return true;
+    }
+}
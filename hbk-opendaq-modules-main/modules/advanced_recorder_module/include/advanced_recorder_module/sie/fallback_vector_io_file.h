@@ -3,10 +3,14 @@
 #include <cerrno>
 #include <cstddef>
 #include <cstdio>
+#include <stdexcept>
 #include <string>
 #include <system_error>
 #include <utility>
 
+#include <advanced_recorder_module/sie/buffer_handle.h>
+#include <advanced_recorder_module/sie/sync_handle.h>
+
 namespace hbk::sie
 {
     /**
@@ -17,6 +21,8 @@ namespace hbk::sie
      * - Opening: Files are opened when an object is constructed.
      * - Writing: The write() member function implements output using multiple calls to
      *   std::fwrite().
+     * - Syncing: The prepare_sync() member function flushes the C library's buffer and returns a
+     *   handle which makes the data written so far durable, from any thread.
      * - Closing: Files are closed when an object is destroyed.
      */
     class fallback_vector_io_file
@@ -28,14 +34,16 @@ namespace hbk::sie
              *
              * @param filename The path and filename of the file to open. Relative paths are
              *     interpreted relative to the current working directory.
+             * @param append If true, data is written after the existing contents of the file.
+             *     Otherwise (the default), any existing contents are discarded.
              *
              * @throws std::system_error The file could not be opened.
              */
-            fallback_vector_io_file(const std::string& filename)
+            fallback_vector_io_file(const std::string& filename, bool append = false)
                 : f(
                     std::fopen(
                         filename.c_str(),
-                        "wb"))
+                        append ? "ab" : "wb"))
             {
                 if (!f)
                     throw std::system_error(
@@ -55,6 +63,7 @@ namespace hbk::sie
              */
             fallback_vector_io_file(fallback_vector_io_file&& rhs) noexcept
                 : f(nullptr)
+                , handle(std::move(rhs.handle))
             {
                 std::swap(f, rhs.f);
             }
@@ -94,6 +103,70 @@ namespace hbk::sie
                 write(args...);
             }
 
+            /**
+             * Performs a vectored write to the file of data owned by @p owner. Since write()
+             * consumes the data before returning, this is equivalent to write(), and @p owner is
+             * released when the call returns.
+             *
+             * @param owner A handle which keeps the data segments valid.
+             * @param args One or more (data, size) argument pairs specifying the segments to
+             *     write to the file.
+             *
+             * @throws ... This function propagates any exception thrown by write().
+             */
+            template <typename ... Args>
+            void write_retained([[maybe_unused]] buffer_handle owner, Args... args)
+            {
+                write(args...);
+            }
+
+            /**
+             * Submits any data buffered by the C library to the operating system.
+             *
+             * @throws std::runtime_error A write error occurred.
+             */
+            void flush()
+            {
+                if (std::fflush(f) != 0)
+                    throw std::runtime_error(
+                        "failed to write to file");
+            }
+
+            /**
+             * Prepares to make the data written so far durable, by submitting any data buffered
+             * by the C library to the operating system.
+             *
+             * @return A handle whose sync() function makes the data written so far durable.
+             *
+             * @throws std::runtime_error A write error occurred.
+             * @throws std::system_error The file descriptor could not be duplicated.
+             */
+            sync_handle prepare_sync()
+            {
+                flush();
+
+                if (!handle)
+#ifdef _WIN32
+                    handle = sync_handle(::_fileno(f));
+#else
+                    handle = sync_handle(::fileno(f));
+#endif
+
+                return handle;
+            }
+
+            /**
+             * Makes the data written so far durable. This is equivalent to
+             * prepare_sync().sync(), and blocks until the storage device has acknowledged the
+             * data.
+             *
+             * @throws std::system_error The operating system reported an error.
+             */
+            void sync()
+            {
+                prepare_sync().sync();
+            }
+
             /**
              * Closes a file.
              */
@@ -118,5 +191,10 @@ namespace hbk::sie
              * been moved-from), the value is nullptr.
              */
             FILE *f;
+
+            /**
+             * The handle returned by prepare_sync(), created when it is first called.
+             */
+            sync_handle handle;
     };
 }
@@ -24,6 +24,10 @@ namespace hbk::sie
 
         /** The group ID for index blocks. */
         static constexpr std::uint32_t INDEX = 1;
+
+        /** The group ID for time index blocks. This group is not defined by the SIE
+            specification, but is reserved by this implementation and described in PREAMBLE. */
+        static constexpr std::uint32_t TIME_INDEX = 2;
     }
 
 #pragma pack(push, 1)
@@ -36,8 +40,8 @@ namespace hbk::sie
     {
         std::uint32_t size;     /**< The size of the block, including header and footer. */
         std::uint32_t group;    /**< The group ID of the block. 0 is reserved for XML metadata,
-                                     and 1 is reserved for index blocks. All other group IDs are
-                                     user-defined. */
+                                     1 is reserved for index blocks, and 2 is reserved for time
+                                     index blocks. All other group IDs are user-defined. */
         std::uint32_t sync;     /**< Must be set to SYNC_WORD. */
     };
 #pragma pack(pop)
@@ -81,6 +85,43 @@ namespace hbk::sie
     };
 #pragma pack(pop)
 
+#pragma pack(push, 1)
+    /**
+     * An entry for a single data block in a time index block. A time index block consists of a
+     * sequence of these structures, each of which specifies the file offset of a preceding data
+     * block together with the domain ticks of the first and last samples it contains. All members
+     * of this structure must be big-endian, requiring byte-swapping on little-endian
+     * architectures.
+     */
+    struct time_index_entry
+    {
+        std::uint64_t offset;   /**< The absolute offset of the block in the file. */
+        std::uint32_t group;    /**< The group ID of the block. */
+        std::int64_t first;     /**< The domain tick of the first sample in the block. */
+        std::int64_t last;      /**< The domain tick of the last sample in the block. */
+
+        /**
+         * Initializes a time index entry with the specified member values.
+         *
+         * @param offset The absolute offset of the block in the file.
+         * @param group The group ID of the block.
+         * @param first The domain tick of the first sample in the block.
+         * @param last The domain tick of the last sample in the block.
+         */
+        time_index_entry(
+                std::uint64_t offset,
+                std::uint32_t group,
+                std::int64_t first,
+                std::int64_t last) noexcept
+            : offset(offset)
+            , group(group)
+            , first(first)
+            , last(last)
+        {
+        }
+    };
+#pragma pack(pop)
+
     /**
      * The standard XML metadata preamble defined by the SIE specification. The XML metadata in
      * group 0 should always begin with this string.
@@ -118,9 +159,30 @@ namespace hbk::sie
         "  </loop>"                                                                                 "\n"
         " </decoder>"                                                                               "\n"
         ""                                                                                          "\n"
+        "<!-- Time Index Block decoder: v0=offset, v1=group, v2=first tick, v3=last tick -->"       "\n"
+        ""                                                                                          "\n"
+        " <tag id=\"hbk:TimeIndex\" group=\"2\" decoder=\"2\"/>"                                    "\n"
+        ""                                                                                          "\n"
+        " <decoder id=\"2\">"                                                                       "\n"
+        "  <loop>"                                                                                  "\n"
+        "   <read var=\"v0\" bits=\"64\" type=\"uint\" endian=\"big\"/>"                            "\n"
+        "   <read var=\"v1\" bits=\"32\" type=\"uint\" endian=\"big\"/>"                            "\n"
+        "   <read var=\"v2\" bits=\"64\" type=\"int\" endian=\"big\"/>"                             "\n"
+        "   <read var=\"v3\" bits=\"64\" type=\"int\" endian=\"big\"/>"                             "\n"
+        "   <sample/>"                                                                              "\n"
+        "  </loop>"                                                                                 "\n"
+        " </decoder>"                                                                               "\n"
+        ""                                                                                          "\n"
         "<!-- Stream-specific definitions begin here -->"                                           "\n"
         ""                                                                                          "\n";
 
+    /**
+     * The name of the channel tag which identifies a compressed encoding of the channel's sample
+     * values, such as XOR_ENCODING or DELTA_ENCODING. Channels without this tag are stored
+     * uncompressed.
+     */
+    static constexpr const char *ENCODING_TAG = "hbk:encoding";
+
     inline constexpr const char *native_endian()
     {
         return boost::endian::order::native == boost::endian::order::big ? "big" : "little";
@@ -0,0 +1,663 @@
+#pragma once
+
+#if defined (__linux__) && __has_include(<linux/io_uring.h>)
+
+#define HBK_SIE_HAVE_IO_URING 1
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <advanced_recorder_module/sie/buffer_handle.h>
+#include <advanced_recorder_module/sie/sync_handle.h>
+
+namespace hbk::sie
+{
+    /**
+     * Implements vectored (scatter/gather) file output using the Linux io_uring API. This class
+     * implements the following file operations:
+     *
+     * - Opening: Files are opened when an object is constructed. An io_uring instance with a
+     *   fixed number of write slots is created at the same time.
+     * - Writing: The write() and write_retained() member functions take a free slot and queue a
+     *   write request for the data segments at the next file offset. Requests are handed to
+     *   the kernel in batches, so many blocks are submitted with a single system call while
+     *   several writes are in flight. A slot (and the buffer referenced by its request) is only
+     *   reused once the kernel has reported that the write completed.
+     * - Flushing: The flush() member function submits any queued requests without waiting.
+     * - Syncing: The prepare_sync() member function waits for all in-flight writes to complete
+     *   and returns a handle which makes the data written so far durable, from any thread.
+     * - Closing: Files are closed when an object is destroyed, after all writes have completed.
+     *
+     * The write() function must copy the data segments, because its contract (shared with
+     * posix_vector_io_file) lets the caller reuse its buffers as soon as it returns. It is meant
+     * for small writes such as metadata and index blocks. Bulk data should be written with
+     * write_retained() (see basic_block_writer::write_block_retained()), which hands the caller's
+     * segments to the kernel directly, without copying, and keeps the caller's buffer_handle in
+     * the slot until the kernel has reported that the write completed; only then is the slot
+     * reused and the buffers released. Write errors reported by the kernel are thrown from a
+     * subsequent call to write(), write_retained() or flush().
+     *
+     * The io_uring interface is used via raw system calls so that liburing is not required.
+     */
+    class io_uring_vector_io_file
+    {
+        public:
+
+            /**
+             * The default number of write slots (the maximum number of writes in flight).
+             */
+            static constexpr unsigned DEFAULT_SLOTS = 64;
+
+            /**
+             * The default number of queued requests which causes a batch to be submitted.
+             */
+            static constexpr unsigned DEFAULT_BATCH = 16;
+
+            /**
+             * Opens a file.
+             *
+             * @param filename The path and filename of the file to open. Relative paths are
+             *     interpreted relative to the current working directory.
+             * @param slots The number of write slots, which is the maximum number of writes that
+             *     can be in flight at once.
+             * @param batch The number of queued write requests which causes a batch to be
+             *     submitted to the kernel.
+             *
+             * @throws std::system_error The io_uring instance could not be created (for example
+             *     because the kernel does not support or has disabled io_uring), or the file
+             *     could not be opened.
+             */
+            io_uring_vector_io_file(
+                    const std::string& filename,
+                    unsigned slots = DEFAULT_SLOTS,
+                    unsigned batch = DEFAULT_BATCH)
+                : r(std::make_unique<ring>(slots, batch))
+            {
+                r->fd = ::open(
+                    filename.c_str(),
+                    O_CREAT | O_TRUNC | O_WRONLY | O_CLOEXEC,
+                    0644);
+
+                if (r->fd == -1)
+                    throw std::system_error(
+                        errno,
+                        std::generic_category(),
+                        "failed to open file");
+            }
+
+            io_uring_vector_io_file(const io_uring_vector_io_file&) = delete;
+            io_uring_vector_io_file& operator=(const io_uring_vector_io_file&) = delete;
+
+            /**
+             * Moves a file. After the call, @p rhs is in an invalid state and its members should
+             * not be accessed.
+             *
+             * @param rhs The object to move from.
+             */
+            io_uring_vector_io_file(io_uring_vector_io_file&& rhs) noexcept = default;
+
+            /**
+             * Performs a vectored write to the file.
+             *
+             * @param data A pointer to the first segment of data to write to the file.
+             * @param size The number of bytes pointed to by @p data.
+             * @param args Zero or more additional (@p data, @p size) argument pairs specifying
+             *     additional segments to write to the file.
+             *
+             * @throws std::system_error A write error occurred, either for this write or for a
+             *     previously queued one.
+             * @throws std::runtime_error An end-of-file condition occurred before completely
+             *     writing all specified data.
+             */
+            template <typename ... Args>
+            void write(const void *data, std::size_t size, Args... args)
+            {
+                std::size_t total = size + get_size(args...);
+
+                auto& s = r->acquire_slot();
+                s.buffer.resize(total);
+                gather(s.buffer.data(), data, size, args...);
+
+                s.segments.resize(1);
+                s.segments[0].iov_base = s.buffer.data();
+                s.segments[0].iov_len = total;
+
+                r->queue_write(s, r->next_offset);
+                r->next_offset += total;
+            }
+
+            /**
+             * Performs a vectored write to the file without copying the data. The write request
+             * references the data segments directly, and @p owner is kept until the kernel has
+             * reported that the write completed.
+             *
+             * @param owner A handle which keeps the data segments valid.
+             * @param args One or more (data, size) argument pairs specifying the segments to
+             *     write to the file. The data must not be modified until @p owner is released.
+             *
+             * @throws std::system_error A write error occurred for a previously queued write.
+             */
+            template <typename ... Args>
+            void write_retained(buffer_handle owner, Args... args)
+            {
+                std::size_t total = get_size(args...);
+
+                auto& s = r->acquire_slot();
+                s.segments.resize(sizeof...(args) / 2);
+                populate_iovs(s.segments.data(), args...);
+                s.owner = std::move(owner);
+
+                r->queue_write(s, r->next_offset);
+                r->next_offset += total;
+            }
+
+            /**
+             * Submits any queued write requests to the kernel without waiting for them to
+             * complete.
+             *
+             * @throws std::system_error A write error occurred for a previously queued write.
+             */
+            void flush()
+            {
+                r->submit(0);
+                r->reap();
+                r->check_error();
+            }
+
+            /**
+             * Prepares to make the data written so far durable, by submitting all queued write
+             * requests and waiting for all in-flight writes to complete.
+             *
+             * @return A handle whose sync() function makes the data written so far durable.
+             *
+             * @throws std::system_error A write error occurred, or the file descriptor could not
+             *     be duplicated.
+             */
+            sync_handle prepare_sync()
+            {
+                r->drain();
+
+                if (!handle)
+                    handle = sync_handle(r->fd);
+
+                return handle;
+            }
+
+            /**
+             * Makes the data written so far durable. This is equivalent to
+             * prepare_sync().sync(), and blocks until the storage device has acknowledged the
+             * data.
+             *
+             * @throws std::system_error The operating system reported an error.
+             */
+            void sync()
+            {
+                prepare_sync().sync();
+            }
+
+            /**
+             * Waits for all in-flight writes to complete, then closes the file. I/O errors are
+             * silently ignored.
+             */
+            ~io_uring_vector_io_file() noexcept
+            {
+                if (!r)
+                    return;
+
+                try
+                {
+                    r->drain();
+                }
+
+                catch (const std::exception&)
+                {
+                }
+            }
+
+        private:
+
+            /**
+             * Describes a write slot: the segments referenced by a write request, the staging
+             * buffer or handle which keeps them valid, and the progress of the request.
+             */
+            struct slot
+            {
+                std::vector<std::uint8_t> buffer;   /**< Staging buffer for copied data. */
+                std::vector<iovec> segments;        /**< The data to write. */
+                buffer_handle owner;                /**< Keeps retained segments valid. */
+                std::size_t first = 0;              /**< The first segment not fully written. */
+                std::uint64_t offset = 0;           /**< The file offset of the next byte. */
+            };
+
+            /**
+             * Owns the io_uring instance, the rings mapped from the kernel, the file descriptor
+             * and the write slots. This is kept on the heap so that the enclosing class can be
+             * moved cheaply without invalidating pointers into the mapped rings.
+             */
+            struct ring
+            {
+                int ring_fd = -1;
+                int fd = -1;
+
+                void *sq_ptr = MAP_FAILED;
+                std::size_t sq_size = 0;
+                void *cq_ptr = MAP_FAILED;
+                std::size_t cq_size = 0;
+                io_uring_sqe *sqes = static_cast<io_uring_sqe *>(MAP_FAILED);
+                std::size_t sqes_size = 0;
+
+                unsigned *sq_tail;
+                unsigned *sq_mask;
+                unsigned *sq_array;
+                unsigned *cq_head;
+                unsigned *cq_tail;
+                unsigned *cq_mask;
+                io_uring_cqe *cqes;
+
+                std::vector<slot> slots;
+                std::vector<unsigned> free_slots;
+
+                unsigned batch;
+                unsigned queued = 0;
+                unsigned in_flight = 0;
+                std::uint64_t next_offset = 0;
+                int error = 0;
+
+                ring(unsigned slot_count, unsigned batch_size)
+                    : slots(slot_count ? slot_count : 1)
+                    , batch(batch_size ? batch_size : 1)
+                {
+                    io_uring_params params;
+                    std::memset(&params, 0, sizeof(params));
+
+                    ring_fd = static_cast<int>(::syscall(
+                        __NR_io_uring_setup,
+                        static_cast<unsigned>(slots.size()),
+                        &params));
+                    if (ring_fd < 0)
+                        throw std::system_error(
+                            errno,
+                            std::generic_category(),
+                            "failed to create io_uring instance");
+
+                    try
+                    {
+                        sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+                        cq_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+                        if (params.features & IORING_FEAT_SINGLE_MMAP)
+                            sq_size = cq_size = std::max(sq_size, cq_size);
+
+                        sq_ptr = map(sq_size, IORING_OFF_SQ_RING);
+                        cq_ptr = (params.features & IORING_FEAT_SINGLE_MMAP)
+                            ? sq_ptr
+                            : map(cq_size, IORING_OFF_CQ_RING);
+
+                        sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+                        sqes = static_cast<io_uring_sqe *>(map(sqes_size, IORING_OFF_SQES));
+
+                        auto *sq = static_cast<std::uint8_t *>(sq_ptr);
+                        sq_tail = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+                        sq_mask = reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+                        sq_array = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+
+                        auto *cq = static_cast<std::uint8_t *>(cq_ptr);
+                        cq_head = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+                        cq_tail = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+                        cq_mask = reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+                        cqes = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+
+                        free_slots.reserve(slots.size());
+                        for (unsigned i = static_cast<unsigned>(slots.size()); i > 0; --i)
+                            free_slots.push_back(i - 1);
+                    }
+
+                    catch (...)
+                    {
+                        release();
+                        throw;
+                    }
+                }
+
+                ring(const ring&) = delete;
+                ring& operator=(const ring&) = delete;
+
+                ~ring() noexcept
+                {
+                    release();
+                }
+
+                void release() noexcept
+                {
+                    if (sqes != MAP_FAILED)
+                        ::munmap(sqes, sqes_size);
+                    if (cq_ptr != MAP_FAILED && cq_ptr != sq_ptr)
+                        ::munmap(cq_ptr, cq_size);
+                    if (sq_ptr != MAP_FAILED)
+                        ::munmap(sq_ptr, sq_size);
+                    if (ring_fd != -1)
+                        ::close(ring_fd);
+                    if (fd != -1)
+                        ::close(fd);
+
+                    sqes = static_cast<io_uring_sqe *>(MAP_FAILED);
+                    cq_ptr = sq_ptr = MAP_FAILED;
+                    ring_fd = fd = -1;
+                }
+
+                void *map(std::size_t size, off_t offset)
+                {
+                    void *ptr = ::mmap(
+                        nullptr,
+                        size,
+                        PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE,
+                        ring_fd,
+                        offset);
+
+                    if (ptr == MAP_FAILED)
+                        throw std::system_error(
+                            errno,
+                            std::generic_category(),
+                            "failed to map io_uring rings");
+
+                    return ptr;
+                }
+
+                /**
+                 * Returns a free slot, waiting for an in-flight write to complete if necessary.
+                 */
+                slot& acquire_slot()
+                {
+                    check_error();
+
+                    if (free_slots.empty())
+                        reap();
+
+                    while (free_slots.empty())
+                    {
+                        submit(1);
+                        reap();
+                        check_error();
+                    }
+
+                    unsigned index = free_slots.back();
+                    free_slots.pop_back();
+                    return slots[index];
+                }
+
+                /**
+                 * Queues a write request for the (remaining) contents of a slot.
+                 */
+                void queue_write(slot& s, std::uint64_t offset)
+                {
+                    s.first = 0;
+                    s.offset = offset;
+                    ++in_flight;
+
+                    prepare(s);
+
+                    if (queued >= batch || in_flight == queued)
+                        submit(0);
+                }
+
+                void prepare(slot& s)
+                {
+                    unsigned tail = *sq_tail;
+                    unsigned index = tail & *sq_mask;
+
+                    io_uring_sqe& sqe = sqes[index];
+                    std::memset(&sqe, 0, sizeof(sqe));
+                    sqe.opcode = IORING_OP_WRITEV;
+                    sqe.fd = fd;
+                    sqe.addr = reinterpret_cast<std::uint64_t>(s.segments.data() + s.first);
+                    sqe.len = static_cast<std::uint32_t>(s.segments.size() - s.first);
+                    sqe.off = s.offset;
+                    sqe.user_data = static_cast<std::uint64_t>(&s - slots.data());
+
+                    sq_array[index] = index;
+                    __atomic_store_n(sq_tail, tail + 1, __ATOMIC_RELEASE);
+                    ++queued;
+                }
+
+                /**
+                 * Submits all queued requests, optionally waiting for @p wait_for completions.
+                 */
+                void submit(unsigned wait_for)
+                {
+                    if (!queued && !wait_for)
+                        return;
+
+                    for (;;)
+                    {
+                        int ret = static_cast<int>(::syscall(
+                            __NR_io_uring_enter,
+                            ring_fd,
+                            queued,
+                            wait_for,
+                            wait_for ? IORING_ENTER_GETEVENTS : 0u,
+                            nullptr,
+                            0));
+
+                        if (ret >= 0)
+                        {
+                            queued -= std::min(queued, static_cast<unsigned>(ret));
+                            if (!queued)
+                                return;
+                        }
+
+                        else if (errno == EAGAIN || errno == EBUSY)
+                        {
+                            // The kernel is short of resources, or its completion queue is
+                            // full. Retrying only helps once completions have been consumed,
+                            // so process those available, or wait for one, first.
+                            bool requeued = false;
+                            if (!collect(requeued) && in_flight > queued)
+                                wait_for_completion();
+                        }
+
+                        else if (errno != EINTR)
+                            throw std::system_error(
+                                errno,
+                                std::generic_category(),
+                                "failed to submit writes");
+                    }
+                }
+
+                /**
+                 * Waits until at least one completion is available, without submitting.
+                 */
+                void wait_for_completion()
+                {
+                    int ret = static_cast<int>(::syscall(
+                        __NR_io_uring_enter,
+                        ring_fd,
+                        0u,
+                        1u,
+                        IORING_ENTER_GETEVENTS,
+                        nullptr,
+                        0));
+
+                    if (ret < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY)
+                        throw std::system_error(
+                            errno,
+                            std::generic_category(),
+                            "failed to wait for writes");
+                }
+
+                /**
+                 * Advances a slot's segments past @p written bytes.
+                 *
+                 * @return True if there is data left to write.
+                 */
+                static bool advance(slot& s, std::size_t written) noexcept
+                {
+                    s.offset += written;
+
+                    while (s.first < s.segments.size())
+                    {
+                        iovec& segment = s.segments[s.first];
+
+                        if (written < segment.iov_len)
+                        {
+                            segment.iov_base = static_cast<std::uint8_t *>(segment.iov_base) + written;
+                            segment.iov_len -= written;
+                            return true;
+                        }
+
+                        written -= segment.iov_len;
+                        ++s.first;
+                    }
+
+                    return false;
+                }
+
+                /**
+                 * Processes all available completions, and submits the remainder of any short
+                 * writes.
+                 */
+                void reap()
+                {
+                    bool requeued = false;
+                    collect(requeued);
+
+                    if (requeued)
+                        submit(0);
+                }
+
+                /**
+                 * Processes all available completions, queuing (but not submitting) the
+                 * remainder of short writes and returning finished slots to the free list.
+                 * Retained buffers are released as their writes complete.
+                 *
+                 * @param requeued Set to true if the remainder of a short write was queued.
+                 *
+                 * @return The number of completions processed.
+                 */
+                unsigned collect(bool& requeued)
+                {
+                    unsigned head = *cq_head;
+                    unsigned tail = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+                    unsigned count = tail - head;
+
+                    for (; head != tail; ++head)
+                    {
+                        const io_uring_cqe& cqe = cqes[head & *cq_mask];
+                        slot& s = slots[cqe.user_data];
+
+                        if (cqe.res < 0)
+                        {
+                            if (!error)
+                                error = -cqe.res;
+                        }
+
+                        else if (cqe.res == 0)
+                        {
+                            if (!error)
+                                error = EIO;
+                        }
+
+                        else if (advance(s, static_cast<std::size_t>(cqe.res)))
+                        {
+                            prepare(s);
+                            requeued = true;
+                            continue;
+                        }
+
+                        --in_flight;
+                        s.owner.reset();
+                        free_slots.push_back(static_cast<unsigned>(&s - slots.data()));
+                    }
+
+                    __atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
+                    return count;
+                }
+
+                /**
+                 * Waits for all in-flight writes to complete.
+                 */
+                void drain()
+                {
+                    while (in_flight)
+                    {
+                        submit(1);
+                        reap();
+                    }
+
+                    check_error();
+                }
+
+                void check_error()
+                {
+                    if (error)
+                    {
+                        int err = error;
+                        error = 0;
+                        throw std::system_error(
+                            err,
+                            std::generic_category(),
+                            "failed to write to file");
+                    }
+                }
+            };
+
+            static std::size_t get_size() noexcept
+            {
+                return 0;
+            }
+
+            template <typename ... Args>
+            static std::size_t get_size(const void *, std::size_t size, Args... args) noexcept
+            {
+                return size + get_size(args...);
+            }
+
+            static void populate_iovs(iovec *) noexcept
+            {
+            }
+
+            template <typename ... Args>
+            static void populate_iovs(iovec *segments, const void *data, std::size_t size, Args... args) noexcept
+            {
+                segments->iov_base = const_cast<void *>(data);
+                segments->iov_len = size;
+                populate_iovs(segments + 1, args...);
+            }
+
+            static void gather(std::uint8_t *) noexcept
+            {
+            }
+
+            template <typename ... Args>
+            static void gather(std::uint8_t *dest, const void *data, std::size_t size, Args... args) noexcept
+            {
+                if (size)
+                    std::memcpy(dest, data, size);
+                gather(dest + size, args...);
+            }
+
+            std::unique_ptr<ring> r;
+
+            /**
+             * The handle returned by prepare_sync(), created when it is first called.
+             */
+            sync_handle handle;
+    };
+}
+
+#endif
@@ -0,0 +1,152 @@
+#pragma once
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <system_error>
+#include <utility>
+
+#if defined (__unix__) || (defined (__APPLE__) && defined (__MACH__))
+#define HBK_SIE_HAVE_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#include <fstream>
+#include <iterator>
+#include <vector>
+#endif
+
+namespace hbk::sie
+{
+    /**
+     * Provides read-only access to the entire contents of a file as a contiguous range of bytes.
+     * On POSIX systems, the file is memory-mapped, so its contents are paged in by the operating
+     * system only when accessed. On other systems, the file is read into memory when the object
+     * is constructed.
+     */
+    class mapped_file
+    {
+        public:
+
+            /**
+             * Opens and maps a file.
+             *
+             * @param filename The path and filename of the file to open. Relative paths are
+             *     interpreted relative to the current working directory.
+             *
+             * @throws std::system_error The file could not be opened or mapped.
+             */
+            explicit mapped_file(const std::string& filename)
+            {
+#ifdef HBK_SIE_HAVE_MMAP
+                int fd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+                if (fd == -1)
+                    throw std::system_error(
+                        errno,
+                        std::generic_category(),
+                        "failed to open file");
+
+                struct stat st;
+                if (::fstat(fd, &st) == -1)
+                {
+                    int error = errno;
+                    ::close(fd);
+                    throw std::system_error(
+                        error,
+                        std::generic_category(),
+                        "failed to stat file");
+                }
+
+                size_ = static_cast<std::size_t>(st.st_size);
+
+                if (size_)
+                {
+                    void *mapping = ::mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+                    if (mapping == MAP_FAILED)
+                    {
+                        int error = errno;
+                        ::close(fd);
+                        throw std::system_error(
+                            error,
+                            std::generic_category(),
+                            "failed to map file");
+                    }
+
+                    data_ = static_cast<const std::uint8_t *>(mapping);
+                }
+
+                ::close(fd);
+#else
+                std::ifstream in(filename, std::ios::binary);
+                if (!in)
+                    throw std::system_error(
+                        std::make_error_code(std::errc::no_such_file_or_directory),
+                        "failed to open file");
+
+                contents.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+                data_ = reinterpret_cast<const std::uint8_t *>(contents.data());
+                size_ = contents.size();
+#endif
+            }
+
+            mapped_file(const mapped_file&) = delete;
+            mapped_file& operator=(const mapped_file&) = delete;
+
+            /**
+             * Moves a mapped file. After the call, @p rhs is empty.
+             *
+             * @param rhs The object to move from.
+             */
+            mapped_file(mapped_file&& rhs) noexcept
+                : data_(std::exchange(rhs.data_, nullptr))
+                , size_(std::exchange(rhs.size_, 0))
+#ifndef HBK_SIE_HAVE_MMAP
+                , contents(std::move(rhs.contents))
+#endif
+            {
+            }
+
+            /**
+             * Unmaps the file.
+             */
+            ~mapped_file() noexcept
+            {
+#ifdef HBK_SIE_HAVE_MMAP
+                if (data_)
+                    ::munmap(const_cast<std::uint8_t *>(data_), size_);
+#endif
+            }
+
+            /**
+             * Gets a pointer to the first byte of the file.
+             *
+             * @return A pointer to the file contents, or nullptr if the file is empty.
+             */
+            const std::uint8_t *data() const noexcept
+            {
+                return data_;
+            }
+
+            /**
+             * Gets the size of the file.
+             *
+             * @return The size of the file, in bytes.
+             */
+            std::size_t size() const noexcept
+            {
+                return size_;
+            }
+
+        private:
+
+            const std::uint8_t *data_ = nullptr;
+            std::size_t size_ = 0;
+
+#ifndef HBK_SIE_HAVE_MMAP
+            std::vector<char> contents;
+#endif
+    };
+}
@@ -0,0 +1,334 @@
+#pragma once
+
+#if defined (__unix__) || (defined (__APPLE__) && defined (__MACH__))
+
+#define HBK_SIE_HAVE_MMAP 1
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <system_error>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <advanced_recorder_module/sie/buffer_handle.h>
+#include <advanced_recorder_module/sie/sync_handle.h>
+
+namespace hbk::sie
+{
+    /**
+     * Implements vectored (scatter/gather) file output by copying into a memory-mapped,
+     * preallocated file. This class implements the following file operations:
+     *
+     * - Opening: Files are opened when an object is constructed. The first extent of the file is
+     *   preallocated and mapped into memory at the same time.
+     * - Writing: The write() member function copies the data segments directly into the mapping.
+     *   No system calls are made, except when the end of the mapped extent is reached: then the
+     *   next extent is preallocated (with fallocate() where available) and the mapping is moved
+     *   to it. Preallocating in large extents also keeps the file contiguous on disk during long
+     *   recordings, and guarantees that the filesystem has reserved space for the mapped pages.
+     * - Syncing: The prepare_sync() member function starts writing back the mapped pages and
+     *   returns a handle which makes the data written so far durable, from any thread.
+     * - Closing: Files are closed when an object is destroyed, after the mapping has been removed
+     *   and the file has been truncated to the number of bytes actually written.
+     *
+     * Only one extent is mapped at a time, so the address space used does not grow with the file.
+     * Data is handed to the operating system's page cache as soon as it is copied, so flush()
+     * has nothing to do. If the process terminates abnormally, the file is not truncated and
+     * contains zero bytes after the last written block; SIE readers treat these as the end of
+     * the file.
+     */
+    class mmap_vector_io_file
+    {
+        public:
+
+            /**
+             * The default size, in bytes, of each preallocated and mapped extent.
+             */
+            static constexpr std::size_t DEFAULT_EXTENT = 64 * 1024 * 1024;
+
+            /**
+             * Opens a file.
+             *
+             * @param filename The path and filename of the file to open. Relative paths are
+             *     interpreted relative to the current working directory.
+             * @param extent The size, in bytes, by which the file is grown and which is mapped
+             *     at once. This value is rounded up to a multiple of the page size.
+             *
+             * @throws std::system_error The file could not be opened, preallocated or mapped.
+             */
+            mmap_vector_io_file(
+                    const std::string& filename,
+                    std::size_t extent = DEFAULT_EXTENT)
+                : fd(
+                    ::open(
+                        filename.c_str(),
+                        O_CREAT | O_TRUNC | O_RDWR | O_CLOEXEC,
+                        0644))
+            {
+                if (fd == -1)
+                    throw std::system_error(
+                        errno,
+                        std::generic_category(),
+                        "failed to open file");
+
+                auto page_size = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+                this->extent = std::max<std::size_t>(
+                    (extent + page_size - 1) / page_size * page_size,
+                    page_size);
+
+                try
+                {
+                    map(0);
+                }
+
+                catch (...)
+                {
+                    ::close(fd);
+                    throw;
+                }
+            }
+
+            mmap_vector_io_file(const mmap_vector_io_file&) = delete;
+            mmap_vector_io_file& operator=(const mmap_vector_io_file&) = delete;
+
+            /**
+             * Moves a file. After the call, @p rhs is in an invalid state and its members should
+             * not be accessed.
+             *
+             * @param rhs The object to move from.
+             */
+            mmap_vector_io_file(mmap_vector_io_file&& rhs) noexcept
+                : fd(std::exchange(rhs.fd, -1))
+                , extent(rhs.extent)
+                , mapping(std::exchange(rhs.mapping, MAP_FAILED))
+                , mapping_offset(rhs.mapping_offset)
+                , position(rhs.position)
+                , handle(std::move(rhs.handle))
+            {
+            }
+
+            /**
+             * Performs a vectored write to the file.
+             *
+             * @param data A pointer to the first segment of data to write to the file.
+             * @param size The number of bytes pointed to by @p data.
+             * @param args Zero or more additional (@p data, @p size) argument pairs specifying
+             *     additional segments to write to the file.
+             *
+             * @throws std::system_error The next extent of the file could not be preallocated or
+             *     mapped.
+             */
+            template <typename ... Args>
+            void write(const void *data, std::size_t size, Args... args)
+            {
+                copy(static_cast<const std::uint8_t *>(data), size);
+                write(args...);
+            }
+
+            /**
+             * Performs a vectored write to the file of data owned by @p owner. Since write()
+             * copies the data into the mapping before returning, this is equivalent to write(),
+             * and @p owner is released when the call returns.
+             *
+             * @param owner A handle which keeps the data segments valid.
+             * @param args One or more (data, size) argument pairs specifying the segments to
+             *     write to the file.
+             *
+             * @throws ... This function propagates any exception thrown by write().
+             */
+            template <typename ... Args>
+            void write_retained([[maybe_unused]] buffer_handle owner, Args... args)
+            {
+                write(args...);
+            }
+
+            /**
+             * Submits any buffered writes to the operating system. Since write() copies data
+             * directly into the page cache, this function does nothing.
+             */
+            void flush() noexcept
+            {
+            }
+
+            /**
+             * Prepares to make the data written so far durable. Previously mapped extents have
+             * already been unmapped, which leaves their pages in the page cache; writeback of the
+             * current extent is started here, without waiting, since not all platforms flush
+             * dirty mapped pages in fsync().
+             *
+             * @return A handle whose sync() function makes the data written so far durable.
+             *
+             * @throws std::system_error The file descriptor could not be duplicated.
+             */
+            sync_handle prepare_sync()
+            {
+                if (mapping != MAP_FAILED && position > mapping_offset)
+                    ::msync(mapping, position - mapping_offset, MS_ASYNC);
+
+                if (!handle)
+                    handle = sync_handle(fd);
+
+                return handle;
+            }
+
+            /**
+             * Makes the data written so far durable. This is equivalent to
+             * prepare_sync().sync(), and blocks until the storage device has acknowledged the
+             * data.
+             *
+             * @throws std::system_error The operating system reported an error.
+             */
+            void sync()
+            {
+                prepare_sync().sync();
+            }
+
+            /**
+             * Removes the mapping, truncates the file to the number of bytes written, and closes
+             * the file. I/O errors are silently ignored.
+             */
+            ~mmap_vector_io_file() noexcept
+            {
+                if (mapping != MAP_FAILED)
+                    ::munmap(mapping, extent);
+
+                if (fd != -1)
+                {
+                    (void) ::ftruncate(fd, static_cast<off_t>(position));
+                    ::close(fd);
+                }
+            }
+
+        private:
+
+            /**
+             * Terminates the recursion of the write(const void *, std::size_t, Args...) member
+             * function.
+             */
+            static void write() noexcept
+            {
+            }
+
+            /**
+             * Copies data into the mapping, moving the mapping to subsequent extents as required.
+             *
+             * @param data A pointer to the data to copy.
+             * @param size The number of bytes pointed to by @p data.
+             */
+            void copy(const std::uint8_t *data, std::size_t size)
+            {
+                while (size)
+                {
+                    if (position == mapping_offset + extent)
+                        map(position);
+
+                    std::size_t n = std::min(size, mapping_offset + extent - position);
+                    std::memcpy(static_cast<std::uint8_t *>(mapping) + (position - mapping_offset), data, n);
+
+                    data += n;
+                    size -= n;
+                    position += n;
+                }
+            }
+
+            /**
+             * Preallocates the extent starting at the specified file offset and replaces the
+             * current mapping with a mapping of that extent.
+             *
+             * @param offset The file offset of the extent, which must be a multiple of the extent
+             *     size.
+             */
+            void map(std::size_t offset)
+            {
+                preallocate(offset, extent);
+
+                if (mapping != MAP_FAILED)
+                {
+                    ::munmap(mapping, extent);
+                    mapping = MAP_FAILED;
+                }
+
+                mapping = ::mmap(
+                    nullptr,
+                    extent,
+                    PROT_READ | PROT_WRITE,
+                    MAP_SHARED,
+                    fd,
+                    static_cast<off_t>(offset));
+
+                if (mapping == MAP_FAILED)
+                    throw std::system_error(
+                        errno,
+                        std::generic_category(),
+                        "failed to map file");
+
+                mapping_offset = offset;
+            }
+
+            /**
+             * Reserves disk space for, and extends the file to include, the specified range.
+             * Where fallocate() is unavailable or unsupported by the filesystem, the file is
+             * extended with ftruncate() instead, which does not reserve disk space.
+             */
+            void preallocate(std::size_t offset, std::size_t size)
+            {
+#ifdef __linux__
+                if (::fallocate(fd, 0, static_cast<off_t>(offset), static_cast<off_t>(size)) == 0)
+                    return;
+
+                if (errno != EOPNOTSUPP && errno != ENOSYS)
+                    throw std::system_error(
+                        errno,
+                        std::generic_category(),
+                        "failed to preallocate file");
+#endif
+
+                if (::ftruncate(fd, static_cast<off_t>(offset + size)) == -1)
+                    throw std::system_error(
+                        errno,
+                        std::generic_category(),
+                        "failed to extend file");
+            }
+
+            /**
+             * The POSIX file descriptor of the file. If the file has been closed (because this
+             * object has been moved-from), the value is -1.
+             */
+            int fd;
+
+            /**
+             * The size of each preallocated and mapped extent, in bytes.
+             */
+            std::size_t extent = 0;
+
+            /**
+             * The address of the currently mapped extent, or MAP_FAILED if none is mapped.
+             */
+            void *mapping = MAP_FAILED;
+
+            /**
+             * The file offset of the currently mapped extent.
+             */
+            std::size_t mapping_offset = 0;
+
+            /**
+             * The number of bytes written to the file so far.
+             */
+            std::size_t position = 0;
+
+            /**
+             * The handle returned by prepare_sync(), created when it is first called.
+             */
+            sync_handle handle;
+    };
+}
+
+#endif
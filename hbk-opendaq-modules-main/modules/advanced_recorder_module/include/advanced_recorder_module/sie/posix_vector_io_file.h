@@ -11,6 +11,9 @@
 #include <unistd.h>
 #include <sys/uio.h>
 
+#include <advanced_recorder_module/sie/buffer_handle.h>
+#include <advanced_recorder_module/sie/sync_handle.h>
+
 namespace hbk::sie
 {
     /**
@@ -19,6 +22,8 @@ namespace hbk::sie
      *
      * - Opening: Files are opened when an object is constructed.
      * - Writing: The write() member function implements vectored output using writev().
+     * - Syncing: The prepare_sync() member function returns a handle which makes the data written
+     *   so far durable using fdatasync(), from any thread.
      * - Closing: Files are closed when an object is destroyed.
      */
     class posix_vector_io_file
@@ -58,6 +63,7 @@ namespace hbk::sie
              */
             posix_vector_io_file(posix_vector_io_file&& rhs) noexcept
                 : fd(-1)
+                , handle(std::move(rhs.handle))
             {
                 std::swap(fd, rhs.fd);
             }
@@ -119,6 +125,58 @@ namespace hbk::sie
                 }
             }
 
+            /**
+             * Performs a vectored write to the file of data owned by @p owner. Since write()
+             * consumes the data before returning, this is equivalent to write(), and @p owner is
+             * released when the call returns.
+             *
+             * @param owner A handle which keeps the data segments valid.
+             * @param args One or more (data, size) argument pairs specifying the segments to
+             *     write to the file.
+             *
+             * @throws ... This function propagates any exception thrown by write().
+             */
+            template <typename ... Args>
+            void write_retained([[maybe_unused]] buffer_handle owner, Args... args)
+            {
+                write(args...);
+            }
+
+            /**
+             * Submits any buffered writes to the operating system. Since write() does not buffer
+             * any data, this function does nothing.
+             */
+            void flush() noexcept
+            {
+            }
+
+            /**
+             * Prepares to make the data written so far durable. Since write() does not buffer
+             * any data, this only returns a handle to the file.
+             *
+             * @return A handle whose sync() function makes the data written so far durable.
+             *
+             * @throws std::system_error The file descriptor could not be duplicated.
+             */
+            sync_handle prepare_sync()
+            {
+                if (!handle)
+                    handle = sync_handle(fd);
+                return handle;
+            }
+
+            /**
+             * Makes the data written so far durable. This is equivalent to
+             * prepare_sync().sync(), and blocks until the storage device has acknowledged the
+             * data.
+             *
+             * @throws std::system_error The operating system reported an error.
+             */
+            void sync()
+            {
+                prepare_sync().sync();
+            }
+
             /**
              * Closes a file.
              */
@@ -172,5 +230,10 @@ namespace hbk::sie
              * object has been moved-from), the value is -1.
              */
             int fd;
+
+            /**
+             * The handle returned by prepare_sync(), created when it is first called.
+             */
+            sync_handle handle;
     };
 }
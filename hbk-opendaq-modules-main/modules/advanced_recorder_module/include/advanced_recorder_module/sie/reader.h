@@ -0,0 +1,646 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/endian/conversion.hpp>
+
+#include <advanced_recorder_module/sie/crc32.h>
+#include <advanced_recorder_module/sie/format.h>
+#include <advanced_recorder_module/sie/mapped_file.h>
+#include <advanced_recorder_module/sie/xml.h>
+#include <advanced_recorder_module/sie/xml_parser.h>
+
+namespace hbk::sie
+{
+    /**
+     * Describes a single block of an SIE file which has been read by a reader. The payload is
+     * not copied: block_view objects point directly into the reader's mapping of the file, and
+     * remain valid as long as the reader exists.
+     */
+    struct block_view
+    {
+        std::uint64_t offset = 0;               /**< The offset of the block in the file. */
+        std::uint32_t group = 0;                /**< The group ID of the block. */
+        std::uint32_t size = 0;                 /**< The size of the block, including header
+                                                     and footer. */
+        std::uint32_t checksum = 0;             /**< The checksum stored in the footer. */
+        const std::uint8_t *block = nullptr;    /**< The first byte of the block (header). */
+        const std::uint8_t *payload = nullptr;  /**< The first byte of the payload. */
+        std::size_t payload_size = 0;           /**< The number of payload bytes. */
+
+        /**
+         * Calculates the checksum of the block's header and payload and compares it to the
+         * checksum stored in the footer.
+         *
+         * @return True if the checksum matches.
+         */
+        bool verify() const noexcept
+        {
+            crc32 crc;
+            crc.process_bytes(block, sizeof(block_header) + payload_size);
+            return crc() == checksum;
+        }
+    };
+
+    /**
+     * Describes a data block listed in an SIE file's time index.
+     */
+    struct timed_block
+    {
+        std::uint64_t offset;   /**< The offset of the block in the file. */
+        std::int64_t first;     /**< The domain tick of the first sample in the block. */
+        std::int64_t last;      /**< The domain tick of the last sample in the block. */
+    };
+
+    /**
+     * Reads an SIE file. The file is memory-mapped, and a table of the offsets of the blocks of
+     * each group is built when it is first needed, so constructing a reader takes constant time
+     * regardless of the size of the file.
+     *
+     * The table is built from the index blocks (group 1) emitted by basic_indexed_writer,
+     * without touching the payload of any other block. If the file ends with an index directory
+     * (as every finished file does, since its trailer is one), the index blocks are found
+     * through the directories, which lead to all of them (see basic_indexed_writer). Otherwise,
+     * the index blocks are found by following their chain: every index block lists the blocks
+     * written since the previous index block, so starting from the index block at the end of the
+     * file, the previous index block is always the one that ends where the first listed block
+     * begins (skipping any index directories in between).
+     *
+     * If the file does not end with a valid index block (for example, because the recording was
+     * interrupted), or if the index is inconsistent, the reader falls back to a forward scan
+     * which follows the size field of each block header, stopping at the first invalid block.
+     * Checksums are not verified while building the table; use block_view::verify() to do so.
+     * Index directories are not included in the table.
+     *
+     * The time index blocks (group 2) written by basic_indexed_writer::write_timed_block() are
+     * also loaded, so that blocks_in_range() can find the blocks covering a time window with a
+     * binary search. Data blocks written after the last time index block (which is only possible
+     * if the recording was interrupted) are not included in the time index.
+     *
+     * A reader is not thread-safe, but its const member functions other than metadata() can be
+     * safely called from multiple threads.
+     */
+    class reader
+    {
+        public:
+
+            /**
+             * Opens an SIE file. The block table is built on first use.
+             *
+             * @param filename The path and filename of the file to open. Relative paths are
+             *     interpreted relative to the current working directory.
+             *
+             * @throws std::system_error The file could not be opened or mapped.
+             */
+            explicit reader(const std::string& filename)
+                : file(filename)
+            {
+                auto last = block_ending_at(file.size());
+                if (last && is_index_directory(*last))
+                    root = last->offset;
+            }
+
+            reader(const reader&) = delete;
+            reader& operator=(const reader&) = delete;
+
+            /**
+             * Moves a reader. After the call, @p rhs is empty. Any block_view objects obtained
+             * from @p rhs remain valid.
+             */
+            reader(reader&&) = default;
+
+            /**
+             * Gets the block table.
+             *
+             * @return A map from each group ID present in the file to the sorted offsets of the
+             *     blocks of that group.
+             */
+            const std::map<std::uint32_t, std::vector<std::uint64_t>>& groups() const
+            {
+                load();
+                return table;
+            }
+
+            /**
+             * Gets the offsets of the blocks of a group.
+             *
+             * @param group The group ID.
+             *
+             * @return The sorted offsets of the blocks of @p group. If there are none, the vector
+             *     is empty.
+             */
+            const std::vector<std::uint64_t>& blocks(std::uint32_t group) const
+            {
+                load();
+
+                static const std::vector<std::uint64_t> none;
+                auto it = table.find(group);
+                return it == table.end() ? none : it->second;
+            }
+
+            /**
+             * Reads the block at the specified offset.
+             *
+             * @param offset The offset of the block in the file.
+             *
+             * @return A description of the block.
+             *
+             * @throws std::runtime_error There is no valid block at @p offset.
+             */
+            block_view block_at(std::uint64_t offset) const
+            {
+                auto block = try_block_at(offset);
+                if (!block)
+                    throw std::runtime_error(
+                        "no valid SIE block at offset " + std::to_string(offset));
+                return *block;
+            }
+
+            /**
+             * Reads the block at the specified offset. The header and footer are checked for
+             * consistency, but the checksum is not verified.
+             *
+             * @param offset The offset of the block in the file.
+             *
+             * @return A description of the block, or an empty optional if there is no valid block
+             *     at @p offset.
+             */
+            std::optional<block_view> try_block_at(std::uint64_t offset) const noexcept
+            {
+                return probe(file.data(), file.size(), offset);
+            }
+
+            /**
+             * Determines whether a block is an index directory (see basic_indexed_writer): an
+             * index block whose entries refer to other index blocks, rather than to data blocks.
+             *
+             * @param block The block.
+             *
+             * @return True if @p block is an index directory.
+             */
+            static bool is_index_directory(const block_view& block) noexcept
+            {
+                return block.group == groups::INDEX
+                    && block.payload_size >= sizeof(index_entry)
+                    && block.payload_size % sizeof(index_entry) == 0
+                    && load_be32(block.payload + 8) == groups::INDEX;
+            }
+
+            /**
+             * Reads the block at the specified offset of the contents of an SIE file, without
+             * constructing a reader. The header and footer are checked for consistency, but the
+             * checksum is not verified.
+             *
+             * @param data A pointer to the first byte of the file.
+             * @param size The size of the file, in bytes.
+             * @param offset The offset of the block in the file.
+             *
+             * @return A description of the block, or an empty optional if there is no valid block
+             *     at @p offset.
+             */
+            static std::optional<block_view> probe(
+                const std::uint8_t *data,
+                std::size_t size,
+                std::uint64_t offset) noexcept
+            {
+                constexpr std::size_t overhead = sizeof(block_header) + sizeof(block_footer);
+
+                if (offset > size || size - offset < overhead)
+                    return std::nullopt;
+
+                const std::uint8_t *p = data + offset;
+
+                std::uint32_t block_size = load_be32(p);
+                if (block_size < overhead
+                        || block_size > size - offset
+                        || load_be32(p + 8) != SYNC_WORD
+                        || load_be32(p + block_size - 4) != block_size)
+                    return std::nullopt;
+
+                block_view block;
+                block.offset = offset;
+                block.group = load_be32(p + 4);
+                block.size = block_size;
+                block.checksum = load_be32(p + block_size - 8);
+                block.block = p;
+                block.payload = p + sizeof(block_header);
+                block.payload_size = block_size - overhead;
+                return block;
+            }
+
+            /**
+             * Gets the time index of a group.
+             *
+             * @param group The group ID.
+             *
+             * @return The time index entries of @p group, sorted by the tick of their first
+             *     sample. If the group has no time index entries, the vector is empty.
+             */
+            const std::vector<timed_block>& time_index(std::uint32_t group) const
+            {
+                load();
+
+                static const std::vector<timed_block> none;
+                auto it = times.find(group);
+                return it == times.end() ? none : it->second.blocks;
+            }
+
+            /**
+             * Finds the data blocks of a group which contain samples within a time window. This
+             * takes O(log n + k) time for n indexed blocks, of which k are returned, provided the
+             * blocks of the group do not overlap in time.
+             *
+             * @param group The group ID.
+             * @param from The domain tick at which the window starts.
+             * @param to The domain tick at which the window ends (inclusive).
+             *
+             * @return The time index entries of the blocks of @p group whose tick range
+             *     intersects [@p from, @p to], sorted by the tick of their first sample.
+             */
+            std::vector<timed_block> blocks_in_range(
+                std::uint32_t group,
+                std::int64_t from,
+                std::int64_t to) const
+            {
+                load();
+
+                std::vector<timed_block> result;
+
+                auto it = times.find(group);
+                if (it == times.end())
+                    return result;
+
+                const auto& blocks = it->second.blocks;
+                const auto& reach = it->second.reach;
+
+                // reach[i] is the largest last tick of blocks 0..i, so it is sorted, and no
+                // block before the first one with reach[i] >= from can end within the window.
+                auto i = static_cast<std::size_t>(
+                    std::lower_bound(reach.begin(), reach.end(), from) - reach.begin());
+
+                for (; i < blocks.size() && blocks[i].first <= to; ++i)
+                    if (blocks[i].last >= from)
+                        result.push_back(blocks[i]);
+
+                return result;
+            }
+
+            /**
+             * Gets the offset just past the last block in the block table. For a complete SIE
+             * file, this is the file size. It is smaller if the file ends with a partially
+             * written block or with preallocated space that was never written.
+             *
+             * @return The offset of the end of the readable data.
+             */
+            std::uint64_t data_end() const
+            {
+                load();
+                return end;
+            }
+
+            /**
+             * Determines whether the block table was built from the file's index blocks, rather
+             * than by scanning the file.
+             *
+             * @return True if the file's index blocks were used.
+             */
+            bool indexed() const
+            {
+                load();
+                return used_index;
+            }
+
+            /**
+             * Determines whether the file ends with an index directory, such as the trailer
+             * written by basic_indexed_writer::finish(), which lets the block table be built
+             * without walking the chain of index blocks. This does not build the block table.
+             *
+             * @return True if the file ends with an index directory.
+             */
+            bool has_directory() const noexcept
+            {
+                return root.has_value();
+            }
+
+            /**
+             * Gets the raw XML metadata: the concatenation of the payloads of all blocks of the
+             * metadata group (group 0), in file order.
+             *
+             * @return The XML metadata string.
+             */
+            std::string metadata_xml() const
+            {
+                std::string xml;
+                for (auto offset : blocks(groups::METADATA))
+                {
+                    auto block = block_at(offset);
+                    xml.append(reinterpret_cast<const char *>(block.payload), block.payload_size);
+                }
+                return xml;
+            }
+
+            /**
+             * Parses the XML metadata. The result is cached, so the metadata is only parsed on
+             * the first call.
+             *
+             * @return The root element of the XML metadata (normally an element named "sie").
+             *
+             * @throws std::runtime_error The metadata is not well-formed XML.
+             */
+            const xml::element& metadata() const
+            {
+                if (!parsed_metadata)
+                    parsed_metadata.emplace(xml::parse(metadata_xml()));
+                return *parsed_metadata;
+            }
+
+            /**
+             * Gets a pointer to the mapped file contents.
+             *
+             * @return A pointer to the first byte of the file.
+             */
+            const std::uint8_t *data() const noexcept
+            {
+                return file.data();
+            }
+
+            /**
+             * Gets the size of the file.
+             *
+             * @return The size of the file, in bytes.
+             */
+            std::size_t size() const noexcept
+            {
+                return file.size();
+            }
+
+        private:
+
+            static std::uint32_t load_be32(const std::uint8_t *p) noexcept
+            {
+                std::uint32_t value;
+                std::memcpy(&value, p, sizeof(value));
+                return boost::endian::big_to_native(value);
+            }
+
+            static std::uint64_t load_be64(const std::uint8_t *p) noexcept
+            {
+                std::uint64_t value;
+                std::memcpy(&value, p, sizeof(value));
+                return boost::endian::big_to_native(value);
+            }
+
+            /**
+             * Gets the block which ends at the specified offset, using the size in its footer.
+             */
+            std::optional<block_view> block_ending_at(std::uint64_t offset) const noexcept
+            {
+                if (offset < sizeof(block_footer) || offset > file.size())
+                    return std::nullopt;
+
+                std::uint32_t size = load_be32(file.data() + offset - 4);
+                if (size > offset)
+                    return std::nullopt;
+
+                auto block = try_block_at(offset - size);
+                if (block && block->size != size)
+                    return std::nullopt;
+                return block;
+            }
+
+            /**
+             * Builds the block table, if it has not been built yet.
+             */
+            void load() const
+            {
+                std::call_once(*loaded, [this]()
+                {
+                    if (!(root && load_directory(*root)) && !load_index())
+                        scan();
+
+                    for (auto& [group, offsets] : table)
+                        std::sort(offsets.begin(), offsets.end());
+
+                    load_time_index();
+                });
+            }
+
+            /**
+             * Adds the blocks listed in an index block to the block table.
+             *
+             * @return True if successful; false if @p index is not a valid index block.
+             */
+            bool load_index_block(const block_view& index) const
+            {
+                if (index.group != groups::INDEX
+                        || index.payload_size == 0
+                        || index.payload_size % sizeof(index_entry) != 0)
+                    return false;
+
+                table[groups::INDEX].push_back(index.offset);
+
+                std::size_t count = index.payload_size / sizeof(index_entry);
+                for (std::size_t i = 0; i < count; ++i)
+                {
+                    const std::uint8_t *entry = index.payload + i * sizeof(index_entry);
+                    std::uint64_t offset = load_be64(entry);
+
+                    // Entries must precede the index block, which also guarantees that any walk
+                    // through the index terminates.
+                    if (offset >= index.offset)
+                        return false;
+
+                    table[load_be32(entry + 8)].push_back(offset);
+                }
+
+                return true;
+            }
+
+            /**
+             * Builds the block table from the index directory at the specified offset, and the
+             * index blocks and directories it leads to.
+             *
+             * @return True if successful; false if the tree is inconsistent, in which case the
+             *     block table is left empty.
+             */
+            bool load_directory(std::uint64_t offset) const
+            {
+                std::vector<std::uint64_t> pending { offset };
+
+                while (!pending.empty())
+                {
+                    auto block = try_block_at(pending.back());
+                    pending.pop_back();
+
+                    if (!block)
+                    {
+                        table.clear();
+                        return false;
+                    }
+
+                    if (!is_index_directory(*block))
+                    {
+                        if (!load_index_block(*block))
+                        {
+                            table.clear();
+                            return false;
+                        }
+
+                        continue;
+                    }
+
+                    std::size_t count = block->payload_size / sizeof(index_entry);
+                    for (std::size_t i = 0; i < count; ++i)
+                    {
+                        std::uint64_t entry = load_be64(block->payload + i * sizeof(index_entry));
+                        if (entry >= block->offset)
+                        {
+                            table.clear();
+                            return false;
+                        }
+
+                        pending.push_back(entry);
+                    }
+                }
+
+                used_index = true;
+                end = file.size();
+                return true;
+            }
+
+            /**
+             * Builds the block table by following the chain of index blocks backwards from the
+             * end of the file.
+             *
+             * @return True if successful; false if the chain is missing or inconsistent, in
+             *     which case the block table is left empty.
+             */
+            bool load_index() const
+            {
+                std::uint64_t position = file.size();
+
+                while (position > 0)
+                {
+                    auto index = block_ending_at(position);
+
+                    // Directories only list index blocks which are also on the chain.
+                    if (index && is_index_directory(*index))
+                    {
+                        position = index->offset;
+                        continue;
+                    }
+
+                    if (!index || !load_index_block(*index))
+                    {
+                        table.clear();
+                        return false;
+                    }
+
+                    std::uint64_t first = index->offset;
+                    std::size_t count = index->payload_size / sizeof(index_entry);
+                    for (std::size_t i = 0; i < count; ++i)
+                        first = std::min(first, load_be64(index->payload + i * sizeof(index_entry)));
+
+                    position = first;
+                }
+
+                used_index = true;
+                end = file.size();
+                return true;
+            }
+
+            /**
+             * Builds the block table by following the size fields of the block headers forwards
+             * from the start of the file, stopping at the first invalid block.
+             */
+            void scan() const
+            {
+                std::uint64_t position = 0;
+
+                while (auto block = try_block_at(position))
+                {
+                    if (!is_index_directory(*block))
+                        table[block->group].push_back(position);
+                    position += block->size;
+                }
+
+                used_index = false;
+                end = position;
+            }
+
+            /**
+             * Loads the entries of all time index blocks into the per-group time tables.
+             */
+            void load_time_index() const
+            {
+                auto it = table.find(groups::TIME_INDEX);
+                if (it == table.end())
+                    return;
+
+                for (auto offset : it->second)
+                {
+                    auto block = try_block_at(offset);
+                    if (!block)
+                        continue;
+
+                    std::size_t count = block->payload_size / sizeof(time_index_entry);
+                    for (std::size_t i = 0; i < count; ++i)
+                    {
+                        const std::uint8_t *entry = block->payload + i * sizeof(time_index_entry);
+
+                        timed_block timed;
+                        timed.offset = load_be64(entry);
+                        timed.first = static_cast<std::int64_t>(load_be64(entry + 12));
+                        timed.last = static_cast<std::int64_t>(load_be64(entry + 20));
+
+                        times[load_be32(entry + 8)].blocks.push_back(timed);
+                    }
+                }
+
+                for (auto& [group, t] : times)
+                {
+                    std::stable_sort(t.blocks.begin(), t.blocks.end(),
+                        [](const timed_block& a, const timed_block& b) { return a.first < b.first; });
+
+                    t.reach.reserve(t.blocks.size());
+                    for (const auto& block : t.blocks)
+                        t.reach.push_back(t.reach.empty()
+                            ? block.last
+                            : std::max(t.reach.back(), block.last));
+                }
+            }
+
+            /**
+             * The time index of a single group.
+             */
+            struct time_table
+            {
+                std::vector<timed_block> blocks;    /**< Sorted by first tick. */
+                std::vector<std::int64_t> reach;    /**< The running maximum of the last ticks. */
+            };
+
+            mapped_file file;
+            std::optional<std::uint64_t> root;
+
+            // The block table is built by load() on first use. The flag is held by pointer so
+            // that the reader remains movable.
+            mutable std::unique_ptr<std::once_flag> loaded = std::make_unique<std::once_flag>();
+            mutable std::map<std::uint32_t, std::vector<std::uint64_t>> table;
+            mutable std::map<std::uint32_t, time_table> times;
+            mutable std::uint64_t end = 0;
+            mutable bool used_index = false;
+
+            mutable std::optional<xml::element> parsed_metadata;
+    };
+}
@@ -0,0 +1,349 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/endian/conversion.hpp>
+
+#include <advanced_recorder_module/sie/basic_block_writer.h>
+#include <advanced_recorder_module/sie/fallback_vector_io_file.h>
+#include <advanced_recorder_module/sie/format.h>
+#include <advanced_recorder_module/sie/mapped_file.h>
+#include <advanced_recorder_module/sie/reader.h>
+
+namespace hbk::sie
+{
+    /**
+     * Describes the state of an SIE file, as determined by check() or repair().
+     */
+    struct repair_report
+    {
+        std::uint64_t file_size = 0;        /**< The size of the file before any repair. */
+        std::uint64_t valid_size = 0;       /**< The offset just past the last valid block. The
+                                                 file is truncated to this size by repair(). */
+        std::uint64_t blocks = 0;           /**< The number of valid blocks, not counting any
+                                                 index block added by repair(). */
+        std::uint64_t unindexed_blocks = 0; /**< The number of valid blocks which are not
+                                                 listed in any index block. repair() adds an
+                                                 index block listing them. */
+        bool finished = false;              /**< True if the valid blocks end with an index
+                                                 directory, such as the trailer written by
+                                                 basic_indexed_writer::finish(). */
+        bool repaired = false;              /**< True if repair() modified the file. */
+
+        /**
+         * Determines whether the file was complete, i.e. it consists entirely of valid blocks
+         * and ends with an index directory leading to index blocks covering all of them.
+         *
+         * @return True if the file needs no repair.
+         */
+        bool intact() const noexcept
+        {
+            return valid_size == file_size && unindexed_blocks == 0 && finished;
+        }
+    };
+
+    namespace detail
+    {
+        /**
+         * The index entries which repair() writes to complete a file.
+         */
+        struct repair_plan
+        {
+            std::vector<index_entry> unindexed;     /**< The valid blocks after the last valid
+                                                         index block, in file order. */
+            std::vector<index_entry> directory;     /**< The last valid index directory, if
+                                                         any, and the valid index blocks after
+                                                         it, in file order. */
+        };
+
+        /**
+         * A run of consecutive blocks found by the forward scan, whose checksums are verified
+         * together by one worker thread.
+         */
+        struct scanned_chunk
+        {
+            std::uint64_t begin;            /**< The offset of the first block. */
+            std::uint64_t end;              /**< The offset just past the last block. */
+            std::uint64_t valid_blocks = 0; /**< The number of blocks, from the first, whose
+                                                 checksums are correct. */
+        };
+
+        /**
+         * Determines the valid prefix of an SIE file. The calling thread follows the size fields
+         * of the block headers forwards from the start of the file, checking each header against
+         * its footer, and hands runs of blocks to @p threads worker threads which verify their
+         * checksums. The scan and the verification overlap, and since the scan only touches the
+         * header and footer of each block, the file is read about as fast as the storage device
+         * delivers it.
+         *
+         * @param file The file contents.
+         * @param threads The number of worker threads which verify checksums. Zero selects one
+         *     per hardware thread.
+         * @param plan Receives the index entries needed to complete the file.
+         *
+         * @return The report, with repaired set to false.
+         */
+        inline repair_report scan_for_repair(
+            const mapped_file& file,
+            unsigned threads,
+            repair_plan& plan)
+        {
+            // Blocks are verified in runs of about this many bytes, which keeps the coordination
+            // overhead negligible without leaving workers idle at the end of the file.
+            constexpr std::uint64_t CHUNK_SIZE = 8 * 1024 * 1024;
+
+            if (threads == 0)
+                threads = std::max(1u, std::thread::hardware_concurrency());
+
+            std::deque<scanned_chunk> chunks;
+            std::size_t next = 0;
+            bool scanned = false;
+            std::mutex mutex;
+            std::condition_variable cv;
+
+            // The offset of the first block with an incorrect checksum.
+            std::atomic<std::uint64_t> corrupt { std::numeric_limits<std::uint64_t>::max() };
+
+            auto verify = [&]()
+            {
+                for (;;)
+                {
+                    scanned_chunk *chunk;
+
+                    {
+                        std::unique_lock<std::mutex> lock(mutex);
+                        cv.wait(lock, [&] { return next < chunks.size() || scanned; });
+                        if (next == chunks.size())
+                            return;
+                        chunk = &chunks[next++];
+                    }
+
+                    // Nothing after a corrupt block is kept, so there is no point verifying it.
+                    if (chunk->begin >= corrupt.load())
+                        continue;
+
+                    for (auto position = chunk->begin; position < chunk->end; )
+                    {
+                        auto block = reader::probe(file.data(), file.size(), position);
+                        if (!block->verify())
+                        {
+                            auto current = corrupt.load();
+                            while (position < current && !corrupt.compare_exchange_weak(current, position))
+                                ;
+                            break;
+                        }
+
+                        ++chunk->valid_blocks;
+                        position += block->size;
+                    }
+                }
+            };
+
+            std::vector<std::thread> workers;
+            for (unsigned i = 0; i < threads; ++i)
+                workers.emplace_back(verify);
+
+            // The offsets of the index blocks and directories found by the scan, in file order.
+            std::vector<std::uint64_t> index_blocks;
+            std::uint64_t position = 0;
+
+            for (;;)
+            {
+                scanned_chunk chunk { position, position };
+
+                while (chunk.end - chunk.begin < CHUNK_SIZE)
+                {
+                    auto block = reader::probe(file.data(), file.size(), chunk.end);
+                    if (!block)
+                        break;
+
+                    if (block->group == groups::INDEX)
+                        index_blocks.push_back(chunk.end);
+                    chunk.end += block->size;
+                }
+
+                if (chunk.end == chunk.begin || chunk.begin >= corrupt.load())
+                    break;
+
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    chunks.push_back(chunk);
+                }
+
+                cv.notify_one();
+                position = chunk.end;
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                scanned = true;
+            }
+
+            cv.notify_all();
+            for (auto& worker : workers)
+                worker.join();
+
+            repair_report report;
+            report.file_size = file.size();
+            report.valid_size = std::min(position, corrupt.load());
+
+            for (const auto& chunk : chunks)
+            {
+                if (chunk.begin >= report.valid_size)
+                    break;
+                report.blocks += chunk.valid_blocks;
+            }
+
+            // The blocks after the last intact index block are the ones it does not list. (The
+            // index blocks before it list everything else, because each one lists all blocks
+            // written since the previous one.) Likewise, the index blocks after the last intact
+            // directory are the ones no directory leads to.
+            std::uint64_t unindexed_begin = 0;
+            plan.directory.clear();
+
+            for (auto offset : index_blocks)
+            {
+                auto block = reader::probe(file.data(), file.size(), offset);
+                if (offset + block->size > report.valid_size)
+                    break;
+
+                unindexed_begin = offset + block->size;
+                report.finished = reader::is_index_directory(*block);
+
+                if (report.finished)
+                    plan.directory.clear();
+                plan.directory.emplace_back(
+                    boost::endian::native_to_big<std::uint64_t>(offset),
+                    boost::endian::native_to_big<std::uint32_t>(groups::INDEX));
+            }
+
+            report.finished = report.finished && unindexed_begin == report.valid_size;
+
+            plan.unindexed.clear();
+            for (auto offset = unindexed_begin; offset < report.valid_size; )
+            {
+                auto block = reader::probe(file.data(), file.size(), offset);
+                plan.unindexed.emplace_back(
+                    boost::endian::native_to_big<std::uint64_t>(offset),
+                    boost::endian::native_to_big<std::uint32_t>(block->group));
+                offset += block->size;
+            }
+
+            report.unindexed_blocks = plan.unindexed.size();
+            return report;
+        }
+    }
+
+    /**
+     * Checks whether an SIE file is complete, without modifying it. See repair() for details.
+     *
+     * @param filename The path and filename of the file to check. Relative paths are
+     *     interpreted relative to the current working directory.
+     * @param threads The number of threads which verify checksums. Zero (the default) selects
+     *     one per hardware thread.
+     *
+     * @return A description of the file.
+     *
+     * @throws std::system_error The file could not be opened or mapped.
+     */
+    inline repair_report check(const std::string& filename, unsigned threads = 0)
+    {
+        detail::repair_plan plan;
+        return detail::scan_for_repair(mapped_file(filename), threads, plan);
+    }
+
+    /**
+     * Repairs an SIE file whose recording was interrupted, e.g. because the recording process
+     * crashed or lost power. Such a file may end with a partially written block, with space that
+     * was preallocated but never written, and without the closing index block, so that the last
+     * blocks can only be found by scanning.
+     *
+     * The file is scanned forwards from the start, following the size field of each block header
+     * and checking it against the block's sync word and footer, and the checksum of every block
+     * is verified using multiple threads. The file is then truncated after the last block which
+     * precedes the first invalid one, and an index block listing all valid blocks not yet listed
+     * in an index block is appended, followed by an index directory and a trailer as written by
+     * basic_indexed_writer::finish(), so that reader finds every block from the index alone. The
+     * repaired file is synced before returning.
+     *
+     * Blocks appended to the index are not added to the time index (see groups::TIME_INDEX),
+     * since their time ranges are only known by decoding them.
+     *
+     * If the file is already complete (see repair_report::intact()), it is not modified.
+     *
+     * @param filename The path and filename of the file to repair. Relative paths are
+     *     interpreted relative to the current working directory.
+     * @param threads The number of threads which verify checksums. Zero (the default) selects
+     *     one per hardware thread.
+     *
+     * @return A description of the file as it was found.
+     *
+     * @throws std::system_error The file could not be opened, mapped, truncated or synced.
+     * @throws std::filesystem::filesystem_error The file could not be truncated.
+     * @throws std::runtime_error The index block could not be written.
+     */
+    inline repair_report repair(const std::string& filename, unsigned threads = 0)
+    {
+        detail::repair_plan plan;
+
+        // The file must be unmapped before it is truncated.
+        auto report = detail::scan_for_repair(mapped_file(filename), threads, plan);
+
+        if (report.intact())
+            return report;
+
+        if (report.valid_size < report.file_size)
+            std::filesystem::resize_file(filename, report.valid_size);
+
+        basic_block_writer<fallback_vector_io_file> writer(fallback_vector_io_file(filename, true));
+        std::uint64_t position = report.valid_size;
+
+        auto append = [&](std::vector<index_entry>& entries)
+        {
+            entries.emplace_back(
+                boost::endian::native_to_big<std::uint64_t>(position),
+                boost::endian::native_to_big<std::uint32_t>(groups::INDEX));
+        };
+
+        if (!plan.unindexed.empty())
+        {
+            append(plan.directory);
+            position += writer.write_block(
+                groups::INDEX,
+                plan.unindexed.data(),
+                plan.unindexed.size() * sizeof(index_entry));
+        }
+
+        // A file which has no index blocks at all is left without a directory, too.
+        if (!report.finished && !plan.directory.empty())
+        {
+            std::vector<index_entry> trailer;
+            append(trailer);
+            writer.write_block(
+                groups::INDEX,
+                plan.directory.data(),
+                plan.directory.size() * sizeof(index_entry));
+
+            writer.write_block(
+                groups::INDEX,
+                trailer.data(),
+                trailer.size() * sizeof(index_entry));
+        }
+
+        writer.sync();
+
+        report.repaired = true;
+        return report;
+    }
+}
@@ -0,0 +1,232 @@
+#pragma once
+
+#include <cerrno>
+#include <cstddef>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <variant>
+
+#include <advanced_recorder_module/sie/buffer_handle.h>
+#include <advanced_recorder_module/sie/sync_handle.h>
+
+#if defined (__unix__) || (defined (__APPLE__) && defined (__MACH__))
+#define HBK_SIE_HAVE_POSIX_IO 1
+#include <advanced_recorder_module/sie/posix_vector_io_file.h>
+#else
+#include <advanced_recorder_module/sie/fallback_vector_io_file.h>
+#endif
+
+#include <advanced_recorder_module/sie/io_uring_vector_io_file.h>
+#include <advanced_recorder_module/sie/mmap_vector_io_file.h>
+
+namespace hbk::sie
+{
+    /**
+     * Identifies a VectorIoFile implementation which can be selected at runtime.
+     */
+    enum class io_backend
+    {
+        automatic,  /**< Use the platform default: the same as posix. */
+        posix,      /**< Use posix_vector_io_file (or fallback_vector_io_file if unavailable). */
+        io_uring,   /**< Use io_uring_vector_io_file (or posix_vector_io_file if unavailable). */
+        mmap,       /**< Use mmap_vector_io_file (or posix_vector_io_file if unavailable). */
+    };
+
+    /**
+     * Implements vectored (scatter/gather) file output by delegating to one of the VectorIoFile
+     * implementations compiled for the current platform, selected at runtime when the file is
+     * opened. Unless another implementation is requested explicitly, posix_vector_io_file is
+     * used. If the requested implementation is not available, either because it was not
+     * compiled or because the running system does not support it (for example, io_uring is
+     * disabled by the kernel, or the file cannot be memory-mapped), posix_vector_io_file is used
+     * instead. Other errors, such as a file which cannot be created, are thrown. The backend()
+     * function can be used to find out which implementation was actually chosen, for example to
+     * log the fallback.
+     */
+    class selectable_vector_io_file
+    {
+        public:
+
+            /**
+             * Opens a file.
+             *
+             * @param filename The path and filename of the file to open. Relative paths are
+             *     interpreted relative to the current working directory.
+             * @param requested The preferred implementation.
+             *
+             * @throws std::system_error The file could not be opened.
+             */
+            selectable_vector_io_file(
+                    const std::string& filename,
+                    io_backend requested = io_backend::automatic)
+                : file(open(filename, requested))
+            {
+            }
+
+            selectable_vector_io_file(const selectable_vector_io_file&) = delete;
+            selectable_vector_io_file& operator=(const selectable_vector_io_file&) = delete;
+
+            /**
+             * Moves a file. After the call, @p rhs is in an invalid state and its members should
+             * not be accessed.
+             *
+             * @param rhs The object to move from.
+             */
+            selectable_vector_io_file(selectable_vector_io_file&& rhs) noexcept = default;
+
+            /**
+             * Performs a vectored write to the file by calling the selected implementation's
+             * write() function.
+             *
+             * @param data A pointer to the first segment of data to write to the file.
+             * @param size The number of bytes pointed to by @p data.
+             * @param args Zero or more additional (@p data, @p size) argument pairs specifying
+             *     additional segments to write to the file.
+             *
+             * @throws ... This function propagates any exception thrown by the selected
+             *     implementation.
+             */
+            template <typename ... Args>
+            void write(const void *data, std::size_t size, Args... args)
+            {
+                std::visit([&](auto& f) { f.write(data, size, args...); }, file);
+            }
+
+            /**
+             * Performs a vectored write of data owned by @p owner by calling the selected
+             * implementation's write_retained() function.
+             *
+             * @param owner A handle which keeps the data segments valid. It is released once the
+             *     selected implementation no longer needs the data.
+             * @param args One or more (data, size) argument pairs specifying the segments to
+             *     write to the file.
+             *
+             * @throws ... This function propagates any exception thrown by the selected
+             *     implementation.
+             */
+            template <typename ... Args>
+            void write_retained(buffer_handle owner, Args... args)
+            {
+                std::visit([&](auto& f) { f.write_retained(std::move(owner), args...); }, file);
+            }
+
+            /**
+             * Submits any writes buffered by the selected implementation to the operating system.
+             *
+             * @throws ... This function propagates any exception thrown by the selected
+             *     implementation.
+             */
+            void flush()
+            {
+                std::visit([](auto& f) { f.flush(); }, file);
+            }
+
+            /**
+             * Prepares to make the data written so far durable by calling the selected
+             * implementation's prepare_sync() function.
+             *
+             * @return A handle whose sync() function makes the data written so far durable.
+             *
+             * @throws ... This function propagates any exception thrown by the selected
+             *     implementation.
+             */
+            sync_handle prepare_sync()
+            {
+                return std::visit([](auto& f) { return f.prepare_sync(); }, file);
+            }
+
+            /**
+             * Makes the data written so far durable by calling the selected implementation's
+             * sync() function.
+             *
+             * @throws ... This function propagates any exception thrown by the selected
+             *     implementation.
+             */
+            void sync()
+            {
+                std::visit([](auto& f) { f.sync(); }, file);
+            }
+
+            /**
+             * Gets the implementation that was actually selected when the file was opened.
+             *
+             * @return The selected backend. This is never io_backend::automatic.
+             */
+            io_backend backend() const noexcept
+            {
+#ifdef HBK_SIE_HAVE_IO_URING
+                if (std::holds_alternative<io_uring_vector_io_file>(file))
+                    return io_backend::io_uring;
+#endif
+#ifdef HBK_SIE_HAVE_MMAP
+                if (std::holds_alternative<mmap_vector_io_file>(file))
+                    return io_backend::mmap;
+#endif
+                return io_backend::posix;
+            }
+
+        private:
+
+            typedef std::variant<
+#ifdef HBK_SIE_HAVE_POSIX_IO
+                posix_vector_io_file
+#else
+                fallback_vector_io_file
+#endif
+#ifdef HBK_SIE_HAVE_IO_URING
+                , io_uring_vector_io_file
+#endif
+#ifdef HBK_SIE_HAVE_MMAP
+                , mmap_vector_io_file
+#endif
+            > variant_type;
+
+            static variant_type open(const std::string& filename, io_backend requested)
+            {
+#ifdef HBK_SIE_HAVE_MMAP
+                if (requested == io_backend::mmap)
+                {
+                    try
+                    {
+                        return variant_type(std::in_place_type<mmap_vector_io_file>, filename);
+                    }
+
+                    // Mapping can fail on some filesystems (e.g. certain network or FUSE
+                    // mounts); fall back silently.
+                    catch (const std::system_error&)
+                    {
+                    }
+                }
+#endif
+
+#ifdef HBK_SIE_HAVE_IO_URING
+                if (requested == io_backend::io_uring)
+                {
+                    try
+                    {
+                        return variant_type(std::in_place_type<io_uring_vector_io_file>, filename);
+                    }
+
+                    // io_uring may be compiled in but unavailable at runtime: ENOSYS on old
+                    // kernels, EPERM under a seccomp policy or the io_uring_disabled sysctl,
+                    // EINVAL if the kernel rejects the parameters. Anything else is a real error.
+                    catch (const std::system_error& ex)
+                    {
+                        int err = ex.code().value();
+                        if (err != ENOSYS && err != EPERM && err != EINVAL)
+                            throw;
+                    }
+                }
+#endif
+
+#ifdef HBK_SIE_HAVE_POSIX_IO
+                return variant_type(std::in_place_type<posix_vector_io_file>, filename);
+#else
+                return variant_type(std::in_place_type<fallback_vector_io_file>, filename);
+#endif
+            }
+
+            variant_type file;
+    };
+}
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <cerrno>
+#include <memory>
+#include <system_error>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace hbk::sie
+{
+    /**
+     * A handle which makes the data written to a file durable, i.e. flushes it from the operating
+     * system's cache to the storage device. The handle refers to a duplicate of the file's
+     * descriptor, so sync() can be called from any thread, concurrently with further writes to
+     * the file, and even after the file has been closed.
+     *
+     * Handles are obtained from the prepare_sync() function of the VectorIoFile implementations,
+     * which first hands any data buffered by the file itself to the operating system. Copies of a
+     * handle share the same descriptor, which is closed when the last copy is destroyed. A
+     * default-constructed handle refers to no file, and sync() does nothing.
+     */
+    class sync_handle
+    {
+        public:
+
+            sync_handle() noexcept = default;
+
+            /**
+             * Creates a handle referring to a duplicate of a file descriptor.
+             *
+             * @param fd The file descriptor to duplicate. It is not affected by the handle.
+             *
+             * @throws std::system_error The descriptor could not be duplicated.
+             */
+            explicit sync_handle(int fd)
+                : d(std::make_shared<descriptor>(duplicate(fd)))
+            {
+            }
+
+            /**
+             * Makes durable all data whose write to the file completed before the call. On Linux
+             * this uses fdatasync(), which skips metadata not needed to read the data back. On
+             * macOS, F_FULLFSYNC is used where supported, since fsync() there does not flush the
+             * drive's cache.
+             *
+             * @throws std::system_error The operating system reported an error.
+             */
+            void sync() const
+            {
+                if (!d)
+                    return;
+
+#if defined (_WIN32)
+                int result = ::_commit(d->fd);
+#elif defined (__APPLE__)
+                int result = ::fcntl(d->fd, F_FULLFSYNC);
+                if (result == -1)
+                    result = ::fsync(d->fd);
+#elif defined (__linux__)
+                int result = ::fdatasync(d->fd);
+#else
+                int result = ::fsync(d->fd);
+#endif
+
+                if (result == -1)
+                    throw std::system_error(
+                        errno,
+                        std::generic_category(),
+                        "failed to sync file");
+            }
+
+            /**
+             * Determines whether two handles refer to the same file (i.e. are copies of each
+             * other).
+             */
+            bool operator==(const sync_handle& rhs) const noexcept
+            {
+                return d == rhs.d;
+            }
+
+            bool operator!=(const sync_handle& rhs) const noexcept
+            {
+                return d != rhs.d;
+            }
+
+            /**
+             * Determines whether this handle refers to a file.
+             */
+            explicit operator bool() const noexcept
+            {
+                return static_cast<bool>(d);
+            }
+
+        private:
+
+            struct descriptor
+            {
+                int fd;
+
+                explicit descriptor(int fd) noexcept
+                    : fd(fd)
+                {
+                }
+
+                descriptor(const descriptor&) = delete;
+                descriptor& operator=(const descriptor&) = delete;
+
+                ~descriptor() noexcept
+                {
+#ifdef _WIN32
+                    ::_close(fd);
+#else
+                    ::close(fd);
+#endif
+                }
+            };
+
+            static int duplicate(int fd)
+            {
+#if defined (_WIN32)
+                int result = ::_dup(fd);
+#else
+                int result = ::fcntl(fd, F_DUPFD_CLOEXEC, 0);
+#endif
+
+                if (result == -1)
+                    throw std::system_error(
+                        errno,
+                        std::generic_category(),
+                        "failed to duplicate file descriptor");
+
+                return result;
+            }
+
+            std::shared_ptr<descriptor> d;
+    };
+}
@@ -1,29 +1,15 @@
 #pragma once
 
-#if defined (__unix__) || (defined (__APPLE__) && defined (__MACH__))
-
-#include <advanced_recorder_module/sie/posix_vector_io_file.h>
-
-namespace hbk::sie
-{
-    /**
-     * A typedef which refers to the best available VectorIoFile implementation detected for the
-     * current platform (e.g., posix_vector_io_file or fallback_vector_io_file).
-     */
-    typedef posix_vector_io_file vector_io_file;
-}
-
-#else
-
-#include <advanced_recorder_module/sie/fallback_vector_io_file.h>
+#include <advanced_recorder_module/sie/selectable_vector_io_file.h>
 
 namespace hbk::sie
 {
     /**
-     * A typedef which refers to the best available VectorIoFile implementation detected for the
-     * current platform (e.g., posix_vector_io_file or fallback_vector_io_file).
+     * A typedef which refers to the VectorIoFile implementation used by the recorder. This is
+     * selectable_vector_io_file, which chooses an implementation when the file is opened: by
+     * default (io_backend::automatic) posix_vector_io_file, or fallback_vector_io_file on
+     * platforms without POSIX I/O. io_uring_vector_io_file and mmap_vector_io_file are used only
+     * when requested explicitly and supported by the running system.
      */
-    typedef fallback_vector_io_file vector_io_file;
+    typedef selectable_vector_io_file vector_io_file;
 }
-
-#endif
@@ -1,167 +1,650 @@
 #pragma once
 
+#include <algorithm>
 #include <cstddef>
 #include <cstdint>
-#include <list>
-#include <optional>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <new>
 #include <ostream>
 #include <string>
+#include <string_view>
+#include <type_traits>
 #include <utility>
+#include <vector>
 
 namespace hbk::sie::xml
 {
+    class element;
+    class node;
+    class parser;
+
+    /**
+     * A monotonic memory arena. Memory is handed out from large chunks by bumping a pointer and
+     * is only released, all at once, when the arena is destroyed. Objects allocated from an
+     * arena are never destroyed, so they must be trivially destructible.
+     *
+     * Moving an arena, or adopting the chunks of another arena with adopt(), does not move the
+     * allocated memory, so pointers into it remain valid.
+     */
+    class arena
+    {
+        public:
+
+            arena() noexcept = default;
+
+            arena(const arena&) = delete;
+            arena& operator=(const arena&) = delete;
+
+            /**
+             * Moves an arena. After the call, @p rhs is empty.
+             *
+             * @param rhs The arena to move from.
+             */
+            arena(arena&& rhs) noexcept
+                : first(std::exchange(rhs.first, nullptr))
+                , last(std::exchange(rhs.last, nullptr))
+                , cursor(std::exchange(rhs.cursor, nullptr))
+                , remaining(std::exchange(rhs.remaining, 0))
+                , next_chunk_size(std::exchange(rhs.next_chunk_size, INITIAL_CHUNK_SIZE))
+            {
+            }
+
+            /**
+             * Moves an arena. The memory previously allocated from this arena is released, and
+             * after the call, @p rhs is empty.
+             *
+             * @param rhs The arena to move from.
+             */
+            arena& operator=(arena&& rhs) noexcept
+            {
+                if (this != &rhs)
+                {
+                    release();
+                    first = std::exchange(rhs.first, nullptr);
+                    last = std::exchange(rhs.last, nullptr);
+                    cursor = std::exchange(rhs.cursor, nullptr);
+                    remaining = std::exchange(rhs.remaining, 0);
+                    next_chunk_size = std::exchange(rhs.next_chunk_size, INITIAL_CHUNK_SIZE);
+                }
+
+                return *this;
+            }
+
+            ~arena()
+            {
+                release();
+            }
+
+            /**
+             * Allocates uninitialized memory.
+             *
+             * @param size The number of bytes to allocate.
+             * @param alignment The required alignment, which must be a power of two and no
+             *     greater than alignof(std::max_align_t).
+             *
+             * @return A pointer to the allocated memory.
+             *
+             * @throws std::bad_alloc Memory could not be allocated.
+             */
+            void *allocate(std::size_t size, std::size_t alignment)
+            {
+                std::size_t padding = (0 - reinterpret_cast<std::uintptr_t>(cursor)) & (alignment - 1);
+
+                if (!cursor || padding + size > remaining)
+                {
+                    std::size_t chunk_size = std::max(next_chunk_size, sizeof(chunk) + size);
+                    auto c = new (::operator new(chunk_size)) chunk;
+
+                    c->next = first;
+                    first = c;
+                    if (!last)
+                        last = c;
+
+                    cursor = reinterpret_cast<char *>(c) + sizeof(chunk);
+                    remaining = chunk_size - sizeof(chunk);
+                    next_chunk_size = std::min(next_chunk_size * 2, MAX_CHUNK_SIZE);
+                    padding = 0;
+                }
+
+                char *result = cursor + padding;
+                cursor = result + size;
+                remaining -= padding + size;
+                return result;
+            }
+
+            /**
+             * Constructs an object in memory allocated from this arena.
+             *
+             * @tparam T The type of object to construct. It must be trivially destructible.
+             * @param args The arguments to pass to the constructor.
+             *
+             * @return A pointer to the constructed object.
+             */
+            template <typename T, typename ... Args>
+            T *make(Args&&... args)
+            {
+                static_assert(std::is_trivially_destructible_v<T>,
+                    "objects allocated from an arena are never destroyed");
+                return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+            }
+
+            /**
+             * Copies a string into this arena.
+             *
+             * @param str The string to copy.
+             *
+             * @return A view of the copy, which remains valid as long as the arena does.
+             */
+            std::string_view store(std::string_view str)
+            {
+                if (str.empty())
+                    return std::string_view();
+
+                auto copy = static_cast<char *>(allocate(str.size(), 1));
+                std::memcpy(copy, str.data(), str.size());
+                return std::string_view(copy, str.size());
+            }
+
+            /**
+             * Takes over all memory allocated from another arena, so that it is released when
+             * this arena is destroyed. This takes constant time. After the call, @p other is
+             * empty.
+             *
+             * @param other The arena whose memory to take over.
+             */
+            void adopt(arena& other) noexcept
+            {
+                if (!other.first)
+                    return;
+
+                // Append the other arena's chunks behind ours; allocation continues in our
+                // current chunk, which is always the first.
+                if (last)
+                    last->next = other.first;
+                else
+                    first = other.first;
+                last = other.last;
+
+                other.first = other.last = nullptr;
+                other.cursor = nullptr;
+                other.remaining = 0;
+            }
+
+        private:
+
+            /**
+             * The header at the start of each chunk of memory.
+             */
+            struct alignas(std::max_align_t) chunk
+            {
+                chunk *next;
+            };
+
+            static constexpr std::size_t INITIAL_CHUNK_SIZE = 256;
+            static constexpr std::size_t MAX_CHUNK_SIZE = 65536;
+
+            void release() noexcept
+            {
+                while (first)
+                {
+                    chunk *next = first->next;
+                    ::operator delete(first);
+                    first = next;
+                }
+
+                last = nullptr;
+            }
+
+            chunk *first = nullptr;
+            chunk *last = nullptr;
+            char *cursor = nullptr;
+            std::size_t remaining = 0;
+            std::size_t next_chunk_size = INITIAL_CHUNK_SIZE;
+    };
+
+    /**
+     * A forward range over a singly-linked list of arena-allocated objects of type @p T.
+     *
+     * @tparam T The type of the list items, which must have a `next_` member pointing to the
+     *     next item.
+     */
+    template <typename T>
+    class list_range
+    {
+        public:
+
+            class iterator
+            {
+                public:
+
+                    using iterator_category = std::forward_iterator_tag;
+                    using value_type = T;
+                    using difference_type = std::ptrdiff_t;
+                    using pointer = const T *;
+                    using reference = const T&;
+
+                    explicit iterator(const T *item = nullptr) noexcept
+                        : item(item)
+                    {
+                    }
+
+                    reference operator*() const noexcept { return *item; }
+                    pointer operator->() const noexcept { return item; }
+
+                    iterator& operator++() noexcept
+                    {
+                        item = item->next_;
+                        return *this;
+                    }
+
+                    iterator operator++(int) noexcept
+                    {
+                        iterator old = *this;
+                        item = item->next_;
+                        return old;
+                    }
+
+                    bool operator==(const iterator& rhs) const noexcept { return item == rhs.item; }
+                    bool operator!=(const iterator& rhs) const noexcept { return item != rhs.item; }
+
+                private:
+
+                    const T *item;
+            };
+
+            list_range(const T *first, std::size_t count) noexcept
+                : first(first)
+                , count(count)
+            {
+            }
+
+            iterator begin() const noexcept { return iterator(first); }
+            iterator end() const noexcept { return iterator(); }
+            bool empty() const noexcept { return !first; }
+            std::size_t size() const noexcept { return count; }
+
+            /**
+             * Gets the first item. The range must not be empty.
+             */
+            const T& front() const noexcept { return *first; }
+
+        private:
+
+            const T *first;
+            std::size_t count;
+    };
+
+    /**
+     * Represents an XML attribute. The strings are stored in the arena of the element the
+     * attribute belongs to.
+     */
+    class attribute
+    {
+        public:
+
+            std::string_view id;    /**< The identifier (name) of the attribute. */
+            std::string_view value; /**< The value of the attribute. */
+
+            attribute(std::string_view id, std::string_view value) noexcept
+                : id(id)
+                , value(value)
+            {
+            }
+
+        private:
+
+            friend class element;
+            friend class list_range<attribute>::iterator;
+
+            const attribute *next_ = nullptr;
+    };
+
     /**
-     * Represents an XML attribute.
+     * A node in an XML element tree. Nodes, and their names, attributes and content, are stored
+     * in the arena of the element which owns the tree; they can be inspected through this class
+     * but are created and modified only through that element.
      */
-    struct attribute
+    class node
     {
-        std::string id;     /**< The identifier (name) of the attribute. */
-        std::string value;  /**< The value of the attribute. */
-
-        /**
-         * Initializes an attribute with the specified identifier (name) and value.
-         *
-         * @param id The identifier (name) of the attribute.
-         * @param value The value of the attribute.
-         */
-        attribute(const std::string& id, const std::string& value)
-            : id(id)
-            , value(value)
-        {
-        }
+        public:
+
+            explicit node(std::string_view name) noexcept
+                : name_(name)
+            {
+            }
+
+            /**
+             * Gets the name (tag) of this element.
+             *
+             * @return The name (tag) of this element.
+             */
+            std::string_view name() const noexcept
+            {
+                return name_;
+            }
+
+            /**
+             * Gets this element's attributes, in the order they were added.
+             *
+             * @return A range of this element's attributes, which is empty if there are none.
+             */
+            list_range<attribute> attributes() const noexcept
+            {
+                return list_range<attribute>(first_attribute, attribute_count);
+            }
+
+            /**
+             * Gets this element's children, in the order they were added.
+             *
+             * @return A range of this element's children, which is empty if there are none.
+             */
+            list_range<node> children() const noexcept
+            {
+                return list_range<node>(first_child, child_count);
+            }
+
+            /**
+             * Gets the text content of this element.
+             *
+             * @return The text content of this element.
+             */
+            std::string_view content() const noexcept
+            {
+                return content_;
+            }
+
+            /**
+             * Recursively serializes this XML element, and its attributes and children, by
+             * appending the text to a string. Reusing the same string for several calls avoids
+             * repeated memory allocation.
+             *
+             * @param out The string to append to.
+             * @param indent The initial indentation level. Nested elements are automatically
+             *     indented by one space per level.
+             *
+             * @return @p out.
+             */
+            std::string& serialize(
+                std::string& out,
+                unsigned indent = 0
+            ) const;
+
+            /**
+             * Recursively serializes this XML element, and its attributes and children, to the
+             * specified output stream.
+             *
+             * @param os The output stream to write to.
+             * @param indent The initial indentation level. Nested elements are automatically indented
+             *     by one space per level.
+             *
+             * @return @p os.
+             */
+            std::ostream& serialize(
+                std::ostream& os,
+                unsigned indent = 0
+            ) const;
+
+        private:
+
+            friend class element;
+            friend class list_range<node>::iterator;
+
+            std::string_view name_;
+            std::string_view content_;
+
+            const attribute *first_attribute = nullptr;
+            attribute *last_attribute = nullptr;
+            std::size_t attribute_count = 0;
+
+            const node *first_child = nullptr;
+            node *last_child = nullptr;
+            std::size_t child_count = 0;
+
+            const node *next_ = nullptr;
     };
 
     /**
-     * Represents an XML element. This structure exposes a "fluent API" which can be used to
+     * Represents an XML element tree. This class exposes a "fluent API" which can be used to
      * construct trees of XML by chaining member function calls. XML elements can be serialized to
-     * an output stream by calling serialize().
+     * a string or an output stream by calling serialize().
+     *
+     * All nodes and strings of the tree are stored in an arena owned by the element, so building
+     * a tree takes only a few memory allocations. Adding an element as a child of another moves
+     * its arena into the parent's without copying anything.
      */
-    struct element
+    class element
     {
-        std::string name_;                  /**< The name (tag) of the element. */
-        std::list<attribute> attributes_;   /**< The attributes assigned to the element. */
-        std::list<element> children_;       /**< The children of the element (nested elements). */
-        std::string content_;               /**< The text content of the element. */
-
-        /**
-         * Initializes a new empty element.
-         *
-         * @param name The name (tag) of the element.
-         */
-        element(const std::string& name)
-            : name_(name)
-        {
-        }
-
-        /**
-         * Gets the name (tag) of this element.
-         *
-         * @return The name (tag) of this element.
-         */
-        const std::string& name() const noexcept
-        {
-            return name_;
-        }
-
-        /**
-         * Gets a list of this element's attributes.
-         *
-         * @return A reference to a list of this element's attributes. If there are no attributes,
-         *     the list is empty.
-         */
-        const std::list<attribute>& attributes() const noexcept
-        {
-            return attributes_;
-        }
-
-        /**
-         * Adds an attribute to this element.
-         *
-         * @param id The identifier (name) of the attribute to add.
-         * @param value The value of the attribute to add.
-         *
-         * @return An rvalue reference to this object, enabling "fluent" style chaining.
-         */
-        element&& add_attribute(const std::string& id, const std::string& value)
-        {
-            attributes_.emplace_back(id, value);
-            return std::move(*this);
-        }
-
-        /**
-         * Gets a list of this element's children.
-         *
-         * @return A reference to a list of this element's children. If there are no children, the
-         *     list is empty.
-         */
-        const std::list<element>& children() const noexcept
-        {
-            return children_;
-        }
-
-        /**
-         * Adds a child element to this element.
-         *
-         * @param name The name (tag) of the child element to add.
-         *
-         * @return An rvalue reference to this object, enabling "fluent" style chaining.
-         */
-        element&& add_child(const std::string& name)
-        {
-            children_.emplace_back(name);
-            return std::move(*this);
-        }
-
-        /**
-         * Adds a child element to this element.
-         *
-         * @param element The child element to add.
-         *
-         * @return An rvalue reference to this object, enabling "fluent" style chaining.
-         */
-        element&& add_child(element&& element)
-        {
-            children_.emplace_back(std::move(element));
-            return std::move(*this);
-        }
-
-        /**
-         * Gets the text content of this element.
-         *
-         * @return The text content of this element.
-         */
-        const std::string& content() const noexcept
-        {
-            return content_;
-        }
-
-        /**
-         * Sets the text content of this element.
-         *
-         * @param content The text content of this element.
-         *
-         * @return An rvalue reference to this object, enabling "fluent" style chaining.
-         */
-        element&& content(const std::string& content)
-        {
-            content_ = content;
-            return std::move(*this);
-        }
-
-        /**
-         * Recursively serializes this XML element, and its attributes and children, to the
-         * specified output stream.
-         *
-         * @param os The output stream to write to.
-         * @param indent The initial indentation level. Nested elements are automatically indented
-         *     by one space per level.
-         *
-         * @return @p os.
-         */
-        std::ostream& serialize(
-            std::ostream& os,
-            unsigned indent = 0
-        ) const;
+        public:
+
+            /**
+             * Initializes a new empty element.
+             *
+             * @param name The name (tag) of the element.
+             */
+            element(std::string_view name)
+                : root(arena_.make<node>(arena_.store(name)))
+            {
+            }
+
+            /**
+             * Makes a deep copy of an element tree.
+             *
+             * @param rhs The element to copy.
+             */
+            element(const element& rhs)
+                : root(copy(*rhs.root))
+            {
+            }
+
+            /**
+             * Moves an element tree. After the call, @p rhs is in an invalid state and its
+             * members should not be accessed.
+             */
+            element(element&&) noexcept = default;
+
+            element& operator=(const element& rhs)
+            {
+                if (this != &rhs)
+                {
+                    arena_ = xml::arena();
+                    root = copy(*rhs.root);
+                }
+
+                return *this;
+            }
+
+            element& operator=(element&&) noexcept = default;
+
+            /**
+             * @copydoc node::name()
+             */
+            std::string_view name() const noexcept
+            {
+                return root->name();
+            }
+
+            /**
+             * @copydoc node::attributes()
+             */
+            list_range<attribute> attributes() const noexcept
+            {
+                return root->attributes();
+            }
+
+            /**
+             * @copydoc node::children()
+             */
+            list_range<node> children() const noexcept
+            {
+                return root->children();
+            }
+
+            /**
+             * @copydoc node::content()
+             */
+            std::string_view content() const noexcept
+            {
+                return root->content();
+            }
+
+            /**
+             * Adds an attribute to this element.
+             *
+             * @param id The identifier (name) of the attribute to add.
+             * @param value The value of the attribute to add.
+             *
+             * @return An rvalue reference to this object, enabling "fluent" style chaining.
+             */
+            element&& add_attribute(std::string_view id, std::string_view value)
+            {
+                append_attribute(root, id, value);
+                return std::move(*this);
+            }
+
+            /**
+             * Adds a child element to this element.
+             *
+             * @param name The name (tag) of the child element to add.
+             *
+             * @return An rvalue reference to this object, enabling "fluent" style chaining.
+             */
+            element&& add_child(std::string_view name)
+            {
+                append_child(root, arena_.make<node>(arena_.store(name)));
+                return std::move(*this);
+            }
+
+            /**
+             * Adds a child element to this element. The child's nodes are not copied; its arena
+             * is merged into this element's.
+             *
+             * @param element The child element to add. After the call, it is in an invalid state
+             *     and its members should not be accessed.
+             *
+             * @return An rvalue reference to this object, enabling "fluent" style chaining.
+             */
+            element&& add_child(element&& element)
+            {
+                arena_.adopt(element.arena_);
+                append_child(root, element.root);
+                element.root = nullptr;
+                return std::move(*this);
+            }
+
+            /**
+             * Sets the text content of this element.
+             *
+             * @param content The text content of this element.
+             *
+             * @return An rvalue reference to this object, enabling "fluent" style chaining.
+             */
+            element&& content(std::string_view content)
+            {
+                root->content_ = arena_.store(content);
+                return std::move(*this);
+            }
+
+            /**
+             * @copydoc node::serialize(std::string&, unsigned) const
+             */
+            std::string& serialize(
+                std::string& out,
+                unsigned indent = 0
+            ) const
+            {
+                return root->serialize(out, indent);
+            }
+
+            /**
+             * @copydoc node::serialize(std::ostream&, unsigned) const
+             */
+            std::ostream& serialize(
+                std::ostream& os,
+                unsigned indent = 0
+            ) const
+            {
+                return root->serialize(os, indent);
+            }
+
+            /**
+             * Gets the root node of this element tree.
+             *
+             * @return The root node.
+             */
+            operator const node&() const noexcept
+            {
+                return *root;
+            }
+
+        private:
+
+            friend class parser;
+
+            node *make_node(std::string_view name)
+            {
+                return arena_.make<node>(arena_.store(name));
+            }
+
+            void append_attribute(node *parent, std::string_view id, std::string_view value)
+            {
+                auto attr = arena_.make<attribute>(arena_.store(id), arena_.store(value));
+
+                if (parent->last_attribute)
+                    parent->last_attribute->next_ = attr;
+                else
+                    parent->first_attribute = attr;
+
+                parent->last_attribute = attr;
+                ++parent->attribute_count;
+            }
+
+            static void append_child(node *parent, node *child) noexcept
+            {
+                if (parent->last_child)
+                    parent->last_child->next_ = child;
+                else
+                    parent->first_child = child;
+
+                parent->last_child = child;
+                ++parent->child_count;
+            }
+
+            void append_content(node *parent, std::string_view content)
+            {
+                if (content.empty())
+                    return;
+
+                if (parent->content_.empty())
+                {
+                    parent->content_ = arena_.store(content);
+                    return;
+                }
+
+                auto size = parent->content_.size() + content.size();
+                auto joined = static_cast<char *>(arena_.allocate(size, 1));
+                std::memcpy(joined, parent->content_.data(), parent->content_.size());
+                std::memcpy(joined + parent->content_.size(), content.data(), content.size());
+                parent->content_ = std::string_view(joined, size);
+            }
+
+            node *copy(const node& source)
+            {
+                node *result = make_node(source.name());
+                result->content_ = arena_.store(source.content());
+
+                for (const auto& attr : source.attributes())
+                    append_attribute(result, attr.id, attr.value);
+
+                for (const auto& child : source.children())
+                    append_child(result, copy(child));
+
+                return result;
+            }
+
+            xml::arena arena_;
+            node *root;
     };
 }
 
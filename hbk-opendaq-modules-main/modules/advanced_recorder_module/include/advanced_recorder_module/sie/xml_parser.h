@@ -0,0 +1,341 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <advanced_recorder_module/sie/xml.h>
+
+namespace hbk::sie::xml
+{
+    /**
+     * Implements a small, non-validating XML parser sufficient for SIE metadata. The parser
+     * supports elements, attributes, text content, comments, processing instructions, CDATA
+     * sections, and the predefined and numeric character entities. It does not support DTDs
+     * (which are skipped) or namespaces (prefixes are kept as part of the names).
+     *
+     * SIE metadata is written incrementally, so an SIE file's metadata is a stream whose root
+     * element is never closed until the end of the file (and may never be closed at all if the
+     * file was truncated). Therefore any elements which remain open at the end of the input are
+     * implicitly closed.
+     */
+    class parser
+    {
+        public:
+
+            /**
+             * Parses an XML document.
+             *
+             * @param text The XML text to parse.
+             *
+             * @return The root element of the document.
+             *
+             * @throws std::runtime_error The text is not well-formed XML or has no root element.
+             */
+            static element parse(std::string_view text)
+            {
+                parser p(text);
+                return p.parse_document();
+            }
+
+        private:
+
+            explicit parser(std::string_view text) noexcept
+                : text(text)
+            {
+            }
+
+            element parse_document()
+            {
+                // The document is built in place in the root element's arena. The stack holds
+                // the open elements, outermost first; each element is appended to its parent
+                // as soon as it is opened.
+                std::optional<element> document;
+                std::vector<node *> stack;
+
+                while (pos < text.size())
+                {
+                    if (text[pos] != '<')
+                    {
+                        std::string content = parse_text();
+                        if (!stack.empty() && !is_whitespace(content))
+                            document->append_content(stack.back(), content);
+                    }
+
+                    else if (starts_with("<!--"))
+                        skip_past("-->");
+
+                    else if (starts_with("<?"))
+                        skip_past("?>");
+
+                    else if (starts_with("<![CDATA["))
+                    {
+                        pos += 9;
+                        auto end = find("]]>");
+                        if (!stack.empty())
+                            document->append_content(stack.back(), text.substr(pos, end - pos));
+                        pos = end + 3;
+                    }
+
+                    else if (starts_with("<!"))
+                        skip_past(">");
+
+                    else if (starts_with("</"))
+                    {
+                        pos += 2;
+                        std::string_view name = parse_name();
+                        skip_whitespace();
+                        expect('>');
+
+                        if (stack.empty() || stack.back()->name() != name)
+                            fail("mismatched closing tag </" + std::string(name) + ">");
+
+                        if (stack.size() == 1)
+                            return std::move(*document);
+
+                        stack.pop_back();
+                    }
+
+                    else
+                    {
+                        ++pos;
+                        std::string_view name = parse_name();
+
+                        if (stack.empty())
+                        {
+                            document.emplace(name);
+                            stack.push_back(document->root);
+                        }
+
+                        else
+                        {
+                            node *child = document->make_node(name);
+                            element::append_child(stack.back(), child);
+                            stack.push_back(child);
+                        }
+
+                        bool empty = parse_attributes(*document, stack.back());
+
+                        if (empty)
+                        {
+                            if (stack.size() == 1)
+                                return std::move(*document);
+                            stack.pop_back();
+                        }
+                    }
+                }
+
+                if (!document)
+                    fail("no root element");
+
+                return std::move(*document);
+            }
+
+            /**
+             * Parses the attributes of a start tag, up to and including the closing '>' or '/>'.
+             *
+             * @return True if the tag was an empty-element tag ('/>').
+             */
+            bool parse_attributes(element& document, node *e)
+            {
+                while (true)
+                {
+                    skip_whitespace();
+
+                    if (starts_with("/>"))
+                    {
+                        pos += 2;
+                        return true;
+                    }
+
+                    if (starts_with(">"))
+                    {
+                        ++pos;
+                        return false;
+                    }
+
+                    std::string_view id = parse_name();
+                    skip_whitespace();
+                    expect('=');
+                    skip_whitespace();
+
+                    if (pos >= text.size() || (text[pos] != '"' && text[pos] != '\''))
+                        fail("expected quoted attribute value");
+
+                    char quote = text[pos++];
+                    auto end = text.find(quote, pos);
+                    if (end == std::string_view::npos)
+                        fail("unterminated attribute value");
+
+                    document.append_attribute(e, id, unescape(text.substr(pos, end - pos)));
+                    pos = end + 1;
+                }
+            }
+
+            std::string_view parse_name()
+            {
+                std::size_t start = pos;
+                while (pos < text.size() && !is_whitespace(text[pos])
+                        && text[pos] != '>' && text[pos] != '/' && text[pos] != '=')
+                    ++pos;
+
+                if (pos == start)
+                    fail("expected a name");
+
+                return text.substr(start, pos - start);
+            }
+
+            std::string parse_text()
+            {
+                auto end = text.find('<', pos);
+                if (end == std::string_view::npos)
+                    end = text.size();
+
+                std::string content = unescape(text.substr(pos, end - pos));
+                pos = end;
+                return content;
+            }
+
+            /**
+             * Replaces the predefined and numeric character entities in @p str.
+             */
+            std::string unescape(std::string_view str) const
+            {
+                std::string result;
+                result.reserve(str.size());
+
+                for (std::size_t i = 0; i < str.size(); ++i)
+                {
+                    if (str[i] != '&')
+                    {
+                        result += str[i];
+                        continue;
+                    }
+
+                    auto end = str.find(';', i);
+                    if (end == std::string_view::npos)
+                        fail("unterminated entity reference");
+
+                    auto entity = str.substr(i + 1, end - i - 1);
+
+                    if (entity == "lt") result += '<';
+                    else if (entity == "gt") result += '>';
+                    else if (entity == "amp") result += '&';
+                    else if (entity == "quot") result += '"';
+                    else if (entity == "apos") result += '\'';
+                    else if (entity.size() > 1 && entity[0] == '#')
+                    {
+                        bool hex = entity[1] == 'x' || entity[1] == 'X';
+                        auto digits = std::string(entity.substr(hex ? 2 : 1));
+                        char *digits_end = nullptr;
+                        auto cp = std::strtoul(digits.c_str(), &digits_end, hex ? 16 : 10);
+                        if (digits.empty() || *digits_end)
+                            fail("invalid character reference &" + std::string(entity) + ";");
+                        append_utf8(result, static_cast<std::uint32_t>(cp));
+                    }
+                    else
+                        fail("unknown entity &" + std::string(entity) + ";");
+
+                    i = end;
+                }
+
+                return result;
+            }
+
+            static void append_utf8(std::string& str, std::uint32_t cp)
+            {
+                if (cp < 0x80)
+                    str += static_cast<char>(cp);
+                else if (cp < 0x800)
+                {
+                    str += static_cast<char>(0xC0 | (cp >> 6));
+                    str += static_cast<char>(0x80 | (cp & 0x3F));
+                }
+                else if (cp < 0x10000)
+                {
+                    str += static_cast<char>(0xE0 | (cp >> 12));
+                    str += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+                    str += static_cast<char>(0x80 | (cp & 0x3F));
+                }
+                else
+                {
+                    str += static_cast<char>(0xF0 | (cp >> 18));
+                    str += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+                    str += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+                    str += static_cast<char>(0x80 | (cp & 0x3F));
+                }
+            }
+
+            static bool is_whitespace(char ch) noexcept
+            {
+                return ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n';
+            }
+
+            static bool is_whitespace(const std::string& str) noexcept
+            {
+                for (char ch : str)
+                    if (!is_whitespace(ch))
+                        return false;
+                return true;
+            }
+
+            void skip_whitespace() noexcept
+            {
+                while (pos < text.size() && is_whitespace(text[pos]))
+                    ++pos;
+            }
+
+            bool starts_with(std::string_view prefix) const noexcept
+            {
+                return text.substr(pos, prefix.size()) == prefix;
+            }
+
+            std::size_t find(std::string_view terminator) const
+            {
+                auto end = text.find(terminator, pos);
+                if (end == std::string_view::npos)
+                    fail("unexpected end of input");
+                return end;
+            }
+
+            void skip_past(std::string_view terminator)
+            {
+                pos = find(terminator) + terminator.size();
+            }
+
+            void expect(char ch)
+            {
+                if (pos >= text.size() || text[pos] != ch)
+                    fail(std::string("expected '") + ch + "'");
+                ++pos;
+            }
+
+            [[noreturn]] void fail(const std::string& message) const
+            {
+                throw std::runtime_error(
+                    "invalid XML at offset " + std::to_string(pos) + ": " + message);
+            }
+
+            std::string_view text;
+            std::size_t pos = 0;
+    };
+
+    /**
+     * Parses an XML document. See hbk::sie::xml::parser for details.
+     *
+     * @param text The XML text to parse.
+     *
+     * @return The root element of the document.
+     *
+     * @throws std::runtime_error The text is not well-formed XML or has no root element.
+     */
+    inline element parse(std::string_view text)
+    {
+        return parser::parse(text);
+    }
+}
@@ -0,0 +1,377 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#include <boost/endian/conversion.hpp>
+
+#include <advanced_recorder_module/sie/format.h>
+
+#if defined (_MSC_VER) && !defined (__clang__)
+#include <intrin.h>
+#endif
+
+namespace hbk::sie
+{
+    /**
+     * The value of the channel tag ENCODING_TAG identifying channels whose sample values are
+     * XOR-compressed (see xor_encode()).
+     */
+    static constexpr const char *XOR_ENCODING = "xor";
+
+    /**
+     * The name of the decoder element which reads the next value of an XOR-compressed stream.
+     * This is an extension of the SIE decoder schema; it is used in place of a read element
+     * inside a loop, has the same var, type and bits attributes, and reads the values in the
+     * order in which xor_encode() encoded them, starting at the element's first execution.
+     */
+    static constexpr const char *READ_XOR_ELEMENT = "hbk:read_xor";
+
+    namespace detail::xor_codec
+    {
+        inline unsigned count_leading_zeros(std::uint64_t x) noexcept
+        {
+#if defined (_MSC_VER) && !defined (__clang__)
+            unsigned long index;
+            _BitScanReverse64(&index, x);
+            return 63 - static_cast<unsigned>(index);
+#else
+            return static_cast<unsigned>(__builtin_clzll(x));
+#endif
+        }
+
+        inline unsigned count_trailing_zeros(std::uint64_t x) noexcept
+        {
+#if defined (_MSC_VER) && !defined (__clang__)
+            unsigned long index;
+            _BitScanForward64(&index, x);
+            return static_cast<unsigned>(index);
+#else
+            return static_cast<unsigned>(__builtin_ctzll(x));
+#endif
+        }
+
+        /**
+         * Writes a stream of bits, most significant bit first, into a byte buffer, eight bytes
+         * at a time.
+         */
+        class bit_writer
+        {
+            public:
+
+                explicit bit_writer(std::uint8_t *out) noexcept
+                    : begin(out)
+                    , out(out)
+                {
+                }
+
+                /**
+                 * Appends the low @p n bits of @p value, which must be between 1 and 64. The
+                 * remaining bits of @p value must be zero.
+                 */
+                void put(std::uint64_t value, unsigned n) noexcept
+                {
+                    if (n < 64 - used)
+                    {
+                        acc |= value << (64 - used - n);
+                        used += n;
+                        return;
+                    }
+
+                    unsigned rest = n - (64 - used);
+                    acc |= value >> rest;
+                    store(acc);
+                    out += sizeof(acc);
+
+                    acc = rest ? value << (64 - rest) : 0;
+                    used = rest;
+                }
+
+                /**
+                 * Writes any buffered bits, padding the last byte with zero bits.
+                 *
+                 * @return The total number of bytes written.
+                 */
+                std::size_t finish() noexcept
+                {
+                    std::uint8_t tail[sizeof(acc)];
+                    auto value = boost::endian::native_to_big(acc);
+                    std::memcpy(tail, &value, sizeof(value));
+                    std::memcpy(out, tail, (used + 7) / 8);
+                    return static_cast<std::size_t>(out - begin) + (used + 7) / 8;
+                }
+
+            private:
+
+                void store(std::uint64_t value) noexcept
+                {
+                    value = boost::endian::native_to_big(value);
+                    std::memcpy(out, &value, sizeof(value));
+                }
+
+                std::uint8_t *begin;
+                std::uint8_t *out;
+                std::uint64_t acc = 0;
+                unsigned used = 0;
+        };
+
+        /**
+         * Reads a stream of bits written by bit_writer.
+         */
+        class bit_reader
+        {
+            public:
+
+                bit_reader(const std::uint8_t *data, std::size_t size) noexcept
+                    : data(data)
+                    , size(size)
+                {
+                }
+
+                /**
+                 * Reads the next @p n bits, which must be between 1 and 64.
+                 *
+                 * @return False if the stream has fewer than @p n bits left.
+                 */
+                bool get(unsigned n, std::uint64_t& value) noexcept
+                {
+                    if (position + n > 8 * static_cast<std::uint64_t>(size))
+                        return false;
+
+                    std::size_t byte = static_cast<std::size_t>(position / 8);
+                    unsigned shift = static_cast<unsigned>(position % 8);
+
+                    std::uint8_t window[sizeof(std::uint64_t)] = { };
+                    std::memcpy(window, data + byte, std::min(sizeof(window), size - byte));
+                    std::uint64_t bits;
+                    std::memcpy(&bits, window, sizeof(bits));
+                    bits = boost::endian::big_to_native(bits) << shift;
+
+                    if (shift && byte + sizeof(window) < size)
+                        bits |= data[byte + sizeof(window)] >> (8 - shift);
+
+                    value = bits >> (64 - n);
+                    position += n;
+                    return true;
+                }
+
+            private:
+
+                const std::uint8_t *data;
+                std::size_t size;
+                std::uint64_t position = 0;
+        };
+
+        /**
+         * The unsigned integer type with the same size as the floating-point type @p T.
+         */
+        template <typename T>
+        using bits_type = std::conditional_t<sizeof(T) == 8, std::uint64_t, std::uint32_t>;
+
+        template <typename T>
+        inline bits_type<T> load(const std::uint8_t *p) noexcept
+        {
+            bits_type<T> value;
+            std::memcpy(&value, p, sizeof(value));
+            return value;
+        }
+    }
+
+    /**
+     * Returns the maximum number of bytes which xor_encode() writes for @p count values of the
+     * floating-point type @p T.
+     */
+    template <typename T>
+    constexpr std::size_t xor_encode_bound(std::size_t count) noexcept
+    {
+        constexpr std::size_t width = 8 * sizeof(T);
+        constexpr std::size_t length_bits = width == 64 ? 6 : 5;
+        return sizeof(std::uint64_t) + (width + count * (2 + 2 * length_bits + width) + 7) / 8;
+    }
+
+    /**
+     * Compresses a sequence of float or double values losslessly, as described by Pelkonen et
+     * al., "Gorilla: A Fast, Scalable, In-Memory Time Series Database" (VLDB 2015). Each value is
+     * XORed with its predecessor, and since slowly-changing signals have most of their sign,
+     * exponent and mantissa bits in common, the result typically has long runs of leading and
+     * trailing zero bits, which are not stored.
+     *
+     * The output is a stream of bits, most significant bit first, with the last byte padded with
+     * zero bits. Let W be the width of @p T in bits and L be 6 for double or 5 for float. The
+     * stream starts with the W bits of the first value. Each subsequent value is encoded from the
+     * XOR X of its bits and those of its predecessor, as:
+     *
+     * - '0', if X is zero;
+     * - '10' followed by the bits of X within the window of the most recent '11' encoding, if X
+     *   has at least as many leading and trailing zero bits as that window;
+     * - '11' followed by the number of leading zero bits of X in L bits, the number M of bits
+     *   from the first to the last one bit of X, minus one, in L bits, and then those M bits.
+     *
+     * The XORs are computed in a separate pass over each run of values, which compilers
+     * vectorize, and the bits are packed with a 64-bit accumulator rather than one at a time.
+     *
+     * @param values The values to compress. No alignment is required.
+     * @param count The number of values.
+     * @param out Receives the compressed data. It must have room for xor_encode_bound<T>(count)
+     *     bytes.
+     *
+     * @return The number of bytes written to @p out.
+     */
+    template <typename T>
+    std::size_t xor_encode(const void *values, std::size_t count, std::uint8_t *out) noexcept
+    {
+        static_assert(std::is_floating_point_v<T> && (sizeof(T) == 4 || sizeof(T) == 8),
+            "T must be float or double");
+
+        using bits_type = detail::xor_codec::bits_type<T>;
+        constexpr unsigned width = 8 * sizeof(T);
+        constexpr unsigned length_bits = width == 64 ? 6 : 5;
+        constexpr std::size_t RUN = 256;
+
+        detail::xor_codec::bit_writer writer(out);
+        if (count == 0)
+            return writer.finish();
+
+        auto bytes = static_cast<const std::uint8_t *>(values);
+        writer.put(detail::xor_codec::load<T>(bytes), width);
+
+        // The leading and trailing zero counts of the current window. Initially there is no
+        // window, which this represents since no nonzero XOR has this many leading zeros.
+        unsigned window_leading = width;
+        unsigned window_trailing = 0;
+
+        bits_type xors[RUN];
+
+        for (std::size_t i = 1; i < count; i += RUN)
+        {
+            std::size_t n = std::min(RUN, count - i);
+
+            for (std::size_t j = 0; j < n; ++j)
+                xors[j] = detail::xor_codec::load<T>(bytes + (i + j) * sizeof(T))
+                    ^ detail::xor_codec::load<T>(bytes + (i + j - 1) * sizeof(T));
+
+            for (std::size_t j = 0; j < n; ++j)
+            {
+                std::uint64_t x = xors[j];
+                if (x == 0)
+                {
+                    writer.put(0, 1);
+                    continue;
+                }
+
+                unsigned leading = detail::xor_codec::count_leading_zeros(x) - (64 - width);
+                unsigned trailing = detail::xor_codec::count_trailing_zeros(x);
+
+                if (leading >= window_leading && trailing >= window_trailing)
+                {
+                    writer.put(0b10, 2);
+                    writer.put(x >> window_trailing, width - window_leading - window_trailing);
+                }
+
+                else
+                {
+                    unsigned meaningful = width - leading - trailing;
+                    writer.put(
+                        (std::uint64_t(0b11) << (2 * length_bits))
+                            | (std::uint64_t(leading) << length_bits)
+                            | (meaningful - 1),
+                        2 + 2 * length_bits);
+                    writer.put(x >> trailing, meaningful);
+
+                    window_leading = leading;
+                    window_trailing = trailing;
+                }
+            }
+        }
+
+        return writer.finish();
+    }
+
+    /**
+     * Decompresses values compressed by xor_encode().
+     *
+     * @param data The compressed data.
+     * @param size The size of the compressed data, in bytes.
+     * @param count The number of values to decompress.
+     * @param values Receives the values. It must have room for @p count values of type @p T. No
+     *     alignment is required.
+     *
+     * @return False if the compressed data is truncated or malformed. The contents of
+     *     @p values are then unspecified.
+     */
+    template <typename T>
+    bool xor_decode(const std::uint8_t *data, std::size_t size, std::size_t count, void *values) noexcept
+    {
+        static_assert(std::is_floating_point_v<T> && (sizeof(T) == 4 || sizeof(T) == 8),
+            "T must be float or double");
+
+        using bits_type = detail::xor_codec::bits_type<T>;
+        constexpr unsigned width = 8 * sizeof(T);
+        constexpr unsigned length_bits = width == 64 ? 6 : 5;
+
+        if (count == 0)
+            return true;
+
+        detail::xor_codec::bit_reader reader(data, size);
+        auto out = static_cast<std::uint8_t *>(values);
+
+        std::uint64_t current;
+        if (!reader.get(width, current))
+            return false;
+
+        auto store = [&](std::size_t i)
+        {
+            auto value = static_cast<bits_type>(current);
+            std::memcpy(out + i * sizeof(T), &value, sizeof(value));
+        };
+
+        store(0);
+
+        unsigned window_leading = width;
+        unsigned window_trailing = 0;
+
+        for (std::size_t i = 1; i < count; ++i)
+        {
+            std::uint64_t control;
+            if (!reader.get(1, control))
+                return false;
+
+            if (control)
+            {
+                if (!reader.get(1, control))
+                    return false;
+
+                if (control)
+                {
+                    std::uint64_t header;
+                    if (!reader.get(2 * length_bits, header))
+                        return false;
+
+                    unsigned leading = static_cast<unsigned>(header >> length_bits);
+                    unsigned meaningful = static_cast<unsigned>(header & ((1u << length_bits) - 1)) + 1;
+                    if (leading + meaningful > width)
+                        return false;
+
+                    window_leading = leading;
+                    window_trailing = width - leading - meaningful;
+                }
+
+                else if (window_leading == width)
+                    return false;
+
+                std::uint64_t x;
+                if (!reader.get(width - window_leading - window_trailing, x))
+                    return false;
+
+                current ^= x << window_trailing;
+            }
+
+            store(i);
+        }
+
+        return true;
+    }
+}
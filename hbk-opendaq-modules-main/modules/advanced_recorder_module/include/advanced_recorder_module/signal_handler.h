@@ -1,15 +1,59 @@
 #pragma once
 
+#include <chrono>
+#include <memory>
+
 #include <opendaq/opendaq.h>
 
 #include <advanced_recorder_module/common.h>
 
 BEGIN_NAMESPACE_ADVANCED_RECORDER_MODULE
 
+/*!
+ * @brief Keeps a data packet, and the value a signal handler writes in front of its data (such as
+ *     its domain value or sample count), alive until a retained block write has completed. This
+ *     lets an asynchronous file backend write the block straight from packet memory. A packet
+ *     also keeps its domain packet alive.
+ * @tparam Prefix The type of the value written in front of the packet data.
+ */
+template <typename Prefix>
+struct RetainedPacket
+{
+    Prefix prefix;
+    DataPacketPtr packet;
+};
+
+/*!
+ * @brief Creates a RetainedPacket to pass to a retained block write.
+ * @param prefix The value written in front of the packet data.
+ * @param packet The packet whose data is written.
+ */
+template <typename Prefix>
+std::shared_ptr<RetainedPacket<Prefix>> retainPacket(Prefix prefix, const DataPacketPtr& packet)
+{
+    return std::make_shared<RetainedPacket<Prefix>>(RetainedPacket<Prefix> { prefix, packet });
+}
+
 struct SignalHandler
 {
     virtual void onDataPacketReceived(const DataPacketPtr& packet) = 0;
 
+    /*!
+     * @brief Writes any data the handler has accumulated but not yet written.
+     */
+    virtual void flush()
+    {
+    }
+
+    /*!
+     * @brief Called periodically by the writer thread so that handlers which accumulate data
+     *     can write it once it becomes too old.
+     * @param now The current time.
+     */
+    virtual void onTick(std::chrono::steady_clock::time_point now)
+    {
+    }
+
     virtual ~SignalHandler()
     {
     }
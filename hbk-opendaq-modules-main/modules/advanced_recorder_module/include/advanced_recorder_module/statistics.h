@@ -0,0 +1,225 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+
+#include <advanced_recorder_module/common.h>
+
+BEGIN_NAMESPACE_ADVANCED_RECORDER_MODULE
+
+/*!
+ * @brief A histogram of durations with logarithmically-sized buckets. Each power of two is
+ *     divided into four buckets, so percentiles are reported with a resolution of 25% at any
+ *     scale, and recording a duration takes constant time without allocating memory.
+ *
+ * This class is not thread-safe; it is meant to be updated by a single thread and copied when
+ * the results are published.
+ */
+class LatencyHistogram
+{
+    public:
+
+        /*!
+         * @brief Records a duration.
+         * @param duration The duration to record. Negative durations are recorded as zero.
+         */
+        void record(std::chrono::nanoseconds duration) noexcept
+        {
+            auto ns = static_cast<std::uint64_t>(std::max<std::int64_t>(duration.count(), 0));
+
+            ++buckets[bucketOf(ns)];
+            ++count;
+
+            if (ns > maxValue)
+                maxValue = ns;
+        }
+
+        /*!
+         * @brief Gets the number of durations recorded.
+         * @return The number of durations recorded since the histogram was created or reset.
+         */
+        std::uint64_t size() const noexcept
+        {
+            return count;
+        }
+
+        /*!
+         * @brief Estimates a percentile of the recorded durations.
+         * @param fraction The percentile, between 0 and 1 (e.g. 0.99 for the 99th percentile).
+         * @return The upper bound of the bucket containing the percentile, but no more than
+         *     the largest duration recorded; or zero if nothing has been recorded.
+         */
+        std::chrono::nanoseconds percentile(double fraction) const noexcept
+        {
+            if (!count)
+                return std::chrono::nanoseconds(0);
+
+            auto rank = static_cast<std::uint64_t>(fraction * static_cast<double>(count));
+            if (rank >= count)
+                rank = count - 1;
+
+            std::uint64_t seen = 0;
+            for (std::size_t i = 0; i < BUCKETS; ++i)
+            {
+                seen += buckets[i];
+                if (seen > rank)
+                    return std::chrono::nanoseconds(std::min(upperBoundOf(i), maxValue));
+            }
+
+            return std::chrono::nanoseconds(maxValue);
+        }
+
+        /*!
+         * @brief Gets the largest duration recorded.
+         * @return The largest duration recorded, or zero if nothing has been recorded.
+         */
+        std::chrono::nanoseconds max() const noexcept
+        {
+            return std::chrono::nanoseconds(maxValue);
+        }
+
+        /*!
+         * @brief Discards all recorded durations.
+         */
+        void reset() noexcept
+        {
+            buckets.fill(0);
+            count = 0;
+            maxValue = 0;
+        }
+
+    private:
+
+        static constexpr std::size_t BUCKETS = 4 * 63;
+
+        static std::size_t bucketOf(std::uint64_t ns) noexcept
+        {
+            if (ns < 4)
+                return static_cast<std::size_t>(ns);
+
+            unsigned exponent = 2;
+            while (ns >> (exponent + 1))
+                ++exponent;
+
+            auto sub = static_cast<std::size_t>((ns >> (exponent - 2)) & 3);
+            return 4 * (exponent - 1) + sub;
+        }
+
+        static std::uint64_t upperBoundOf(std::size_t bucket) noexcept
+        {
+            if (bucket < 4)
+                return bucket;
+
+            unsigned exponent = static_cast<unsigned>(bucket / 4) + 1;
+            std::uint64_t sub = bucket % 4;
+            return ((5 + sub) << (exponent - 2)) - 1;
+        }
+
+        std::array<std::uint64_t, BUCKETS> buckets {};
+        std::uint64_t count = 0;
+        std::uint64_t maxValue = 0;
+};
+
+/*!
+ * @brief A snapshot of the recorder's performance counters. The writer thread keeps these
+ *     counters without synchronization and publishes a copy periodically (see
+ *     WriterThread::getStatistics()).
+ */
+struct RecorderStatistics
+{
+    /*!
+     * @brief The number of bytes written to SIE files since the recording was started,
+     *     including block headers, footers and index blocks.
+     */
+    std::uint64_t bytesWritten = 0;
+
+    /*!
+     * @brief The number of SIE blocks written since the recording was started.
+     */
+    std::uint64_t blocksWritten = 0;
+
+    /*!
+     * @brief The number of index blocks written since the recording was started.
+     */
+    std::uint64_t indexFlushes = 0;
+
+    /*!
+     * @brief The number of packets which were discarded without being recorded.
+     */
+    std::uint64_t packetsDropped = 0;
+
+    /*!
+     * @brief The number of bytes currently charged to the memory budget: the sample data of
+     *     queued packets and the block pool of the signal handlers.
+     */
+    std::uint64_t memoryUsed = 0;
+
+    /*!
+     * @brief The write rate, in bytes per second, over the most recent measurement interval.
+     */
+    double bytesPerSecond = 0;
+
+    /*!
+     * @brief The block rate, in blocks per second, over the most recent measurement interval.
+     */
+    double blocksPerSecond = 0;
+
+    /*!
+     * @brief The median time taken to record a packet, over the most recent measurement
+     *     interval. This includes any block writes the packet caused.
+     */
+    std::chrono::nanoseconds latencyP50 { 0 };
+
+    /*!
+     * @brief The 99th percentile of the time taken to record a packet, over the most recent
+     *     measurement interval.
+     */
+    std::chrono::nanoseconds latencyP99 { 0 };
+
+    /*!
+     * @brief The longest time taken to record a packet since the recording was started.
+     */
+    std::chrono::nanoseconds latencyMax { 0 };
+
+    /*!
+     * @brief The number of commits (syncs of all files with pending data) completed since the
+     *     recording was started. This is zero unless a DurabilityMode other than None is used.
+     */
+    std::uint64_t commits = 0;
+
+    /*!
+     * @brief The number of bytes, counted like bytesWritten, which are known to be durable.
+     *     The difference to bytesWritten is the amount of data at risk if power were lost now.
+     */
+    std::uint64_t bytesCommitted = 0;
+
+    /*!
+     * @brief The median time from requesting a commit until the data was durable, over the
+     *     most recent measurement interval.
+     */
+    std::chrono::nanoseconds commitLatencyP50 { 0 };
+
+    /*!
+     * @brief The 99th percentile of the commit latency, over the most recent measurement
+     *     interval.
+     */
+    std::chrono::nanoseconds commitLatencyP99 { 0 };
+
+    /*!
+     * @brief The longest commit latency since the recording was started.
+     */
+    std::chrono::nanoseconds commitLatencyMax { 0 };
+
+    /*!
+     * @brief The number of packets processed for each signal, by global ID, since the
+     *     recording was started.
+     */
+    std::map<std::string, std::uint64_t> packetCounts;
+};
+
+END_NAMESPACE_ADVANCED_RECORDER_MODULE
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+
+#include <advanced_recorder_module/common.h>
+
+BEGIN_NAMESPACE_ADVANCED_RECORDER_MODULE
+
+/*!
+ * @brief Specifies which direction of level crossing fires a trigger.
+ */
+enum class TriggerSlope
+{
+    Rising,
+    Falling,
+    Either,
+};
+
+/*!
+ * @brief Specifies whether and how a recording is restricted to windows around trigger events.
+ *     The values are captured from the AdvancedRecorderImpl properties when the recording is
+ *     started.
+ */
+struct TriggerSettings
+{
+    /*!
+     * @brief If false, all data is recorded continuously and the other settings are ignored.
+     */
+    bool enabled = false;
+
+    /*!
+     * @brief How much history of each signal is kept in memory while waiting for a trigger, and
+     *     recorded when the trigger fires.
+     */
+    std::chrono::milliseconds preTrigger { 5000 };
+
+    /*!
+     * @brief How long after the most recent trigger data continues to be recorded.
+     */
+    std::chrono::milliseconds postTrigger { 5000 };
+};
+
+/*!
+ * @brief A time in the domain of a signal, in seconds from the domain's origin: a domain tick
+ *     multiplied by the domain's tick resolution.
+ */
+typedef std::chrono::duration<double> DomainTime;
+
+/*!
+ * @brief Detects the crossing of a level by the samples of a scalar signal. The last sample of
+ *     each call is remembered, so crossings between consecutive packets are detected as well.
+ */
+class LevelDetector
+{
+    public:
+
+        /*!
+         * @brief Creates a level detector.
+         * @param level The level which must be crossed.
+         * @param slope The direction of crossing which is detected.
+         */
+        LevelDetector(double level, TriggerSlope slope) noexcept
+            : level(level)
+            , slope(slope)
+        {
+        }
+
+        /*!
+         * @brief Examines a sequence of samples for a level crossing.
+         * @tparam T The sample type.
+         * @param samples A pointer to the first sample.
+         * @param count The number of samples.
+         * @return True if the samples (or the previous sample and the first of these) cross the
+         *     level in the configured direction.
+         */
+        template <typename T>
+        bool process(const T *samples, std::size_t count) noexcept
+        {
+            bool crossed = false;
+
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                double value = static_cast<double>(samples[i]);
+
+                if (havePrevious)
+                {
+                    bool rising = previous < level && value >= level;
+                    bool falling = previous > level && value <= level;
+
+                    if ((rising && slope != TriggerSlope::Falling)
+                            || (falling && slope != TriggerSlope::Rising))
+                        crossed = true;
+                }
+
+                previous = value;
+                havePrevious = true;
+            }
+
+            return crossed;
+        }
+
+    private:
+
+        double level;
+        TriggerSlope slope;
+
+        double previous = 0;
+        bool havePrevious = false;
+};
+
+END_NAMESPACE_ADVANCED_RECORDER_MODULE
@@ -0,0 +1,431 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <opendaq/opendaq.h>
+
+#include <advanced_recorder_module/advanced_recorder_signal.h>
+#include <advanced_recorder_module/block_pool.h>
+#include <advanced_recorder_module/bounded_queue.h>
+#include <advanced_recorder_module/commit_thread.h>
+#include <advanced_recorder_module/common.h>
+#include <advanced_recorder_module/segment.h>
+#include <advanced_recorder_module/signal_handler.h>
+#include <advanced_recorder_module/sie/writer.h>
+#include <advanced_recorder_module/statistics.h>
+#include <advanced_recorder_module/trigger.h>
+
+BEGIN_NAMESPACE_ADVANCED_RECORDER_MODULE
+
+/*!
+ * @brief Specifies what an acquisition thread does with a packet when the writer thread's queue
+ *     is full or the memory budget is exhausted.
+ */
+enum class BackpressurePolicy
+{
+    /*!
+     * @brief The acquisition thread waits until the writer thread has made room. No packets
+     *     are lost, but acquisition is held up.
+     */
+    Block,
+
+    /*!
+     * @brief The new packet is discarded.
+     */
+    DropNewest,
+
+    /*!
+     * @brief The oldest queued packets are discarded to make room for the new packet.
+     */
+    DropOldest,
+};
+
+/*!
+ * @brief Specifies how much memory the recording may hold and what happens when it is used up.
+ *     The values are captured from the AdvancedRecorderImpl properties when the recording is
+ *     started.
+ */
+struct BackpressureSettings
+{
+    BackpressurePolicy policy = BackpressurePolicy::Block;
+
+    /*!
+     * @brief The budget which queued and held packets are charged to. It is shared with the
+     *     BlockPool of the signal handlers (see RecorderSettings::pool). If null, memory is not
+     *     limited.
+     */
+    std::shared_ptr<MemoryBudget> budget;
+};
+
+/*!
+ * @brief Decouples the acquisition threads from the filesystem by recording packets in a
+ *     dedicated background thread.
+ *
+ * Acquisition threads call enqueue(), which only appends a reference to the packets (and to the
+ * AdvancedRecorderSignal object which should record them) to a bounded lock-free queue. The
+ * background thread drains the queue and invokes AdvancedRecorderSignal::onPacketReceived(),
+ * which in turn writes to the SIE file. Since only the background thread ever writes to the SIE
+ * writer stack, the writer stack need not be thread-safe. Whenever the queue runs dry, the
+ * background thread flushes the writer so that writes batched by the file layer (see
+ * hbk::sie::io_uring_vector_io_file) are submitted before it goes to sleep.
+ *
+ * The background thread keeps every AdvancedRecorderSignal it has seen alive until the signal is
+ * retired (see retire()) or the thread is stopped, and calls AdvancedRecorderSignal::onTick()
+ * periodically so that signal handlers can write accumulated data once it becomes too old. This
+ * also guarantees that AdvancedRecorderSignal objects are only ever destroyed after their final
+ * data has been written by the background thread.
+ *
+ * If a RotationPolicy is enabled, the background thread also splits the recording into several
+ * files (segments). The next segment is always prepared ahead of time by a helper thread, which
+ * creates the file, writes the preamble, and creates signal handlers (writing their channel
+ * metadata) for the signals recorded so far. When the current segment is due to be closed, the
+ * background thread moves every signal to the prepared segment between two packets, so no
+ * packets are lost. If the next segment is not ready yet, the current one is kept a little longer
+ * rather than waiting, and acquisition threads are never blocked by the switch.
+ *
+ * If TriggerSettings are enabled, packets are only recorded inside trigger windows. Outside a
+ * window, each AdvancedRecorderSignal holds references to its packets from the pre-trigger
+ * interval (see AdvancedRecorderSignal::hold()). When a trigger fires, either because a packet
+ * of a trigger source crosses its level or because trigger() was called, every signal's history
+ * is recorded and a window is opened which lasts until the post-trigger interval has elapsed
+ * since the most recent trigger. Times are domain times (see getPacketDomainTime()): a packet is
+ * recorded if its first sample falls inside the window, however late it is processed, and a
+ * trigger() request fires at the latest domain time processed. This assumes that the signals
+ * share a domain origin. For packets whose domain time is not known, and until a trigger has
+ * fired with a domain time, the time at which the background thread processes the packets is
+ * used instead.
+ *
+ * If a DurabilityPolicy is enabled, the background thread also requests commits from a
+ * CommitThread, which syncs the files without holding up recording. In periodic mode, a commit is
+ * requested once the configured interval has elapsed or amount of data has been written since
+ * the previous request. In group-commit mode, a commit is requested whenever new data has been
+ * written and no earlier request is still waiting, so all data written while one commit runs is
+ * covered by the next. Either way, requests are only made between batches of packets (at least
+ * once per tick interval), and a final commit covers each closed segment, including its closing
+ * index block.
+ *
+ * The packets waiting in the queue are charged to a MemoryBudget (see BackpressureSettings),
+ * by the size of their sample data. If the queue is full or the budget is exhausted, enqueue()
+ * applies the BackpressurePolicy: it waits, discards the new packet, or discards the oldest
+ * queued packets. Discarded packets are counted in RecorderStatistics::packetsDropped. Waiting
+ * producers sleep on a condition variable until the background thread has taken entries off the
+ * queue or memory has been released (see MemoryBudget::charge()), and give up once the thread is
+ * stopped, so stop() never leaves packets behind in the queue. In triggered mode, the packets
+ * held in the pre-trigger history remain charged, up to AdvancedRecorderSignal::HISTORY_SHARE of
+ * the budget.
+ *
+ * The background thread also keeps performance counters (see RecorderStatistics). They are
+ * updated without synchronization, and a copy is published once per second for getStatistics().
+ */
+class WriterThread
+{
+    public:
+
+        /*!
+         * @brief The default maximum number of packets which may be queued.
+         */
+        static constexpr std::size_t DEFAULT_CAPACITY = 65536;
+
+        /*!
+         * @brief Creates a queue and starts the background thread.
+         * @param segment The first (or only) file to record to. Its writer is attached to each
+         *     AdvancedRecorderSignal when the signal's first packet is processed, and is flushed
+         *     whenever the queue runs dry.
+         * @param capacity The maximum number of packets which may be queued. This value is
+         *     rounded up to the next power of two.
+         * @param tickInterval The interval at which AdvancedRecorderSignal::onTick() is called.
+         * @param policy Specifies when the recording is split into a new segment.
+         * @param factory Creates subsequent segments, with sequence numbers starting from 1.
+         *     This is only required if @p policy is enabled.
+         * @param trigger Specifies whether packets are only recorded around trigger events.
+         * @param durability Specifies when recorded data is made durable.
+         * @param backpressure Specifies the memory budget of the queue and what happens when
+         *     it is exhausted.
+         */
+        explicit WriterThread(
+            Segment segment,
+            std::size_t capacity = DEFAULT_CAPACITY,
+            std::chrono::milliseconds tickInterval = std::chrono::milliseconds(100),
+            RotationPolicy policy = RotationPolicy(),
+            SegmentFactory factory = SegmentFactory(),
+            TriggerSettings trigger = TriggerSettings(),
+            DurabilityPolicy durability = DurabilityPolicy(),
+            BackpressureSettings backpressure = BackpressureSettings());
+
+        WriterThread(const WriterThread&) = delete;
+        WriterThread& operator=(const WriterThread&) = delete;
+
+        /*!
+         * @brief Records any packets remaining in the queue and stops the background thread.
+         */
+        ~WriterThread();
+
+        /*!
+         * @brief Queues a batch of packets of one signal, such as those returned by
+         *     IConnection::dequeueAll(), to be recorded by the background thread. The batch
+         *     takes a single entry of the queue and a single charge to the memory budget, unless
+         *     that charge would exceed what the budget can grant; it is then split into runs of
+         *     packets which do not. Each entry is dropped as a whole by the backpressure policy.
+         * @param signal The object which should record the packets.
+         * @param packets The packets to record, in order.
+         */
+        void enqueue(const std::shared_ptr<AdvancedRecorderSignal>& signal, const ListPtr<IPacket>& packets);
+
+        /*!
+         * @brief Asks the background thread to write any data @p signal has accumulated and
+         *     then release its reference to @p signal, after all packets previously enqueued for
+         *     it have been recorded. This should be called when a signal is disconnected.
+         * @param signal The object to retire.
+         */
+        void retire(std::shared_ptr<AdvancedRecorderSignal> signal);
+
+        /*!
+         * @brief Asks the background thread to fire a trigger as soon as possible. This has no
+         *     effect unless triggered recording is enabled.
+         */
+        void trigger();
+
+        /*!
+         * @brief Records any packets remaining in the queue and stops the background thread.
+         *     Packets enqueued after this call, or still waiting for room in the queue when it
+         *     is made, are discarded and counted as dropped.
+         */
+        void stop();
+
+        /*!
+         * @brief Gets the number of entries (runs of packets) currently waiting in the queue.
+         * @return The approximate current queue depth.
+         */
+        std::size_t getQueueDepth() const noexcept;
+
+        /*!
+         * @brief Gets the largest queue depth observed since the background thread was started.
+         * @return The queue high-water mark.
+         */
+        std::size_t getHighWaterMark() const noexcept;
+
+        /*!
+         * @brief Gets the most recently published performance counters.
+         * @return A copy of the counters, which are at most about one second old.
+         */
+        RecorderStatistics getStatistics() const;
+
+    private:
+
+        /*!
+         * @brief A queued run of packets from a batch. An entry without packets asks the
+         *     background thread to retire the signal.
+         */
+        struct Entry
+        {
+            std::shared_ptr<AdvancedRecorderSignal> signal;
+            ListPtr<IPacket> batch;
+
+            /*!
+             * @brief The index of the first packet of the run in @p batch.
+             */
+            std::size_t first = 0;
+
+            /*!
+             * @brief The number of packets in the run.
+             */
+            std::size_t count = 0;
+
+            /*!
+             * @brief The number of bytes charged to the memory budget for this entry.
+             */
+            std::size_t bytes = 0;
+        };
+
+        /*!
+         * @brief A signal handler created ahead of time for the next segment.
+         */
+        struct PreparedHandler
+        {
+            std::shared_ptr<AdvancedRecorderSignal> signal;
+            AdvancedRecorderSignal::Descriptors descriptors;
+            std::unique_ptr<SignalHandler> handler;
+        };
+
+        /*!
+         * @brief The next segment, prepared by the helper thread. The handlers refer to the
+         *     segment's writer, so they are declared after it to be destroyed first.
+         */
+        struct PreparedSegment
+        {
+            Segment segment;
+            std::vector<PreparedHandler> handlers;
+        };
+
+        class ProducerScope;
+
+        static std::size_t sizeOf(const PacketPtr& packet);
+        std::size_t maxCharge() const;
+        void push(Entry& entry);
+        void insert(Entry& entry);
+        void notify();
+        bool dropOldest();
+        void signalRoom();
+        void waitForRoom(std::uint64_t seen);
+        void discardQueued();
+        void run();
+        void process(Entry& entry);
+        std::size_t processPacket(
+            const std::shared_ptr<AdvancedRecorderSignal>& signal,
+            const PacketPtr& packet,
+            std::size_t charge);
+        void tick(std::chrono::steady_clock::time_point now);
+        void flush();
+        void wake();
+
+        void prepareNextSegment();
+        bool isRotationDue(std::chrono::steady_clock::time_point now) const;
+        void rotateIfDue(std::chrono::steady_clock::time_point now);
+        void discardPreparedSegment();
+        void startSegment(std::chrono::steady_clock::time_point now);
+
+        void fireTrigger(
+            std::chrono::steady_clock::time_point now,
+            std::optional<DomainTime> domainTime);
+        bool isInTriggerWindow(
+            std::chrono::steady_clock::time_point now,
+            const std::optional<DomainTime>& domainTime) const;
+
+        void commitIfDue(std::chrono::steady_clock::time_point now);
+        void requestCommit(std::chrono::steady_clock::time_point now);
+
+        void publishStatistics(std::chrono::steady_clock::time_point now);
+
+        Segment segment;
+        BoundedQueue<Entry> queue;
+        std::chrono::milliseconds tickInterval;
+
+        RotationPolicy policy;
+        SegmentFactory factory;
+
+        /*!
+         * @brief The sequence number of the next segment. Only accessed by the background thread.
+         */
+        unsigned nextSequence = 1;
+
+        std::chrono::steady_clock::time_point segmentStarted;
+        std::chrono::system_clock::time_point nextBoundary;
+
+        /*!
+         * @brief The next segment, while it is being prepared or once it is ready. Only accessed
+         *     by the background thread.
+         */
+        std::future<PreparedSegment> preparedSegment;
+
+        TriggerSettings triggerSettings;
+
+        /*!
+         * @brief The end of the current trigger window, by the time packets are processed; in
+         *     the past if no window is open. Only accessed by the background thread.
+         */
+        std::chrono::steady_clock::time_point triggerWindowEnd;
+
+        /*!
+         * @brief The end of the current trigger window in domain time, once a trigger has fired
+         *     with a domain time known. Only accessed by the background thread.
+         */
+        std::optional<DomainTime> domainWindowEnd;
+
+        /*!
+         * @brief The latest domain time of any packet processed, which a trigger() request is
+         *     taken to fire at. Only accessed by the background thread.
+         */
+        std::optional<DomainTime> latestDomainTime;
+
+        DurabilityPolicy durability;
+
+        BackpressurePolicy backpressurePolicy;
+        std::shared_ptr<MemoryBudget> budget;
+
+        /*!
+         * @brief Syncs the files; only created if durability is enabled.
+         */
+        std::unique_ptr<CommitThread> commitThread;
+
+        /*!
+         * @brief The recording position, and the time, of the most recent commit request. Only
+         *     accessed by the background thread.
+         */
+        std::uint64_t requestedBytes = 0;
+        std::chrono::steady_clock::time_point lastCommitRequest;
+
+        /*!
+         * @brief The signals seen by the background thread, and the number of packets processed
+         *     for each. Only accessed by that thread.
+         */
+        std::unordered_map<std::shared_ptr<AdvancedRecorderSignal>, std::uint64_t> signals;
+
+        /*!
+         * @brief The packet counts of retired signals, by global ID. Only accessed by the
+         *     background thread.
+         */
+        std::map<std::string, std::uint64_t> retiredPacketCounts;
+
+        /*!
+         * @brief Times taken to record packets since the counters were last published. Only
+         *     accessed by the background thread, like the other counters below.
+         */
+        LatencyHistogram latency;
+        std::chrono::nanoseconds latencyMax { 0 };
+
+        std::uint64_t closedBytes = 0;
+        std::uint64_t closedBlocks = 0;
+        std::uint64_t closedIndexFlushes = 0;
+        std::uint64_t publishedBytes = 0;
+        std::uint64_t publishedBlocks = 0;
+        std::chrono::steady_clock::time_point lastPublished;
+
+        /*!
+         * @brief The most recently published counters, protected by statisticsMutex.
+         */
+        RecorderStatistics statistics;
+        mutable std::mutex statisticsMutex;
+
+        std::atomic<std::uint64_t> packetsDropped = 0;
+
+        std::atomic<std::size_t> highWaterMark = 0;
+        std::atomic<bool> stopRequested = false;
+        std::atomic<bool> triggerRequested = false;
+        std::atomic<bool> idle = false;
+
+        std::mutex mutex;
+        std::condition_variable cv;
+
+        /*!
+         * @brief Counts the occasions on which room was made in the queue (see signalRoom()),
+         *     so that producers waiting in waitForRoom() can tell whether they missed one.
+         */
+        std::atomic<std::uint64_t> roomEvents = 0;
+        std::atomic<unsigned> roomWaiters = 0;
+        std::mutex roomMutex;
+        std::condition_variable roomCv;
+
+        /*!
+         * @brief The number of threads currently in enqueue() or retire(). stop() waits for
+         *     them to leave before discarding whatever they queued too late to be processed.
+         */
+        std::atomic<unsigned> producers = 0;
+
+        std::thread thread;
+};
+
+END_NAMESPACE_ADVANCED_RECORDER_MODULE
@@ -1,22 +1,80 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
 #include <functional>
+#include <iostream>
 #include <memory>
 #include <set>
-#include <sstream>
 #include <string>
+#include <thread>
+#include <utility>
+#include <vector>
 
 #include <opendaq/function_block_impl.h>
 #include <opendaq/opendaq.h>
 
 #include <advanced_recorder_module/advanced_recorder_impl.h>
 #include <advanced_recorder_module/common.h>
+#include <advanced_recorder_module/segment.h>
+#include <advanced_recorder_module/sie/block_pipeline.h>
 #include <advanced_recorder_module/sie/block_writer.h>
 #include <advanced_recorder_module/sie/format.h>
 #include <advanced_recorder_module/sie/indexed_writer.h>
 #include <advanced_recorder_module/sie/vector_io_file.h>
 #include <advanced_recorder_module/sie/writer.h>
+#include <advanced_recorder_module/sie/xml.h>
+#include <advanced_recorder_module/statistics.h>
+#include <advanced_recorder_module/trigger.h>
+#include <advanced_recorder_module/writer_thread.h>
 
 BEGIN_NAMESPACE_ADVANCED_RECORDER_MODULE
 
+static hbk::sie::io_backend ioBackendFromSelection(Int selection)
+{
+    switch (selection)
+    {
+        case 1: return hbk::sie::io_backend::posix;
+        case 2: return hbk::sie::io_backend::io_uring;
+        case 3: return hbk::sie::io_backend::mmap;
+        default: return hbk::sie::io_backend::automatic;
+    }
+}
+
+/*!
+ * @brief Creates an SIE file and writes the preamble. If @p compressionThreads is nonzero, the
+ *     writer compresses blocks on that many worker threads.
+ */
+static Segment openSegment(
+    const std::string& filename,
+    hbk::sie::io_backend backend,
+    std::size_t indexEvery,
+    unsigned compressionThreads,
+    std::size_t compressionInFlight)
+{
+    auto file = hbk::sie::vector_io_file(filename, backend);
+
+    if (backend != hbk::sie::io_backend::automatic && file.backend() != backend)
+        std::cerr << "[advanced-recorder] the selected I/O backend is not available; using POSIX I/O" << std::endl;
+
+    auto writer = std::make_shared<hbk::sie::writer>(
+        hbk::sie::indexed_writer(
+            hbk::sie::block_writer(
+                std::move(file)),
+            indexEvery));
+
+    if (compressionThreads)
+        writer->start_pipeline(compressionThreads, compressionInFlight);
+
+    std::string xml = hbk::sie::PREAMBLE;
+    hbk::sie::test(0).serialize(xml, 1);
+
+    writer->write_metadata(xml);
+
+    return { filename, std::move(writer) };
+}
+
 FunctionBlockTypePtr AdvancedRecorderImpl::createType()
 {
     return FunctionBlockType(
@@ -36,8 +94,8 @@ AdvancedRecorderImpl::AdvancedRecorderImpl(
 {
     this->tags.add(Tags::RECORDER);
 
-    addInputPort();
     addProperties();
+    addInputPort();
 }
 
 ErrCode AdvancedRecorderImpl::startRecording()
@@ -99,56 +157,493 @@ void AdvancedRecorderImpl::activeChanged()
         stopRecording();
 }
 
+/*!
+ * @brief Counts the calling acquisition thread as a reader of the current snapshot while it
+ *     exists, so that reclaimSnapshots() does not free a snapshot the thread is still using.
+ */
+class AdvancedRecorderImpl::SnapshotReader
+{
+    public:
+
+        explicit SnapshotReader(AdvancedRecorderImpl& owner) noexcept
+            : owner(owner)
+        {
+            // Sequentially consistent, like the store in publishSnapshot() and the load in
+            // reclaimSnapshots(): either the reclaiming thread sees this reader and waits for
+            // it, or this reader sees the snapshot published before the others were freed.
+            owner.snapshotReaders.fetch_add(1);
+            current = owner.snapshot.load();
+        }
+
+        ~SnapshotReader()
+        {
+            owner.snapshotReaders.fetch_sub(1, std::memory_order_release);
+        }
+
+        SnapshotReader(const SnapshotReader&) = delete;
+        SnapshotReader& operator=(const SnapshotReader&) = delete;
+
+        const Snapshot *get() const noexcept
+        {
+            return current;
+        }
+
+    private:
+
+        AdvancedRecorderImpl& owner;
+        const Snapshot *current;
+};
+
 void AdvancedRecorderImpl::onPacketReceived(const InputPortPtr& port)
 {
-    auto signal = findSignal(port);
+    // A single atomic load gives a consistent view of the writer thread and the signals,
+    // however many threads deliver packets at once, without locking or reference counting.
+    SnapshotReader reader(*this);
+    auto current = reader.get();
 
-    auto connection = port.getConnection();
-    if (!connection.assigned())
+    if (current && current->drainAll)
+    {
+        drainAll();
         return;
+    }
 
-    PacketPtr packet;
-    while ((packet = connection.dequeue()).assigned())
-        if (signal)
-            signal->onPacketReceived(packet);
+    if (current)
+    {
+        if (auto it = current->sources.find(port.getObject()); it != current->sources.end())
+        {
+            drain(*current, it->second);
+            return;
+        }
+    }
+
+    // The port was connected after the snapshot was published; discard its packets.
+    if (auto connection = port.getConnection(); connection.assigned())
+        connection.dequeueAll();
+}
+
+void AdvancedRecorderImpl::drain(const Snapshot& current, const Snapshot::Source& source)
+{
+    // Packets are only queued here; the writer thread records them to the file. Packets of
+    // ports which are not being recorded are discarded.
+    auto packets = source.connection.dequeueAll();
+    if (source.signal && current.writerThread && packets.getCount() > 0)
+        current.writerThread->enqueue(source.signal, packets);
+}
+
+void AdvancedRecorderImpl::drainAll()
+{
+    drainPending = true;
+
+    while (drainPending.load())
+    {
+        // If another scheduler thread is draining, it will see our request and drain again.
+        std::unique_lock<std::mutex> lock(drainMutex, std::try_to_lock);
+        if (!lock.owns_lock())
+            return;
+
+        drainPending = false;
+
+        SnapshotReader reader(*this);
+        auto current = reader.get();
+        for (const auto& entry : current->sources)
+            drain(*current, entry.second);
+    }
 }
 
 void AdvancedRecorderImpl::addProperties()
 {
     objPtr.addProperty(StringProperty(Props::FILENAME, ""));
     objPtr.getOnPropertyValueWrite(Props::FILENAME) += std::bind(&AdvancedRecorderImpl::reconfigure, this);
+
+    objPtr.addProperty(BoolProperty(Props::APPEND_TESTS, False));
+    objPtr.getOnPropertyValueWrite(Props::APPEND_TESTS) += std::bind(&AdvancedRecorderImpl::reconfigure, this);
+
+    objPtr.addProperty(IntPropertyBuilder(Props::QUEUE_CAPACITY, static_cast<Int>(WriterThread::DEFAULT_CAPACITY))
+        .setMinValue(1)
+        .build());
+
+    objPtr.addProperty(SelectionProperty(
+        Props::IO_BACKEND,
+        List<IString>("Automatic", "POSIX", "io_uring", "Memory-mapped"),
+        0));
+
+    objPtr.addProperty(IntPropertyBuilder(Props::INDEX_INTERVAL, static_cast<Int>(hbk::sie::indexed_writer::DEFAULT_INDEX_EVERY))
+        .setMinValue(2)
+        .build());
+
+    objPtr.addProperty(IntPropertyBuilder(Props::BLOCK_SIZE, static_cast<Int>(RecorderSettings().blockSize))
+        .setMinValue(0)
+        .setUnit(Unit("B"))
+        .build());
+
+    objPtr.addProperty(IntPropertyBuilder(Props::MAX_BLOCK_LATENCY, static_cast<Int>(RecorderSettings().maxBlockLatency.count()))
+        .setMinValue(0)
+        .setUnit(Unit("ms"))
+        .build());
+
+    objPtr.addProperty(IntPropertyBuilder(Props::SEGMENT_MAX_SIZE, 0)
+        .setMinValue(0)
+        .setUnit(Unit("B"))
+        .build());
+
+    objPtr.addProperty(IntPropertyBuilder(Props::SEGMENT_MAX_DURATION, 0)
+        .setMinValue(0)
+        .setUnit(Unit("s"))
+        .build());
+
+    objPtr.addProperty(IntPropertyBuilder(Props::SEGMENT_BOUNDARY, 0)
+        .setMinValue(0)
+        .setUnit(Unit("s"))
+        .build());
+
+    objPtr.addProperty(StringProperty(Props::SEGMENT_FILENAME, "{base}_{seq:04}.sie"));
+
+    objPtr.addProperty(SelectionProperty(
+        Props::TRIGGER_MODE,
+        List<IString>("Continuous", "Triggered"),
+        0));
+
+    objPtr.addProperty(IntPropertyBuilder(Props::PRE_TRIGGER_TIME, static_cast<Int>(TriggerSettings().preTrigger.count()))
+        .setMinValue(0)
+        .setUnit(Unit("ms"))
+        .build());
+
+    objPtr.addProperty(IntPropertyBuilder(Props::POST_TRIGGER_TIME, static_cast<Int>(TriggerSettings().postTrigger.count()))
+        .setMinValue(0)
+        .setUnit(Unit("ms"))
+        .build());
+
+    objPtr.addProperty(IntPropertyBuilder(Props::TRIGGER_INPUT, 0)
+        .setMinValue(0)
+        .build());
+
+    objPtr.addProperty(FloatProperty(Props::TRIGGER_LEVEL, 0.0));
+
+    objPtr.addProperty(SelectionProperty(
+        Props::TRIGGER_SLOPE,
+        List<IString>("Rising", "Falling", "Either"),
+        0));
+
+    objPtr.addProperty(FunctionProperty(Props::TRIGGER, ProcedureInfo()));
+    objPtr.setPropertyValue(Props::TRIGGER, Procedure([this]()
+    {
+        if (auto thread = std::atomic_load(&writerThread))
+            thread->trigger();
+    }));
+
+    objPtr.addProperty(SelectionProperty(
+        Props::DURABILITY_MODE,
+        List<IString>("None", "Periodic", "Group commit"),
+        0));
+
+    objPtr.addProperty(IntPropertyBuilder(Props::SYNC_INTERVAL, static_cast<Int>(DurabilityPolicy().interval.count()))
+        .setMinValue(0)
+        .setUnit(Unit("ms"))
+        .build());
+
+    objPtr.addProperty(IntPropertyBuilder(Props::SYNC_SIZE, 0)
+        .setMinValue(0)
+        .setUnit(Unit("B"))
+        .build());
+
+    objPtr.addProperty(IntPropertyBuilder(Props::MEMORY_BUDGET, 0)
+        .setMinValue(0)
+        .setUnit(Unit("B"))
+        .build());
+
+    objPtr.addProperty(SelectionProperty(
+        Props::BACKPRESSURE,
+        List<IString>("Block", "Drop newest", "Drop oldest"),
+        0));
+
+    objPtr.addProperty(BoolProperty(Props::HUGE_PAGES, False));
+
+    objPtr.addProperty(BoolProperty(Props::COMPRESS, False));
+
+    objPtr.addProperty(IntPropertyBuilder(Props::COMPRESSION_THREADS, 0)
+        .setMinValue(0)
+        .build());
+
+    objPtr.addProperty(IntPropertyBuilder(Props::COMPRESSION_IN_FLIGHT, static_cast<Int>(hbk::sie::block_pipeline::DEFAULT_MAX_IN_FLIGHT))
+        .setMinValue(1)
+        .build());
+
+    objPtr.addProperty(SelectionProperty(
+        Props::PACKET_NOTIFICATION,
+        List<IString>("Same thread", "Scheduler"),
+        0));
+    objPtr.getOnPropertyValueWrite(Props::PACKET_NOTIFICATION) +=
+        std::bind(&AdvancedRecorderImpl::updateNotificationMethod, this);
+
+    objPtr.addProperty(IntPropertyBuilder(Props::QUEUE_DEPTH, 0).setReadOnly(true).build());
+    objPtr.getOnPropertyValueRead(Props::QUEUE_DEPTH) +=
+        [this](PropertyObjectPtr&, PropertyValueEventArgsPtr& args)
+        {
+            auto thread = std::atomic_load(&writerThread);
+            args.setValue(Integer(thread ? static_cast<Int>(thread->getQueueDepth()) : 0));
+        };
+
+    objPtr.addProperty(IntPropertyBuilder(Props::QUEUE_HIGH_WATER_MARK, 0).setReadOnly(true).build());
+    objPtr.getOnPropertyValueRead(Props::QUEUE_HIGH_WATER_MARK) +=
+        [this](PropertyObjectPtr&, PropertyValueEventArgsPtr& args)
+        {
+            auto thread = std::atomic_load(&writerThread);
+            args.setValue(Integer(thread ? static_cast<Int>(thread->getHighWaterMark()) : 0));
+        };
+
+    addStatisticProperty(
+        IntPropertyBuilder(Props::BYTES_WRITTEN, 0).setReadOnly(true).setUnit(Unit("B")).build(),
+        [](const RecorderStatistics& stats) { return Integer(static_cast<Int>(stats.bytesWritten)); });
+
+    addStatisticProperty(
+        FloatPropertyBuilder(Props::WRITE_RATE, 0.0).setReadOnly(true).setUnit(Unit("B/s")).build(),
+        [](const RecorderStatistics& stats) { return Floating(stats.bytesPerSecond); });
+
+    addStatisticProperty(
+        IntPropertyBuilder(Props::BLOCKS_WRITTEN, 0).setReadOnly(true).build(),
+        [](const RecorderStatistics& stats) { return Integer(static_cast<Int>(stats.blocksWritten)); });
+
+    addStatisticProperty(
+        FloatPropertyBuilder(Props::BLOCK_RATE, 0.0).setReadOnly(true).setUnit(Unit("1/s")).build(),
+        [](const RecorderStatistics& stats) { return Floating(stats.blocksPerSecond); });
+
+    addStatisticProperty(
+        IntPropertyBuilder(Props::INDEX_FLUSHES, 0).setReadOnly(true).build(),
+        [](const RecorderStatistics& stats) { return Integer(static_cast<Int>(stats.indexFlushes)); });
+
+    addStatisticProperty(
+        IntPropertyBuilder(Props::DROPPED_PACKETS, 0).setReadOnly(true).build(),
+        [](const RecorderStatistics& stats) { return Integer(static_cast<Int>(stats.packetsDropped)); });
+
+    addStatisticProperty(
+        IntPropertyBuilder(Props::MEMORY_USED, 0).setReadOnly(true).setUnit(Unit("B")).build(),
+        [](const RecorderStatistics& stats) { return Integer(static_cast<Int>(stats.memoryUsed)); });
+
+    addStatisticProperty(
+        FloatPropertyBuilder(Props::WRITE_LATENCY_P50, 0.0).setReadOnly(true).setUnit(Unit("us")).build(),
+        [](const RecorderStatistics& stats) { return Floating(stats.latencyP50.count() / 1000.0); });
+
+    addStatisticProperty(
+        FloatPropertyBuilder(Props::WRITE_LATENCY_P99, 0.0).setReadOnly(true).setUnit(Unit("us")).build(),
+        [](const RecorderStatistics& stats) { return Floating(stats.latencyP99.count() / 1000.0); });
+
+    addStatisticProperty(
+        FloatPropertyBuilder(Props::WRITE_LATENCY_MAX, 0.0).setReadOnly(true).setUnit(Unit("us")).build(),
+        [](const RecorderStatistics& stats) { return Floating(stats.latencyMax.count() / 1000.0); });
+
+    addStatisticProperty(
+        IntPropertyBuilder(Props::BYTES_COMMITTED, 0).setReadOnly(true).setUnit(Unit("B")).build(),
+        [](const RecorderStatistics& stats) { return Integer(static_cast<Int>(stats.bytesCommitted)); });
+
+    addStatisticProperty(
+        IntPropertyBuilder(Props::COMMITS, 0).setReadOnly(true).build(),
+        [](const RecorderStatistics& stats) { return Integer(static_cast<Int>(stats.commits)); });
+
+    addStatisticProperty(
+        FloatPropertyBuilder(Props::COMMIT_LATENCY_P50, 0.0).setReadOnly(true).setUnit(Unit("us")).build(),
+        [](const RecorderStatistics& stats) { return Floating(stats.commitLatencyP50.count() / 1000.0); });
+
+    addStatisticProperty(
+        FloatPropertyBuilder(Props::COMMIT_LATENCY_P99, 0.0).setReadOnly(true).setUnit(Unit("us")).build(),
+        [](const RecorderStatistics& stats) { return Floating(stats.commitLatencyP99.count() / 1000.0); });
+
+    addStatisticProperty(
+        FloatPropertyBuilder(Props::COMMIT_LATENCY_MAX, 0.0).setReadOnly(true).setUnit(Unit("us")).build(),
+        [](const RecorderStatistics& stats) { return Floating(stats.commitLatencyMax.count() / 1000.0); });
+
+    addStatisticProperty(
+        DictPropertyBuilder(Props::PACKET_COUNTS, Dict<IString, IInteger>()).setReadOnly(true).build(),
+        [](const RecorderStatistics& stats)
+        {
+            auto counts = Dict<IString, IInteger>();
+            for (const auto& [id, count] : stats.packetCounts)
+                counts.set(id, static_cast<Int>(count));
+            return counts;
+        });
+}
+
+void AdvancedRecorderImpl::addStatisticProperty(
+    const PropertyPtr& property,
+    std::function<BaseObjectPtr(const RecorderStatistics&)> get)
+{
+    objPtr.addProperty(property);
+    objPtr.getOnPropertyValueRead(property.getName()) +=
+        [this, get](PropertyObjectPtr&, PropertyValueEventArgsPtr& args)
+        {
+            auto thread = std::atomic_load(&writerThread);
+            args.setValue(get(thread ? thread->getStatistics() : RecorderStatistics()));
+        };
 }
 
 void AdvancedRecorderImpl::addInputPort()
 {
-    createAndAddInputPort("Value" + std::to_string(++portCount), PacketReadyNotification::SameThread);
+    createAndAddInputPort("Value" + std::to_string(++portCount), readNotificationMethod());
+}
+
+PacketReadyNotification AdvancedRecorderImpl::readNotificationMethod()
+{
+    Int mode = objPtr.getPropertyValue(Props::PACKET_NOTIFICATION);
+    return mode == 1
+        ? PacketReadyNotification::Scheduler
+        : PacketReadyNotification::SameThread;
+}
+
+void AdvancedRecorderImpl::updateNotificationMethod()
+{
+    auto lock = getRecursiveConfigLock();
+
+    auto method = readNotificationMethod();
+    for (const auto& inputPort : borrowPtr<FunctionBlockPtr>().getInputPorts())
+        inputPort.template asPtr<IInputPortConfig>().setNotificationMethod(method);
+
+    publishSnapshot();
+}
+
+void AdvancedRecorderImpl::readSettings(std::shared_ptr<MemoryBudget> budget)
+{
+    Int blockSize = objPtr.getPropertyValue(Props::BLOCK_SIZE);
+    Int maxBlockLatency = objPtr.getPropertyValue(Props::MAX_BLOCK_LATENCY);
+    bool hugePages = objPtr.getPropertyValue(Props::HUGE_PAGES);
+    bool compress = objPtr.getPropertyValue(Props::COMPRESS);
+
+    settings.blockSize = static_cast<std::size_t>(blockSize);
+    settings.maxBlockLatency = std::chrono::milliseconds(maxBlockLatency);
+    settings.compress = compress;
+
+    // Handlers of a previous recording may still hold buffers; they keep the old pool alive.
+    settings.pool = settings.blockSize
+        ? std::make_shared<BlockPool>(settings.blockSize, std::move(budget), hugePages)
+        : nullptr;
+}
+
+RotationPolicy AdvancedRecorderImpl::readRotationPolicy()
+{
+    Int maxSize = objPtr.getPropertyValue(Props::SEGMENT_MAX_SIZE);
+    Int maxDuration = objPtr.getPropertyValue(Props::SEGMENT_MAX_DURATION);
+    Int boundary = objPtr.getPropertyValue(Props::SEGMENT_BOUNDARY);
+
+    RotationPolicy policy;
+    policy.maxBytes = static_cast<std::uint64_t>(maxSize);
+    policy.maxDuration = std::chrono::seconds(maxDuration);
+    policy.boundary = std::chrono::seconds(boundary);
+    return policy;
+}
+
+TriggerSettings AdvancedRecorderImpl::readTriggerSettings()
+{
+    Int mode = objPtr.getPropertyValue(Props::TRIGGER_MODE);
+    Int preTrigger = objPtr.getPropertyValue(Props::PRE_TRIGGER_TIME);
+    Int postTrigger = objPtr.getPropertyValue(Props::POST_TRIGGER_TIME);
+
+    TriggerSettings trigger;
+    trigger.enabled = mode == 1;
+    trigger.preTrigger = std::chrono::milliseconds(preTrigger);
+    trigger.postTrigger = std::chrono::milliseconds(postTrigger);
+    return trigger;
+}
+
+DurabilityPolicy AdvancedRecorderImpl::readDurabilityPolicy()
+{
+    Int mode = objPtr.getPropertyValue(Props::DURABILITY_MODE);
+    Int interval = objPtr.getPropertyValue(Props::SYNC_INTERVAL);
+    Int size = objPtr.getPropertyValue(Props::SYNC_SIZE);
+
+    DurabilityPolicy durability;
+    durability.mode = mode == 2 ? DurabilityMode::GroupCommit
+        : mode == 1 ? DurabilityMode::Periodic
+        : DurabilityMode::None;
+    durability.interval = std::chrono::milliseconds(interval);
+    durability.bytes = static_cast<std::uint64_t>(size);
+    return durability;
+}
+
+BackpressureSettings AdvancedRecorderImpl::readBackpressureSettings()
+{
+    Int budget = objPtr.getPropertyValue(Props::MEMORY_BUDGET);
+    Int policy = objPtr.getPropertyValue(Props::BACKPRESSURE);
+
+    BackpressureSettings backpressure;
+    backpressure.policy = policy == 2 ? BackpressurePolicy::DropOldest
+        : policy == 1 ? BackpressurePolicy::DropNewest
+        : BackpressurePolicy::Block;
+    backpressure.budget = std::make_shared<MemoryBudget>(static_cast<std::size_t>(budget));
+    return backpressure;
 }
 
 void AdvancedRecorderImpl::reconfigure()
 {
     std::string filename = static_cast<std::string>(objPtr.getPropertyValue(Props::FILENAME));
 
+    bool appendTests = objPtr.getPropertyValue(Props::APPEND_TESTS);
+
     if (recordingActive)
     {
         // Open and initialize the output file, if we haven't already.
-        if (!writer)
+        if (!std::atomic_load(&writerThread))
         {
-            writer = std::make_shared<hbk::sie::writer>(
-                hbk::sie::indexed_writer(
-                    hbk::sie::block_writer(
-                        hbk::sie::vector_io_file(
-                            filename))));
-
-            auto test = hbk::sie::xml::element("test")
-                .add_attribute("id", std::to_string(0));
-
-            std::ostringstream os;
-            os << hbk::sie::PREAMBLE;
-            test.serialize(os, 1);
-
-            writer->write_metadata(os.str());
+            auto backend = ioBackendFromSelection(objPtr.getPropertyValue(Props::IO_BACKEND));
+            auto rotation = readRotationPolicy();
+            std::string pattern = static_cast<std::string>(objPtr.getPropertyValue(Props::SEGMENT_FILENAME));
+            Int indexInterval = objPtr.getPropertyValue(Props::INDEX_INTERVAL);
+            auto indexEvery = static_cast<std::size_t>(indexInterval);
+
+            // Only compressed blocks go through the pipeline, so it is not worth its threads
+            // otherwise.
+            bool compress = objPtr.getPropertyValue(Props::COMPRESS);
+            Int threads = objPtr.getPropertyValue(Props::COMPRESSION_THREADS);
+            Int inFlight = objPtr.getPropertyValue(Props::COMPRESSION_IN_FLIGHT);
+            auto compressionThreads = compress ? static_cast<unsigned>(threads) : 0u;
+            auto compressionInFlight = static_cast<std::size_t>(inFlight);
+
+            auto segment = openSegment(
+                rotation.enabled() ? formatSegmentFilename(pattern, filename, 0) : filename,
+                backend,
+                indexEvery,
+                compressionThreads,
+                compressionInFlight);
+
+            // Subsequent segments are opened by a helper thread, so capture everything by value.
+            SegmentFactory factory = [filename, pattern, backend, indexEvery, compressionThreads, compressionInFlight](unsigned sequence)
+            {
+                return openSegment(
+                    formatSegmentFilename(pattern, filename, sequence),
+                    backend,
+                    indexEvery,
+                    compressionThreads,
+                    compressionInFlight);
+            };
+
+            auto backpressure = readBackpressureSettings();
+            readSettings(backpressure.budget);
+
+            // Tick often enough that no merged block is held much longer than the latency limit.
+            auto tickInterval = std::clamp(
+                settings.maxBlockLatency / 4,
+                std::chrono::milliseconds(1),
+                std::chrono::milliseconds(100));
+
+            Int capacity = objPtr.getPropertyValue(Props::QUEUE_CAPACITY);
+            std::atomic_store(&writerThread, std::make_shared<WriterThread>(
+                std::move(segment),
+                static_cast<std::size_t>(capacity),
+                tickInterval,
+                rotation,
+                std::move(factory),
+                readTriggerSettings(),
+                readDurabilityPolicy(),
+                std::move(backpressure)));
+
+            openFilename = filename;
+            testId = 0;
         }
 
+        // In triggered mode, the signal on the selected input port is the level trigger source.
+        Int mode = objPtr.getPropertyValue(Props::TRIGGER_MODE);
+        Int triggerInput = objPtr.getPropertyValue(Props::TRIGGER_INPUT);
+        std::string triggerPort = mode == 1 && triggerInput > 0
+            ? "Value" + std::to_string(triggerInput)
+            : std::string();
+
         // We will update the 'signals' map by emplacing new AdvancedRecorderSignal objects for
         // newly-connected input ports, and destroying AdvancedRecorderSignal objects for ports
         // that are gone or no longer connected. Notably, we will not disturb
@@ -171,19 +666,32 @@ void AdvancedRecorderImpl::reconfigure()
                 // If we don't yet have an AdvancedRecorderSignal for this port, create one.
                 auto it = signals.find(inputPort.getObject());
                 if (it == signals.end())
-                    signals.emplace(
-                        inputPort.getObject(),
-                        std::make_shared<AdvancedRecorderSignal>(signal, writer, 0));
+                {
+                    auto recorderSignal = std::make_shared<AdvancedRecorderSignal>(signal, testId, settings);
+
+                    if (!triggerPort.empty() && inputPort.getLocalId() == triggerPort)
+                    {
+                        Float level = objPtr.getPropertyValue(Props::TRIGGER_LEVEL);
+                        Int slope = objPtr.getPropertyValue(Props::TRIGGER_SLOPE);
+                        recorderSignal->setLevelTrigger(LevelDetector(level, static_cast<TriggerSlope>(slope)));
+                    }
+
+                    signals.emplace(inputPort.getObject(), std::move(recorderSignal));
+                }
             }
         }
 
         // Now make another pass, and destroy AdvancedRecorderSignal
-        // objects for ports that are gone or no longer connected.
+        // objects for ports that are gone or no longer connected. The writer thread holds on to
+        // them until it has written out everything they have accumulated.
+        std::vector<std::shared_ptr<AdvancedRecorderSignal>> retired;
         decltype(signals)::iterator it = signals.begin();
         while (it != signals.end())
         {
             if (ports.find(it->first) == ports.end())
             {
+                retired.push_back(std::move(it->second));
+
                 auto jt = it;
                 ++jt;
                 signals.erase(it);
@@ -195,23 +703,98 @@ void AdvancedRecorderImpl::reconfigure()
                 ++it;
             }
         }
+
+        // Stop acquisition threads from queuing packets for the retired signals before retiring
+        // them. (A thread still using the previous snapshot may queue a few more; the writer
+        // thread then simply keeps the signal until it is stopped.)
+        publishSnapshot();
+
+        if (auto thread = std::atomic_load(&writerThread))
+            for (auto& signal : retired)
+                thread->retire(std::move(signal));
     }
 
-    else
+    // A stopped recording can leave the file open for another test, as long as it is still the
+    // file we are supposed to write.
+    else if (auto thread = std::atomic_load(&writerThread); thread && active && appendTests && filename == openFilename)
     {
+        // End the current test but keep the file open. The writer thread writes out whatever
+        // the signals have accumulated, and the next start records new channels (reusing their
+        // decoders) under the next test id.
+        auto retired = std::move(signals);
         signals.clear();
-        writer.reset();
+        publishSnapshot();
+
+        if (!retired.empty())
+        {
+            for (const auto& entry : retired)
+                thread->retire(entry.second);
+
+            ++testId;
+        }
     }
+
+    else
+        closeFile();
+}
+
+void AdvancedRecorderImpl::closeFile()
+{
+    // Detach the writer thread from the acquisition threads first, then let it finish writing
+    // whatever is still queued before the file is closed.
+    auto thread = std::atomic_exchange(&writerThread, std::shared_ptr<WriterThread>());
+
+    signals.clear();
+    openFilename.clear();
+    publishSnapshot();
+
+    // Stopping the thread also releases acquisition threads waiting for room in its queue, so
+    // that the snapshots they are reading can be reclaimed.
+    if (thread)
+        thread->stop();
+
+    reclaimSnapshots();
 }
 
-std::shared_ptr<AdvancedRecorderSignal> AdvancedRecorderImpl::findSignal(IInputPort *port)
+void AdvancedRecorderImpl::publishSnapshot()
 {
-    std::shared_ptr<AdvancedRecorderSignal> signal;
-    auto lock = getAcquisitionLock();
-    auto it = signals.find(port);
-    if (it != signals.end())
-        signal = it->second;
-    return signal;
+    auto next = std::make_unique<Snapshot>();
+    next->writerThread = std::atomic_load(&writerThread);
+    next->drainAll = readNotificationMethod() == PacketReadyNotification::Scheduler;
+
+    // Every connected port is listed, so that packets of ports which are not being recorded
+    // are drained (and discarded) as well.
+    for (const auto& inputPort : borrowPtr<FunctionBlockPtr>().getInputPorts())
+    {
+        auto connection = inputPort.getConnection();
+        if (!connection.assigned())
+            continue;
+
+        auto& source = next->sources[inputPort.getObject()];
+        source.connection = connection;
+        if (auto it = signals.find(inputPort.getObject()); it != signals.end())
+            source.signal = it->second;
+    }
+
+    // Acquisition threads may still be reading the previous snapshot, so it is kept until the
+    // recording is closed.
+    snapshots.push_back(std::move(next));
+    snapshot.store(snapshots.back().get());
+}
+
+/*!
+ * @brief Frees every snapshot but the current one, once no acquisition thread can be reading
+ *     them any more. This is only done when the recording is closed, so that waiting for the
+ *     readers never holds up a reconfiguration.
+ */
+void AdvancedRecorderImpl::reclaimSnapshots()
+{
+    // Readers which start after this see the current snapshot, and each reader only holds a
+    // snapshot for the duration of one notification.
+    while (snapshotReaders.load() != 0)
+        std::this_thread::yield();
+
+    snapshots.erase(snapshots.begin(), snapshots.end() - 1);
 }
 
 END_NAMESPACE_ADVANCED_RECORDER_MODULE
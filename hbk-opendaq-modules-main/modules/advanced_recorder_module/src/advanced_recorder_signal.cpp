@@ -1,6 +1,10 @@
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
 #include <exception>
 #include <iostream>
 #include <memory>
+#include <string>
 #include <utility>
 
 #include <opendaq/opendaq.h>
@@ -8,6 +12,8 @@
 #include <advanced_recorder_module/advanced_recorder_signal.h>
 #include <advanced_recorder_module/common.h>
 #include <advanced_recorder_module/handlers/can_signal_handler.h>
+#include <advanced_recorder_module/handlers/multi_dimensional_signal_handler.h>
+#include <advanced_recorder_module/handlers/scalar_explicit_signal_handler.h>
 #include <advanced_recorder_module/handlers/scalar_linear_signal_handler.h>
 #include <advanced_recorder_module/sie/writer.h>
 
@@ -17,14 +23,118 @@ BEGIN_NAMESPACE_ADVANCED_RECORDER_MODULE
 
 AdvancedRecorderSignal::AdvancedRecorderSignal(
         const SignalPtr& signal,
-        std::shared_ptr<hbk::sie::writer> writer,
-        unsigned testId)
+        unsigned testId,
+        const RecorderSettings& settings)
     : signal(signal)
-    , writer(std::move(writer))
+    , globalId(signal.getGlobalId().toStdString())
     , testId(testId)
+    , settings(settings)
 {
 }
 
+AdvancedRecorderSignal::~AdvancedRecorderSignal()
+{
+    while (!history.empty())
+        discardOldest();
+}
+
+const std::string& AdvancedRecorderSignal::getGlobalId() const noexcept
+{
+    return globalId;
+}
+
+const std::shared_ptr<hbk::sie::writer>& AdvancedRecorderSignal::getWriter() const noexcept
+{
+    return writer;
+}
+
+void AdvancedRecorderSignal::setWriter(std::shared_ptr<hbk::sie::writer> writer)
+{
+    switchWriter(std::move(writer), nullptr, {});
+}
+
+void AdvancedRecorderSignal::switchWriter(
+    std::shared_ptr<hbk::sie::writer> writer,
+    std::unique_ptr<SignalHandler> handler,
+    const Descriptors& descriptors)
+{
+    // Write out anything the old handler accumulated, to the old file, before it is destroyed.
+    flush();
+
+    // Destroy the old handler before releasing the writer it refers to.
+    this->handler = std::move(handler);
+    this->writer = std::move(writer);
+
+    lastValueDescriptor = this->handler ? descriptors.value : nullptr;
+    lastDomainDescriptor = this->handler ? descriptors.domain : nullptr;
+}
+
+AdvancedRecorderSignal::Descriptors AdvancedRecorderSignal::getDescriptors() const
+{
+    return { lastValueDescriptor, lastDomainDescriptor };
+}
+
+std::unique_ptr<SignalHandler> AdvancedRecorderSignal::createHandler(
+    hbk::sie::writer& writer,
+    const Descriptors& descriptors) const
+{
+    const auto& valueDescriptor = descriptors.value;
+    const auto& domainDescriptor = descriptors.domain;
+
+    try
+    {
+        if (ScalarLinearSignalHandler::supports(signal, valueDescriptor, domainDescriptor))
+            return std::make_unique<ScalarLinearSignalHandler>(
+                writer,
+                testId,
+                settings,
+                signal,
+                valueDescriptor,
+                domainDescriptor);
+
+        else if (MultiDimensionalSignalHandler::supports(signal, valueDescriptor, domainDescriptor))
+            return std::make_unique<MultiDimensionalSignalHandler>(
+                writer,
+                testId,
+                signal,
+                valueDescriptor,
+                domainDescriptor);
+
+        else if (ScalarExplicitSignalHandler::supports(signal, valueDescriptor, domainDescriptor))
+            return std::make_unique<ScalarExplicitSignalHandler>(
+                writer,
+                testId,
+                signal,
+                valueDescriptor,
+                domainDescriptor);
+
+        else if (CanSignalHandler::supports(signal, valueDescriptor, domainDescriptor))
+            return std::make_unique<CanSignalHandler>(
+                writer,
+                testId,
+                signal,
+                valueDescriptor,
+                domainDescriptor);
+
+        else
+        {
+            std::cerr << "[advanced-recorder] No suitable SIE signal handler found for '" << signal.getGlobalId() << "'." << std::endl;
+            std::cerr << "[advanced-recorder] Its value descriptor is:" << std::endl;
+            hbk::opendaq::printDescriptor(std::cerr, valueDescriptor, "    ");
+            std::cerr << "[advanced-recorder] Its domain descriptor is:" << std::endl;
+            hbk::opendaq::printDescriptor(std::cerr, domainDescriptor, "    ");
+        }
+    }
+
+    catch (const std::exception& ex)
+    {
+        // XXX TODO
+        std::cerr << "[advanced-recorder] failed to create handler for signal: " << ex.what() << std::endl;
+    }
+
+    return nullptr;
+}
+
 void AdvancedRecorderSignal::onPacketReceived(const PacketPtr& packet)
 {
     switch (packet.getType())
@@ -48,49 +158,127 @@ void AdvancedRecorderSignal::onDataPacketReceived(DataPacketPtr packet)
 
     if (valueDescriptor != lastValueDescriptor || domainDescriptor != lastDomainDescriptor)
     {
+        // Write out anything the old handler accumulated before it is destroyed.
+        flush();
         handler.reset();
 
         lastValueDescriptor = valueDescriptor;
         lastDomainDescriptor = domainDescriptor;
 
-        try
-        {
-            if (ScalarLinearSignalHandler::supports(signal, valueDescriptor, domainDescriptor))
-                handler = std::make_unique<ScalarLinearSignalHandler>(
-                    *writer,
-                    testId,
-                    signal,
-                    valueDescriptor,
-                    domainDescriptor);
-
-            else if (CanSignalHandler::supports(signal, valueDescriptor, domainDescriptor))
-                handler = std::make_unique<CanSignalHandler>(
-                    *writer,
-                    testId,
-                    signal,
-                    valueDescriptor,
-                    domainDescriptor);
-
-            else
-            {
-                std::cerr << "[advanced-recorder] No suitable SIE signal handler found for '" << signal.getGlobalId() << "'." << std::endl;
-                std::cerr << "[advanced-recorder] Its value descriptor is:" << std::endl;
-                hbk::opendaq::printDescriptor(std::cerr, valueDescriptor, "    ");
-                std::cerr << "[advanced-recorder] Its domain descriptor is:" << std::endl;
-                hbk::opendaq::printDescriptor(std::cerr, domainDescriptor, "    ");
-            }
-        }
-
-        catch (const std::exception& ex)
-        {
-            // XXX TODO
-            std::cerr << "[advanced-recorder] failed to create handler for signal: " << ex.what() << std::endl;
-            handler.reset();
-        }
+        if (writer)
+            handler = createHandler(*writer, { valueDescriptor, domainDescriptor });
     }
 
     if (handler)
         handler->onDataPacketReceived(packet);
 }
 
+void AdvancedRecorderSignal::setLevelTrigger(const LevelDetector& detector)
+{
+    levelDetector = detector;
+}
+
+bool AdvancedRecorderSignal::detectTrigger(const PacketPtr& packet)
+{
+    if (!levelDetector || packet.getType() != PacketType::Data)
+        return false;
+
+    DataPacketPtr dataPacket = packet;
+    auto descriptor = dataPacket.getDataDescriptor();
+
+    auto dimensions = descriptor.getDimensions();
+    if (dimensions.assigned() && dimensions.getCount() > 0)
+        return false;
+
+    // getData() applies any post-scaling, so the values have the descriptor's sample type.
+    const void *data = dataPacket.getData();
+    std::size_t count = dataPacket.getSampleCount();
+    auto& detector = *levelDetector;
+
+    switch (descriptor.getSampleType())
+    {
+        case SampleType::Float32: return detector.process(static_cast<const float *>(data), count);
+        case SampleType::Float64: return detector.process(static_cast<const double *>(data), count);
+        case SampleType::UInt8: return detector.process(static_cast<const std::uint8_t *>(data), count);
+        case SampleType::Int8: return detector.process(static_cast<const std::int8_t *>(data), count);
+        case SampleType::UInt16: return detector.process(static_cast<const std::uint16_t *>(data), count);
+        case SampleType::Int16: return detector.process(static_cast<const std::int16_t *>(data), count);
+        case SampleType::UInt32: return detector.process(static_cast<const std::uint32_t *>(data), count);
+        case SampleType::Int32: return detector.process(static_cast<const std::int32_t *>(data), count);
+        case SampleType::UInt64: return detector.process(static_cast<const std::uint64_t *>(data), count);
+        case SampleType::Int64: return detector.process(static_cast<const std::int64_t *>(data), count);
+        default: return false;
+    }
+}
+
+void AdvancedRecorderSignal::hold(
+    const PacketPtr& packet,
+    std::size_t charge,
+    const std::shared_ptr<MemoryBudget>& budget,
+    std::chrono::steady_clock::time_point now,
+    std::optional<DomainTime> domainTime,
+    std::chrono::milliseconds preTrigger)
+{
+    if (!historyBudget)
+        historyBudget = budget;
+
+    history.push_back({ now, domainTime, packet, charge });
+
+    while (!history.empty())
+    {
+        const auto& oldest = history.front();
+        bool expired = domainTime && oldest.domainTime
+            ? *domainTime - *oldest.domainTime > preTrigger
+            : now - oldest.received > preTrigger;
+
+        if (!expired)
+            break;
+        discardOldest();
+    }
+
+    trimHistory();
+}
+
+void AdvancedRecorderSignal::trimHistory() noexcept
+{
+    if (!historyBudget || !historyBudget->limit())
+        return;
+
+    auto ceiling = static_cast<std::size_t>(historyBudget->limit() * HISTORY_SHARE);
+    while (!history.empty() && historyBudget->used() > ceiling)
+        discardOldest();
+}
+
+void AdvancedRecorderSignal::discardOldest() noexcept
+{
+    historyBudget->release(history.front().charge);
+    history.pop_front();
+}
+
+void AdvancedRecorderSignal::release()
+{
+    // Take the history first so that it is cleared even if recording a packet throws. The
+    // packets are being recorded now, so their charges are no longer needed.
+    auto packets = std::move(history);
+    history.clear();
+
+    for (const auto& held : packets)
+        historyBudget->release(held.charge);
+
+    for (const auto& held : packets)
+        onPacketReceived(held.packet);
+}
+
+void AdvancedRecorderSignal::flush()
+{
+    if (handler)
+        handler->flush();
+}
+
+void AdvancedRecorderSignal::onTick(std::chrono::steady_clock::time_point now)
+{
+    if (handler)
+        handler->onTick(now);
+}
+
 END_NAMESPACE_ADVANCED_RECORDER_MODULE
@@ -0,0 +1,133 @@
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <advanced_recorder_module/commit_thread.h>
+#include <advanced_recorder_module/common.h>
+#include <advanced_recorder_module/sie/sync_handle.h>
+
+BEGIN_NAMESPACE_ADVANCED_RECORDER_MODULE
+
+CommitThread::CommitThread()
+    : thread(&CommitThread::run, this)
+{
+}
+
+CommitThread::~CommitThread()
+{
+    stop();
+}
+
+void CommitThread::stop()
+{
+    if (!thread.joinable())
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopRequested = true;
+    }
+
+    cv.notify_one();
+    thread.join();
+}
+
+void CommitThread::request(hbk::sie::sync_handle handle, std::uint64_t position)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        if (stopRequested)
+            return;
+
+        if (handles.empty())
+            firstRequested = std::chrono::steady_clock::now();
+
+        // Each file is synced once per commit, however often it was requested.
+        if (std::find(handles.begin(), handles.end(), handle) == handles.end())
+            handles.push_back(std::move(handle));
+
+        requestedPosition = std::max(requestedPosition, position);
+    }
+
+    cv.notify_one();
+}
+
+bool CommitThread::pending() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return !handles.empty();
+}
+
+CommitStatistics CommitThread::collectStatistics()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    CommitStatistics result;
+    result.commits = commits;
+    result.bytesCommitted = committedPosition;
+
+    if (latency.max() > latencyMax)
+        latencyMax = latency.max();
+
+    result.latencyP50 = latency.percentile(0.5);
+    result.latencyP99 = latency.percentile(0.99);
+    result.latencyMax = latencyMax;
+    latency.reset();
+
+    return result;
+}
+
+void CommitThread::run()
+{
+    std::vector<hbk::sie::sync_handle> batch;
+
+    std::unique_lock<std::mutex> lock(mutex);
+
+    for (;;)
+    {
+        cv.wait(lock, [this] { return stopRequested || !handles.empty(); });
+
+        if (handles.empty())
+            break;
+
+        batch.swap(handles);
+        auto position = requestedPosition;
+        auto requested = firstRequested;
+
+        lock.unlock();
+
+        bool succeeded = true;
+        for (const auto& handle : batch)
+        {
+            try
+            {
+                handle.sync();
+            }
+
+            catch (const std::exception& ex)
+            {
+                std::cerr << "[advanced-recorder] failed to sync file: " << ex.what() << std::endl;
+                succeeded = false;
+            }
+        }
+
+        // Release the handles outside the lock; the last one to a closed file closes it.
+        batch.clear();
+        auto completed = std::chrono::steady_clock::now();
+
+        lock.lock();
+
+        ++commits;
+        latency.record(completed - requested);
+        if (succeeded)
+            committedPosition = std::max(committedPosition, position);
+    }
+}
+
+END_NAMESPACE_ADVANCED_RECORDER_MODULE
@@ -3,6 +3,7 @@
 #include <cstring>
 #include <iostream>
 #include <limits>
+#include <memory>
 #include <string>
 
 #include <opendaq/opendaq.h>
@@ -74,22 +75,8 @@ CanSignalHandler::CanSignalHandler(
     : writer(writer)
     , group(writer.allocate_group())
 {
-    unsigned decoderId = writer.allocate_decoder();
     unsigned channelId = writer.allocate_channel();
 
-    auto dim0 = hbk::sie::dimension(0)
-        .add_child(tickResolutionToTransform(domainDescriptor))
-        .add_child(hbk::sie::data(decoderId, 0));
-
-    if (auto unit = domainDescriptor.getUnit(); unit.assigned())
-        dim0.add_child(hbk::sie::units(unit.getName()));
-    auto channel = hbk::sie::channel(channelId, group, valueDescriptor.getName())
-        .add_child(hbk::sie::tag("core:description", "Raw CAN messages"))
-        .add_child(hbk::sie::tag("data_type", "message_can"))
-        .add_child(hbk::sie::tag("somat:datamode_type", "message_log"))
-        .add_child(hbk::sie::tag("core:schema", "somat:message"))
-        .add_child(std::move(dim0));
-
     auto [type, bits] = sampleTypeToSieReadType(domainDescriptor);
     unsigned bytes = bits / 8;
 
@@ -103,10 +90,6 @@ CanSignalHandler::CanSignalHandler(
     unsigned dimIndex = 1;
     for (const auto& field : valueDescriptor.getStructFields())
     {
-        auto dim = hbk::sie::dimension(dimIndex)
-            .add_child(hbk::sie::tag("openDAQ:fieldName", field.getName()))
-            .add_child(hbk::sie::data(decoderId, dimIndex));
-
         if ((field.getSampleType() == SampleType::Int8 || field.getSampleType() == SampleType::UInt8)
                 && field.getDimensions().assigned()
                 && field.getDimensions().getCount() == 1
@@ -122,8 +105,6 @@ CanSignalHandler::CanSignalHandler(
             loop.add_child(hbk::sie::read("v" + std::to_string(dimIndex), fieldType, size));
         }
 
-        channel.add_child(std::move(dim));
-
         ++dimIndex;
     }
 
@@ -131,18 +112,51 @@ CanSignalHandler::CanSignalHandler(
         .add_child(hbk::sie::sample())
         .add_child(hbk::sie::seek("start", "{" + std::to_string(sizeof(std::uint32_t) + bytes) + " + (" + std::to_string(bytes) + " * $i)}"));
 
+    auto makeDecoder = [&](unsigned id)
+    {
+        return hbk::sie::decoder(id)
+            .add_child(hbk::sie::read("n", "uint", 32))
+            .add_child(hbk::sie::xml::element(loop));
+    };
+
+    // CAN signals with the same message structure share a decoder, as do the channels of
+    // successive tests recording the same signal.
+    std::string definition;
+    makeDecoder(0).serialize(definition);
+    auto [decoderId, newDecoder] = writer.intern_decoder(definition);
+
+    auto dim0 = hbk::sie::dimension(0)
+        .add_child(tickResolutionToTransform(domainDescriptor))
+        .add_child(hbk::sie::data(decoderId, 0));
+
+    if (auto unit = domainDescriptor.getUnit(); unit.assigned())
+        dim0.add_child(hbk::sie::units(unit.getName()));
+    auto channel = hbk::sie::channel(channelId, group, valueDescriptor.getName())
+        .add_child(hbk::sie::tag("core:description", "Raw CAN messages"))
+        .add_child(hbk::sie::tag("data_type", "message_can"))
+        .add_child(hbk::sie::tag("somat:datamode_type", "message_log"))
+        .add_child(hbk::sie::tag("core:schema", "somat:message"))
+        .add_child(std::move(dim0));
+
+    dimIndex = 1;
+    for (const auto& field : valueDescriptor.getStructFields())
+    {
+        channel.add_child(hbk::sie::dimension(dimIndex)
+            .add_child(hbk::sie::tag("openDAQ:fieldName", field.getName()))
+            .add_child(hbk::sie::data(decoderId, dimIndex)));
+
+        ++dimIndex;
+    }
+
     auto test = hbk::sie::test(testId)
         .add_child(std::move(channel));
 
-    auto decoder = hbk::sie::decoder(decoderId)
-        .add_child(hbk::sie::read("n", "uint", 32))
-        .add_child(std::move(loop));
+    std::string xml;
+    if (newDecoder)
+        makeDecoder(decoderId).serialize(xml, 1);
+    test.serialize(xml, 1);
 
-    std::ostringstream os;
-    decoder.serialize(os, 1);
-    test.serialize(os, 1);
-
-    writer.write_metadata(os.str());
+    writer.write_metadata(xml);
 }
 
 void CanSignalHandler::onDataPacketReceived(const DataPacketPtr& packet)
@@ -167,8 +181,20 @@ void CanSignalHandler::onDataPacketReceived(const DataPacketPtr& packet)
     if (domainPacket.getRawDataSize() < N * sizeof(std::int64_t))
         return;
 
-    writer.write_block(group,
-        &N,                         sizeof(N),
+    if (N == 0)
+        return;
+
+    auto timestamps = static_cast<const std::int64_t *>(domainPacket.getRawData());
+
+    // The message count is written in front of the timestamps and messages.
+    auto retained = retainPacket(N, packet);
+    auto& prefix = retained->prefix;
+
+    writer.write_timed_block_retained(group,
+        timestamps[0],
+        timestamps[N - 1],
+        std::move(retained),
+        &prefix,                    sizeof(prefix),
         domainPacket.getRawData(),  domainPacket.getRawDataSize(),
         packet.getRawData(),        packet.getRawDataSize());
 }
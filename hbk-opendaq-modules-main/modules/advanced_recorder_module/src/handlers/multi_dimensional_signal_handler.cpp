@@ -0,0 +1,222 @@
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include <boost/uuid/random_generator.hpp>
+#include <boost/uuid/uuid_io.hpp>
+
+#include <opendaq/opendaq.h>
+
+#include <advanced_recorder_module/common.h>
+#include <advanced_recorder_module/metadata.h>
+#include <advanced_recorder_module/handlers/multi_dimensional_signal_handler.h>
+#include <advanced_recorder_module/sie/writer.h>
+#include <advanced_recorder_module/sie/xml.h>
+
+BEGIN_NAMESPACE_ADVANCED_RECORDER_MODULE
+
+bool MultiDimensionalSignalHandler::supports(
+    const SignalPtr& signal,
+    const DataDescriptorPtr& valueDescriptor,
+    const DataDescriptorPtr& domainDescriptor)
+{
+    // The domain must be linear-rule.
+    auto domainRule = domainDescriptor.getRule();
+    if (!domainRule.assigned() || domainRule.getType() != DataRuleType::Linear)
+        return false;
+
+    // The value must be explicit-rule.
+    auto valueRule = valueDescriptor.getRule();
+    if (!valueRule.assigned() || valueRule.getType() != DataRuleType::Explicit)
+        return false;
+
+    // The value must be a scalar type.
+    auto type = valueDescriptor.getSampleType();
+    if (type != SampleType::Float32 &&
+        type != SampleType::Float64 &&
+        type != SampleType::UInt8 &&
+        type != SampleType::Int8 &&
+        type != SampleType::UInt16 &&
+        type != SampleType::Int16 &&
+        type != SampleType::UInt32 &&
+        type != SampleType::Int32 &&
+        type != SampleType::UInt64 &&
+        type != SampleType::Int64)
+        return false;
+
+    // The value must have one or two non-empty linear-rule dimensions.
+    auto dimensions = valueDescriptor.getDimensions();
+    if (!dimensions.assigned() || dimensions.getCount() < 1 || dimensions.getCount() > 2)
+        return false;
+
+    for (const auto& dimension : dimensions)
+    {
+        auto rule = dimension.getRule();
+        if (!rule.assigned() || rule.getType() != DimensionRuleType::Linear)
+            return false;
+        if (dimension.getSize() == 0)
+            return false;
+    }
+
+    return true;
+}
+
+MultiDimensionalSignalHandler::MultiDimensionalSignalHandler(
+        hbk::sie::writer& writer,
+        unsigned testId,
+        const SignalPtr& signal,
+        const DataDescriptorPtr& valueDescriptor,
+        const DataDescriptorPtr& domainDescriptor)
+    : writer(writer)
+    , group(writer.allocate_group())
+{
+    unsigned channelId = writer.allocate_channel();
+
+    auto [start, delta] = getLinearRuleStartDelta(domainDescriptor);
+    this->start = start;
+    this->delta = delta;
+    auto [type, bits] = sampleTypeToSieReadType(valueDescriptor);
+
+    double resolution = 1;
+    if (auto tickResolution = domainDescriptor.getTickResolution(); tickResolution.assigned())
+        resolution = static_cast<double>(tickResolution.getNumerator())
+            / static_cast<double>(tickResolution.getDenominator());
+    double sampleRate = 1.0 / resolution / delta;
+
+    auto dimensions = valueDescriptor.getDimensions();
+    unsigned valueIndex = static_cast<unsigned>(dimensions.getCount()) + 1;
+
+    // Nest one loop per dimension, the last (fastest-varying in memory) innermost. The loops
+    // count element indices; the channel metadata transforms them into dimension values.
+    auto loops = hbk::sie::xml::element("loop")
+        .add_attribute("var", "v" + std::to_string(valueIndex - 1))
+        .add_attribute("start", "0")
+        .add_attribute("end", std::to_string(dimensions.getItemAt(valueIndex - 2).getSize()))
+        .add_child(hbk::sie::read("v" + std::to_string(valueIndex), type, bits))
+        .add_child(hbk::sie::sample());
+
+    for (unsigned i = valueIndex - 2; i > 0; --i)
+    {
+        loops = hbk::sie::xml::element("loop")
+            .add_attribute("var", "v" + std::to_string(i))
+            .add_attribute("start", "0")
+            .add_attribute("end", std::to_string(dimensions.getItemAt(i - 1).getSize()))
+            .add_child(std::move(loops));
+    }
+
+    auto makeDecoder = [&, start = start, delta = delta](unsigned id)
+    {
+        return hbk::sie::decoder(id)
+            .add_child(hbk::sie::read("offset", "int", 8 * sizeof(std::int64_t)))
+            .add_child(
+                hbk::sie::xml::element("loop")
+                    .add_attribute("var", "v0")
+                    .add_attribute("start", "{$offset + " + std::to_string(start) + "}")
+                    .add_attribute("increment", std::to_string(delta))
+                    .add_child(hbk::sie::xml::element(loops))
+            );
+    };
+
+    // Signals with the same sample type, domain rule and dimension sizes share a decoder, as do
+    // the channels of successive tests recording the same signal.
+    std::string definition;
+    makeDecoder(0).serialize(definition);
+    auto [decoderId, newDecoder] = writer.intern_decoder(definition);
+
+    auto dim0 = hbk::sie::dimension(0)
+        .add_child(tickResolutionToTransform(domainDescriptor))
+        .add_child(hbk::sie::data(decoderId, 0));
+
+    if (auto unit = domainDescriptor.getUnit(); unit.assigned())
+        dim0.add_child(hbk::sie::units(unit.getName()));
+
+    auto channel = hbk::sie::channel(channelId, group, valueDescriptor.getName())
+        .add_child(hbk::sie::tag("core:uuid", boost::uuids::to_string(boost::uuids::random_generator()())))
+        .add_child(hbk::sie::tag("somat:data_format", openDaqSampleTypeToSieDataFormat(valueDescriptor.getSampleType())))
+        .add_child(hbk::sie::tag("core:description", signal.getDescription()))
+        .add_child(hbk::sie::tag("somat:input_channel", signal.getGlobalId()))
+        .add_child(hbk::sie::tag("core:sample_rate", std::to_string(sampleRate)))
+        .add_child(hbk::sie::tag("somat:data_bits", std::to_string(bits)))
+        .add_child(std::move(dim0));
+
+    unsigned dimIndex = 1;
+    for (const auto& dimension : dimensions)
+    {
+        auto params = dimension.getRule().getParameters();
+        Float dimensionStart = params.getOrDefault("start", 0);
+        Float dimensionDelta = params.getOrDefault("delta", 1);
+
+        auto dim = hbk::sie::dimension(dimIndex)
+            .add_child(hbk::sie::transform(dimensionDelta, dimensionStart))
+            .add_child(hbk::sie::data(decoderId, dimIndex))
+            .add_child(hbk::sie::tag("openDAQ:dimensionName", dimension.getName()))
+            .add_child(hbk::sie::tag("openDAQ:dimensionSize", std::to_string(dimension.getSize())));
+
+        if (auto unit = dimension.getUnit(); unit.assigned())
+            dim.add_child(hbk::sie::units(unit.getName()));
+
+        channel.add_child(std::move(dim));
+        ++dimIndex;
+    }
+
+    auto valueDim = hbk::sie::dimension(valueIndex)
+        .add_child(hbk::sie::data(decoderId, valueIndex));
+
+    if (auto unit = valueDescriptor.getUnit(); unit.assigned())
+        valueDim.add_child(hbk::sie::units(unit.getName()));
+
+    if (auto range = valueDescriptor.getValueRange(); range.assigned())
+    {
+        double min = range.getLowValue();
+        double max = range.getHighValue();
+
+        valueDim.add_child(hbk::sie::tag("FS_Min", std::to_string(min)));
+        valueDim.add_child(hbk::sie::tag("FS_Max", std::to_string(max)));
+    }
+
+    channel.add_child(std::move(valueDim));
+
+    auto test = hbk::sie::test(testId)
+        .add_child(std::move(channel));
+
+    std::string xml;
+    if (newDecoder)
+        makeDecoder(decoderId).serialize(xml, 1);
+    test.serialize(xml, 1);
+
+    writer.write_metadata(xml);
+}
+
+void MultiDimensionalSignalHandler::onDataPacketReceived(const DataPacketPtr& packet)
+{
+    // We can't currently handle packets without a domain packet.
+    auto domainPacket = packet.getDomainPacket();
+    if (!domainPacket.assigned())
+        return;
+
+    // Get the 64-bit domain value. We can't currently handle packets without a domain offset.
+    auto offset = domainPacket.getOffset();
+    if (!offset.assigned())
+        return;
+    std::int64_t domainValue = offset;
+
+    auto samples = static_cast<std::int64_t>(packet.getSampleCount());
+    if (samples == 0 || packet.getRawDataSize() == 0)
+        return;
+
+    // The data block, in accordance with the SIE decoder generated at construction, consists of
+    // the 64-bit domain value followed by the raw value data.
+    auto retained = retainPacket(domainValue, packet);
+    auto& prefix = retained->prefix;
+
+    writer.write_timed_block_retained(group,
+        start + domainValue,
+        start + domainValue + (samples - 1) * delta,
+        std::move(retained),
+        &prefix,                    sizeof(prefix),
+        packet.getRawData(),        packet.getRawDataSize());
+}
+
+END_NAMESPACE_ADVANCED_RECORDER_MODULE
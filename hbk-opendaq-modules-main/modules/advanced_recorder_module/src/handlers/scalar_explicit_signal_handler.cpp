@@ -0,0 +1,181 @@
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include <boost/uuid/random_generator.hpp>
+#include <boost/uuid/uuid_io.hpp>
+
+#include <opendaq/opendaq.h>
+
+#include <advanced_recorder_module/common.h>
+#include <advanced_recorder_module/metadata.h>
+#include <advanced_recorder_module/handlers/scalar_explicit_signal_handler.h>
+#include <advanced_recorder_module/sie/writer.h>
+#include <advanced_recorder_module/sie/xml.h>
+
+BEGIN_NAMESPACE_ADVANCED_RECORDER_MODULE
+
+bool ScalarExplicitSignalHandler::supports(
+    const SignalPtr& signal,
+    const DataDescriptorPtr& valueDescriptor,
+    const DataDescriptorPtr& domainDescriptor)
+{
+    // The domain must be explicit-rule.
+    auto domainRule = domainDescriptor.getRule();
+    if (!domainRule.assigned() || domainRule.getType() != DataRuleType::Explicit)
+        return false;
+
+    // The domain must be a 64-bit integer, so its values can be recorded in the SIE time index.
+    auto domainType = domainDescriptor.getSampleType();
+    if (domainType != SampleType::Int64 && domainType != SampleType::UInt64)
+        return false;
+
+    // The value must be explicit-rule.
+    auto valueRule = valueDescriptor.getRule();
+    if (!valueRule.assigned() || valueRule.getType() != DataRuleType::Explicit)
+        return false;
+
+    // The value must be a scalar type.
+    auto type = valueDescriptor.getSampleType();
+    if (type != SampleType::Float32 &&
+        type != SampleType::Float64 &&
+        type != SampleType::UInt8 &&
+        type != SampleType::Int8 &&
+        type != SampleType::UInt16 &&
+        type != SampleType::Int16 &&
+        type != SampleType::UInt32 &&
+        type != SampleType::Int32 &&
+        type != SampleType::UInt64 &&
+        type != SampleType::Int64)
+        return false;
+
+    // The value must not have custom dimensions.
+    auto dimensions = valueDescriptor.getDimensions();
+    if (dimensions.assigned() && dimensions.getCount() > 0)
+        return false;
+
+    return true;
+}
+
+ScalarExplicitSignalHandler::ScalarExplicitSignalHandler(
+        hbk::sie::writer& writer,
+        unsigned testId,
+        const SignalPtr& signal,
+        const DataDescriptorPtr& valueDescriptor,
+        const DataDescriptorPtr& domainDescriptor)
+    : writer(writer)
+    , group(writer.allocate_group())
+    , valueBytes(openDaqSampleTypeToSieBits(valueDescriptor.getSampleType()) / 8)
+{
+    unsigned channelId = writer.allocate_channel();
+
+    auto [domainType, domainBits] = sampleTypeToSieReadType(domainDescriptor);
+    auto [type, bits] = sampleTypeToSieReadType(valueDescriptor);
+
+    // The domain column starts after the count, and the value column after the domain column.
+    // After each sample, seek back to the next domain value.
+    std::string countBytes = std::to_string(sizeof(std::uint32_t));
+    std::string domainBytes = std::to_string(domainBits / 8);
+
+    auto loop = hbk::sie::xml::element("loop")
+        .add_attribute("var", "i")
+        .add_attribute("start", "0")
+        .add_attribute("end", "{$n}")
+        .add_child(hbk::sie::read("v0", domainType, domainBits))
+        .add_child(hbk::sie::seek("start", "{" + countBytes + " + (" + domainBytes + " * $n) + (" + std::to_string(bits / 8) + " * $i)}"))
+        .add_child(hbk::sie::read("v1", type, bits))
+        .add_child(hbk::sie::sample())
+        .add_child(hbk::sie::seek("start", "{" + countBytes + " + " + domainBytes + " + (" + domainBytes + " * $i)}"));
+
+    auto makeDecoder = [&](unsigned id)
+    {
+        return hbk::sie::decoder(id)
+            .add_child(hbk::sie::read("n", "uint", 32))
+            .add_child(hbk::sie::xml::element(loop));
+    };
+
+    // Signals with the same domain and value types share a decoder, as do the channels of
+    // successive tests recording the same signal.
+    std::string definition;
+    makeDecoder(0).serialize(definition);
+    auto [decoderId, newDecoder] = writer.intern_decoder(definition);
+
+    auto dim0 = hbk::sie::dimension(0)
+        .add_child(tickResolutionToTransform(domainDescriptor))
+        .add_child(hbk::sie::data(decoderId, 0));
+
+    if (auto unit = domainDescriptor.getUnit(); unit.assigned())
+        dim0.add_child(hbk::sie::units(unit.getName()));
+
+    auto dim1 = hbk::sie::dimension(1)
+        .add_child(hbk::sie::data(decoderId, 1));
+
+    if (auto unit = valueDescriptor.getUnit(); unit.assigned())
+        dim1.add_child(hbk::sie::units(unit.getName()));
+
+    if (auto range = valueDescriptor.getValueRange(); range.assigned())
+    {
+        double min = range.getLowValue();
+        double max = range.getHighValue();
+
+        dim1.add_child(hbk::sie::tag("FS_Min", std::to_string(min)));
+        dim1.add_child(hbk::sie::tag("FS_Max", std::to_string(max)));
+    }
+
+    auto channel = hbk::sie::channel(channelId, group, valueDescriptor.getName())
+        .add_child(hbk::sie::tag("core:uuid", boost::uuids::to_string(boost::uuids::random_generator()())))
+        .add_child(hbk::sie::tag("somat:data_format", openDaqSampleTypeToSieDataFormat(valueDescriptor.getSampleType())))
+        .add_child(hbk::sie::tag("core:description", signal.getDescription()))
+        .add_child(hbk::sie::tag("somat:input_channel", signal.getGlobalId()))
+        .add_child(hbk::sie::tag("somat:data_bits", std::to_string(bits)))
+        .add_child(std::move(dim0))
+        .add_child(std::move(dim1));
+
+    auto test = hbk::sie::test(testId)
+        .add_child(std::move(channel));
+
+    std::string xml;
+    if (newDecoder)
+        makeDecoder(decoderId).serialize(xml, 1);
+    test.serialize(xml, 1);
+
+    writer.write_metadata(xml);
+}
+
+void ScalarExplicitSignalHandler::onDataPacketReceived(const DataPacketPtr& packet)
+{
+    // We can't currently handle packets without a domain packet.
+    auto domainPacket = packet.getDomainPacket();
+    if (!domainPacket.assigned())
+        return;
+
+    if (packet.getSampleCount() > std::numeric_limits<std::uint32_t>::max())
+        return;
+    std::uint32_t N = static_cast<std::uint32_t>(packet.getSampleCount());
+
+    if (N == 0)
+        return;
+    if (packet.getRawDataSize() < N * valueBytes)
+        return;
+    if (domainPacket.getRawDataSize() < N * sizeof(std::int64_t))
+        return;
+
+    auto timestamps = static_cast<const std::int64_t *>(domainPacket.getRawData());
+
+    // The sample count is written in front of the timestamp and value columns.
+    auto retained = retainPacket(N, packet);
+    auto& prefix = retained->prefix;
+
+    writer.write_timed_block_retained(group,
+        timestamps[0],
+        timestamps[N - 1],
+        std::move(retained),
+        &prefix,                    sizeof(prefix),
+        domainPacket.getRawData(),  N * sizeof(std::int64_t),
+        packet.getRawData(),        N * valueBytes);
+}
+
+END_NAMESPACE_ADVANCED_RECORDER_MODULE
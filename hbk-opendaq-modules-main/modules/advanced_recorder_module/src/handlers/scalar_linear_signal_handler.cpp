@@ -1,7 +1,12 @@
+#include <chrono>
+#include <cstddef>
 #include <cstdint>
-#include <sstream>
+#include <cstring>
+#include <memory>
 #include <string>
+#include <type_traits>
 #include <utility>
+#include <vector>
 
 #include <boost/uuid/random_generator.hpp>
 #include <boost/uuid/uuid_io.hpp>
@@ -11,46 +16,44 @@
 #include <advanced_recorder_module/common.h>
 #include <advanced_recorder_module/metadata.h>
 #include <advanced_recorder_module/handlers/scalar_linear_signal_handler.h>
+#include <advanced_recorder_module/sie/delta_codec.h>
 #include <advanced_recorder_module/sie/writer.h>
 #include <advanced_recorder_module/sie/xml.h>
+#include <advanced_recorder_module/sie/xor_codec.h>
 
 BEGIN_NAMESPACE_ADVANCED_RECORDER_MODULE
 
-static const char *openDaqSampleTypeToSieDataType(SampleType type)
+/**
+ * Keeps a merged block's buffer, the domain value written in front of it, and the pool the
+ * buffer belongs to, alive until the block has been written or its samples compressed. Either
+ * may happen after the handler has been destroyed: on completion of an asynchronous write, or on
+ * a worker thread of the writer's block pipeline.
+ */
+struct RetainedBuffer
 {
-    switch (type)
-    {
-        case SampleType::Float32: return "sequential_float32";
-        case SampleType::Float64: return "sequential_float64";
-        case SampleType::UInt8: return "sequential_uint8";
-        case SampleType::Int8: return "sequential_int8";
-        case SampleType::UInt16: return "sequential_uint16";
-        case SampleType::Int16: return "sequential_int16";
-        case SampleType::UInt32: return "sequential_uint32";
-        case SampleType::Int32: return "sequential_int32";
-        case SampleType::UInt64: return "sequential_uint64";
-        case SampleType::Int64: return "sequential_int64";
-
-        default:
-            throw InvalidParameterException(
-                "Unsupported openDAQ sample type " + std::to_string(static_cast<int>(type)));
-    }
-}
-
-static const char *openDaqSampleTypeToSieDataFormat(SampleType type)
+    std::int64_t domainValue;
+    std::shared_ptr<BlockPool> pool;
+    BlockPool::Block buffer;
+};
+
+/**
+ * Calls a function with a value of the C++ type corresponding to a scalar openDAQ sample type.
+ */
+template <typename Function>
+static auto visitSampleType(SampleType type, Function&& function)
 {
     switch (type)
     {
-        case SampleType::Float32: return "float";
-        case SampleType::Float64: return "float";
-        case SampleType::UInt8: return "uint";
-        case SampleType::UInt16: return "uint";
-        case SampleType::UInt32: return "uint";
-        case SampleType::UInt64: return "uint";
-        case SampleType::Int8: return "int";
-        case SampleType::Int16: return "int";
-        case SampleType::Int32: return "int";
-        case SampleType::Int64: return "int";
+        case SampleType::Float32: return function(float());
+        case SampleType::Float64: return function(double());
+        case SampleType::UInt8: return function(std::uint8_t());
+        case SampleType::Int8: return function(std::int8_t());
+        case SampleType::UInt16: return function(std::uint16_t());
+        case SampleType::Int16: return function(std::int16_t());
+        case SampleType::UInt32: return function(std::uint32_t());
+        case SampleType::Int32: return function(std::int32_t());
+        case SampleType::UInt64: return function(std::uint64_t());
+        case SampleType::Int64: return function(std::int64_t());
 
         default:
             throw InvalidParameterException(
@@ -58,25 +61,9 @@ static const char *openDaqSampleTypeToSieDataFormat(SampleType type)
     }
 }
 
-static unsigned openDaqSampleTypeToSieBits(SampleType type)
+static bool isFloatingPoint(SampleType type)
 {
-    switch (type)
-    {
-        case SampleType::Float32: return 32;
-        case SampleType::Float64: return 64;
-        case SampleType::UInt8: return 8;
-        case SampleType::Int8: return 8;
-        case SampleType::UInt16: return 16;
-        case SampleType::Int16: return 16;
-        case SampleType::UInt32: return 32;
-        case SampleType::Int32: return 32;
-        case SampleType::UInt64: return 64;
-        case SampleType::Int64: return 64;
-
-        default:
-            throw InvalidParameterException(
-                "Unsupported openDAQ sample type " + std::to_string(static_cast<int>(type)));
-    }
+    return type == SampleType::Float32 || type == SampleType::Float64;
 }
 
 bool ScalarLinearSignalHandler::supports(
@@ -119,16 +106,24 @@ bool ScalarLinearSignalHandler::supports(
 ScalarLinearSignalHandler::ScalarLinearSignalHandler(
         hbk::sie::writer& writer,
         unsigned testId,
+        const RecorderSettings& settings,
         const SignalPtr& signal,
         const DataDescriptorPtr& valueDescriptor,
         const DataDescriptorPtr& domainDescriptor)
     : writer(writer)
     , group(writer.allocate_group())
+    , blockSize(settings.blockSize)
+    , maxBlockLatency(settings.maxBlockLatency)
+    , pool(settings.pool)
+    , sampleType(valueDescriptor.getSampleType())
+    , sampleSize(openDaqSampleTypeToSieBits(valueDescriptor.getSampleType()) / 8)
+    , compress(settings.compress)
 {
-    unsigned decoderId = writer.allocate_decoder();
     unsigned channelId = writer.allocate_channel();
 
     auto [start, delta] = getLinearRuleStartDelta(domainDescriptor);
+    this->start = start;
+    this->delta = delta;
     auto [type, bits] = sampleTypeToSieReadType(valueDescriptor);
 
     double resolution = 1;
@@ -137,16 +132,48 @@ ScalarLinearSignalHandler::ScalarLinearSignalHandler(
             / static_cast<double>(tickResolution.getDenominator());
     double sampleRate = 1.0 / resolution / delta;
 
-    auto decoder = hbk::sie::decoder(decoderId)
-        .add_child(hbk::sie::read("offset", "int", 8 * sizeof(std::int64_t)))
-        .add_child(
-            hbk::sie::xml::element("loop")
-                .add_attribute("var", "v0")
-                .add_attribute("start", "{$offset + " + std::to_string(start) + "}")
-                .add_attribute("increment", std::to_string(delta))
-                .add_child(hbk::sie::read("v1", type, bits))
-                .add_child(hbk::sie::sample())
-        );
+    // Structured bindings cannot be captured by a lambda until C++20, so capture copies.
+    auto makeDecoder = [this, start = start, delta = delta, type = type, bits = bits](unsigned id)
+    {
+        auto decoder = hbk::sie::decoder(id)
+            .add_child(hbk::sie::read("offset", "int", 8 * sizeof(std::int64_t)));
+
+        if (!compress)
+            return decoder.add_child(
+                hbk::sie::xml::element("loop")
+                    .add_attribute("var", "v0")
+                    .add_attribute("start", "{$offset + " + std::to_string(start) + "}")
+                    .add_attribute("increment", std::to_string(delta))
+                    .add_child(hbk::sie::read("v1", type, bits))
+                    .add_child(hbk::sie::sample())
+            );
+
+        // Compressed blocks are not self-delimiting, so they store their sample count, and the
+        // values are read with an extension element (see hbk::sie::READ_XOR_ELEMENT and
+        // hbk::sie::READ_DELTA_ELEMENT).
+        return decoder
+            .add_child(hbk::sie::read("n", "uint", 32))
+            .add_child(
+                hbk::sie::xml::element("loop")
+                    .add_attribute("var", "v0")
+                    .add_attribute("start", "{$offset + " + std::to_string(start) + "}")
+                    .add_attribute("end", "{$offset + " + std::to_string(start) + " + ($n * " + std::to_string(delta) + ")}")
+                    .add_attribute("increment", std::to_string(delta))
+                    .add_child(hbk::sie::xml::element(isFloatingPoint(sampleType)
+                            ? hbk::sie::READ_XOR_ELEMENT
+                            : hbk::sie::READ_DELTA_ELEMENT)
+                        .add_attribute("var", "v1")
+                        .add_attribute("type", type)
+                        .add_attribute("bits", std::to_string(bits)))
+                    .add_child(hbk::sie::sample())
+            );
+    };
+
+    // Signals with the same sample type and domain rule share a decoder, as do the channels of
+    // successive tests recording the same signal.
+    std::string definition;
+    makeDecoder(0).serialize(definition);
+    auto [decoderId, newDecoder] = writer.intern_decoder(definition);
 
     auto dim0 = hbk::sie::dimension(0)
         .add_child(tickResolutionToTransform(domainDescriptor))
@@ -182,14 +209,19 @@ ScalarLinearSignalHandler::ScalarLinearSignalHandler(
         .add_child(std::move(dim0))
         .add_child(std::move(dim1));
 
+    if (compress)
+        channel.add_child(hbk::sie::tag(hbk::sie::ENCODING_TAG,
+            isFloatingPoint(sampleType) ? hbk::sie::XOR_ENCODING : hbk::sie::DELTA_ENCODING));
+
     auto test = hbk::sie::test(testId)
         .add_child(std::move(channel));
 
-    std::ostringstream os;
-    decoder.serialize(os, 1);
-    test.serialize(os, 1);
+    std::string xml;
+    if (newDecoder)
+        makeDecoder(decoderId).serialize(xml, 1);
+    test.serialize(xml, 1);
 
-    writer.write_metadata(os.str());
+    writer.write_metadata(xml);
 }
 
 void ScalarLinearSignalHandler::onDataPacketReceived(const DataPacketPtr& packet)
@@ -205,11 +237,167 @@ void ScalarLinearSignalHandler::onDataPacketReceived(const DataPacketPtr& packet
         return;
     std::int64_t domainValue = offset;
 
+    auto data = static_cast<const std::uint8_t *>(packet.getRawData());
+    std::size_t size = packet.getRawDataSize();
+    if (size == 0)
+        return;
+
+    // Samples can only be appended to the current block if they continue exactly where the
+    // accumulated samples left off; otherwise the block's single domain offset would be wrong.
+    // Blocks never grow beyond the block size, so they always fit a pool buffer.
+    if (!buffer.empty() && (domainValue != nextOffset || buffer.size() + size > blockSize))
+        flush();
+
+    nextOffset = domainValue + static_cast<std::int64_t>(packet.getSampleCount()) * delta;
+
+    // Packets which are large enough by themselves are written directly, avoiding the copy.
+    if (buffer.empty() && size >= blockSize)
+    {
+        writePacket(packet, domainValue);
+        return;
+    }
+
+    if (!buffer)
+    {
+        if (pool)
+            buffer = pool->tryAcquire();
+
+        // Without a buffer, the packet is written directly after all, as a smaller block.
+        if (!buffer)
+        {
+            writePacket(packet, domainValue);
+            return;
+        }
+    }
+
+    if (buffer.empty())
+    {
+        bufferOffset = domainValue;
+        bufferStarted = std::chrono::steady_clock::now();
+    }
+
+    buffer.append(data, size);
+
+    if (buffer.size() >= blockSize)
+        flush();
+}
+
+void ScalarLinearSignalHandler::writePacket(const DataPacketPtr& packet, std::int64_t domainValue)
+{
+    if (compress)
+    {
+        writeCompressed(domainValue,
+            hbk::sie::make_buffer_handle(packet),
+            packet.getRawData(),
+            packet.getRawDataSize());
+        return;
+    }
+
     // The data block, in accordance with the SIE decoder generated at construction, consists of
     // the 64-bit domain value followed by the raw value data.
-    writer.write_block(group,
-        &domainValue,           sizeof(domainValue),
-        packet.getRawData(),    packet.getRawDataSize());
+    auto retained = retainPacket(domainValue, packet);
+    auto& prefix = retained->prefix;
+
+    writer.write_timed_block_retained(group,
+        start + domainValue,
+        start + nextOffset - delta,
+        std::move(retained),
+        &prefix,                    sizeof(prefix),
+        packet.getRawData(),        packet.getRawDataSize());
+}
+
+void ScalarLinearSignalHandler::flush()
+{
+    if (buffer.empty())
+        return;
+
+    // The accumulated samples always end where the next packet is expected to begin.
+    if (compress)
+    {
+        // The buffer goes with the block and is returned to the pool once it is compressed.
+        const void *data = buffer.data();
+        std::size_t size = buffer.size();
+        writeCompressed(bufferOffset,
+            hbk::sie::make_buffer_handle(RetainedBuffer { bufferOffset, pool, std::move(buffer) }),
+            data,
+            size);
+    }
+
+    else
+    {
+        // Likewise, the buffer is written in place and returned to the pool once the write has
+        // completed.
+        auto retained = std::make_shared<RetainedBuffer>(
+            RetainedBuffer { bufferOffset, pool, std::move(buffer) });
+        auto& prefix = retained->domainValue;
+        auto& samples = retained->buffer;
+
+        writer.write_timed_block_retained(group,
+            start + bufferOffset,
+            start + nextOffset - delta,
+            retained,
+            &prefix,        sizeof(prefix),
+            samples.data(), samples.size());
+    }
+
+    // Return the buffer to the pool, so that idle signals do not hold on to memory.
+    buffer.reset();
+}
+
+void ScalarLinearSignalHandler::writeCompressed(
+    std::int64_t domainValue,
+    hbk::sie::buffer_handle owner,
+    const void *data,
+    std::size_t size)
+{
+    auto count = static_cast<std::uint32_t>(size / sampleSize);
+    if (count == 0)
+        return;
+
+    // The data block consists of the 64-bit domain value, the 32-bit sample count and the
+    // compressed values. Floating-point values are XOR-compressed, integers delta-compressed.
+    // The writer compresses the block on a worker thread if it has a pipeline, so the encoder
+    // keeps the samples alive and must not refer to the handler.
+    auto encode = [owner = std::move(owner), type = sampleType, domainValue, data, count](
+        std::vector<std::uint8_t>& block)
+    {
+        visitSampleType(type, [&](auto sample)
+        {
+            using T = decltype(sample);
+            constexpr bool floatingPoint = std::is_floating_point_v<T>;
+            constexpr std::size_t prefix = sizeof(domainValue) + sizeof(count);
+
+            std::size_t bound = floatingPoint
+                ? hbk::sie::xor_encode_bound<T>(count)
+                : hbk::sie::delta_encode_bound<T>(count);
+
+            std::size_t offset = block.size();
+            block.resize(offset + prefix + bound);
+
+            auto out = block.data() + offset;
+            std::memcpy(out, &domainValue, sizeof(domainValue));
+            std::memcpy(out + sizeof(domainValue), &count, sizeof(count));
+
+            std::size_t encodedSize;
+            if constexpr (floatingPoint)
+                encodedSize = hbk::sie::xor_encode<T>(data, count, out + prefix);
+            else
+                encodedSize = hbk::sie::delta_encode<T>(data, count, out + prefix);
+
+            block.resize(offset + prefix + encodedSize);
+        });
+    };
+
+    writer.submit_timed_block(group,
+        start + domainValue,
+        start + domainValue + static_cast<std::int64_t>(count - 1) * delta,
+        std::move(encode));
+}
+
+void ScalarLinearSignalHandler::onTick(std::chrono::steady_clock::time_point now)
+{
+    if (!buffer.empty() && now - bufferStarted >= maxBlockLatency)
+        flush();
 }
 
 END_NAMESPACE_ADVANCED_RECORDER_MODULE
@@ -1,151 +1,182 @@
+#include <charconv>
 #include <cstddef>
 #include <ostream>
 #include <sstream>
 #include <string>
+#include <string_view>
 
 #include <advanced_recorder_module/sie/format.h>
 #include <advanced_recorder_module/sie/xml.h>
 
-struct escaped_string
+/**
+ * Appends a string to an output string, escaping the characters which have special meaning in
+ * XML. Runs of characters which need no escaping are appended in one go.
+ */
+static void append_escaped(std::string& out, std::string_view str)
 {
-    const std::string& str;
+    std::size_t run = 0;
 
-    escaped_string(const std::string& str) noexcept
-        : str(str)
+    for (std::size_t i = 0; i < str.size(); ++i)
     {
-    }
-};
+        std::string_view entity;
 
-std::ostream& operator<<(std::ostream& os, const escaped_string& str)
-{
-    for (char ch : str.str)
-    {
-        switch (ch)
+        switch (str[i])
         {
             case '"':
-                os << "&quot;";
+                entity = "&quot;";
                 break;
 
             case '\'':
-                os << "&apos;";
+                entity = "&apos;";
                 break;
 
             case '<':
-                os << "&lt;";
+                entity = "&lt;";
                 break;
 
             case '>':
-                os << "&gt;";
+                entity = "&gt;";
                 break;
 
             case '&':
-                os << "&amp;";
+                entity = "&amp;";
                 break;
 
             default:
-                os << ch;
-                break;
+                continue;
         }
+
+        out.append(str.data() + run, i - run);
+        out.append(entity);
+        run = i + 1;
     }
 
-    return os;
+    out.append(str.data() + run, str.size() - run);
 }
 
-std::ostream&
-hbk::sie::xml::element::serialize(
-    std::ostream& os,
+/**
+ * Formats an unsigned integer into a caller-provided buffer.
+ */
+template <typename T, std::size_t N>
+static std::string_view to_chars(char (&buffer)[N], T value)
+{
+    auto result = std::to_chars(buffer, buffer + N, value);
+    return std::string_view(buffer, result.ptr - buffer);
+}
+
+std::string&
+hbk::sie::xml::node::serialize(
+    std::string& out,
     unsigned indent
 ) const
 {
-    os
-        << std::string(indent, ' ')
-        << '<'
-        << name();
+    out.append(indent, ' ');
+    out += '<';
+    out.append(name());
 
     for (const auto& attribute : attributes())
-        os
-            << ' '
-            << attribute.id
-            << "=\""
-            << escaped_string(attribute.value)
-            << '"';
+    {
+        out += ' ';
+        out.append(attribute.id);
+        out.append("=\"");
+        append_escaped(out, attribute.value);
+        out += '"';
+    }
 
     if (content().empty() && children().empty())
     {
-        os << "/>\n";
+        out.append("/>\n");
     }
 
     else
     {
         if (!content().empty())
         {
-            os
-                << '>'
-                << escaped_string(content());
-            os
-                << "</"
-                << name()
-                << ">\n";
+            out += '>';
+            append_escaped(out, content());
         }
 
         else
         {
-            os << ">\n";
-            for (const auto child : children())
-                child.serialize(os, indent + 1);
-            os << std::string(indent, ' ');
-            os
-                << "</"
-                << name()
-                << ">\n";
+            out.append(">\n");
+            for (const auto& child : children())
+                child.serialize(out, indent + 1);
+            out.append(indent, ' ');
         }
+
+        out.append("</");
+        out.append(name());
+        out.append(">\n");
     }
 
-    return os;
+    return out;
+}
+
+std::ostream&
+hbk::sie::xml::node::serialize(
+    std::ostream& os,
+    unsigned indent
+) const
+{
+    std::string out;
+    serialize(out, indent);
+    return os.write(out.data(), static_cast<std::streamsize>(out.size()));
 }
 
 hbk::sie::xml::element hbk::sie::channel(unsigned id, std::uint32_t group, const std::string& name)
 {
+    char buffer[24];
+
     return xml::element("ch")
-        .add_attribute("id", std::to_string(id))
-        .add_attribute("group", std::to_string(group))
+        .add_attribute("id", to_chars(buffer, id))
+        .add_attribute("group", to_chars(buffer, group))
         .add_attribute("name", name);
 }
 
 hbk::sie::xml::element hbk::sie::data(unsigned decoderId, unsigned variableId)
 {
+    char buffer[24];
+
     return xml::element("data")
-        .add_attribute("decoder", std::to_string(decoderId))
-        .add_attribute("v", std::to_string(variableId));
+        .add_attribute("decoder", to_chars(buffer, decoderId))
+        .add_attribute("v", to_chars(buffer, variableId));
 }
 
 hbk::sie::xml::element hbk::sie::decoder(unsigned id)
 {
+    char buffer[24];
+
     return xml::element("decoder")
-        .add_attribute("id", std::to_string(id));
+        .add_attribute("id", to_chars(buffer, id));
 }
 
 hbk::sie::xml::element hbk::sie::dimension(unsigned id)
 {
+    char buffer[24];
+
     return xml::element("dim")
-        .add_attribute("index", std::to_string(id));
+        .add_attribute("index", to_chars(buffer, id));
 }
 
 hbk::sie::xml::element hbk::sie::read(const std::string& var, const std::string& type, unsigned bits)
 {
+    char buffer[24];
+
     return xml::element("read")
         .add_attribute("var", var)
         .add_attribute("type", type)
-        .add_attribute("bits", std::to_string(bits))
+        .add_attribute("bits", to_chars(buffer, bits))
         .add_attribute("endian", hbk::sie::native_endian());
 }
 
 hbk::sie::xml::element hbk::sie::read_raw(const std::string& var, std::size_t octets)
 {
+    char buffer[24];
+
     return xml::element("read")
         .add_attribute("var", var)
         .add_attribute("type", "raw")
-        .add_attribute("octets", std::to_string(octets));
+        .add_attribute("octets", to_chars(buffer, octets));
 }
 
 hbk::sie::xml::element hbk::sie::read_raw(const std::string& var, const std::string& octets)
@@ -184,8 +215,10 @@ hbk::sie::xml::element hbk::sie::tag(const char *id, const std::string& value)
 
 hbk::sie::xml::element hbk::sie::test(unsigned id)
 {
+    char buffer[24];
+
     return xml::element("test")
-        .add_attribute("id", std::to_string(id));
+        .add_attribute("id", to_chars(buffer, id));
 }
 
 hbk::sie::xml::element hbk::sie::transform(double scale, double offset)
@@ -0,0 +1,871 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <exception>
+#include <filesystem>
+#include <future>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <opendaq/opendaq.h>
+
+#include <advanced_recorder_module/advanced_recorder_signal.h>
+#include <advanced_recorder_module/commit_thread.h>
+#include <advanced_recorder_module/common.h>
+#include <advanced_recorder_module/metadata.h>
+#include <advanced_recorder_module/sie/writer.h>
+#include <advanced_recorder_module/statistics.h>
+#include <advanced_recorder_module/writer_thread.h>
+
+BEGIN_NAMESPACE_ADVANCED_RECORDER_MODULE
+
+/*!
+ * @brief The maximum number of entries processed between checks of the tick timer.
+ */
+static constexpr std::size_t BATCH_SIZE = 1024;
+
+/*!
+ * @brief The interval at which the performance counters are published.
+ */
+static constexpr std::chrono::seconds STATISTICS_INTERVAL(1);
+
+WriterThread::WriterThread(
+        Segment segment,
+        std::size_t capacity,
+        std::chrono::milliseconds tickInterval,
+        RotationPolicy policy,
+        SegmentFactory factory,
+        TriggerSettings trigger,
+        DurabilityPolicy durability,
+        BackpressureSettings backpressure)
+    : segment(std::move(segment))
+    , queue(capacity)
+    , tickInterval(tickInterval)
+    , policy(policy)
+    , factory(std::move(factory))
+    , triggerSettings(trigger)
+    , durability(durability)
+    , backpressurePolicy(backpressure.policy)
+    , budget(std::move(backpressure.budget))
+{
+    if (!this->factory)
+        this->policy = RotationPolicy();
+
+    if (!budget)
+        budget = std::make_shared<MemoryBudget>();
+
+    if (durability.mode != DurabilityMode::None)
+        commitThread = std::make_unique<CommitThread>();
+
+    lastPublished = std::chrono::steady_clock::now();
+    lastCommitRequest = lastPublished;
+    startSegment(lastPublished);
+    thread = std::thread(&WriterThread::run, this);
+}
+
+/*!
+ * @brief Counts the calling thread as a producer while it is in enqueue() or retire(), so that
+ *     stop() can wait for it to leave.
+ */
+class WriterThread::ProducerScope
+{
+    public:
+
+        explicit ProducerScope(WriterThread& owner) noexcept
+            : owner(owner)
+        {
+            // Sequentially consistent, like the store in stop(): either stop() sees this
+            // producer and waits for it, or the producer sees the stop request.
+            owner.producers.fetch_add(1);
+        }
+
+        ~ProducerScope()
+        {
+            if (owner.producers.fetch_sub(1) == 1 && owner.stopRequested.load())
+                owner.signalRoom();
+        }
+
+        ProducerScope(const ProducerScope&) = delete;
+        ProducerScope& operator=(const ProducerScope&) = delete;
+
+    private:
+
+        WriterThread& owner;
+};
+
+WriterThread::~WriterThread()
+{
+    stop();
+}
+
+void WriterThread::enqueue(const std::shared_ptr<AdvancedRecorderSignal>& signal, const ListPtr<IPacket>& packets)
+{
+    ProducerScope scope(*this);
+
+    std::size_t count = packets.getCount();
+    if (stopRequested.load(std::memory_order_relaxed))
+    {
+        packetsDropped.fetch_add(count, std::memory_order_relaxed);
+        return;
+    }
+
+    // A batch which would exceed the largest charge the budget can grant is split into runs
+    // which do not, so that backpressure sees the real amount of queued data. Only a single
+    // packet larger than that is charged less than its size.
+    std::size_t limit = maxCharge();
+    Entry entry { signal, packets };
+
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        std::size_t bytes = sizeOf(packets.getItemAt(i));
+        if (entry.count && entry.bytes + bytes > limit)
+        {
+            push(entry);
+            entry = Entry { signal, packets, i };
+        }
+
+        entry.count++;
+        entry.bytes = std::min(entry.bytes + bytes, limit);
+    }
+
+    if (entry.count)
+        push(entry);
+}
+
+std::size_t WriterThread::sizeOf(const PacketPtr& packet)
+{
+    // Only the sample data is charged; everything else a packet holds is small in comparison.
+    if (packet.getType() == PacketType::Data)
+        return DataPacketPtr(packet).getRawDataSize();
+    return 0;
+}
+
+std::size_t WriterThread::maxCharge() const
+{
+    // The block pool may take up to half of the budget, and held packets (in triggered mode)
+    // up to their share, so a larger charge would never fit.
+    if (auto limit = budget->limit())
+    {
+        double share = triggerSettings.enabled
+            ? AdvancedRecorderSignal::HISTORY_SHARE
+            : BlockPool::BUDGET_SHARE;
+        return limit - static_cast<std::size_t>(limit * share);
+    }
+
+    return std::numeric_limits<std::size_t>::max();
+}
+
+void WriterThread::retire(std::shared_ptr<AdvancedRecorderSignal> signal)
+{
+    ProducerScope scope(*this);
+
+    if (stopRequested.load(std::memory_order_relaxed))
+        return;
+
+    Entry entry { std::move(signal) };
+    push(entry);
+}
+
+void WriterThread::push(Entry& entry)
+{
+    insert(entry);
+    notify();
+}
+
+void WriterThread::insert(Entry& entry)
+{
+    // Retire requests are never dropped, whatever the policy.
+    std::size_t packets = entry.count;
+    bool droppable = packets && backpressurePolicy != BackpressurePolicy::Block;
+
+    bool charged = false;
+
+    for (;;)
+    {
+        // Read before checking the stop request, which stop() makes before signalling room.
+        std::uint64_t seen = roomEvents.load();
+
+        // Once the background thread is stopping, it may already have made its final pass over
+        // the queue, so nothing may be queued any more.
+        if (stopRequested.load())
+        {
+            if (charged)
+                budget->release(entry.bytes);
+            packetsDropped.fetch_add(packets, std::memory_order_relaxed);
+            return;
+        }
+
+        if (!charged)
+            charged = budget->tryCharge(entry.bytes);
+
+        if (charged && queue.tryPush(entry))
+            break;
+
+        if (droppable && backpressurePolicy == BackpressurePolicy::DropNewest)
+        {
+            if (charged)
+                budget->release(entry.bytes);
+            packetsDropped.fetch_add(packets, std::memory_order_relaxed);
+            return;
+        }
+
+        // Otherwise make room ourselves if we may. If not, make sure the background thread is
+        // awake and wait for it: for room in the queue, or for memory to be released.
+        if (droppable && dropOldest())
+            continue;
+
+        wake();
+
+        if (charged)
+            waitForRoom(seen);
+        else
+            charged = budget->charge(entry.bytes, [this] { return stopRequested.load(); });
+    }
+
+    std::size_t depth = queue.size();
+    std::size_t mark = highWaterMark.load(std::memory_order_relaxed);
+    while (depth > mark && !highWaterMark.compare_exchange_weak(mark, depth, std::memory_order_relaxed))
+        ;
+}
+
+void WriterThread::notify()
+{
+    // Pairs with the fence in run(): either we see that the background thread is idle, or it
+    // sees the packet we just pushed before it goes to sleep.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (idle.load(std::memory_order_relaxed))
+        wake();
+}
+
+bool WriterThread::dropOldest()
+{
+    Entry oldest;
+    if (!queue.tryPop(oldest))
+        return false;
+
+    // A retire request is put back at the tail. Its signal then records the packets queued
+    // after it before being retired, which does no harm.
+    std::size_t packets = oldest.count;
+    if (!packets)
+    {
+        push(oldest);
+        return true;
+    }
+
+    budget->release(oldest.bytes);
+    packetsDropped.fetch_add(packets, std::memory_order_relaxed);
+    return true;
+}
+
+/*!
+ * @brief Wakes the producers waiting in waitForRoom(). The background thread calls this after
+ *     taking a batch of entries off the queue, and stop() after making the stop request.
+ */
+void WriterThread::signalRoom()
+{
+    // Pairs with waitForRoom(): either we see the waiter, or it sees the new event count.
+    roomEvents.fetch_add(1);
+    if (roomWaiters.load() > 0)
+    {
+        std::lock_guard<std::mutex> lock(roomMutex);
+        roomCv.notify_all();
+    }
+}
+
+/*!
+ * @brief Waits until signalRoom() has been called since @p seen was read from roomEvents.
+ */
+void WriterThread::waitForRoom(std::uint64_t seen)
+{
+    std::unique_lock<std::mutex> lock(roomMutex);
+    roomWaiters.fetch_add(1);
+    roomCv.wait(lock, [&] { return roomEvents.load() != seen; });
+    roomWaiters.fetch_sub(1);
+}
+
+/*!
+ * @brief Discards the entries queued by producers which passed the stop check just before
+ *     stop() was called, once they have all left, and counts their packets as dropped.
+ */
+void WriterThread::discardQueued()
+{
+    for (;;)
+    {
+        std::uint64_t seen = roomEvents.load();
+        if (producers.load() == 0)
+            break;
+        waitForRoom(seen);
+    }
+
+    Entry entry;
+    while (queue.tryPop(entry))
+    {
+        budget->release(entry.bytes);
+        packetsDropped.fetch_add(entry.count, std::memory_order_relaxed);
+    }
+}
+
+void WriterThread::trigger()
+{
+    triggerRequested = true;
+    wake();
+}
+
+void WriterThread::stop()
+{
+    if (!thread.joinable())
+        return;
+
+    stopRequested = true;
+    signalRoom();
+    budget->wakeAll();
+    wake();
+    thread.join();
+
+    discardQueued();
+}
+
+std::size_t WriterThread::getQueueDepth() const noexcept
+{
+    return queue.size();
+}
+
+std::size_t WriterThread::getHighWaterMark() const noexcept
+{
+    return highWaterMark.load(std::memory_order_relaxed);
+}
+
+RecorderStatistics WriterThread::getStatistics() const
+{
+    std::lock_guard<std::mutex> lock(statisticsMutex);
+    RecorderStatistics result = statistics;
+    result.packetsDropped = packetsDropped.load(std::memory_order_relaxed);
+    result.memoryUsed = budget->used();
+    return result;
+}
+
+void WriterThread::run()
+{
+    Entry entry;
+    auto nextTick = std::chrono::steady_clock::now() + tickInterval;
+
+    for (;;)
+    {
+        if (triggerRequested.exchange(false))
+            fireTrigger(std::chrono::steady_clock::now(), latestDomainTime);
+
+        std::size_t processed = 0;
+        while (processed < BATCH_SIZE && queue.tryPop(entry))
+        {
+            process(entry);
+            ++processed;
+        }
+
+        if (processed)
+            signalRoom();
+
+        auto now = std::chrono::steady_clock::now();
+        if (now >= nextTick)
+        {
+            tick(now);
+            nextTick = now + tickInterval;
+        }
+
+        rotateIfDue(now);
+        commitIfDue(now);
+
+        if (processed == BATCH_SIZE)
+            continue;
+
+        if (stopRequested)
+        {
+            // Record anything that was enqueued while we were checking the flag, then write out
+            // whatever the signal handlers are still holding.
+            while (queue.tryPop(entry))
+                process(entry);
+
+            for (const auto& [signal, packets] : signals)
+            {
+                try
+                {
+                    signal->flush();
+                }
+
+                catch (const std::exception& ex)
+                {
+                    std::cerr << "[advanced-recorder] failed to flush signal '" << signal->getGlobalId() << "' while stopping: " << ex.what() << std::endl;
+                }
+            }
+
+            flush();
+
+            // The final commit covers everything, including the closing index blocks.
+            if (commitThread)
+            {
+                try
+                {
+                    segment.writer->finish();
+                }
+
+                catch (const std::exception& ex)
+                {
+                    std::cerr << "[advanced-recorder] failed to write to file: " << ex.what() << std::endl;
+                }
+
+                requestCommit(std::chrono::steady_clock::now());
+                commitThread->stop();
+            }
+
+            publishStatistics(std::chrono::steady_clock::now());
+            signals.clear();
+            discardPreparedSegment();
+            break;
+        }
+
+        flush();
+
+        std::unique_lock<std::mutex> lock(mutex);
+        idle.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        // Producers wake us explicitly; the timeout serves the tick timer.
+        cv.wait_until(lock, nextTick, [this]
+        {
+            return stopRequested || triggerRequested || queue.size() > 0;
+        });
+
+        idle.store(false, std::memory_order_relaxed);
+    }
+}
+
+void WriterThread::process(Entry& entry)
+{
+    if (entry.count)
+    {
+        // Hand each packet its own part of the entry's charge, so that held packets take over
+        // what they hold. The charge of a single oversized packet is capped, so it may get less.
+        std::size_t remaining = entry.bytes;
+        for (std::size_t i = entry.first; i < entry.first + entry.count; ++i)
+        {
+            PacketPtr packet = entry.batch.getItemAt(i);
+            std::size_t charge = std::min(remaining, sizeOf(packet));
+            remaining -= charge;
+            budget->release(processPacket(entry.signal, packet, charge));
+        }
+
+        budget->release(remaining);
+    }
+
+    else
+    {
+        try
+        {
+            // Keep the packet count of the retired signal for the statistics.
+            if (auto it = signals.find(entry.signal); it != signals.end())
+            {
+                retiredPacketCounts[entry.signal->getGlobalId()] += it->second;
+                signals.erase(it);
+            }
+
+            entry.signal->flush();
+        }
+
+        catch (const std::exception& ex)
+        {
+            std::cerr << "[advanced-recorder] failed to flush retired signal '" << entry.signal->getGlobalId() << "': " << ex.what() << std::endl;
+        }
+    }
+
+    // Release our references now rather than when the next entry is popped.
+    entry = Entry();
+}
+
+/*!
+ * @brief Records or holds a single packet.
+ * @return The part of @p charge which the caller must release; zero if the packet was held,
+ *     in which case its pre-trigger history has taken over the charge.
+ */
+std::size_t WriterThread::processPacket(
+    const std::shared_ptr<AdvancedRecorderSignal>& signal,
+    const PacketPtr& packet,
+    std::size_t charge)
+{
+    try
+    {
+        // Attach the current segment to signals we have not seen before.
+        auto [it, inserted] = signals.try_emplace(signal, 0);
+        if (inserted && signal->getWriter() != segment.writer)
+            signal->setWriter(segment.writer);
+
+        ++it->second;
+        auto started = std::chrono::steady_clock::now();
+
+        if (!triggerSettings.enabled)
+            signal->onPacketReceived(packet);
+
+        else
+        {
+            std::optional<DomainTime> domainTime;
+            if (packet.getType() == PacketType::Data)
+                domainTime = getPacketDomainTime(DataPacketPtr(packet));
+
+            if (domainTime && (!latestDomainTime || *domainTime > *latestDomainTime))
+                latestDomainTime = domainTime;
+
+            if (signal->detectTrigger(packet))
+                fireTrigger(started, domainTime);
+
+            if (isInTriggerWindow(started, domainTime))
+                signal->onPacketReceived(packet);
+            else
+            {
+                signal->hold(packet, charge, budget, started, domainTime, triggerSettings.preTrigger);
+                charge = 0;
+            }
+        }
+
+        latency.record(std::chrono::steady_clock::now() - started);
+    }
+
+    catch (const std::exception& ex)
+    {
+        std::cerr << "[advanced-recorder] failed to record packet of signal '" << signal->getGlobalId() << "': " << ex.what() << std::endl;
+    }
+
+    return charge;
+}
+
+void WriterThread::tick(std::chrono::steady_clock::time_point now)
+{
+    if (now - lastPublished >= STATISTICS_INTERVAL)
+        publishStatistics(now);
+
+    // Keep the next segment in preparation. If preparing it failed, this retries once per tick.
+    if (policy.enabled() && !preparedSegment.valid())
+        prepareNextSegment();
+
+    for (const auto& [signal, packets] : signals)
+    {
+        // A signal only trims its own history as it receives packets, so this also bounds the
+        // memory held for signals which have fallen silent.
+        signal->trimHistory();
+
+        try
+        {
+            signal->onTick(now);
+        }
+
+        catch (const std::exception& ex)
+        {
+            std::cerr << "[advanced-recorder] failed to write pending data of signal '" << signal->getGlobalId() << "': " << ex.what() << std::endl;
+        }
+    }
+}
+
+void WriterThread::flush()
+{
+    try
+    {
+        segment.writer->flush();
+    }
+
+    catch (const std::exception& ex)
+    {
+        std::cerr << "[advanced-recorder] failed to write to file: " << ex.what() << std::endl;
+    }
+}
+
+void WriterThread::prepareNextSegment()
+{
+    // Capture the descriptors here, in the background thread, since only it may read them.
+    std::vector<std::pair<std::shared_ptr<AdvancedRecorderSignal>, AdvancedRecorderSignal::Descriptors>> snapshot;
+    for (const auto& [signal, packets] : signals)
+    {
+        auto descriptors = signal->getDescriptors();
+        if (descriptors.value.assigned())
+            snapshot.emplace_back(signal, std::move(descriptors));
+    }
+
+    preparedSegment = std::async(
+        std::launch::async,
+        [factory = factory, sequence = nextSequence, snapshot = std::move(snapshot)]()
+        {
+            PreparedSegment next;
+            next.segment = factory(sequence);
+
+            for (const auto& [signal, descriptors] : snapshot)
+                next.handlers.push_back(
+                {
+                    signal,
+                    descriptors,
+                    signal->createHandler(*next.segment.writer, descriptors)
+                });
+
+            return next;
+        });
+}
+
+bool WriterThread::isRotationDue(std::chrono::steady_clock::time_point now) const
+{
+    if (policy.maxBytes && segment.writer->size() >= policy.maxBytes)
+        return true;
+
+    if (policy.maxDuration.count() && now - segmentStarted >= policy.maxDuration)
+        return true;
+
+    if (policy.boundary.count() && std::chrono::system_clock::now() >= nextBoundary)
+        return true;
+
+    return false;
+}
+
+void WriterThread::rotateIfDue(std::chrono::steady_clock::time_point now)
+{
+    if (!policy.enabled() || !isRotationDue(now))
+        return;
+
+    // Never wait for the next segment; keep writing to the current one until it is ready.
+    if (!preparedSegment.valid()
+            || preparedSegment.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+        return;
+
+    PreparedSegment next;
+
+    try
+    {
+        next = preparedSegment.get();
+    }
+
+    catch (const std::exception& ex)
+    {
+        std::cerr << "[advanced-recorder] failed to open next segment: " << ex.what() << std::endl;
+        return;
+    }
+
+    for (const auto& entry : signals)
+    {
+        const auto& signal = entry.first;
+
+        try
+        {
+            auto it = std::find_if(next.handlers.begin(), next.handlers.end(),
+                [&](const PreparedHandler& prepared) { return prepared.signal == signal; });
+
+            if (it != next.handlers.end())
+                signal->switchWriter(next.segment.writer, std::move(it->handler), it->descriptors);
+            else
+                signal->setWriter(next.segment.writer);
+        }
+
+        catch (const std::exception& ex)
+        {
+            std::cerr << "[advanced-recorder] failed to move signal '" << signal->getGlobalId() << "' to the next segment: " << ex.what() << std::endl;
+        }
+    }
+
+    // Releasing our reference to the previous segment's writer closes the file. If durability
+    // is enabled, the closing index blocks are written now so that a final commit covers them.
+    flush();
+
+    if (commitThread)
+    {
+        try
+        {
+            segment.writer->finish();
+        }
+
+        catch (const std::exception& ex)
+        {
+            std::cerr << "[advanced-recorder] failed to write to file: " << ex.what() << std::endl;
+        }
+
+        requestCommit(now);
+    }
+
+    closedBytes += segment.writer->size();
+    closedBlocks += segment.writer->block_count();
+    closedIndexFlushes += segment.writer->index_flush_count();
+    segment = std::move(next.segment);
+    ++nextSequence;
+    startSegment(now);
+}
+
+void WriterThread::discardPreparedSegment()
+{
+    if (!preparedSegment.valid())
+        return;
+
+    std::string filename;
+
+    try
+    {
+        // Destroying the prepared segment closes the file, which is then removed since it
+        // contains no data.
+        filename = preparedSegment.get().segment.filename;
+        std::filesystem::remove(filename);
+    }
+
+    catch (const std::exception& ex)
+    {
+        std::cerr << "[advanced-recorder] failed to remove unused segment " << filename << ": " << ex.what() << std::endl;
+    }
+}
+
+void WriterThread::startSegment(std::chrono::steady_clock::time_point now)
+{
+    segmentStarted = now;
+
+    if (policy.boundary.count())
+    {
+        auto sinceEpoch = std::chrono::duration_cast<std::chrono::seconds>(
+            std::chrono::system_clock::now().time_since_epoch());
+        nextBoundary = std::chrono::system_clock::time_point(
+            (sinceEpoch / policy.boundary + 1) * policy.boundary);
+    }
+}
+
+void WriterThread::fireTrigger(
+    std::chrono::steady_clock::time_point now,
+    std::optional<DomainTime> domainTime)
+{
+    if (!triggerSettings.enabled)
+        return;
+
+    // A trigger whose own domain time is not known fires at the latest one processed.
+    if (!domainTime)
+        domainTime = latestDomainTime;
+
+    // If a window is already open, the history is empty and the window is merely extended.
+    if (!isInTriggerWindow(now, domainTime))
+    {
+        for (const auto& [signal, packets] : signals)
+        {
+            try
+            {
+                signal->release();
+            }
+
+            catch (const std::exception& ex)
+            {
+                std::cerr << "[advanced-recorder] failed to record pre-trigger history of signal '" << signal->getGlobalId() << "': " << ex.what() << std::endl;
+            }
+        }
+    }
+
+    triggerWindowEnd = now + triggerSettings.postTrigger;
+    if (domainTime)
+        domainWindowEnd = *domainTime + triggerSettings.postTrigger;
+}
+
+bool WriterThread::isInTriggerWindow(
+    std::chrono::steady_clock::time_point now,
+    const std::optional<DomainTime>& domainTime) const
+{
+    if (domainTime && domainWindowEnd)
+        return *domainTime < *domainWindowEnd;
+
+    return now < triggerWindowEnd;
+}
+
+void WriterThread::commitIfDue(std::chrono::steady_clock::time_point now)
+{
+    if (!commitThread)
+        return;
+
+    std::uint64_t written = closedBytes + segment.writer->size();
+    if (written == requestedBytes)
+        return;
+
+    if (durability.mode == DurabilityMode::Periodic)
+    {
+        bool due = (durability.interval.count() && now - lastCommitRequest >= durability.interval)
+            || (durability.bytes && written - requestedBytes >= durability.bytes);
+        if (!due)
+            return;
+    }
+
+    // In group-commit mode, a request which is still waiting will be started as soon as the
+    // running commit completes; a new request would only cover slightly more data.
+    else if (commitThread->pending())
+        return;
+
+    requestCommit(now);
+}
+
+void WriterThread::requestCommit(std::chrono::steady_clock::time_point now)
+{
+    try
+    {
+        auto handle = segment.writer->prepare_sync();
+        requestedBytes = closedBytes + segment.writer->size();
+        lastCommitRequest = now;
+        commitThread->request(std::move(handle), requestedBytes);
+    }
+
+    catch (const std::exception& ex)
+    {
+        std::cerr << "[advanced-recorder] failed to sync file: " << ex.what() << std::endl;
+    }
+}
+
+void WriterThread::publishStatistics(std::chrono::steady_clock::time_point now)
+{
+    RecorderStatistics current;
+
+    // The counters of a closed segment's writer do not include its closing index block, which is
+    // only written when the writer is destroyed.
+    current.bytesWritten = closedBytes + segment.writer->size();
+    current.blocksWritten = closedBlocks + segment.writer->block_count();
+    current.indexFlushes = closedIndexFlushes + segment.writer->index_flush_count();
+
+    std::chrono::duration<double> elapsed = now - lastPublished;
+    if (elapsed.count() > 0)
+    {
+        current.bytesPerSecond = (current.bytesWritten - publishedBytes) / elapsed.count();
+        current.blocksPerSecond = (current.blocksWritten - publishedBlocks) / elapsed.count();
+    }
+
+    if (latency.max() > latencyMax)
+        latencyMax = latency.max();
+
+    current.latencyP50 = latency.percentile(0.5);
+    current.latencyP99 = latency.percentile(0.99);
+    current.latencyMax = latencyMax;
+    latency.reset();
+
+    if (commitThread)
+    {
+        auto commit = commitThread->collectStatistics();
+        current.commits = commit.commits;
+        current.bytesCommitted = commit.bytesCommitted;
+        current.commitLatencyP50 = commit.latencyP50;
+        current.commitLatencyP99 = commit.latencyP99;
+        current.commitLatencyMax = commit.latencyMax;
+    }
+
+    current.packetCounts = retiredPacketCounts;
+    for (const auto& [signal, packets] : signals)
+        current.packetCounts[signal->getGlobalId()] += packets;
+
+    publishedBytes = current.bytesWritten;
+    publishedBlocks = current.blocksWritten;
+    lastPublished = now;
+
+    std::lock_guard<std::mutex> lock(statisticsMutex);
+    statistics = std::move(current);
+}
+
+void WriterThread::wake()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    cv.notify_one();
+}
+
+END_NAMESPACE_ADVANCED_RECORDER_MODULE
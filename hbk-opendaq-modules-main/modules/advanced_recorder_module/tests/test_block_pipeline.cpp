@@ -0,0 +1,173 @@
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <future>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <advanced_recorder_module/sie/block_pipeline.h>
+#include <advanced_recorder_module/sie/format.h>
+#include <advanced_recorder_module/sie/reader.h>
+#include <advanced_recorder_module/sie/writer.h>
+
+#include "test_helpers.h"
+
+using namespace hbk::sie;
+
+/**
+ * Returns an encoder which appends @p value, repeated a varying number of times, after sleeping
+ * for a random time so that the workers of a pipeline finish blocks out of order.
+ */
+static block_encoder makeEncoder(std::uint32_t value, std::chrono::microseconds delay)
+{
+    return [value, delay](std::vector<std::uint8_t>& block)
+    {
+        std::this_thread::sleep_for(delay);
+
+        for (std::uint32_t i = 0; i <= value % 7; ++i)
+        {
+            auto bytes = reinterpret_cast<const std::uint8_t *>(&value);
+            block.insert(block.end(), bytes, bytes + sizeof(value));
+        }
+    };
+}
+
+/**
+ * Writes a test file whose blocks are encoded by @p threads pipeline workers, or inline if zero.
+ */
+static void writeEncodedFile(const std::filesystem::path& path, unsigned threads)
+{
+    auto w = openTestFile(path);
+
+    if (threads)
+        w.start_pipeline(threads, 8);
+
+    writeTestMetadata(w);
+
+    std::mt19937 rng(12345);
+    for (std::uint32_t i = 0; i < BLOCK_COUNT; ++i)
+    {
+        w.submit_timed_block(testGroup(i),
+            i * 100, i * 100 + 99,
+            makeEncoder(i, std::chrono::microseconds(threads ? rng() % 500 : 0)));
+
+        if (i % 20 == 0)
+            w.flush();
+    }
+}
+
+TEST(BlockPipeline, PipelinedBlocksMatchInlineBlocks)
+{
+    auto dir = std::filesystem::temp_directory_path();
+    auto inlinePath = dir / "test_block_pipeline_inline.sie";
+    auto pipelinedPath = dir / "test_block_pipeline_pipelined.sie";
+
+    writeEncodedFile(inlinePath, 0);
+    writeEncodedFile(pipelinedPath, 4);
+
+    EXPECT_EQ(readFile(pipelinedPath), readFile(inlinePath));
+
+    {
+        reader r(pipelinedPath.string());
+
+        EXPECT_TRUE(r.indexed());
+        EXPECT_EQ(r.blocks(DATA_GROUP).size(), BLOCK_COUNT * 4 / 5);
+        EXPECT_EQ(r.time_index(DATA_GROUP).size(), r.blocks(DATA_GROUP).size());
+
+        std::uint32_t expected = 1;
+        for (const auto& timed : r.time_index(DATA_GROUP))
+        {
+            auto block = r.block_at(timed.offset);
+            ASSERT_EQ(block.group, DATA_GROUP);
+            ASSERT_EQ(block.payload_size, sizeof(std::uint32_t) * (expected % 7 + 1));
+            EXPECT_TRUE(block.verify());
+
+            std::uint32_t value;
+            std::memcpy(&value, block.payload, sizeof(value));
+            EXPECT_EQ(value, expected);
+            EXPECT_EQ(timed.first, static_cast<std::int64_t>(expected) * 100);
+
+            if (++expected % 5 == 0)
+                ++expected;
+        }
+    }
+
+    std::filesystem::remove(inlinePath);
+    std::filesystem::remove(pipelinedPath);
+}
+
+TEST(BlockPipeline, HandsBackBlocksInSubmissionOrder)
+{
+    block_pipeline pipeline(3, 5);
+    EXPECT_EQ(pipeline.thread_count(), 3u);
+    EXPECT_EQ(pipeline.max_in_flight(), 5u);
+
+    std::vector<std::uint32_t> emitted;
+    auto emit = [&](sealed_block block)
+    {
+        auto payloadSize = sizeof(std::uint32_t) * static_cast<std::size_t>(block.first % 7 + 1);
+        ASSERT_EQ(block.data->size(), sizeof(block_header) + payloadSize + sizeof(block_footer));
+        EXPECT_EQ(block.last, block.first + 99);
+
+        auto probed = reader::probe(block.data->data(), block.data->size(), 0);
+        ASSERT_TRUE(probed);
+        EXPECT_TRUE(probed->verify());
+        EXPECT_EQ(probed->group, block.group);
+
+        emitted.push_back(static_cast<std::uint32_t>(block.first));
+    };
+
+    std::mt19937 rng(12345);
+    for (std::uint32_t i = 0; i < 100; ++i)
+    {
+        pipeline.submit(DATA_GROUP, i, i + 99, makeEncoder(i, std::chrono::microseconds(rng() % 300)), emit);
+        EXPECT_LE(pipeline.in_flight(), pipeline.max_in_flight());
+    }
+
+    pipeline.drain(emit);
+    EXPECT_EQ(pipeline.in_flight(), 0u);
+
+    ASSERT_EQ(emitted.size(), 100u);
+    for (std::uint32_t i = 0; i < emitted.size(); ++i)
+        EXPECT_EQ(emitted[i], i);
+}
+
+TEST(BlockPipeline, RethrowsEncoderErrorsInOrder)
+{
+    block_pipeline pipeline(2, 4);
+
+    std::vector<std::int64_t> emitted;
+    auto emit = [&](sealed_block block)
+    {
+        emitted.push_back(block.first);
+    };
+
+    for (std::int64_t i = 0; i < 3; ++i)
+        pipeline.submit(DATA_GROUP, i, i, makeEncoder(1, std::chrono::microseconds(200)), emit);
+
+    // The failing encoder is held until everything is submitted, so only drain() sees the error.
+    std::promise<void> gate;
+    std::shared_future<void> opened = gate.get_future().share();
+
+    pipeline.submit(DATA_GROUP, 3, 3, [opened](std::vector<std::uint8_t>&)
+    {
+        opened.wait();
+        throw std::runtime_error("encoding failed");
+    }, emit);
+
+    pipeline.submit(DATA_GROUP, 4, 4, makeEncoder(1, std::chrono::microseconds(0)), emit);
+    gate.set_value();
+
+    EXPECT_THROW(pipeline.drain(emit), std::runtime_error);
+    EXPECT_EQ(emitted, (std::vector<std::int64_t> { 0, 1, 2 }));
+
+    // The blocks after the failed one are still handed back.
+    pipeline.drain(emit);
+    EXPECT_EQ(emitted, (std::vector<std::int64_t> { 0, 1, 2, 4 }));
+}
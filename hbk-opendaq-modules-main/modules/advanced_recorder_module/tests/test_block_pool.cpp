@@ -0,0 +1,189 @@
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <advanced_recorder_module/block_pool.h>
+
+using namespace daq::modules::advanced_recorder_module;
+
+static constexpr std::size_t MiB = 1024 * 1024;
+
+TEST(MemoryBudget, ChargesWithinLimit)
+{
+    MemoryBudget budget(1000);
+
+    EXPECT_TRUE(budget.tryCharge(600));
+    EXPECT_FALSE(budget.tryCharge(500));
+    EXPECT_FALSE(budget.tryCharge(1, 0.5));
+    EXPECT_TRUE(budget.tryCharge(400));
+    EXPECT_EQ(budget.used(), 1000u);
+
+    budget.release(1000);
+    EXPECT_TRUE(budget.tryCharge(500, 0.5));
+    EXPECT_FALSE(budget.tryCharge(1, 0.5));
+    EXPECT_FALSE(budget.tryCharge(2000));
+}
+
+TEST(MemoryBudget, ZeroIsUnlimited)
+{
+    MemoryBudget budget;
+
+    EXPECT_TRUE(budget.tryCharge(std::size_t(1) << 40));
+    EXPECT_EQ(budget.used(), std::size_t(1) << 40);
+}
+
+TEST(MemoryBudget, ChargeWaitsForRelease)
+{
+    MemoryBudget budget(100);
+    ASSERT_TRUE(budget.tryCharge(80));
+
+    std::atomic<bool> charged = false;
+    std::thread waiter([&]
+    {
+        charged = budget.charge(50, [] { return false; });
+    });
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    EXPECT_FALSE(charged);
+
+    budget.release(10);
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    EXPECT_FALSE(charged);
+
+    budget.release(70);
+    waiter.join();
+    EXPECT_TRUE(charged);
+    EXPECT_EQ(budget.used(), 50u);
+}
+
+TEST(MemoryBudget, ChargeCanBeCancelled)
+{
+    MemoryBudget budget(100);
+    ASSERT_TRUE(budget.tryCharge(100));
+
+    std::atomic<bool> cancelled = false;
+    std::atomic<bool> charged = true;
+    std::thread waiter([&]
+    {
+        charged = budget.charge(10, [&] { return cancelled.load(); });
+    });
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    cancelled = true;
+    budget.wakeAll();
+    waiter.join();
+
+    EXPECT_FALSE(charged);
+    EXPECT_EQ(budget.used(), 100u);
+}
+
+TEST(BlockPool, ReusesAlignedBlocks)
+{
+    for (std::size_t blockSize : { std::size_t(100), std::size_t(65536) })
+    {
+        BlockPool pool(blockSize);
+        const std::uint8_t *first;
+
+        {
+            auto block = pool.tryAcquire();
+            ASSERT_TRUE(block);
+            EXPECT_EQ(block.capacity(), blockSize);
+            EXPECT_EQ(reinterpret_cast<std::uintptr_t>(block.data()) % (blockSize >= 4096 ? 4096 : 64), 0u);
+
+            std::vector<std::uint8_t> data(blockSize, 0x5a);
+            block.append(data.data(), 10);
+            block.append(data.data(), blockSize - 10);
+            EXPECT_EQ(block.size(), blockSize);
+            EXPECT_EQ(block.data()[blockSize - 1], 0x5a);
+
+            first = block.data();
+            EXPECT_EQ(pool.inUse(), 1u);
+        }
+
+        EXPECT_EQ(pool.inUse(), 0u);
+
+        // The released block comes back, empty.
+        auto block = pool.tryAcquire();
+        EXPECT_EQ(block.data(), first);
+        EXPECT_TRUE(block.empty());
+    }
+}
+
+TEST(BlockPool, StaysWithinHalfOfBudget)
+{
+    auto budget = std::make_shared<MemoryBudget>(16 * MiB);
+
+    {
+        BlockPool pool(MiB, budget);
+
+        std::vector<BlockPool::Block> blocks;
+        for (;;)
+        {
+            auto block = pool.tryAcquire();
+            if (!block)
+                break;
+            blocks.push_back(std::move(block));
+        }
+
+        EXPECT_EQ(blocks.size(), 8u);
+        EXPECT_EQ(pool.allocated(), 8 * MiB);
+        EXPECT_EQ(budget->used(), 8 * MiB);
+
+        // A released block is reused without a new charge, even if the budget is exhausted.
+        blocks.pop_back();
+        EXPECT_TRUE(budget->tryCharge(8 * MiB));
+        EXPECT_TRUE(pool.tryAcquire());
+        budget->release(8 * MiB);
+    }
+
+    EXPECT_EQ(budget->used(), 0u);
+}
+
+TEST(BlockPool, StaysWithinMaxBlocks)
+{
+    BlockPool pool(4096, nullptr, true, 3);
+
+    auto a = pool.tryAcquire();
+    auto b = pool.tryAcquire();
+    auto c = pool.tryAcquire();
+    EXPECT_TRUE(a && b && c);
+    EXPECT_FALSE(pool.tryAcquire());
+
+    b = BlockPool::Block();
+    EXPECT_TRUE(pool.tryAcquire());
+}
+
+TEST(BlockPool, SharedBetweenThreads)
+{
+    BlockPool pool(256, nullptr, false, 64);
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t)
+    {
+        threads.emplace_back([&pool, t]()
+        {
+            for (int i = 0; i < 10000; ++i)
+            {
+                auto block = pool.tryAcquire();
+                ASSERT_TRUE(block);
+
+                // A block is never handed to two threads at once.
+                auto value = static_cast<std::uint8_t>(t);
+                block.append(&value, 1);
+                std::this_thread::yield();
+                EXPECT_EQ(block.data()[0], value);
+            }
+        });
+    }
+
+    for (auto& thread : threads)
+        thread.join();
+
+    EXPECT_EQ(pool.inUse(), 0u);
+}
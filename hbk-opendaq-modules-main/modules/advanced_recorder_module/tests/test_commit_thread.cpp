@@ -0,0 +1,105 @@
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <advanced_recorder_module/commit_thread.h>
+#include <advanced_recorder_module/sie/sync_handle.h>
+#include <advanced_recorder_module/sie/vector_io_file.h>
+
+#include "test_helpers.h"
+
+using namespace daq::modules::advanced_recorder_module;
+
+TEST(SyncHandle, DefaultConstructedIsNoOp)
+{
+    hbk::sie::sync_handle handle;
+
+    EXPECT_FALSE(handle);
+    EXPECT_NO_THROW(handle.sync());
+    EXPECT_EQ(handle, hbk::sie::sync_handle());
+}
+
+TEST(SyncHandle, EveryBackendSyncsWrittenData)
+{
+    auto path = std::filesystem::temp_directory_path() / "test_commit_thread_sync.bin";
+
+    for (auto backend : { hbk::sie::io_backend::posix, hbk::sie::io_backend::io_uring, hbk::sie::io_backend::mmap })
+    {
+        std::string payload(10000, 'x');
+        hbk::sie::sync_handle handle;
+
+        {
+            hbk::sie::vector_io_file file(path.string(), backend);
+            file.write(payload.data(), payload.size());
+
+            handle = file.prepare_sync();
+            EXPECT_TRUE(handle);
+            EXPECT_EQ(handle, file.prepare_sync());
+            EXPECT_NO_THROW(handle.sync());
+            EXPECT_NO_THROW(file.sync());
+        }
+
+        // The handle outlives the file.
+        EXPECT_NO_THROW(handle.sync());
+        EXPECT_EQ(readFile(path), std::vector<char>(payload.begin(), payload.end()));
+    }
+
+    std::filesystem::remove(path);
+}
+
+TEST(CommitThread, CommitsRequestedPosition)
+{
+    auto path = std::filesystem::temp_directory_path() / "test_commit_thread_position.bin";
+
+    CommitStatistics stats;
+
+    {
+        hbk::sie::vector_io_file file(path.string(), hbk::sie::io_backend::posix);
+        CommitThread thread;
+
+        std::string payload(4096, 'y');
+        for (std::uint64_t i = 1; i <= 10; ++i)
+        {
+            file.write(payload.data(), payload.size());
+            thread.request(file.prepare_sync(), i * payload.size());
+        }
+
+        thread.stop();
+        stats = thread.collectStatistics();
+    }
+
+    // Requests made while a commit is running are coalesced, so there may be fewer commits
+    // than requests, but never more.
+    EXPECT_GE(stats.commits, 1u);
+    EXPECT_LE(stats.commits, 10u);
+    EXPECT_EQ(stats.bytesCommitted, 10u * 4096u);
+    EXPECT_GE(stats.latencyMax, stats.latencyP50);
+
+    std::filesystem::remove(path);
+}
+
+TEST(CommitThread, IgnoresRequestsAfterStop)
+{
+    auto path = std::filesystem::temp_directory_path() / "test_commit_thread_stopped.bin";
+
+    {
+        hbk::sie::vector_io_file file(path.string(), hbk::sie::io_backend::posix);
+        CommitThread thread;
+
+        thread.stop();
+        thread.stop();
+
+        thread.request(file.prepare_sync(), 100);
+        EXPECT_FALSE(thread.pending());
+
+        auto stats = thread.collectStatistics();
+        EXPECT_EQ(stats.commits, 0u);
+        EXPECT_EQ(stats.bytesCommitted, 0u);
+    }
+
+    std::filesystem::remove(path);
+}
@@ -0,0 +1,100 @@
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include <boost/crc.hpp>
+#include <gtest/gtest.h>
+
+#include <advanced_recorder_module/sie/crc32.h>
+
+using namespace hbk::sie;
+
+static std::vector<std::uint8_t> randomBytes(std::size_t size)
+{
+    std::mt19937 rng(12345);
+    std::vector<std::uint8_t> bytes(size);
+    for (auto& byte : bytes)
+        byte = static_cast<std::uint8_t>(rng());
+    return bytes;
+}
+
+static std::uint32_t boostCrc(const std::uint8_t *data, std::size_t size)
+{
+    boost::crc_32_type crc;
+    crc.process_bytes(data, size);
+    return crc();
+}
+
+static std::vector<detail::crc32::update_function> supportedImplementations()
+{
+    std::vector<detail::crc32::update_function> implementations
+    {
+        &detail::crc32::update_bytewise,
+        &detail::crc32::update_slice_by_16,
+    };
+
+#ifdef HBK_SIE_CRC32_X86
+    if (detail::crc32::cpu_has_pclmul())
+        implementations.push_back(&detail::crc32::update_pclmul);
+#endif
+#ifdef HBK_SIE_CRC32_ARM
+    if (detail::crc32::cpu_has_armv8_crc())
+        implementations.push_back(&detail::crc32::update_armv8);
+#endif
+
+    return implementations;
+}
+
+TEST(Crc32, KnownValue)
+{
+    const char data[] = "123456789";
+
+    crc32 crc;
+    crc.process_bytes(data, 9);
+
+    EXPECT_EQ(crc(), 0xCBF43926u);
+}
+
+TEST(Crc32, EmptyInput)
+{
+    crc32 crc;
+    EXPECT_EQ(crc(), 0u);
+}
+
+TEST(Crc32, AllImplementationsMatchBoost)
+{
+    auto bytes = randomBytes(4096 + 16);
+
+    for (auto update : supportedImplementations())
+    {
+        for (std::size_t offset = 0; offset < 16; ++offset)
+        {
+            for (std::size_t size : { 0, 1, 7, 15, 16, 17, 63, 64, 65, 127, 128, 129, 200, 1000, 4096 })
+            {
+                const std::uint8_t *data = bytes.data() + offset;
+                EXPECT_EQ(
+                    update(0xFFFFFFFFu, data, size) ^ 0xFFFFFFFFu,
+                    boostCrc(data, size))
+                    << "offset=" << offset << " size=" << size;
+            }
+        }
+    }
+}
+
+TEST(Crc32, IncrementalMatchesBoost)
+{
+    auto bytes = randomBytes(10000);
+
+    crc32 crc;
+    boost::crc_32_type expected;
+
+    std::size_t pos = 0;
+    for (std::size_t chunk = 1; pos + chunk <= bytes.size(); chunk = chunk * 3 + 1)
+    {
+        crc.process_bytes(bytes.data() + pos, chunk);
+        expected.process_bytes(bytes.data() + pos, chunk);
+        pos += chunk;
+        EXPECT_EQ(crc(), expected());
+    }
+}
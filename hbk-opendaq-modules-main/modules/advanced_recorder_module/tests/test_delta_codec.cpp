@@ -0,0 +1,148 @@
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <advanced_recorder_module/sie/delta_codec.h>
+
+using namespace hbk::sie;
+
+template <typename T>
+static std::vector<std::uint8_t> encode(const std::vector<T>& values)
+{
+    std::vector<std::uint8_t> encoded(delta_encode_bound<T>(values.size()));
+    encoded.resize(delta_encode<T>(values.data(), values.size(), encoded.data()));
+    return encoded;
+}
+
+/**
+ * Compresses and decompresses the values, and checks that the result is identical.
+ *
+ * @return The compressed size.
+ */
+template <typename T>
+static std::size_t roundTrip(const std::vector<T>& values)
+{
+    auto encoded = encode(values);
+
+    std::vector<T> decoded(values.size());
+    EXPECT_TRUE(delta_decode<T>(encoded.data(), encoded.size(), decoded.size(), decoded.data()));
+    EXPECT_EQ(decoded, values);
+
+    return encoded.size();
+}
+
+/**
+ * Generates ADC-like values: a random walk with steps of up to +/- @p step, which wraps around
+ * at the limits of @p T, interspersed with jumps between the extreme values.
+ */
+template <typename T>
+static std::vector<T> randomWalk(std::size_t count, int step)
+{
+    std::mt19937 rng(12345);
+    std::uniform_int_distribution<int> steps(-step, step);
+
+    std::vector<T> values(count);
+    auto value = static_cast<std::make_unsigned_t<T>>(rng());
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        value = static_cast<std::make_unsigned_t<T>>(value + steps(rng));
+        values[i] = static_cast<T>(value);
+    }
+
+    for (std::size_t i = 700; i + 1 < count; i += 997)
+    {
+        values[i] = std::numeric_limits<T>::min();
+        values[i + 1] = std::numeric_limits<T>::max();
+    }
+
+    return values;
+}
+
+template <typename T>
+class DeltaCodec : public testing::Test
+{
+};
+
+typedef testing::Types<
+    std::int8_t, std::uint8_t,
+    std::int16_t, std::uint16_t,
+    std::int32_t, std::uint32_t,
+    std::int64_t, std::uint64_t> IntegerTypes;
+
+TYPED_TEST_SUITE(DeltaCodec, IntegerTypes);
+
+TYPED_TEST(DeltaCodec, RoundTrips)
+{
+    for (std::size_t count : { 0, 1, 2, 255, 256, 257, 5000 })
+        for (int step : { 0, 1, 100, 1000000 })
+            roundTrip(randomWalk<TypeParam>(count, step));
+}
+
+TYPED_TEST(DeltaCodec, DetectsTruncatedInput)
+{
+    auto values = randomWalk<TypeParam>(600, 100);
+    auto encoded = encode(values);
+    std::vector<TypeParam> decoded(values.size());
+
+    for (std::size_t size = 0; size < encoded.size(); ++size)
+        EXPECT_FALSE(delta_decode<TypeParam>(encoded.data(), size, decoded.size(), decoded.data()));
+}
+
+TEST(DeltaCodec, CompressesSlowlyChangingCounts)
+{
+    // An int16 ADC signal with small noise takes a few bits per value, plus one byte per frame.
+    std::vector<std::int16_t> counts(100000);
+    std::mt19937 rng(12345);
+    for (std::size_t i = 0; i < counts.size(); ++i)
+        counts[i] = static_cast<std::int16_t>(1000 + (i / 100) % 50 + static_cast<int>(rng() % 7));
+
+    EXPECT_LT(roundTrip(counts) * 3, counts.size() * sizeof(std::int16_t));
+
+    // A constant signal takes one byte per frame.
+    std::vector<std::int32_t> constant(2560, -42);
+    EXPECT_EQ(roundTrip(constant), sizeof(std::int32_t) + 10);
+}
+
+TEST(DeltaCodec, UnpackImplementationsAgree)
+{
+    using namespace detail::delta_codec;
+
+    std::mt19937 rng(12345);
+
+    for (unsigned bits = 1; bits <= 32; ++bits)
+    {
+        std::vector<std::uint32_t> values(FRAME_SIZE);
+        for (auto& value : values)
+            value = bits == 32 ? static_cast<std::uint32_t>(rng()) : static_cast<std::uint32_t>(rng()) & ((1u << bits) - 1);
+
+        std::vector<std::uint8_t> packed(FRAME_BYTES_PER_BIT * bits);
+        pack(values.data(), bits, packed.data());
+
+        std::vector<std::uint32_t> expected(FRAME_SIZE);
+        unpack_scalar<std::uint32_t>(packed.data(), bits, 123456789u, expected.data());
+
+        // The scalar implementation is checked against a plain zigzag decode and prefix sum.
+        std::uint32_t previous = 123456789u;
+        for (std::size_t i = 0; i < FRAME_SIZE; ++i)
+        {
+            previous += (values[i] >> 1) ^ (0u - (values[i] & 1));
+            ASSERT_EQ(expected[i], previous) << "bits " << bits << ", index " << i;
+        }
+
+        std::vector<std::uint32_t> actual(FRAME_SIZE);
+        unpack32(packed.data(), bits, 123456789u, actual.data());
+        EXPECT_EQ(actual, expected) << "bits " << bits;
+
+#ifdef HBK_SIE_DELTA_X86
+        if (cpu_has_avx2())
+        {
+            unpack_avx2(packed.data(), bits, 123456789u, actual.data());
+            EXPECT_EQ(actual, expected) << "bits " << bits;
+        }
+#endif
+    }
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <vector>
+
+#include <advanced_recorder_module/sie/format.h>
+#include <advanced_recorder_module/sie/writer.h>
+#include <advanced_recorder_module/sie/xml.h>
+
+/**
+ * The groups the blocks of a test file are written to.
+ */
+static constexpr std::uint32_t DATA_GROUP = 3;
+static constexpr std::uint32_t OTHER_GROUP = 4;
+
+/**
+ * The number of blocks in a test file.
+ */
+static constexpr std::uint32_t BLOCK_COUNT = 250;
+
+/**
+ * Gets the group of the @p i-th block of a test file which uses both groups: every fifth block
+ * goes to OTHER_GROUP, the others to DATA_GROUP.
+ */
+inline std::uint32_t testGroup(std::uint32_t i)
+{
+    return i % 5 ? DATA_GROUP : OTHER_GROUP;
+}
+
+inline std::vector<char> readFile(const std::filesystem::path& path)
+{
+    std::ifstream in(path, std::ios::binary);
+    return std::vector<char>(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+/**
+ * Creates an indexed SIE writer for a test file at @p path.
+ */
+inline hbk::sie::writer openTestFile(
+    const std::filesystem::path& path,
+    hbk::sie::io_backend backend = hbk::sie::io_backend::posix,
+    std::size_t indexEvery = hbk::sie::indexed_writer::DEFAULT_INDEX_EVERY)
+{
+    return hbk::sie::writer(hbk::sie::indexed_writer(
+        hbk::sie::block_writer(hbk::sie::vector_io_file(path.string(), backend)), indexEvery));
+}
+
+/**
+ * Writes the metadata of a test file: the SIE preamble followed by an empty test element.
+ */
+inline void writeTestMetadata(hbk::sie::writer& w)
+{
+    std::ostringstream os;
+    os << hbk::sie::PREAMBLE;
+    hbk::sie::xml::element("test").add_attribute("id", "0").serialize(os, 1);
+    w.write_metadata(os.str());
+}
+
+/**
+ * Writes a test file of BLOCK_COUNT blocks, calling @p writeBlock with the writer and the index
+ * of each block to write it.
+ */
+template <typename WriteBlock>
+void writeTestFile(
+    const std::filesystem::path& path,
+    WriteBlock writeBlock,
+    hbk::sie::io_backend backend = hbk::sie::io_backend::posix,
+    std::size_t indexEvery = hbk::sie::indexed_writer::DEFAULT_INDEX_EVERY)
+{
+    auto w = openTestFile(path, backend, indexEvery);
+    writeTestMetadata(w);
+
+    for (std::uint32_t i = 0; i < BLOCK_COUNT; ++i)
+        writeBlock(w, i);
+}
@@ -0,0 +1,353 @@
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <boost/endian/conversion.hpp>
+#include <gtest/gtest.h>
+
+#include <advanced_recorder_module/sie/format.h>
+#include <advanced_recorder_module/sie/reader.h>
+#include <advanced_recorder_module/sie/writer.h>
+#include <advanced_recorder_module/sie/xml_parser.h>
+
+#include "test_helpers.h"
+
+using namespace hbk::sie;
+
+/**
+ * Writes the @p i-th block of a test file, holding the value @p i for 100 ticks.
+ */
+static void writeValueBlock(writer& w, std::uint32_t i)
+{
+    w.write_timed_block(testGroup(i),
+        i * 100, i * 100 + 99,
+        &i, sizeof(i));
+}
+
+/**
+ * Writes the same block as writeValueBlock(), but from a buffer the file retains.
+ */
+static void writeRetainedValueBlock(writer& w, std::uint32_t i)
+{
+    auto owner = std::make_shared<std::uint32_t>(i);
+    auto data = owner.get();
+    w.write_timed_block_retained(testGroup(i),
+        i * 100, i * 100 + 99,
+        std::move(owner),
+        data, sizeof(*data));
+}
+
+TEST(Reader, UsesIndexBlocks)
+{
+    auto path = std::filesystem::temp_directory_path() / "test_reader_indexed.sie";
+    writeTestFile(path, writeValueBlock);
+
+    {
+        reader r(path.string());
+
+        EXPECT_TRUE(r.indexed());
+        EXPECT_EQ(r.data_end(), std::filesystem::file_size(path));
+        EXPECT_EQ(r.blocks(groups::METADATA).size(), 1u);
+        EXPECT_EQ(r.blocks(DATA_GROUP).size(), BLOCK_COUNT * 4 / 5);
+        EXPECT_EQ(r.blocks(OTHER_GROUP).size(), BLOCK_COUNT / 5);
+        EXPECT_EQ(r.blocks(groups::INDEX).size(), 3u);
+        EXPECT_EQ(r.blocks(groups::TIME_INDEX).size(), 3u);
+        EXPECT_TRUE(r.blocks(42).empty());
+
+        std::uint32_t expected = 1;
+        for (auto offset : r.blocks(DATA_GROUP))
+        {
+            auto block = r.block_at(offset);
+            ASSERT_EQ(block.group, DATA_GROUP);
+            ASSERT_EQ(block.payload_size, sizeof(std::uint32_t));
+            EXPECT_TRUE(block.verify());
+
+            std::uint32_t value;
+            std::memcpy(&value, block.payload, sizeof(value));
+            EXPECT_EQ(value, expected);
+
+            if (++expected % 5 == 0)
+                ++expected;
+        }
+    }
+
+    std::filesystem::remove(path);
+}
+
+TEST(Reader, RetainedBlocksMatchCopiedBlocks)
+{
+    auto dir = std::filesystem::temp_directory_path();
+    auto copiedPath = dir / "test_reader_copied.sie";
+    auto retainedPath = dir / "test_reader_retained.sie";
+
+    writeTestFile(copiedPath, writeValueBlock);
+    writeTestFile(retainedPath, writeRetainedValueBlock, io_backend::io_uring);
+
+    EXPECT_EQ(readFile(retainedPath), readFile(copiedPath));
+
+    {
+        reader r(retainedPath.string());
+        EXPECT_EQ(r.blocks(DATA_GROUP).size(), BLOCK_COUNT * 4 / 5);
+    }
+
+    std::filesystem::remove(copiedPath);
+    std::filesystem::remove(retainedPath);
+}
+
+TEST(Reader, ScansTruncatedFile)
+{
+    auto path = std::filesystem::temp_directory_path() / "test_reader_truncated.sie";
+    writeTestFile(path, writeValueBlock);
+
+    // Cut off the closing index blocks and part of the last data block.
+    std::uintmax_t truncatedSize;
+    {
+        reader r(path.string());
+        truncatedSize = r.blocks(groups::TIME_INDEX).back() - 10;
+    }
+    std::filesystem::resize_file(path, truncatedSize);
+
+    {
+        reader r(path.string());
+
+        EXPECT_FALSE(r.indexed());
+        EXPECT_LT(r.data_end(), truncatedSize);
+        EXPECT_EQ(r.blocks(groups::METADATA).size(), 1u);
+        EXPECT_EQ(r.blocks(DATA_GROUP).size() + r.blocks(OTHER_GROUP).size(), BLOCK_COUNT - 1);
+
+        for (const auto& [group, offsets] : r.groups())
+            for (auto offset : offsets)
+                EXPECT_TRUE(r.block_at(offset).verify());
+    }
+
+    std::filesystem::remove(path);
+}
+
+TEST(Reader, DetectsCorruptPayload)
+{
+    auto path = std::filesystem::temp_directory_path() / "test_reader_corrupt.sie";
+    writeTestFile(path, writeValueBlock);
+
+    std::uint64_t offset;
+    {
+        reader r(path.string());
+        offset = r.blocks(DATA_GROUP).front();
+    }
+
+    {
+        std::fstream f(path, std::ios::in | std::ios::out | std::ios::binary);
+        f.seekp(offset + sizeof(block_header));
+        f.put('\xFF');
+    }
+
+    {
+        reader r(path.string());
+        EXPECT_FALSE(r.block_at(offset).verify());
+        EXPECT_THROW(r.block_at(offset + 1), std::runtime_error);
+    }
+
+    std::filesystem::remove(path);
+}
+
+TEST(Reader, ParsesMetadata)
+{
+    auto path = std::filesystem::temp_directory_path() / "test_reader_metadata.sie";
+    writeTestFile(path, writeValueBlock);
+
+    {
+        reader r(path.string());
+        const auto& root = r.metadata();
+
+        EXPECT_EQ(root.name(), "sie");
+
+        std::vector<std::string> decoders;
+        bool foundTest = false;
+        for (const auto& child : root.children())
+        {
+            if (child.name() == "decoder")
+                decoders.emplace_back(child.attributes().front().value);
+            if (child.name() == "test")
+                foundTest = true;
+        }
+
+        EXPECT_EQ(decoders, (std::vector<std::string> { "0", "1", "2" }));
+        EXPECT_TRUE(foundTest);
+    }
+
+    std::filesystem::remove(path);
+}
+
+TEST(Reader, FindsBlocksInTimeRange)
+{
+    auto path = std::filesystem::temp_directory_path() / "test_reader_time.sie";
+    writeTestFile(path, writeValueBlock);
+
+    {
+        reader r(path.string());
+
+        EXPECT_EQ(r.time_index(DATA_GROUP).size(), r.blocks(DATA_GROUP).size());
+        EXPECT_EQ(r.time_index(OTHER_GROUP).size(), r.blocks(OTHER_GROUP).size());
+
+        // Ticks 1050..1250 span blocks 10 (OTHER_GROUP), 11 and 12 (DATA_GROUP).
+        auto found = r.blocks_in_range(DATA_GROUP, 1050, 1250);
+        ASSERT_EQ(found.size(), 2u);
+        EXPECT_EQ(found[0].first, 1100);
+        EXPECT_EQ(found[1].first, 1200);
+
+        for (const auto& timed : found)
+        {
+            auto block = r.block_at(timed.offset);
+            std::uint32_t value;
+            std::memcpy(&value, block.payload, sizeof(value));
+            EXPECT_EQ(static_cast<std::int64_t>(value) * 100, timed.first);
+        }
+
+        found = r.blocks_in_range(OTHER_GROUP, 1050, 1250);
+        ASSERT_EQ(found.size(), 1u);
+        EXPECT_EQ(found[0].first, 1000);
+
+        EXPECT_EQ(r.blocks_in_range(DATA_GROUP, 1199, 1199).size(), 1u);
+        EXPECT_TRUE(r.blocks_in_range(DATA_GROUP, 100000, 200000).empty());
+        EXPECT_TRUE(r.blocks_in_range(DATA_GROUP, -100, -1).empty());
+        EXPECT_EQ(r.blocks_in_range(DATA_GROUP, 0, 1000000).size(), r.blocks(DATA_GROUP).size());
+    }
+
+    std::filesystem::remove(path);
+}
+
+/**
+ * Removes the last block of a file, using the size in its footer.
+ */
+static void removeLastBlock(const std::filesystem::path& path)
+{
+    auto contents = readFile(path);
+    ASSERT_GE(contents.size(), sizeof(block_footer));
+
+    std::uint32_t size;
+    std::memcpy(&size, contents.data() + contents.size() - sizeof(size), sizeof(size));
+    std::filesystem::resize_file(path, contents.size() - boost::endian::big_to_native(size));
+}
+
+TEST(Reader, UsesIndexDirectories)
+{
+    auto path = std::filesystem::temp_directory_path() / "test_reader_directories.sie";
+
+    // With four blocks per index block and four index blocks per directory, the 250 blocks
+    // need several levels of directories.
+    writeTestFile(path, writeValueBlock, io_backend::posix, 4);
+
+    std::map<std::uint32_t, std::vector<std::uint64_t>> expected;
+    {
+        reader r(path.string());
+
+        EXPECT_TRUE(r.has_directory());
+        EXPECT_TRUE(r.indexed());
+        EXPECT_EQ(r.blocks(DATA_GROUP).size(), BLOCK_COUNT * 4 / 5);
+        EXPECT_EQ(r.blocks(OTHER_GROUP).size(), BLOCK_COUNT / 5);
+        EXPECT_EQ(r.time_index(DATA_GROUP).size(), BLOCK_COUNT * 4 / 5);
+        expected = r.groups();
+    }
+
+    // Without the trailer, the file still ends with a directory leading to every index block.
+    removeLastBlock(path);
+    {
+        reader r(path.string());
+
+        EXPECT_TRUE(r.has_directory());
+        EXPECT_TRUE(r.indexed());
+        EXPECT_EQ(r.groups(), expected);
+    }
+
+    // Without the last directory, the chain of index blocks is walked, skipping the others.
+    removeLastBlock(path);
+    {
+        reader r(path.string());
+
+        EXPECT_FALSE(r.has_directory());
+        EXPECT_TRUE(r.indexed());
+        EXPECT_EQ(r.groups(), expected);
+    }
+
+    std::filesystem::remove(path);
+}
+
+TEST(Reader, SharesDecodersBetweenTests)
+{
+    auto path = std::filesystem::temp_directory_path() / "test_reader_tests.sie";
+
+    {
+        writer w(indexed_writer(block_writer(vector_io_file(path.string(), io_backend::posix))));
+        w.write_metadata(PREAMBLE);
+
+        auto makeDecoder = [](unsigned id)
+        {
+            return decoder(id).add_child(read("v0", "uint", 32)).add_child(sample());
+        };
+
+        std::string definition;
+        makeDecoder(0).serialize(definition);
+
+        // Each test records the same signal through a new channel and group.
+        for (unsigned testId = 0; testId < 3; ++testId)
+        {
+            auto [decoderId, created] = w.intern_decoder(definition);
+            EXPECT_EQ(decoderId, 3u);
+            EXPECT_EQ(created, testId == 0);
+
+            std::string xml;
+            if (created)
+                makeDecoder(decoderId).serialize(xml, 1);
+            test(testId)
+                .add_child(channel(w.allocate_channel(), w.allocate_group(), "signal")
+                    .add_child(dimension(0).add_child(data(decoderId, 0))))
+                .serialize(xml, 1);
+            w.write_metadata(xml);
+        }
+
+        // A decoder with a different definition gets its own id.
+        auto [otherId, otherCreated] = w.intern_decoder("other");
+        EXPECT_EQ(otherId, 4u);
+        EXPECT_TRUE(otherCreated);
+    }
+
+    {
+        reader r(path.string());
+
+        std::vector<std::string> decoders;
+        std::vector<std::string> tests;
+        for (const auto& child : r.metadata().children())
+        {
+            if (child.name() == "decoder")
+                decoders.emplace_back(child.attributes().front().value);
+            if (child.name() == "test")
+                tests.emplace_back(child.attributes().front().value);
+        }
+
+        EXPECT_EQ(decoders, (std::vector<std::string> { "0", "1", "2", "3" }));
+        EXPECT_EQ(tests, (std::vector<std::string> { "0", "1", "2" }));
+    }
+
+    std::filesystem::remove(path);
+}
+
+TEST(XmlParser, Entities)
+{
+    auto root = xml::parse("<a x=\"&lt;&amp;&#65;&#x42;\"><b>c &gt; d</b><![CDATA[<e>]]></a>");
+
+    EXPECT_EQ(root.name(), "a");
+    EXPECT_EQ(root.attributes().front().value, "<&AB");
+    EXPECT_EQ(root.children().front().content(), "c > d");
+    EXPECT_EQ(root.content(), "<e>");
+}
+
+TEST(XmlParser, Malformed)
+{
+    EXPECT_THROW(xml::parse("<a></b>"), std::runtime_error);
+    EXPECT_THROW(xml::parse("<a x=1/>"), std::runtime_error);
+    EXPECT_THROW(xml::parse("   "), std::runtime_error);
+}
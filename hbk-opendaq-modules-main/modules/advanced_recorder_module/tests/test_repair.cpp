@@ -0,0 +1,152 @@
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <advanced_recorder_module/sie/format.h>
+#include <advanced_recorder_module/sie/reader.h>
+#include <advanced_recorder_module/sie/repair.h>
+#include <advanced_recorder_module/sie/writer.h>
+
+#include "test_helpers.h"
+
+using namespace hbk::sie;
+
+/**
+ * Writes the @p i-th block of a test file, holding a varying number of copies of the value @p i
+ * for 100 ticks. All blocks go to DATA_GROUP.
+ */
+static void writeVaryingBlock(writer& w, std::uint32_t i)
+{
+    std::vector<std::uint32_t> values(1 + i % 50, i);
+    w.write_timed_block(DATA_GROUP,
+        i * 100, i * 100 + 99,
+        values.data(), values.size() * sizeof(std::uint32_t));
+}
+
+/**
+ * Gets the offsets of the data blocks of a test file, in file order.
+ */
+static std::vector<std::uint64_t> dataBlocks(const std::filesystem::path& path)
+{
+    reader r(path.string());
+    return r.blocks(DATA_GROUP);
+}
+
+TEST(Repair, LeavesIntactFileUnchanged)
+{
+    auto path = std::filesystem::temp_directory_path() / "test_repair_intact.sie";
+    writeTestFile(path, writeVaryingBlock);
+    auto expected = readFile(path);
+
+    auto report = repair(path.string());
+
+    EXPECT_TRUE(report.intact());
+    EXPECT_FALSE(report.repaired);
+    EXPECT_EQ(report.valid_size, expected.size());
+    EXPECT_EQ(readFile(path), expected);
+
+    std::filesystem::remove(path);
+}
+
+TEST(Repair, RebuildsIndexOfTruncatedFile)
+{
+    auto path = std::filesystem::temp_directory_path() / "test_repair_truncated.sie";
+    writeTestFile(path, writeVaryingBlock);
+
+    // Cut the file in the middle of a data block after the second index block, as if the
+    // recording process had crashed while writing it.
+    auto blocks = dataBlocks(path);
+    std::filesystem::resize_file(path, blocks[230] + 10);
+
+    // The check is read-only, but reports the same as the repair.
+    auto checked = check(path.string(), 3);
+    EXPECT_FALSE(checked.intact());
+    EXPECT_EQ(std::filesystem::file_size(path), blocks[230] + 10);
+
+    auto report = repair(path.string(), 3);
+
+    EXPECT_TRUE(report.repaired);
+    EXPECT_EQ(report.file_size, blocks[230] + 10);
+    EXPECT_EQ(report.valid_size, blocks[230]);
+    EXPECT_EQ(report.valid_size, checked.valid_size);
+    EXPECT_EQ(report.unindexed_blocks, checked.unindexed_blocks);
+    EXPECT_GT(report.unindexed_blocks, 0u);
+
+    {
+        reader r(path.string());
+
+        EXPECT_TRUE(r.has_directory());
+        EXPECT_TRUE(r.indexed());
+        EXPECT_EQ(r.blocks(DATA_GROUP).size(), 230u);
+        EXPECT_EQ(r.blocks(groups::METADATA).size(), 1u);
+
+        for (auto offset : r.blocks(DATA_GROUP))
+            EXPECT_TRUE(r.block_at(offset).verify());
+    }
+
+    EXPECT_TRUE(check(path.string()).intact());
+
+    std::filesystem::remove(path);
+}
+
+TEST(Repair, TruncatesAtCorruptBlock)
+{
+    auto path = std::filesystem::temp_directory_path() / "test_repair_corrupt.sie";
+    writeTestFile(path, writeVaryingBlock);
+
+    // Flip a payload bit in one data block, so its header and footer are consistent but its
+    // checksum is not. Everything from that block on is discarded.
+    auto blocks = dataBlocks(path);
+    {
+        std::fstream f(path, std::ios::binary | std::ios::in | std::ios::out);
+        f.seekg(blocks[50] + sizeof(block_header));
+        char c = static_cast<char>(f.get());
+        f.seekp(blocks[50] + sizeof(block_header));
+        f.put(static_cast<char>(c ^ 1));
+    }
+
+    auto report = repair(path.string(), 4);
+
+    EXPECT_TRUE(report.repaired);
+    EXPECT_EQ(report.valid_size, blocks[50]);
+
+    {
+        reader r(path.string());
+
+        EXPECT_TRUE(r.indexed());
+        EXPECT_EQ(r.blocks(DATA_GROUP).size(), 50u);
+    }
+
+    std::filesystem::remove(path);
+}
+
+TEST(Repair, DiscardsPreallocatedSpace)
+{
+    auto path = std::filesystem::temp_directory_path() / "test_repair_preallocated.sie";
+    writeTestFile(path, writeVaryingBlock);
+
+    // A file written through a memory mapping is extended ahead of the data, and the unwritten
+    // space remains zero-filled if the recording process crashes.
+    auto size = std::filesystem::file_size(path);
+    std::filesystem::resize_file(path, size + 1024 * 1024);
+
+    auto report = repair(path.string(), 1);
+
+    EXPECT_TRUE(report.repaired);
+    EXPECT_EQ(report.valid_size, size);
+    EXPECT_EQ(report.unindexed_blocks, 0u);
+    EXPECT_EQ(std::filesystem::file_size(path), size);
+
+    {
+        reader r(path.string());
+
+        EXPECT_TRUE(r.indexed());
+        EXPECT_EQ(r.blocks(DATA_GROUP).size(), BLOCK_COUNT);
+    }
+
+    std::filesystem::remove(path);
+}
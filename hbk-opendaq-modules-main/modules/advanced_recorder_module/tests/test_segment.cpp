@@ -0,0 +1,18 @@
+#include <gtest/gtest.h>
+
+#include <advanced_recorder_module/segment.h>
+
+using namespace daq::modules::advanced_recorder_module;
+
+TEST(Segment, FormatsFilename)
+{
+    EXPECT_EQ(formatSegmentFilename("{base}_{seq:04}.sie", "/data/run.sie", 7), "/data/run_0007.sie");
+    EXPECT_EQ(formatSegmentFilename("{base}-{seq}{ext}", "run.sie", 12), "run-12.sie");
+    EXPECT_EQ(formatSegmentFilename("{base}_{seq:2}{ext}", "run", 123), "run_123");
+}
+
+TEST(Segment, KeepsUnknownPlaceholders)
+{
+    EXPECT_EQ(formatSegmentFilename("{base}_{date}_{seq}", "run.sie", 1), "run_{date}_1");
+    EXPECT_EQ(formatSegmentFilename("{base}_{seq", "run.sie", 1), "run_{seq");
+}
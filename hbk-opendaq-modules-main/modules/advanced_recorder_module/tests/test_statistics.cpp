@@ -0,0 +1,51 @@
+#include <chrono>
+
+#include <gtest/gtest.h>
+
+#include <advanced_recorder_module/statistics.h>
+
+using namespace daq::modules::advanced_recorder_module;
+using std::chrono::nanoseconds;
+
+TEST(LatencyHistogram, Empty)
+{
+    LatencyHistogram h;
+    EXPECT_EQ(h.size(), 0u);
+    EXPECT_EQ(h.percentile(0.5), nanoseconds(0));
+    EXPECT_EQ(h.max(), nanoseconds(0));
+}
+
+TEST(LatencyHistogram, Percentiles)
+{
+    LatencyHistogram h;
+    for (int i = 1; i <= 1000; ++i)
+        h.record(nanoseconds(i * 1000));
+
+    EXPECT_EQ(h.size(), 1000u);
+    EXPECT_EQ(h.max(), nanoseconds(1000000));
+
+    // Each bucket spans at most 25% of its lower bound.
+    auto p50 = h.percentile(0.5).count();
+    EXPECT_GE(p50, 500000);
+    EXPECT_LE(p50, 500000 * 5 / 4);
+
+    auto p99 = h.percentile(0.99).count();
+    EXPECT_GE(p99, 990000);
+    EXPECT_LE(p99, 1000000);
+
+    EXPECT_EQ(h.percentile(1.0), h.max());
+
+    h.reset();
+    EXPECT_EQ(h.size(), 0u);
+    EXPECT_EQ(h.max(), nanoseconds(0));
+}
+
+TEST(LatencyHistogram, SmallAndNegativeValues)
+{
+    LatencyHistogram h;
+    h.record(nanoseconds(-5));
+    h.record(nanoseconds(3));
+
+    EXPECT_EQ(h.percentile(0), nanoseconds(0));
+    EXPECT_EQ(h.percentile(0.99), nanoseconds(3));
+}
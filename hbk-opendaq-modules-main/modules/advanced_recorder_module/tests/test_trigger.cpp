@@ -0,0 +1,37 @@
+#include <cstdint>
+
+#include <gtest/gtest.h>
+
+#include <advanced_recorder_module/trigger.h>
+
+using namespace daq::modules::advanced_recorder_module;
+
+TEST(LevelDetector, DetectsSlopes)
+{
+    const double up[] = { 0.0, 0.5, 1.0, 1.5 };
+    const double down[] = { 1.5, 1.0, 0.5, 0.0 };
+
+    LevelDetector rising(1.0, TriggerSlope::Rising);
+    EXPECT_TRUE(rising.process(up, 4));
+    EXPECT_FALSE(rising.process(down, 4));
+
+    LevelDetector falling(1.0, TriggerSlope::Falling);
+    EXPECT_FALSE(falling.process(up, 4));
+    EXPECT_TRUE(falling.process(down, 4));
+
+    LevelDetector either(1.0, TriggerSlope::Either);
+    EXPECT_TRUE(either.process(up, 4));
+    EXPECT_TRUE(either.process(down, 4));
+}
+
+TEST(LevelDetector, DetectsCrossingBetweenCalls)
+{
+    const std::int16_t below[] = { -5, -3 };
+    const std::int16_t above[] = { 7, 9 };
+
+    LevelDetector detector(0, TriggerSlope::Rising);
+    EXPECT_FALSE(detector.process(below, 2));
+    EXPECT_TRUE(detector.process(above, 2));
+    EXPECT_FALSE(detector.process(above, 2));
+    EXPECT_FALSE(detector.process(above, 0));
+}
@@ -0,0 +1,161 @@
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <advanced_recorder_module/sie/mmap_vector_io_file.h>
+#include <advanced_recorder_module/sie/vector_io_file.h>
+
+#include "test_helpers.h"
+
+template <typename VectorIoFile>
+static void writeTestPattern(VectorIoFile& file)
+{
+    for (std::uint32_t i = 0; i < 1000; ++i)
+    {
+        std::string payload(i % 97, static_cast<char>('a' + i % 26));
+        file.write(
+            &i, sizeof(i),
+            payload.data(), payload.size(),
+            &i, sizeof(i));
+
+        if (i % 100 == 0)
+            file.flush();
+    }
+}
+
+/**
+ * Writes the same data as writeTestPattern(), but with write_retained(). Each payload is owned by
+ * its handle, and each write's weak reference is recorded so the caller can check it was released.
+ */
+template <typename VectorIoFile>
+static void writeRetainedTestPattern(VectorIoFile& file, std::vector<std::weak_ptr<const void>>& handles)
+{
+    for (std::uint32_t i = 0; i < 1000; ++i)
+    {
+        struct owned
+        {
+            std::uint32_t i;
+            std::string payload;
+        };
+
+        auto data = std::make_shared<owned>(owned { i, std::string(i % 97, static_cast<char>('a' + i % 26)) });
+        handles.emplace_back(data);
+
+        file.write_retained(
+            data,
+            &data->i, sizeof(data->i),
+            data->payload.data(), data->payload.size(),
+            &data->i, sizeof(data->i));
+
+        if (i % 100 == 0)
+            file.flush();
+    }
+}
+
+static std::vector<char> writeTestPattern(const std::filesystem::path& path, hbk::sie::io_backend backend)
+{
+    {
+        hbk::sie::vector_io_file file(path.string(), backend);
+        writeTestPattern(file);
+    }
+
+    return readFile(path);
+}
+
+TEST(VectorIoFile, BackendsProduceIdenticalFiles)
+{
+    auto dir = std::filesystem::temp_directory_path();
+    auto posixPath = dir / "test_vector_io_file_posix.bin";
+    auto ioUringPath = dir / "test_vector_io_file_io_uring.bin";
+
+    auto expected = writeTestPattern(posixPath, hbk::sie::io_backend::posix);
+    auto actual = writeTestPattern(ioUringPath, hbk::sie::io_backend::io_uring);
+
+    EXPECT_FALSE(expected.empty());
+    EXPECT_EQ(expected, actual);
+
+    std::filesystem::remove(posixPath);
+    std::filesystem::remove(ioUringPath);
+}
+
+#ifdef HBK_SIE_HAVE_MMAP
+TEST(VectorIoFile, MemoryMappedMatchesPosix)
+{
+    auto dir = std::filesystem::temp_directory_path();
+    auto posixPath = dir / "test_vector_io_file_posix_ref.bin";
+    auto mmapPath = dir / "test_vector_io_file_mmap.bin";
+
+    auto expected = writeTestPattern(posixPath, hbk::sie::io_backend::posix);
+    auto actual = writeTestPattern(mmapPath, hbk::sie::io_backend::mmap);
+
+    EXPECT_EQ(expected, actual);
+
+    std::filesystem::remove(posixPath);
+    std::filesystem::remove(mmapPath);
+}
+
+TEST(VectorIoFile, MemoryMappedCrossesExtents)
+{
+    auto dir = std::filesystem::temp_directory_path();
+    auto posixPath = dir / "test_vector_io_file_posix_ref2.bin";
+    auto mmapPath = dir / "test_vector_io_file_mmap_small.bin";
+
+    auto expected = writeTestPattern(posixPath, hbk::sie::io_backend::posix);
+
+    {
+        // A one-page extent forces the mapping to move many times, including mid-segment.
+        hbk::sie::mmap_vector_io_file file(mmapPath.string(), 1);
+        writeTestPattern(file);
+    }
+
+    EXPECT_EQ(std::filesystem::file_size(mmapPath), expected.size());
+    EXPECT_EQ(readFile(mmapPath), expected);
+
+    std::filesystem::remove(posixPath);
+    std::filesystem::remove(mmapPath);
+}
+#endif
+
+TEST(VectorIoFile, RetainedWritesMatchCopiedWrites)
+{
+    auto dir = std::filesystem::temp_directory_path();
+    auto referencePath = dir / "test_vector_io_file_reference.bin";
+    auto retainedPath = dir / "test_vector_io_file_retained.bin";
+
+    auto expected = writeTestPattern(referencePath, hbk::sie::io_backend::posix);
+
+    for (auto backend : { hbk::sie::io_backend::posix, hbk::sie::io_backend::io_uring, hbk::sie::io_backend::mmap })
+    {
+        std::vector<std::weak_ptr<const void>> handles;
+
+        {
+            hbk::sie::vector_io_file file(retainedPath.string(), backend);
+            writeRetainedTestPattern(file, handles);
+        }
+
+        EXPECT_EQ(readFile(retainedPath), expected);
+
+        for (const auto& handle : handles)
+            EXPECT_TRUE(handle.expired());
+    }
+
+    std::filesystem::remove(referencePath);
+    std::filesystem::remove(retainedPath);
+}
+
+TEST(VectorIoFile, AutomaticSelectsPosix)
+{
+    auto path = std::filesystem::temp_directory_path() / "test_vector_io_file_backend.bin";
+
+    {
+        hbk::sie::vector_io_file file(path.string());
+        EXPECT_EQ(file.backend(), hbk::sie::io_backend::posix);
+    }
+
+    std::filesystem::remove(path);
+}
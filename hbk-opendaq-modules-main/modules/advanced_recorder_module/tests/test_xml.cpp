@@ -0,0 +1,82 @@
+#include <sstream>
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include <advanced_recorder_module/sie/xml.h>
+#include <advanced_recorder_module/sie/xml_parser.h>
+
+using namespace hbk::sie;
+
+TEST(Xml, SerializesNestedElements)
+{
+    auto element = test(1)
+        .add_child(tag("core:name", "a < b & \"c\""))
+        .add_child(xml::element("empty").add_attribute("x", "'y'"))
+        .add_child(channel(2, 3, "Ch").add_child(units("V")));
+
+    std::string xml;
+    element.serialize(xml, 1);
+
+    EXPECT_EQ(xml,
+        " <test id=\"1\">\n"
+        "  <tag id=\"core:name\">a &lt; b &amp; &quot;c&quot;</tag>\n"
+        "  <empty x=\"&apos;y&apos;\"/>\n"
+        "  <ch id=\"2\" group=\"3\" name=\"Ch\">\n"
+        "   <units>V</units>\n"
+        "  </ch>\n"
+        " </test>\n");
+
+    std::ostringstream os;
+    element.serialize(os, 1);
+    EXPECT_EQ(os.str(), xml);
+}
+
+TEST(Xml, AppendsToExistingBuffer)
+{
+    std::string xml = "<sie>\n";
+    decoder(0).serialize(xml, 1);
+    test(0).serialize(xml, 1);
+
+    EXPECT_EQ(xml, "<sie>\n <decoder id=\"0\"/>\n <test id=\"0\"/>\n");
+}
+
+TEST(Xml, CopiesAreIndependent)
+{
+    auto original = test(0).add_child(tag("a", "1"));
+    auto copy = original;
+    copy.add_child(tag("b", "2"));
+
+    EXPECT_EQ(original.children().size(), 1u);
+    ASSERT_EQ(copy.children().size(), 2u);
+    EXPECT_EQ(copy.children().front().content(), "1");
+
+    std::string xml;
+    original = copy;
+    original.serialize(xml);
+    EXPECT_EQ(xml, "<test id=\"0\">\n <tag id=\"a\">1</tag>\n <tag id=\"b\">2</tag>\n</test>\n");
+}
+
+TEST(Xml, BuildsLargeTrees)
+{
+    auto element = test(0);
+    for (unsigned i = 0; i < 1000; ++i)
+        element.add_child(channel(i, i + 3, std::string(100, 'x') + std::to_string(i)));
+
+    ASSERT_EQ(element.children().size(), 1000u);
+
+    unsigned i = 0;
+    for (const auto& child : element.children())
+    {
+        EXPECT_EQ(child.attributes().front().value, std::to_string(i));
+        ++i;
+    }
+
+    std::string xml;
+    element.serialize(xml);
+
+    auto parsed = xml::parse(xml);
+    std::string reserialized;
+    parsed.serialize(reserialized);
+    EXPECT_EQ(reserialized, xml);
+}
@@ -0,0 +1,124 @@
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <advanced_recorder_module/sie/xor_codec.h>
+
+using namespace hbk::sie;
+
+template <typename T>
+static std::vector<std::uint8_t> encode(const std::vector<T>& values)
+{
+    std::vector<std::uint8_t> encoded(xor_encode_bound<T>(values.size()));
+    encoded.resize(xor_encode<T>(values.data(), values.size(), encoded.data()));
+    return encoded;
+}
+
+/**
+ * Compresses and decompresses the values, and checks that the result is bit-identical.
+ *
+ * @return The compressed size.
+ */
+template <typename T>
+static std::size_t roundTrip(const std::vector<T>& values)
+{
+    auto encoded = encode(values);
+
+    std::vector<T> decoded(values.size());
+    EXPECT_TRUE(xor_decode<T>(encoded.data(), encoded.size(), decoded.size(), decoded.data()));
+    for (std::size_t i = 0; i < values.size(); ++i)
+        EXPECT_EQ(std::memcmp(&decoded[i], &values[i], sizeof(T)), 0) << "at index " << i;
+
+    return encoded.size();
+}
+
+template <typename T>
+static std::vector<T> slowlyVarying(std::size_t count)
+{
+    // A temperature-like signal: a slow drift, quantized to 1/65536 degree as by an ADC.
+    std::vector<T> values(count);
+    for (std::size_t i = 0; i < count; ++i)
+        values[i] = static_cast<T>(std::round((21.5 + 0.05 * std::sin(i * 1e-5)) * 65536) / 65536);
+    return values;
+}
+
+TEST(XorCodec, RoundTripsDoubles)
+{
+    std::mt19937_64 rng(12345);
+    std::vector<double> values;
+
+    // Random bit patterns, which do not compress, exercise every window shape.
+    for (int i = 0; i < 1000; ++i)
+    {
+        std::uint64_t bits = rng();
+        double value;
+        std::memcpy(&value, &bits, sizeof(value));
+        values.push_back(value);
+    }
+
+    // Repeated values and special values.
+    values.insert(values.end(), 50, 1.0);
+    values.insert(values.end(), {
+        0.0, -0.0, std::numeric_limits<double>::infinity(), -std::numeric_limits<double>::infinity(),
+        std::numeric_limits<double>::quiet_NaN(), std::numeric_limits<double>::denorm_min(),
+        std::numeric_limits<double>::max(), std::numeric_limits<double>::lowest() });
+
+    roundTrip(values);
+}
+
+TEST(XorCodec, RoundTripsFloats)
+{
+    std::mt19937 rng(12345);
+    std::vector<float> values;
+
+    for (int i = 0; i < 1000; ++i)
+    {
+        std::uint32_t bits = static_cast<std::uint32_t>(rng());
+        float value;
+        std::memcpy(&value, &bits, sizeof(value));
+        values.push_back(value);
+    }
+
+    values.insert(values.end(), 50, 1.0f);
+
+    roundTrip(values);
+}
+
+TEST(XorCodec, RoundTripsShortSequences)
+{
+    for (std::size_t count : { 0, 1, 2, 3, 255, 256, 257, 513 })
+    {
+        std::vector<double> values = slowlyVarying<double>(count);
+        roundTrip(values);
+    }
+}
+
+TEST(XorCodec, CompressesSlowlyVaryingSignals)
+{
+    auto doubles = slowlyVarying<double>(100000);
+    EXPECT_LT(roundTrip(doubles) * 5, doubles.size() * sizeof(double));
+
+    // A constant signal takes one bit per value.
+    std::vector<double> constant(80000, 3.25);
+    EXPECT_EQ(roundTrip(constant), sizeof(double) + (constant.size() - 1 + 7) / 8);
+}
+
+TEST(XorCodec, DetectsTruncatedInput)
+{
+    std::mt19937_64 rng(12345);
+    std::vector<double> values(100);
+    for (auto& value : values)
+        value = static_cast<double>(rng() % 1000) / 7;
+
+    auto encoded = encode(values);
+    std::vector<double> decoded(values.size());
+
+    for (std::size_t size = 0; size < encoded.size() - 1; ++size)
+        EXPECT_FALSE(xor_decode<double>(encoded.data(), size, decoded.size(), decoded.data()));
+}